@@ -264,7 +264,7 @@ public:
 
                 // Add the vstream info and data pointer to the HailoRoi for later use (postprocessing)
                 input_buffer->get_roi()->add_tensor(std::make_shared<HailoTensor>(reinterpret_cast<uint8_t *>(tensor_buffer->get_buffer()->get_plane(0)), 
-                                                                                  m_vstream_infos[output.name()]));
+                                                                                  m_vstream_infos[output.name()], tensor_buffer));
             }
 
             std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
@@ -293,6 +293,15 @@ public:
         return AppStatus::SUCCESS;
     }
 
+    /**
+     * @brief Inference results are sent to subscribers from the HailoRT completion callbacks,
+     *        not from the stage's loop thread.
+     */
+    bool sends_from_loop_thread() override
+    {
+        return false;
+    }
+
     /**
      * @brief Process the data in the buffer.
      * 
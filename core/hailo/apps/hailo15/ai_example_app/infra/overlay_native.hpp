@@ -18,6 +18,7 @@
 #include <vector>
 #include "hailo_objects.hpp"
 #include "common/hailomat.hpp"
+#include "worker_pool.hpp"
 #include <opencv2/opencv.hpp>
 #include <algorithm>
 #include "hailo_common.hpp"
@@ -27,11 +28,12 @@ typedef enum
     OVERLAY_STATUS_OK,
 
 } overlay_status_t;
-overlay_status_t draw_all(HailoMat &hmat, HailoROIPtr roi, float landmark_point_radius, bool show_confidence = true, bool local_gallery = false, uint mask_overlay_n_threads = 0);
+overlay_status_t draw_all(HailoMat &hmat, HailoROIPtr roi, float landmark_point_radius, bool show_confidence = true, bool local_gallery = false, uint mask_overlay_n_threads = 0, WorkerPool *mask_workers = nullptr);
 void face_blur(HailoMat &mat, HailoROIPtr roi);
 
 cv::Scalar indexToColor(size_t index);
 #include "overlay/overlay_utils.hpp"
+#include "overlay/mask_compositor.hpp"
 
 #define SPACE " "
 #define TEXT_CLS_FONT_SCALE_FACTOR (0.0025f)
@@ -227,6 +229,42 @@ static overlay_status_t draw_id(HailoMat &mat, HailoUniqueIDPtr &hailo_id, Hailo
     return OVERLAY_STATUS_OK;
 }
 
+/**
+ * @brief gather the masks of a roi and of the detections and tiles inside it into the compositor.
+ *
+ * @param compositor the compositor drawing the masks of the frame
+ * @param image_planes the full resolution plane of the image, mask ROIs are scaled to it
+ * @param roi the region of interest
+ */
+static void collect_masks(MaskCompositor &compositor, cv::Mat &image_planes, HailoROIPtr roi)
+{
+    for (auto obj : roi->get_objects())
+    {
+        switch (obj->get_type())
+        {
+        case HAILO_DETECTION:
+        case HAILO_TILE:
+            collect_masks(compositor, image_planes, std::dynamic_pointer_cast<HailoROI>(obj));
+            break;
+        case HAILO_DEPTH_MASK:
+            compositor.add_depth_mask(std::dynamic_pointer_cast<HailoDepthMask>(obj), roi, image_planes, DEPTH_MIN_DISTANCE, DEPTH_MAX_DISTANCE);
+            break;
+        case HAILO_CLASS_MASK:
+            compositor.add_class_mask(std::dynamic_pointer_cast<HailoClassMask>(obj), roi, image_planes, indexToColor);
+            break;
+        case HAILO_CONF_CLASS_MASK:
+        {
+            HailoConfClassMaskPtr mask = std::dynamic_pointer_cast<HailoConfClassMask>(obj);
+            compositor.add_conf_class_mask(mask, roi, image_planes, indexToColor(mask->get_class_id()));
+            break;
+        }
+        default:
+            // continue
+            break;
+        }
+    }
+}
+
 /**
  * @brief calculate the destionation region of interest and the resized mask
  *
@@ -355,7 +393,7 @@ static overlay_status_t draw_conf_class_mask(cv::Mat &image_planes, HailoConfCla
     return OVERLAY_STATUS_OK;
 }
 
-overlay_status_t draw_all(HailoMat &hmat, HailoROIPtr roi, float landmark_point_radius, bool show_confidence, bool local_gallery, const uint mask_overlay_n_threads)
+static overlay_status_t draw_objects(HailoMat &hmat, HailoROIPtr roi, float landmark_point_radius, bool show_confidence, bool local_gallery, const uint mask_overlay_n_threads, bool draw_masks)
 {
     overlay_status_t ret = OVERLAY_STATUS_UNINITIALIZED;
     uint number_of_classifications = 0;
@@ -394,7 +432,7 @@ overlay_status_t draw_all(HailoMat &hmat, HailoROIPtr roi, float landmark_point_
             hmat.draw_text(text, text_position, font_scale, color);
 
             // Draw inner objects.
-            ret = draw_all(hmat, detection, landmark_point_radius, show_confidence, local_gallery, mask_overlay_n_threads);
+            ret = draw_objects(hmat, detection, landmark_point_radius, show_confidence, local_gallery, mask_overlay_n_threads, draw_masks);
             break;
         }
         case HAILO_CLASSIFICATION:
@@ -428,7 +466,7 @@ overlay_status_t draw_all(HailoMat &hmat, HailoROIPtr roi, float landmark_point_
         {
             HailoTileROIPtr tile = std::dynamic_pointer_cast<HailoTileROI>(obj);
             draw_tile(hmat, tile);
-            draw_all(hmat, tile, landmark_point_radius, show_confidence, local_gallery, mask_overlay_n_threads);
+            draw_objects(hmat, tile, landmark_point_radius, show_confidence, local_gallery, mask_overlay_n_threads, draw_masks);
             break;
         }
         case HAILO_UNIQUE_ID:
@@ -440,18 +478,24 @@ overlay_status_t draw_all(HailoMat &hmat, HailoROIPtr roi, float landmark_point_
         }
         case HAILO_DEPTH_MASK:
         {
+            if (!draw_masks)
+                break;
             HailoDepthMaskPtr mask = std::dynamic_pointer_cast<HailoDepthMask>(obj);
             draw_depth_mask(mat, mask, roi, mask_overlay_n_threads);
             break;
         }
         case HAILO_CLASS_MASK:
         {
+            if (!draw_masks)
+                break;
             HailoClassMaskPtr mask = std::dynamic_pointer_cast<HailoClassMask>(obj);
             draw_class_mask(mat, mask, roi, mask_overlay_n_threads);
             break;
         }
         case HAILO_CONF_CLASS_MASK:
         {
+            if (!draw_masks)
+                break;
             HailoConfClassMaskPtr mask = std::dynamic_pointer_cast<HailoConfClassMask>(obj);
             draw_conf_class_mask(mat, mask, roi, mask_overlay_n_threads);
             break;
@@ -465,6 +509,20 @@ overlay_status_t draw_all(HailoMat &hmat, HailoROIPtr roi, float landmark_point_
     return ret;
 }
 
+overlay_status_t draw_all(HailoMat &hmat, HailoROIPtr roi, float landmark_point_radius, bool show_confidence, bool local_gallery, const uint mask_overlay_n_threads, WorkerPool *mask_workers)
+{
+    // Masks are drawn one by one as they are found in the roi tree
+    if (!mask_workers)
+        return draw_objects(hmat, roi, landmark_point_radius, show_confidence, local_gallery, mask_overlay_n_threads, true);
+
+    // All the masks of the frame are drawn in one pass, under the boxes and text
+    MaskCompositor compositor;
+    collect_masks(compositor, hmat.get_matrices()[0], roi);
+    compositor.composite(hmat, mask_workers);
+
+    return draw_objects(hmat, roi, landmark_point_radius, show_confidence, local_gallery, mask_overlay_n_threads, false);
+}
+
 void face_blur(HailoMat &hmat, HailoROIPtr roi)
 {
     for (auto detection : hailo_common::get_hailo_detections(roi))
@@ -18,6 +18,8 @@ struct HailoOverlay
     bool show_confidence;               /**< Enable or disable confidence display. */
     bool local_gallery;                 /**< Enable or disable local gallery usage. */
     uint mask_overlay_n_threads;        /**< Number of threads for mask overlay. */
+    bool mask_compositor;               /**< Composite all the masks of a frame in one pass, under the boxes and text. */
+    bool text_atlas;                    /**< Draw text from cached glyph atlases instead of cv::putText. */
 };
 
 /**
@@ -28,6 +30,7 @@ class OverlayStage : public ConnectedStage
 {
 private:
     HailoOverlay m_hailooverlay_info;   /**< Overlay configuration parameters. */
+    std::unique_ptr<WorkerPool> m_mask_workers; /**< Threads compositing the masks of a frame, only with mask_compositor. */
     
 public:
     /**
@@ -54,6 +57,10 @@ public:
         m_hailooverlay_info.local_gallery = false;
         m_hailooverlay_info.landmark_point_radius = 3;
         m_hailooverlay_info.mask_overlay_n_threads = 0;
+        m_hailooverlay_info.text_atlas = true;
+        m_hailooverlay_info.mask_compositor = false;
+        if (m_hailooverlay_info.mask_compositor)
+            m_mask_workers = std::make_unique<WorkerPool>(m_hailooverlay_info.mask_overlay_n_threads);
         return AppStatus::SUCCESS;
     }
 
@@ -63,6 +70,7 @@ public:
      */
     AppStatus deinit() override
     {
+        m_mask_workers.reset();
         return AppStatus::SUCCESS;
     }
 
@@ -88,6 +96,8 @@ public:
 
         if (hmat)
         {
+            if (m_hailooverlay_info.text_atlas)
+                hmat->set_text_renderer(&TextRenderer::shared());
             if (DmaMemoryAllocator::get_instance().dmabuf_sync_start(data->get_buffer()->get_plane(0)) != MEDIA_LIBRARY_SUCCESS)
                     return AppStatus::DMA_ERROR;
             if (DmaMemoryAllocator::get_instance().dmabuf_sync_start(data->get_buffer()->get_plane(1)) != MEDIA_LIBRARY_SUCCESS)
@@ -98,7 +108,7 @@ public:
                 face_blur(*hmat.get(), data->get_roi());
             }
             // Draw all results of the given roi on mat.
-            ret = draw_all(*hmat.get(), data->get_roi(), m_hailooverlay_info.landmark_point_radius, m_hailooverlay_info.show_confidence, m_hailooverlay_info.local_gallery, m_hailooverlay_info.mask_overlay_n_threads);
+            ret = draw_all(*hmat.get(), data->get_roi(), m_hailooverlay_info.landmark_point_radius, m_hailooverlay_info.show_confidence, m_hailooverlay_info.local_gallery, m_hailooverlay_info.mask_overlay_n_threads, m_mask_workers.get());
             if (ret != OVERLAY_STATUS_OK)
             {
                 std::cerr << " Overlay failure draw_all failed, status = " << ret << std::endl;
@@ -1,39 +1,254 @@
 #pragma once
 
 // General includes
-#include <queue>
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <condition_variable>
+#include <vector>
 
 // Infra includes
 #include "buffer.hpp"
 
+// Rounds spent spinning on an empty / full queue before parking the thread
+#define QUEUE_SPIN_ROUNDS (64)
+#define QUEUE_YIELD_ROUNDS (16)
+
+/**
+ * @brief Bounded ring buffer for a single producer and a single consumer.
+ *        Each side only writes its own index, so no slot is ever contended.
+ */
+class SpscRing
+{
+private:
+    std::vector<BufferPtr> m_slots;
+    const size_t m_capacity;
+    alignas(64) std::atomic<size_t> m_head{0}; // next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> m_tail{0}; // next slot to push, written by the producer
+
+public:
+    explicit SpscRing(size_t capacity) : m_slots(capacity), m_capacity(capacity) {}
+
+    bool try_push(BufferPtr &buffer)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= m_capacity)
+            return false;
+        m_slots[tail % m_capacity] = std::move(buffer);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(BufferPtr &buffer)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        buffer = std::move(m_slots[head % m_capacity]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const
+    {
+        size_t head = m_head.load(std::memory_order_acquire);
+        return m_tail.load(std::memory_order_acquire) - head;
+    }
+};
+
+/**
+ * @brief Bounded ring buffer for any number of producers and consumers.
+ *        Every slot carries a sequence number telling whether it is ready to be written or read
+ *        for a given lap, producers and consumers claim slots with a CAS on their index.
+ */
+class MpmcRing
+{
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        BufferPtr buffer;
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    const size_t m_capacity;
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+
+public:
+    explicit MpmcRing(size_t capacity) : m_slots(new Slot[capacity]), m_capacity(capacity)
+    {
+        for (size_t i = 0; i < capacity; i++)
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool try_push(BufferPtr &buffer)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = m_slots[tail % m_capacity];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == tail)
+            {
+                if (m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+                {
+                    slot.buffer = std::move(buffer);
+                    slot.sequence.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < tail)
+            {
+                // The slot still holds the previous lap's buffer, the ring is full
+                return false;
+            }
+            else
+            {
+                tail = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(BufferPtr &buffer)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = m_slots[head % m_capacity];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == head + 1)
+            {
+                if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed))
+                {
+                    buffer = std::move(slot.buffer);
+                    slot.sequence.store(head + m_capacity, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < head + 1)
+            {
+                // Nothing was written to the slot for this lap yet, the ring is empty
+                return false;
+            }
+            else
+            {
+                head = m_head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        size_t head = m_head.load(std::memory_order_acquire);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+};
+
+/**
+ * @brief Spin-then-park wait used by the queue on both of its sides.
+ *        A waiter spins for a short while, then yields, and only then sleeps on the condition variable.
+ *        Wakers only touch the mutex when someone is actually parked.
+ */
+class QueueWaiter
+{
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_condvar;
+    std::atomic<int> m_parked{0};
+
+public:
+    template <typename Predicate>
+    void wait(Predicate ready)
+    {
+        for (int i = 0; i < QUEUE_SPIN_ROUNDS; i++)
+        {
+            if (ready())
+                return;
+        }
+        for (int i = 0; i < QUEUE_YIELD_ROUNDS; i++)
+        {
+            if (ready())
+                return;
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // Pairs with the read-modify-write in notify, either the waker sees us parked or we see its update
+        m_parked.fetch_add(1, std::memory_order_seq_cst);
+        m_condvar.wait(lock, ready);
+        m_parked.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void notify_one()
+    {
+        if (m_parked.fetch_add(0, std::memory_order_seq_cst) == 0)
+            return;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_condvar.notify_one();
+    }
+
+    void notify_all()
+    {
+        if (m_parked.fetch_add(0, std::memory_order_seq_cst) == 0)
+            return;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_condvar.notify_all();
+    }
+};
+
+/**
+ * @brief Bounded queue of buffers between stages.
+ *        A queue fed by a single thread that never drops buffers uses the SPSC ring,
+ *        anything else (several pushing threads, or a leaky queue where the producer also pops to drop the oldest buffer)
+ *        uses the MPMC ring.
+ */
 class Queue
 {
 private:
-    std::queue<BufferPtr> m_queue;
     size_t m_max_buffers;
     bool m_leaky;
     std::string m_name;
-    bool m_flushing;
-    std::unique_ptr<std::condition_variable> m_condvar;
-    std::shared_ptr<std::mutex> m_mutex;
-    uint64_t m_drop_count = 0, m_push_count = 0;
+    std::atomic<bool> m_flushing;
+    std::unique_ptr<SpscRing> m_spsc;
+    std::unique_ptr<MpmcRing> m_mpmc;
+    QueueWaiter m_not_empty;
+    QueueWaiter m_not_full;
+    std::atomic<uint64_t> m_drop_count{0}, m_push_count{0};
+
+    bool try_push(BufferPtr &buffer)
+    {
+        return m_spsc ? m_spsc->try_push(buffer) : m_mpmc->try_push(buffer);
+    }
+
+    bool try_pop(BufferPtr &buffer)
+    {
+        return m_spsc ? m_spsc->try_pop(buffer) : m_mpmc->try_pop(buffer);
+    }
+
+    void drain()
+    {
+        BufferPtr buffer;
+        while (try_pop(buffer))
+            buffer = nullptr;
+    }
 
 public:
-    Queue(std::string name, size_t max_buffers, bool leaky=false)
-        : m_max_buffers(max_buffers), m_leaky(leaky), m_name(name), m_flushing(false) 
+    Queue(std::string name, size_t max_buffers, bool leaky=false, bool single_producer=false)
+        : m_max_buffers(max_buffers), m_leaky(leaky), m_name(name), m_flushing(false)
     {
-        m_mutex = std::make_shared<std::mutex>();
-        m_condvar = std::make_unique<std::condition_variable>();
-        m_queue = std::queue<BufferPtr>();
+        if (m_max_buffers == 0)
+            m_max_buffers = 1;
+        if (single_producer && !leaky)
+            m_spsc = std::make_unique<SpscRing>(m_max_buffers);
+        else
+            m_mpmc = std::make_unique<MpmcRing>(m_max_buffers);
     }
 
     ~Queue()
     {
-        m_flushing = true;
-        m_condvar->notify_all();
         flush();
     }
 
@@ -44,60 +259,75 @@ public:
 
     int size()
     {
-        std::unique_lock<std::mutex> lock(*(m_mutex));
-        return m_queue.size();
+        return m_spsc ? m_spsc->size() : m_mpmc->size();
+    }
+
+    uint64_t drop_count()
+    {
+        return m_drop_count.load(std::memory_order_relaxed);
+    }
+
+    uint64_t push_count()
+    {
+        return m_push_count.load(std::memory_order_relaxed);
     }
 
     void push(BufferPtr buffer)
     {
-        std::unique_lock<std::mutex> lock(*(m_mutex));
         if (!m_leaky)
         {
             // if not leaky, then wait until there is space in the queue
-            m_condvar->wait(lock, [this]
-                            { return m_queue.size() < m_max_buffers; });
-        } 
-        else 
+            bool pushed = try_push(buffer);
+            if (!pushed)
+                m_not_full.wait([this, &buffer, &pushed]
+                                { return (pushed = try_push(buffer)) || m_flushing.load(std::memory_order_acquire); });
+            if (!pushed)
+            {
+                // flushing, nobody is going to pop this buffer
+                m_drop_count.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        else
         {
             // if leaky, pop the front for a full queue
-            if(m_queue.size() >= m_max_buffers)
+            while (!try_push(buffer))
             {
-                m_queue.pop();
-                m_drop_count++;
+                BufferPtr dropped;
+                if (try_pop(dropped))
+                    m_drop_count.fetch_add(1, std::memory_order_relaxed);
             }
         }
-        m_queue.push(buffer);
-        m_push_count++;
-        m_condvar->notify_one();
+        m_push_count.fetch_add(1, std::memory_order_relaxed);
+        m_not_empty.notify_one();
     }
 
     BufferPtr pop()
     {
-        std::unique_lock<std::mutex> lock(*(m_mutex));
+        BufferPtr buffer;
         // wait for there to be something in the queue to pull
-        m_condvar->wait(lock, [this]
-                            { return !m_queue.empty() || m_flushing; });
-        if (m_queue.empty())
+        m_not_empty.wait([this, &buffer]
+                         { return m_flushing.load(std::memory_order_acquire) || try_pop(buffer); });
+        if (buffer == nullptr)
         {
-            // if we reachied here, then the queue is empty and we are flushing
+            // if we reached here, then we are flushing. The consumer drains the SPSC ring itself,
+            // it is the only thread allowed to pop from it
+            drain();
+            m_not_full.notify_all();
             return nullptr;
         }
-        BufferPtr buffer = m_queue.front();
-        m_queue.pop();
-        m_condvar->notify_one();
+        m_not_full.notify_one();
         return buffer;
     }
 
     void flush()
     {
-        std::unique_lock<std::mutex> lock(*(m_mutex));
-        m_flushing = true;
-        while (!m_queue.empty())
-        {
-            m_queue.pop();
-        }
-        m_condvar->notify_all();
+        m_flushing.store(true, std::memory_order_seq_cst);
+        if (m_mpmc)
+            drain();
+        m_not_empty.notify_all();
+        m_not_full.notify_all();
     }
 
 };
-using QueuePtr = std::shared_ptr<Queue>;
\ No newline at end of file
+using QueuePtr = std::shared_ptr<Queue>;
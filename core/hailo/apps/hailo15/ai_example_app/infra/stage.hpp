@@ -90,10 +90,15 @@ public:
         return AppStatus::SUCCESS;
     }
 
-    virtual void add_queue(std::string name){};
+    virtual size_t add_queue(std::string name, bool single_producer=false)
+    {
+        return 0;
+    };
 
     virtual void push(BufferPtr buffer, std::string caller_name){};
 
+    virtual void push(BufferPtr buffer, size_t queue_index){};
+
     virtual void loop(){};
 
     virtual AppStatus process(BufferPtr buffer)
@@ -149,6 +154,7 @@ protected:
     bool m_leaky;
     std::vector<QueuePtr> m_queues;
     std::vector<ConnectedStagePtr> m_subscribers;
+    std::vector<size_t> m_subscriber_queues; // index of our queue in each subscriber, resolved at connect time
 
 public:
     ConnectedStage(std::string name, size_t queue_size, bool leaky=false, bool print_fps=false) :
@@ -156,28 +162,42 @@ public:
     {
     }
 
-    void add_queue(std::string name) override
+    /**
+     * @brief Whether buffers are sent to subscribers only from the stage's own loop thread.
+     *        Subscribers then give this stage a single producer (SPSC) queue.
+     */
+    virtual bool sends_from_loop_thread()
+    {
+        return true;
+    }
+
+    size_t add_queue(std::string name, bool single_producer=false) override
     {
-        m_queues.push_back(std::make_shared<Queue>(name, m_queue_size, m_leaky));
+        m_queues.push_back(std::make_shared<Queue>(name, m_queue_size, m_leaky, single_producer));
+        return m_queues.size() - 1;
     }
 
     void add_subscriber(ConnectedStagePtr subscriber)
     {
         m_subscribers.push_back(subscriber);
-        subscriber->add_queue(m_stage_name);
+        m_subscriber_queues.push_back(subscriber->add_queue(m_stage_name, sends_from_loop_thread()));
     }
 
     void push(BufferPtr data, std::string caller_name) override
     {
-        for (auto &queue : m_queues)
+        for (size_t i = 0; i < m_queues.size(); i++)
         {
-            if (queue->name() == caller_name)
+            if (m_queues[i]->name() == caller_name)
             {
-                queue->push(data);
+                push(data, i);
                 break;
             }
         }
-        m_condvar->notify_one();
+    }
+
+    void push(BufferPtr data, size_t queue_index) override
+    {
+        m_queues[queue_index]->push(data);
     }
 
     void set_end_of_stream(bool end_of_stream)
@@ -194,19 +214,19 @@ public:
 
     void send_to_subscribers(BufferPtr data)
     {
-        for (auto &subscriber : m_subscribers)
+        for (size_t i = 0; i < m_subscribers.size(); i++)
         {
-            subscriber->push(data, m_stage_name);
+            m_subscribers[i]->push(data, m_subscriber_queues[i]);
         }
     }
 
     void send_to_specific_subsciber(std::string stage_name, BufferPtr data)
     {
-        for (auto &subscriber : m_subscribers)
+        for (size_t i = 0; i < m_subscribers.size(); i++)
         {
-            if (stage_name == subscriber->get_name())
+            if (stage_name == m_subscribers[i]->get_name())
             {
-                subscriber->push(data, m_stage_name);
+                m_subscribers[i]->push(data, m_subscriber_queues[i]);
             }
         } 
     }
@@ -30,6 +30,7 @@ public:
         m_tracker_params.std_weight_velocity_box = DEFAULT_STD_WEIGHT_VELOCITY_BOX;
         m_tracker_params.debug = DEFAULT_DEBUG;
         m_tracker_params.hailo_objects_blacklist = DEFAULT_HAILO_OBJECTS_BLACKLIST;
+        m_tracker_params.assignment_solver = DEFAULT_ASSIGNMENT_SOLVER;
         return AppStatus::SUCCESS;
     }
 
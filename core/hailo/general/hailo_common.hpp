@@ -8,6 +8,7 @@
 
 #pragma once
 #include "hailo_objects.hpp"
+#include "hailo_object_pool.hpp"
 // #include <stdlib.h>
 // #include <string>
 // #include <cstring>
@@ -43,12 +44,12 @@ namespace hailo_common
     inline void add_classification(HailoROIPtr roi, std::string type, std::string label, float confidence, int class_id = NULL_CLASS_ID)
     {
         add_object(roi,
-                   std::make_shared<HailoClassification>(type, class_id, label, confidence));
+                   hailo_object_pool::make_pooled<HailoClassification>(type, class_id, label, confidence));
     }
 
     inline HailoDetectionPtr add_detection(HailoROIPtr roi, HailoBBox bbox, std::string label, float confidence, int class_id = NULL_CLASS_ID)
     {
-        HailoDetectionPtr detection = std::make_shared<HailoDetection>(bbox, class_id, label, confidence);
+        HailoDetectionPtr detection = hailo_object_pool::make_pooled<HailoDetection>(bbox, class_id, label, confidence);
         detection->set_scaling_bbox(roi->get_bbox());
         add_object(roi, detection);
         return detection;
@@ -58,7 +59,7 @@ namespace hailo_common
     {
         for (auto det : detections)
         {
-            add_object(roi, std::make_shared<HailoDetection>(det));
+            add_object(roi, hailo_object_pool::make_pooled<HailoDetection>(det));
         }
     }
 
@@ -71,12 +72,22 @@ namespace hailo_common
         }
     }
 
+    /**
+     * @brief Remove several objects from a ROI in a single pass over its objects, each one looked up in the sorted list to remove.
+     *
+     * @param roi  -  HailoROIPtr
+     *        The ROI to remove the objects from.
+     *
+     * @param objects  -  std::vector<HailoObjectPtr>
+     *        The objects to remove.
+     */
     inline void remove_objects(HailoROIPtr roi, std::vector<HailoObjectPtr> objects)
     {
-        for (HailoObjectPtr obj : objects)
-        {
-            roi->remove_object(obj);
-        }
+        if (objects.empty())
+            return;
+        std::sort(objects.begin(), objects.end());
+        roi->remove_objects_if([&objects](const HailoObjectPtr &obj)
+                               { return std::binary_search(objects.begin(), objects.end(), obj); });
     }
 
     inline void remove_detections(HailoROIPtr roi, std::vector<HailoDetectionPtr> objects)
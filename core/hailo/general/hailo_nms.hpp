@@ -0,0 +1,411 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file hailo_nms.hpp
+ * @authors Hailo
+ *
+ * Allocation free NMS engine working on a structure-of-arrays box buffer.
+ * Boxes are bucketed per class, each bucket is swept in xmin order so a kept box is only
+ * compared against the boxes that can possibly reach the IOU threshold, and the IOU of one box
+ * against a run of boxes is computed with SSE2 / NEON kernels (scalar fallback elsewhere).
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "hailo_objects.hpp"
+
+#include "hailo_simd.hpp"
+
+namespace hailo_nms
+{
+    /**
+     * @brief Structure-of-arrays buffer of boxes to run NMS on.
+     *        Buffers keep their capacity between frames, so a buffer that is reused
+     *        (e.g. a thread_local one) does not allocate once it reached its working size.
+     */
+    struct BoxBuffer
+    {
+        std::vector<float> xmin;
+        std::vector<float> ymin;
+        std::vector<float> xmax;
+        std::vector<float> ymax;
+        std::vector<float> score;
+        std::vector<int> class_id;
+
+        size_t size() const { return score.size(); }
+        bool empty() const { return score.empty(); }
+
+        void clear()
+        {
+            xmin.clear();
+            ymin.clear();
+            xmax.clear();
+            ymax.clear();
+            score.clear();
+            class_id.clear();
+        }
+
+        void reserve(size_t capacity)
+        {
+            xmin.reserve(capacity);
+            ymin.reserve(capacity);
+            xmax.reserve(capacity);
+            ymax.reserve(capacity);
+            score.reserve(capacity);
+            class_id.reserve(capacity);
+        }
+
+        void push_back(float box_xmin, float box_ymin, float box_xmax, float box_ymax, float box_score, int box_class_id)
+        {
+            xmin.push_back(box_xmin);
+            ymin.push_back(box_ymin);
+            xmax.push_back(box_xmax);
+            ymax.push_back(box_ymax);
+            score.push_back(box_score);
+            class_id.push_back(box_class_id);
+        }
+
+        void push_back(const HailoBBox &bbox, float box_score, int box_class_id)
+        {
+            push_back(bbox.xmin(), bbox.ymin(), bbox.xmax(), bbox.ymax(), box_score, box_class_id);
+        }
+    };
+
+    /**
+     * @brief Parameters of a single NMS run.
+     *
+     * @param iou_threshold  Boxes with IOU >= iou_threshold against a higher scored box are suppressed.
+     * @param cross_classes  If true, then apply NMS regardless of class differences.
+     * @param top_k  Stop once top_k boxes were kept (0 keeps all surviving boxes).
+     */
+    struct NmsConfig
+    {
+        float iou_threshold;
+        bool cross_classes = false;
+        size_t top_k = 0;
+    };
+
+    /**
+     * @brief Calculate IOU between two boxes given by their corners.
+     */
+    inline float iou(float xmin_1, float ymin_1, float xmax_1, float ymax_1,
+                     float xmin_2, float ymin_2, float xmax_2, float ymax_2)
+    {
+        const float overlap_width = std::max(std::min(xmax_1, xmax_2) - std::max(xmin_1, xmin_2), 0.0f);
+        const float overlap_height = std::max(std::min(ymax_1, ymax_2) - std::max(ymin_1, ymin_2), 0.0f);
+        const float area_of_overlap = overlap_width * overlap_height;
+        const float box_1_area = (ymax_1 - ymin_1) * (xmax_1 - xmin_1);
+        const float box_2_area = (ymax_2 - ymin_2) * (xmax_2 - xmin_2);
+        return area_of_overlap / (box_1_area + box_2_area - area_of_overlap);
+    }
+
+    inline float iou(const HailoBBox &box_1, const HailoBBox &box_2)
+    {
+        return iou(box_1.xmin(), box_1.ymin(), box_1.xmax(), box_1.ymax(),
+                   box_2.xmin(), box_2.ymin(), box_2.xmax(), box_2.ymax());
+    }
+
+    class NmsEngine
+    {
+    private:
+        // Candidates gathered per class bucket, ordered by xmin inside each bucket.
+        std::vector<float> m_xmin;
+        std::vector<float> m_ymin;
+        std::vector<float> m_xmax;
+        std::vector<float> m_ymax;
+        std::vector<float> m_area;
+        std::vector<uint8_t> m_suppressed;
+        std::vector<uint32_t> m_sweep_to_input; // sweep position -> index in the input buffer
+        std::vector<uint32_t> m_input_to_sweep; // index in the input buffer -> sweep position
+        std::vector<uint32_t> m_bucket_of;      // sweep position -> bucket id
+        std::vector<uint32_t> m_bucket_begin;   // bucket id -> first sweep position
+        std::vector<uint32_t> m_score_order;    // input indices ordered by descending score
+        std::vector<uint32_t> m_class_index;    // input index -> bucket id
+        std::vector<int> m_class_ids;           // bucket id -> class id
+        std::vector<uint32_t> m_keep;
+
+        /**
+         * @brief Mark every box in [begin, end) whose IOU against (x0, y0, x1, y1, area) reaches the threshold.
+         */
+        void suppress_range(float x0, float y0, float x1, float y1, float area,
+                            uint32_t begin, uint32_t end, float iou_threshold)
+        {
+            const float *__restrict__ xmin = m_xmin.data();
+            const float *__restrict__ ymin = m_ymin.data();
+            const float *__restrict__ xmax = m_xmax.data();
+            const float *__restrict__ ymax = m_ymax.data();
+            const float *__restrict__ areas = m_area.data();
+            uint8_t *__restrict__ suppressed = m_suppressed.data();
+            uint32_t j = begin;
+#if defined(HAILO_SIMD_SSE2)
+            const __m128 v_x0 = _mm_set1_ps(x0), v_y0 = _mm_set1_ps(y0);
+            const __m128 v_x1 = _mm_set1_ps(x1), v_y1 = _mm_set1_ps(y1);
+            const __m128 v_area = _mm_set1_ps(area), v_thr = _mm_set1_ps(iou_threshold);
+            const __m128 v_zero = _mm_setzero_ps();
+            for (; j + 4 <= end; j += 4)
+            {
+                __m128 w = _mm_sub_ps(_mm_min_ps(v_x1, _mm_loadu_ps(xmax + j)), _mm_max_ps(v_x0, _mm_loadu_ps(xmin + j)));
+                __m128 h = _mm_sub_ps(_mm_min_ps(v_y1, _mm_loadu_ps(ymax + j)), _mm_max_ps(v_y0, _mm_loadu_ps(ymin + j)));
+                __m128 overlap = _mm_mul_ps(_mm_max_ps(w, v_zero), _mm_max_ps(h, v_zero));
+                __m128 iou = _mm_div_ps(overlap, _mm_sub_ps(_mm_add_ps(v_area, _mm_loadu_ps(areas + j)), overlap));
+                int mask = _mm_movemask_ps(_mm_cmpge_ps(iou, v_thr));
+                suppressed[j] |= (mask & 1);
+                suppressed[j + 1] |= (mask >> 1) & 1;
+                suppressed[j + 2] |= (mask >> 2) & 1;
+                suppressed[j + 3] |= (mask >> 3) & 1;
+            }
+#elif defined(HAILO_SIMD_NEON)
+            const float32x4_t v_x0 = vdupq_n_f32(x0), v_y0 = vdupq_n_f32(y0);
+            const float32x4_t v_x1 = vdupq_n_f32(x1), v_y1 = vdupq_n_f32(y1);
+            const float32x4_t v_area = vdupq_n_f32(area), v_thr = vdupq_n_f32(iou_threshold);
+            const float32x4_t v_zero = vdupq_n_f32(0.0f);
+            for (; j + 4 <= end; j += 4)
+            {
+                float32x4_t w = vsubq_f32(vminq_f32(v_x1, vld1q_f32(xmax + j)), vmaxq_f32(v_x0, vld1q_f32(xmin + j)));
+                float32x4_t h = vsubq_f32(vminq_f32(v_y1, vld1q_f32(ymax + j)), vmaxq_f32(v_y0, vld1q_f32(ymin + j)));
+                float32x4_t overlap = vmulq_f32(vmaxq_f32(w, v_zero), vmaxq_f32(h, v_zero));
+                float32x4_t iou = vdivq_f32(overlap, vsubq_f32(vaddq_f32(v_area, vld1q_f32(areas + j)), overlap));
+                uint32x4_t mask = vcgeq_f32(iou, v_thr);
+                suppressed[j] |= vgetq_lane_u32(mask, 0) & 1;
+                suppressed[j + 1] |= vgetq_lane_u32(mask, 1) & 1;
+                suppressed[j + 2] |= vgetq_lane_u32(mask, 2) & 1;
+                suppressed[j + 3] |= vgetq_lane_u32(mask, 3) & 1;
+            }
+#endif
+            for (; j < end; j++)
+            {
+                const float w = std::max(std::min(x1, xmax[j]) - std::max(x0, xmin[j]), 0.0f);
+                const float h = std::max(std::min(y1, ymax[j]) - std::max(y0, ymin[j]), 0.0f);
+                const float overlap = w * h;
+                suppressed[j] |= (overlap / (area + areas[j] - overlap)) >= iou_threshold;
+            }
+        }
+
+        void bucket_by_class(const BoxBuffer &boxes, bool cross_classes)
+        {
+            const size_t count = boxes.size();
+            m_class_index.resize(count);
+            m_class_ids.clear();
+            m_bucket_begin.clear();
+            if (cross_classes)
+            {
+                std::fill(m_class_index.begin(), m_class_index.end(), 0);
+                m_bucket_begin.push_back(0);
+            }
+            else
+            {
+                // Classes are small dense ids, a linear lookup over the (few) distinct ids is cheaper than a map.
+                for (size_t i = 0; i < count; i++)
+                {
+                    auto it = std::find(m_class_ids.begin(), m_class_ids.end(), boxes.class_id[i]);
+                    if (it == m_class_ids.end())
+                    {
+                        m_class_ids.push_back(boxes.class_id[i]);
+                        m_bucket_begin.push_back(0);
+                        it = m_class_ids.end() - 1;
+                    }
+                    m_class_index[i] = it - m_class_ids.begin();
+                    m_bucket_begin[m_class_index[i]]++;
+                }
+                // Turn the bucket sizes into bucket start offsets
+                uint32_t offset = 0;
+                for (auto &bucket : m_bucket_begin)
+                {
+                    uint32_t bucket_size = bucket;
+                    bucket = offset;
+                    offset += bucket_size;
+                }
+            }
+            m_bucket_begin.push_back(count);
+        }
+
+    public:
+        /**
+         * @brief Run greedy IOU based NMS.
+         *
+         * @param boxes  -  BoxBuffer
+         *        The candidate boxes.
+         *
+         * @param config  -  NmsConfig
+         *        NMS parameters.
+         *
+         * @return const std::vector<uint32_t>& - Indices (into boxes) of the kept boxes, ordered by descending score.
+         *         The vector is owned by the engine and is valid until the next call to run().
+         */
+        const std::vector<uint32_t> &run(const BoxBuffer &boxes, const NmsConfig &config)
+        {
+            const uint32_t count = boxes.size();
+            m_keep.clear();
+            if (count == 0)
+                return m_keep;
+
+            // Rank all boxes by descending score, ties are broken by input order to keep results deterministic.
+            m_score_order.resize(count);
+            for (uint32_t i = 0; i < count; i++)
+                m_score_order[i] = i;
+            const float *scores = boxes.score.data();
+            std::sort(m_score_order.begin(), m_score_order.end(),
+                      [scores](uint32_t a, uint32_t b)
+                      { return scores[a] > scores[b] || (scores[a] == scores[b] && a < b); });
+
+            // Gather the boxes into per class buckets, each bucket sorted by xmin.
+            bucket_by_class(boxes, config.cross_classes);
+            const uint32_t num_buckets = m_bucket_begin.size() - 1;
+            m_sweep_to_input.resize(count);
+            m_bucket_of.resize(count);
+            {
+                m_input_to_sweep.assign(m_bucket_begin.begin(), m_bucket_begin.end() - 1); // used as insert cursors
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    uint32_t bucket = m_class_index[i];
+                    uint32_t position = m_input_to_sweep[bucket]++;
+                    m_sweep_to_input[position] = i;
+                    m_bucket_of[position] = bucket;
+                }
+            }
+            const float *xmin = boxes.xmin.data();
+            for (uint32_t bucket = 0; bucket < num_buckets; bucket++)
+            {
+                std::sort(m_sweep_to_input.begin() + m_bucket_begin[bucket], m_sweep_to_input.begin() + m_bucket_begin[bucket + 1],
+                          [xmin](uint32_t a, uint32_t b)
+                          { return xmin[a] < xmin[b]; });
+            }
+            m_input_to_sweep.resize(count);
+            m_xmin.resize(count);
+            m_ymin.resize(count);
+            m_xmax.resize(count);
+            m_ymax.resize(count);
+            m_area.resize(count);
+            for (uint32_t position = 0; position < count; position++)
+            {
+                const uint32_t i = m_sweep_to_input[position];
+                m_input_to_sweep[i] = position;
+                m_xmin[position] = boxes.xmin[i];
+                m_ymin[position] = boxes.ymin[i];
+                m_xmax[position] = boxes.xmax[i];
+                m_ymax[position] = boxes.ymax[i];
+                m_area[position] = (m_ymax[position] - m_ymin[position]) * (m_xmax[position] - m_xmin[position]);
+            }
+            m_suppressed.assign(count, 0);
+
+            // A box j can only reach IOU >= thr against box i if it overlaps i on the x axis and
+            // width(j) <= width(i) / thr, so its xmin lies in (xmin(i) - width(i) / thr, xmax(i)).
+            const bool sweep = config.iou_threshold > 0.0f;
+            for (uint32_t rank = 0; rank < count; rank++)
+            {
+                const uint32_t i = m_score_order[rank];
+                const uint32_t position = m_input_to_sweep[i];
+                if (m_suppressed[position])
+                    continue;
+                m_keep.push_back(i);
+                if (config.top_k != 0 && m_keep.size() >= config.top_k)
+                    break;
+
+                const uint32_t bucket = m_bucket_of[position];
+                auto bucket_first = m_xmin.begin() + m_bucket_begin[bucket];
+                auto bucket_last = m_xmin.begin() + m_bucket_begin[bucket + 1];
+                const float x0 = m_xmin[position], y0 = m_ymin[position];
+                const float x1 = m_xmax[position], y1 = m_ymax[position];
+                uint32_t begin = m_bucket_begin[bucket];
+                uint32_t end = m_bucket_begin[bucket + 1];
+                if (sweep)
+                {
+                    // Slightly widen the window so float rounding never drops a borderline box
+                    const float reach = (x1 - x0) / config.iou_threshold * 1.001f;
+                    begin = std::upper_bound(bucket_first, bucket_last, x0 - reach) - m_xmin.begin();
+                    end = std::lower_bound(bucket_first, bucket_last, x1) - m_xmin.begin();
+                }
+                // A kept box never reaches the threshold against another kept box, so it is safe to
+                // mark the whole window - the box itself is already kept and will not be visited again.
+                suppress_range(x0, y0, x1, y1, m_area[position], begin, end, config.iou_threshold);
+            }
+            return m_keep;
+        }
+    };
+
+    /**
+     * @brief Perform IOU based NMS in place on a vector of detection-like objects.
+     *        The surviving objects are moved to the front of the vector ordered by descending
+     *        confidence, and the rest are erased.
+     *        Objects with 0 confidence are treated as already suppressed.
+     *
+     * @param objects  -  std::vector<T>
+     *        The objects to perform NMS on.
+     *
+     * @param config  -  NmsConfig
+     *        NMS parameters.
+     *
+     * @param get_detection  -  callable
+     *        Returns the HailoDetection & that holds the bbox, confidence and class id of an object.
+     */
+    template <typename T, typename GetDetection>
+    void nms(std::vector<T> &objects, const NmsConfig &config, GetDetection get_detection)
+    {
+        static thread_local BoxBuffer boxes;
+        static thread_local NmsEngine engine;
+        static thread_local std::vector<uint32_t> candidates;
+        static thread_local std::vector<uint32_t> position_of;
+        static thread_local std::vector<uint32_t> original_at;
+
+        boxes.clear();
+        candidates.clear();
+        boxes.reserve(objects.size());
+        for (uint32_t index = 0; index < objects.size(); index++)
+        {
+            HailoDetection &detection = get_detection(objects[index]);
+            float confidence = detection.get_confidence();
+            if (confidence == 0.0f)
+                continue;
+            boxes.push_back(detection.get_bbox(), confidence, detection.get_class_id());
+            candidates.push_back(index);
+        }
+        const std::vector<uint32_t> &keep = engine.run(boxes, config);
+
+        // Permute the kept objects to the front of the vector (in score order) without copying the rest.
+        position_of.resize(objects.size());
+        original_at.resize(objects.size());
+        for (uint32_t index = 0; index < objects.size(); index++)
+        {
+            position_of[index] = index;
+            original_at[index] = index;
+        }
+        for (uint32_t target = 0; target < keep.size(); target++)
+        {
+            uint32_t kept = candidates[keep[target]];
+            uint32_t source = position_of[kept];
+            if (source != target)
+            {
+                std::swap(objects[target], objects[source]);
+                uint32_t displaced = original_at[target];
+                position_of[displaced] = source;
+                original_at[source] = displaced;
+                position_of[kept] = target;
+                original_at[target] = kept;
+            }
+        }
+        objects.erase(objects.begin() + keep.size(), objects.end());
+    }
+
+    /**
+     * @brief Perform IOU based NMS in place on a vector of HailoDetection objects.
+     */
+    inline void nms(std::vector<HailoDetection> &objects, const NmsConfig &config)
+    {
+        nms(objects, config, [](HailoDetection &detection) -> HailoDetection &
+            { return detection; });
+    }
+
+    /**
+     * @brief Perform IOU based NMS in place on a vector of HailoDetectionPtr objects.
+     */
+    inline void nms(std::vector<HailoDetectionPtr> &objects, const NmsConfig &config)
+    {
+        nms(objects, config, [](HailoDetectionPtr &detection) -> HailoDetection &
+            { return *detection; });
+    }
+}
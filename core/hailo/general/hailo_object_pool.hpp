@@ -0,0 +1,241 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file hailo_object_pool.hpp
+ * @authors Hailo
+ *
+ * Slab allocation of HailoObjects.
+ * Objects created with hailo_object_pool::make_pooled share one allocation with their shared_ptr control block
+ * (std::allocate_shared), and that allocation comes from a slab of equally sized blocks.
+ * When the last reference goes away (typically when the GstHailoMeta owning the frame's ROI is freed)
+ * the block returns to the slab and the next object of the same size reuses it, so steady state frames do not reach malloc.
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace hailo_object_pool
+{
+    /**
+     * @brief Thread safe pool of fixed size blocks, carved out of slabs that are never returned to the system.
+     *        Each thread keeps a small cache of free blocks, the shared free list is only locked
+     *        to refill or drain that cache.
+     */
+    class SlabPool
+    {
+    private:
+        struct FreeBlock
+        {
+            FreeBlock *next;
+        };
+
+        // Blocks moved at once between a thread cache and the shared free list
+        static constexpr size_t BATCH_SIZE = 32;
+        static constexpr size_t BLOCKS_PER_SLAB = 256;
+
+        struct ThreadCache
+        {
+            SlabPool *pool;
+            FreeBlock *head;
+            size_t count;
+        };
+
+        // The caches of one thread, handed back to their pools when the thread exits
+        struct ThreadCaches
+        {
+            std::vector<ThreadCache> caches;
+            ~ThreadCaches()
+            {
+                for (auto &cache : caches)
+                    cache.pool->release(cache.head);
+                thread_exited() = true;
+            }
+        };
+
+        const size_t m_block_size;
+        std::mutex m_mutex;
+        FreeBlock *m_free = nullptr;
+        std::vector<void *> m_slabs;
+
+        static bool &thread_exited()
+        {
+            // Trivially destructible, still readable after the thread's caches are gone
+            thread_local bool exited = false;
+            return exited;
+        }
+
+        static FreeBlock *pop(FreeBlock *&head)
+        {
+            FreeBlock *block = head;
+            head = block->next;
+            return block;
+        }
+
+        static void push(FreeBlock *&head, FreeBlock *block)
+        {
+            block->next = head;
+            head = block;
+        }
+
+        // Carves a new slab into the shared free list, called with the lock held
+        void grow()
+        {
+            char *slab = static_cast<char *>(::operator new(m_block_size * BLOCKS_PER_SLAB));
+            m_slabs.push_back(slab);
+            for (size_t i = BLOCKS_PER_SLAB; i > 0; i--)
+                push(m_free, reinterpret_cast<FreeBlock *>(slab + (i - 1) * m_block_size));
+        }
+
+        // Moves BATCH_SIZE blocks from the shared list to the cache
+        void refill(ThreadCache &cache)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            while (cache.count < BATCH_SIZE)
+            {
+                if (m_free == nullptr)
+                    grow();
+                push(cache.head, pop(m_free));
+                cache.count++;
+            }
+        }
+
+        // Returns a list of blocks to the shared list
+        void release(FreeBlock *head)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            while (head != nullptr)
+                push(m_free, pop(head));
+        }
+
+        // The cache of the calling thread, nullptr once the thread is exiting
+        ThreadCache *cache()
+        {
+            if (thread_exited())
+                return nullptr;
+            thread_local ThreadCaches thread_caches;
+            for (auto &cache : thread_caches.caches)
+            {
+                if (cache.pool == this)
+                    return &cache;
+            }
+            thread_caches.caches.push_back({this, nullptr, 0});
+            return &thread_caches.caches.back();
+        }
+
+    public:
+        explicit SlabPool(size_t block_size)
+            : m_block_size((std::max(block_size, sizeof(FreeBlock)) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1)) {}
+
+        SlabPool(const SlabPool &) = delete;
+        SlabPool &operator=(const SlabPool &) = delete;
+
+        size_t block_size() const { return m_block_size; }
+
+        void *allocate()
+        {
+            ThreadCache *thread_cache = cache();
+            if (thread_cache == nullptr)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_free == nullptr)
+                    grow();
+                return pop(m_free);
+            }
+            if (thread_cache->head == nullptr)
+                refill(*thread_cache);
+            thread_cache->count--;
+            return pop(thread_cache->head);
+        }
+
+        void deallocate(void *ptr)
+        {
+            FreeBlock *block = static_cast<FreeBlock *>(ptr);
+            ThreadCache *thread_cache = cache();
+            if (thread_cache == nullptr)
+            {
+                block->next = nullptr;
+                release(block);
+                return;
+            }
+            push(thread_cache->head, block);
+            if (++thread_cache->count > 2 * BATCH_SIZE)
+            {
+                // Hand a batch back, so blocks freed by another thread than the one that allocated them get reused
+                FreeBlock *batch = nullptr;
+                for (size_t i = 0; i < BATCH_SIZE; i++)
+                    push(batch, pop(thread_cache->head));
+                thread_cache->count -= BATCH_SIZE;
+                release(batch);
+            }
+        }
+    };
+
+    /**
+     * @brief The pool serving blocks of a given size.
+     *        Intentionally never destroyed, objects may still be released during static destruction.
+     */
+    template <size_t BlockSize>
+    SlabPool &pool_for_size()
+    {
+        static SlabPool *pool = new SlabPool(BlockSize);
+        return *pool;
+    }
+
+    /**
+     * @brief Allocator drawing single objects from the slab of their size, arrays go to the global allocator.
+     *        Meant for std::allocate_shared, which allocates the object and its control block as one T.
+     */
+    template <typename T>
+    struct PoolAllocator
+    {
+        using value_type = T;
+
+        PoolAllocator() = default;
+        template <typename U>
+        PoolAllocator(const PoolAllocator<U> &) {}
+
+        T *allocate(size_t count)
+        {
+            if (count != 1 || alignof(T) > alignof(std::max_align_t))
+                return static_cast<T *>(::operator new(count * sizeof(T)));
+            return static_cast<T *>(pool_for_size<sizeof(T)>().allocate());
+        }
+
+        void deallocate(T *ptr, size_t count)
+        {
+            if (count != 1 || alignof(T) > alignof(std::max_align_t))
+                ::operator delete(ptr);
+            else
+                pool_for_size<sizeof(T)>().deallocate(ptr);
+        }
+
+        template <typename U>
+        bool operator==(const PoolAllocator<U> &) const { return true; }
+        template <typename U>
+        bool operator!=(const PoolAllocator<U> &) const { return false; }
+    };
+
+    /**
+     * @brief Creates a shared object in a pooled block, the pooled counterpart of std::make_shared.
+     *
+     * @param args  -  Args&&...
+     *        Arguments forwarded to the constructor of T.
+     *
+     * @return std::shared_ptr<T>
+     */
+    template <typename T, typename... Args>
+    std::shared_ptr<T> make_pooled(Args &&...args)
+    {
+        return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+    }
+}
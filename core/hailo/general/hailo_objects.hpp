@@ -161,20 +161,19 @@ public:
 class HailoObject
 {
 protected:
-    std::shared_ptr<std::mutex> mutex;
+    // Guards the state of this object. It lives inside the object, so creating an object costs no extra allocation,
+    // copies and moves get a lock of their own.
+    mutable std::mutex mutex;
 
 public:
     // Constructor
-    HailoObject()
-    {
-        mutex = std::make_shared<std::mutex>();
-    };
+    HailoObject(){};
     // Destructor
     virtual ~HailoObject() = default;
-    HailoObject &operator=(const HailoObject &other) = default;
-    HailoObject &operator=(HailoObject &&other) noexcept = default;
-    HailoObject(HailoObject &&other) noexcept = default;
-    HailoObject(const HailoObject &other) = default;
+    HailoObject &operator=(const HailoObject &other) { return *this; };
+    HailoObject &operator=(HailoObject &&other) noexcept { return *this; };
+    HailoObject(HailoObject &&other) noexcept {};
+    HailoObject(const HailoObject &other){};
 
     /**
      * @brief Get the type object
@@ -197,10 +196,7 @@ protected:
     std::map<std::string, HailoTensorPtr> m_tensors;
 
 public:
-    HailoMainObject()
-    {
-        mutex = std::make_shared<std::mutex>();
-    };
+    HailoMainObject(){};
     virtual ~HailoMainObject() = default;
     HailoMainObject(HailoMainObject &&other) noexcept : HailoObject(other), m_sub_objects(std::move(other.m_sub_objects)){};
     HailoMainObject(const HailoMainObject &other) : HailoObject(other), m_sub_objects(other.m_sub_objects){};
@@ -214,7 +210,7 @@ public:
      */
     void add_object(HailoObjectPtr obj)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_sub_objects.emplace_back(obj);
     };
 
@@ -225,7 +221,7 @@ public:
      */
     void add_tensor(HailoTensorPtr tensor)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_tensors.emplace(tensor->name(), tensor);
     };
 
@@ -237,7 +233,7 @@ public:
      */
     void remove_object(HailoObjectPtr obj)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_sub_objects.erase(std::remove(m_sub_objects.begin(), m_sub_objects.end(), obj), m_sub_objects.end());
     };
 
@@ -249,10 +245,24 @@ public:
      */
     void remove_object(uint index)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_sub_objects.erase(m_sub_objects.begin() + index);
     };
 
+    /**
+     * @brief Remove the HailoObjects matching a predicate from the MainObject, in one pass that keeps the order of the others.
+     *        The predicate runs under the lock of the MainObject and must not call into it.
+     *
+     * @param remove  -  Predicate
+     *        Called with each object, returns true for the objects to remove.
+     */
+    template <typename Predicate>
+    void remove_objects_if(Predicate remove)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        m_sub_objects.erase(std::remove_if(m_sub_objects.begin(), m_sub_objects.end(), remove), m_sub_objects.end());
+    };
+
     /**
      * @brief Get a tensor from this main object.
      *
@@ -261,7 +271,7 @@ public:
      */
     HailoTensorPtr get_tensor(std::string name)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         auto itr = m_tensors.find(name);
         if (itr == m_tensors.end())
         {
@@ -288,7 +298,7 @@ public:
      */
     std::vector<HailoTensorPtr> get_tensors()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         std::vector<HailoTensorPtr> _tensors;
         _tensors.reserve(m_tensors.size());
         for (auto &tensor_pair : m_tensors)
@@ -315,7 +325,7 @@ public:
      */
     void clear_tensors()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_tensors.clear();
     }
 
@@ -326,7 +336,7 @@ public:
      */
     std::vector<HailoObjectPtr> get_objects()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_sub_objects;
     }
 
@@ -338,7 +348,7 @@ public:
      */
     std::vector<HailoObjectPtr> get_objects_typed(hailo_object_t type)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         std::vector<HailoObjectPtr> filtered_subobjects;
         for (auto &obj : m_sub_objects)
         {
@@ -426,7 +436,7 @@ public:
      */
     HailoBBox &get_bbox()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_bbox;
     }
 
@@ -437,7 +447,7 @@ public:
      */
     void set_bbox(HailoBBox bbox)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_bbox = std::move(bbox);
     }
 
@@ -448,7 +458,7 @@ public:
      */
     HailoBBox &get_scaling_bbox()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_scaling_bbox;
     }
 
@@ -459,7 +469,7 @@ public:
      */
     void set_scaling_bbox(HailoBBox bbox)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         float new_xmin = (m_scaling_bbox.xmin() * bbox.width()) + bbox.xmin();
         float new_ymin = (m_scaling_bbox.ymin() * bbox.height()) + bbox.ymin();
         float new_width = m_scaling_bbox.width() * bbox.width();
@@ -474,7 +484,7 @@ public:
      */
     void clear_scaling_bbox()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_scaling_bbox = HailoBBox(0.0, 0.0, 1.0, 1.0);
     }
 
@@ -485,7 +495,7 @@ public:
      */
     std::string get_stream_id()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_stream_id;
     }
 
@@ -496,7 +506,7 @@ public:
      */
     void set_stream_id(std::string stream_id)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_stream_id = std::move(stream_id);
     }
 };
@@ -650,13 +660,13 @@ public:
 
     virtual hailo_object_t get_type()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return HAILO_DETECTION;
     }
 
     std::shared_ptr<HailoObject> clone()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return std::make_shared<HailoDetection>(*this);
     }
 
@@ -664,27 +674,27 @@ public:
 
     float get_confidence()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_confidence;
     }
     void set_confidence(float conf)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_confidence = conf;
     }
     std::string get_label()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_label;
     }
     void set_label(std::string label)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_label = label;
     }
     int get_class_id()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_class_id;
     }
 };
@@ -772,13 +782,13 @@ public:
 
     std::shared_ptr<HailoObject> clone()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return std::make_shared<HailoClassification>(*this);
     }
 
     virtual hailo_object_t get_type()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return HAILO_CLASSIFICATION;
     }
 
@@ -786,22 +796,22 @@ public:
 
     float get_confidence()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_confidence;
     }
     std::string get_label()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_label;
     }
     std::string get_classification_type()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_classification_type;
     }
     int get_class_id()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_class_id;
     }
 };
@@ -861,7 +871,7 @@ public:
      */
     void add_point(HailoPoint point)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_points.emplace_back(point);
     };
 
@@ -872,14 +882,14 @@ public:
      */
     void set_points(std::vector<HailoPoint> points)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_points.clear();
         m_points = std::move(points);
     };
 
     std::shared_ptr<HailoObject> clone()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return std::make_shared<HailoLandmarks>(*this);
     }
 
@@ -887,7 +897,7 @@ public:
 
     std::vector<HailoPoint> get_points()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_points;
     }
     float get_threshold()
@@ -937,7 +947,7 @@ public:
 
     std::shared_ptr<HailoObject> clone()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return std::make_shared<HailoUniqueID>(*this);
     }
 
@@ -990,17 +1000,140 @@ class HailoDepthMask : public HailoMask
 {
 protected:
     std::vector<float> m_data;
+    HailoTensorPtr m_tensor; // Set for a mask viewing the output tensor, m_data is then only filled on demand
 
 public:
     HailoDepthMask(std::vector<float> &&data_vec, int mask_width, int mask_height, float transparency) : HailoMask(mask_width, mask_height, transparency), m_data(std::move(data_vec)){};
 
+    /**
+     * @brief Construct a depth mask viewing a single channel output tensor, without copying it.
+     *        The tensor (and through its owner the buffer holding it) stays alive as long as the mask does,
+     *        values are dequantized when read. A tensor without an owner is dequantized into the mask right away.
+     *
+     * @param tensor  -  HailoTensorPtr
+     *        UINT8, UINT16 or FLOAT32 tensor with a single feature.
+     *
+     * @param transparency  -  float
+     */
+    HailoDepthMask(HailoTensorPtr tensor, float transparency) : HailoMask(tensor->width(), tensor->height(), transparency), m_tensor(tensor)
+    {
+        if (tensor->features() != 1)
+            throw std::invalid_argument("HailoDepthMask can only view a single channel tensor");
+        hailo_format_type_t type = tensor->vstream_info().format.type;
+        if (type != HAILO_FORMAT_TYPE_UINT8 && type != HAILO_FORMAT_TYPE_UINT16 && type != HAILO_FORMAT_TYPE_FLOAT32)
+            throw std::invalid_argument("HailoDepthMask can only view a UINT8, UINT16 or FLOAT32 tensor");
+        if (!tensor->owner())
+        {
+            m_data.resize(size());
+            dequantize(m_data.data());
+            m_tensor = nullptr;
+        }
+    };
+
     virtual hailo_object_t get_type()
     {
         return HAILO_DEPTH_MASK;
     }
 
+    size_t size()
+    {
+        return size_t(m_mask_width) * m_mask_height;
+    }
+
+    bool is_view()
+    {
+        return m_tensor != nullptr;
+    }
+
+    /**
+     * @brief The tensor this mask views, nullptr for a mask owning its data.
+     */
+    HailoTensorPtr get_tensor()
+    {
+        return m_tensor;
+    }
+
+    /**
+     * @brief Gets the dequantized value at a given index.
+     *
+     * @param index  -  size_t
+     *        Row-major index into the mask.
+     *
+     * @return float
+     */
+    float get_value(size_t index)
+    {
+        if (!m_tensor)
+            return m_data[index];
+        switch (m_tensor->vstream_info().format.type)
+        {
+        case HAILO_FORMAT_TYPE_UINT16:
+            return m_tensor->fix_scale(reinterpret_cast<const uint16_t *>(m_tensor->data())[index]);
+        case HAILO_FORMAT_TYPE_FLOAT32:
+            return reinterpret_cast<const float *>(m_tensor->data())[index];
+        default:
+            return m_tensor->fix_scale(m_tensor->data()[index]);
+        }
+    }
+
+    /**
+     * @brief Writes the whole mask, dequantized, to a caller owned buffer.
+     *
+     * @param out  -  float *
+     *        Buffer of at least size() floats.
+     */
+    void dequantize(float *out)
+    {
+        size_t count = size();
+        if (!m_tensor)
+        {
+            std::copy(m_data.begin(), m_data.begin() + count, out);
+            return;
+        }
+        float zp = m_tensor->vstream_info().quant_info.qp_zp;
+        float scale = m_tensor->vstream_info().quant_info.qp_scale;
+        switch (m_tensor->vstream_info().format.type)
+        {
+        case HAILO_FORMAT_TYPE_UINT16:
+        {
+            const uint16_t *in = reinterpret_cast<const uint16_t *>(m_tensor->data());
+            for (size_t i = 0; i < count; i++)
+                out[i] = (float(in[i]) - zp) * scale;
+            break;
+        }
+        case HAILO_FORMAT_TYPE_FLOAT32:
+        {
+            const float *in = reinterpret_cast<const float *>(m_tensor->data());
+            std::copy(in, in + count, out);
+            break;
+        }
+        default:
+        {
+            const uint8_t *in = m_tensor->data();
+            for (size_t i = 0; i < count; i++)
+                out[i] = (float(in[i]) - zp) * scale;
+            break;
+        }
+        }
+    }
+
+    /**
+     * @brief Gets the dequantized mask. A view dequantizes the tensor into the mask on the first call,
+     *        prefer get_value or dequantize where a copy is not needed.
+     *
+     * @return const std::vector<float>&
+     */
     const std::vector<float> &get_data()
     {
+        if (m_tensor)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (m_data.empty())
+            {
+                m_data.resize(size());
+                dequantize(m_data.data());
+            }
+        }
         return m_data;
     }
     virtual ~HailoDepthMask() = default;
@@ -1011,17 +1144,78 @@ class HailoClassMask : public HailoMask
 {
 protected:
     std::vector<uint8_t> m_data;
+    HailoTensorPtr m_tensor; // Set for a mask viewing the output tensor, m_data is then only filled on demand
 
 public:
     HailoClassMask(std::vector<uint8_t> &&data_vec, int mask_width, int mask_height, float transparency) : HailoMask(mask_width, mask_height, transparency), m_data(std::move(data_vec)){};
 
+    /**
+     * @brief Construct a class mask viewing a single channel UINT8 tensor of class ids, without copying it.
+     *        The tensor (and through its owner the buffer holding it) stays alive as long as the mask does.
+     *        A tensor without an owner is copied into the mask right away.
+     *
+     * @param tensor  -  HailoTensorPtr
+     *
+     * @param transparency  -  float
+     */
+    HailoClassMask(HailoTensorPtr tensor, float transparency) : HailoMask(tensor->width(), tensor->height(), transparency), m_tensor(tensor)
+    {
+        if (tensor->features() != 1 || tensor->vstream_info().format.type != HAILO_FORMAT_TYPE_UINT8)
+            throw std::invalid_argument("HailoClassMask can only view a single channel UINT8 tensor");
+        if (!tensor->owner())
+        {
+            m_data.assign(tensor->data(), tensor->data() + size());
+            m_tensor = nullptr;
+        }
+    };
+
     virtual hailo_object_t get_type()
     {
         return HAILO_CLASS_MASK;
     }
 
+    size_t size()
+    {
+        return size_t(m_mask_width) * m_mask_height;
+    }
+
+    bool is_view()
+    {
+        return m_tensor != nullptr;
+    }
+
+    /**
+     * @brief The tensor this mask views, nullptr for a mask owning its data.
+     */
+    HailoTensorPtr get_tensor()
+    {
+        return m_tensor;
+    }
+
+    /**
+     * @brief Gets the class ids of the mask without copying, whether it views a tensor or owns its data.
+     *
+     * @return const uint8_t* size() class ids, row-major.
+     */
+    const uint8_t *data()
+    {
+        return m_tensor ? m_tensor->data() : m_data.data();
+    }
+
+    /**
+     * @brief Gets the mask as a vector. A view copies the tensor into the mask on the first call,
+     *        prefer data() where a copy is not needed.
+     *
+     * @return const std::vector<uint8_t>&
+     */
     const std::vector<uint8_t> &get_data()
     {
+        if (m_tensor)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (m_data.empty())
+                m_data.assign(m_tensor->data(), m_tensor->data() + size());
+        }
         return m_data;
     }
     virtual ~HailoClassMask() = default;
@@ -1127,38 +1321,38 @@ public:
 
     virtual hailo_object_t get_type()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return HAILO_USER_META;
     }
 
     float get_user_float()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_user_float;
     }
     std::string get_user_string()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_user_string;
     }
     int get_user_int()
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         return m_user_int;
     }
     void set_user_float(float user_float)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_user_float = user_float;
     }
     void set_user_string(std::string user_string)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_user_string = user_string;
     }
     void set_user_int(int user_int)
     {
-        std::lock_guard<std::mutex> lock(*mutex);
+        std::lock_guard<std::mutex> lock(mutex);
         m_user_int = user_int;
     }
 };
@@ -0,0 +1,22 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file hailo_simd.hpp
+ * @authors Hailo
+ *
+ * Selects the SIMD instruction set of the hand written kernels at compile time.
+ * HAILO_SIMD_SSE2 is defined on x86-64 (and x86 built with SSE2), HAILO_SIMD_NEON on aarch64,
+ * and neither elsewhere, in which case the kernels use their scalar path.
+ **/
+
+#pragma once
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HAILO_SIMD_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define HAILO_SIMD_NEON
+#endif
@@ -19,6 +19,7 @@ private:
     uint8_t *m_data;                     // Pointer to the data of the tensor.
     hailo_vstream_info_t m_vstream_info; // Pointer to vstream info.
     std::string m_name;                  // Name of output tensor.
+    std::shared_ptr<void> m_owner;       // Keeps the memory behind m_data alive, empty when the caller manages it.
 public:
     /**
      * @brief Construct a new Hailo Tensor object
@@ -27,6 +28,15 @@ public:
      * @param vstream_info - pointer to info about the output, represented as hailo_vstream_info_t.
      */
     HailoTensor(uint8_t *data, const hailo_vstream_info_t &vstream_info) : m_data(data), m_vstream_info(vstream_info), m_name(m_vstream_info.name){};
+    /**
+     * @brief Construct a new Hailo Tensor object that keeps its memory alive
+     *
+     * @param data - Pointer to the tensor output.
+     * @param vstream_info - pointer to info about the output, represented as hailo_vstream_info_t.
+     * @param owner - Reference to whatever owns the data (e.g. the GstBuffer), released with the last copy of the tensor.
+     */
+    HailoTensor(uint8_t *data, const hailo_vstream_info_t &vstream_info, std::shared_ptr<void> owner)
+        : m_data(data), m_vstream_info(vstream_info), m_name(m_vstream_info.name), m_owner(std::move(owner)){};
     // Destructor
     ~HailoTensor() = default;
     // Copy constructor
@@ -47,6 +57,10 @@ public:
     {
         return m_data;
     }
+    const std::shared_ptr<void> &owner() const
+    {
+        return m_owner;
+    }
     const uint32_t width() { return m_vstream_info.shape.width; }
     const uint32_t height() { return m_vstream_info.shape.height; }
     const uint32_t features() { return m_vstream_info.shape.features; }
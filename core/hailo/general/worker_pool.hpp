@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Persistent worker threads shared by the elements and postprocesses that work off the calling thread.
+ *        run(count, task) is fork-join: it calls task(i) for every i in [0, count), spread over the workers and the
+ *        calling thread, and returns once every call is done. submit(job) queues an independent job and returns at once,
+ *        callers track its completion themselves.
+ *        Any number of threads may use the pool concurrently, including its own jobs, a nested run() never waits on
+ *        an idle pool since the caller runs the jobs left over itself.
+ */
+class WorkerPool
+{
+private:
+    struct Batch
+    {
+        const std::function<void(size_t)> *task;
+        size_t count;
+        std::atomic<size_t> next{0};
+        std::mutex mutex;
+        std::condition_variable done_cv;
+        size_t done = 0;
+        std::exception_ptr error;
+    };
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::queue<std::function<void()>> m_jobs;
+    bool m_stop = false;
+
+    // Runs calls of the batch until none is left. The task is only touched while calls remain,
+    // so a worker picking up an already finished batch never reaches the caller's stack
+    static void drain(Batch &batch)
+    {
+        size_t ran = 0;
+        std::exception_ptr error;
+        for (size_t i = batch.next.fetch_add(1); i < batch.count; i = batch.next.fetch_add(1))
+        {
+            try
+            {
+                (*batch.task)(i);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            ran++;
+        }
+        if (ran == 0)
+            return;
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        if (error && !batch.error)
+            batch.error = error;
+        batch.done += ran;
+        if (batch.done == batch.count)
+            batch.done_cv.notify_all();
+    }
+
+    void work()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]
+                          { return m_stop || !m_jobs.empty(); });
+                if (m_jobs.empty())
+                    return;
+                job = std::move(m_jobs.front());
+                m_jobs.pop();
+            }
+            job();
+        }
+    }
+
+public:
+    /**
+     * @brief Construct a new Worker Pool
+     *
+     * @param size  -  size_t
+     *        Number of threads running the jobs, including the calling thread.
+     *        0 uses one thread per hardware thread.
+     */
+    explicit WorkerPool(size_t size)
+    {
+        if (size == 0)
+            size = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 1; i < size; i++)
+            m_threads.emplace_back(&WorkerPool::work, this);
+    }
+
+    // Runs the jobs still queued before joining the workers
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (auto &thread : m_threads)
+            thread.join();
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    /**
+     * @brief The pool shared by every element and postprocess of the process, one thread per hardware thread.
+     *        It always has a worker thread, so submitted jobs never run on the thread that submits them.
+     *
+     * @return WorkerPool&
+     */
+    static WorkerPool &shared()
+    {
+        static WorkerPool pool(std::max(2u, std::thread::hardware_concurrency()));
+        return pool;
+    }
+
+    size_t size() const { return m_threads.size() + 1; }
+
+    /**
+     * @brief Queues a job for the workers, a pool of size 1 runs it on the caller before returning.
+     *        Jobs start in submission order as workers become free and must not throw.
+     *
+     * @param job  -  std::function<void()>
+     *        The job to run.
+     */
+    void submit(std::function<void()> job)
+    {
+        if (m_threads.empty())
+        {
+            job();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push(std::move(job));
+        }
+        m_cv.notify_one();
+    }
+
+    /**
+     * @brief Calls task(i) for every i in [0, count) and returns once all calls are done.
+     *        The first exception thrown by a call is rethrown here.
+     *
+     * @param count  -  size_t
+     *        Number of calls.
+     *
+     * @param task  -  const std::function<void(size_t)> &
+     *        Call body, called with the call index.
+     */
+    void run(size_t count, const std::function<void(size_t)> &task)
+    {
+        if (m_threads.empty() || count <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+                task(i);
+            return;
+        }
+
+        auto batch = std::make_shared<Batch>();
+        batch->task = &task;
+        batch->count = count;
+        size_t helpers = std::min(m_threads.size(), count - 1);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t i = 0; i < helpers; i++)
+                m_jobs.push([batch]
+                            { drain(*batch); });
+        }
+        if (helpers == 1)
+            m_cv.notify_one();
+        else
+            m_cv.notify_all();
+
+        drain(*batch);
+
+        std::unique_lock<std::mutex> lock(batch->mutex);
+        batch->done_cv.wait(lock, [&batch]
+                            { return batch->done == batch->count; });
+        if (batch->error)
+            std::rethrow_exception(batch->error);
+    }
+};
@@ -16,7 +16,10 @@
 #define TRACK_DELAY (5)
 #define MIN_QUALITY (400)
 #define RE_ID_NETWORK_SIZE (cv::Size(128, 256))
+#define RE_ID_TRACK_UPDATE (10)
 std::map<int, int> track_counter;
+// The tracker does not keep the re-id matrices, so the cache only gates the crops
+TrackCropCache re_id_cache(TrackCropCacheParams(RE_ID_TRACK_UPDATE));
 
 /**
  * @brief Returns the quaility estimation of the person's crop.
@@ -85,6 +88,8 @@ HailoUniqueIDPtr get_tracking_id(HailoDetectionPtr detection)
 
 /**
  * @brief Returns a vector of HailoROIPtr to crop and resize.
+ *        A tracked person is cropped again only when the cache finds its last embedding stale,
+ *        or its box scale or quality changed enough since.
  *
  * @param image The original picture (cv::Mat).
  * @param roi The main ROI of this picture.
@@ -93,6 +98,7 @@ HailoUniqueIDPtr get_tracking_id(HailoDetectionPtr detection)
 std::vector<HailoROIPtr> create_crops(std::shared_ptr<HailoMat> image, HailoROIPtr roi)
 {
     std::vector<HailoROIPtr> crop_rois;
+    re_id_cache.new_frame(roi->get_stream_id());
     // Get all detections.
     std::vector<HailoDetectionPtr> detections_ptrs = hailo_common::get_hailo_detections(roi);
     for (HailoDetectionPtr &detection : detections_ptrs)
@@ -117,16 +123,24 @@ std::vector<HailoROIPtr> create_crops(std::shared_ptr<HailoMat> image, HailoROIP
             else
             {
                 auto bbox = detection->get_bbox();
-                float quality = quality_estimation(image->get_matrices()[0], bbox);
                 float ratio = (bbox.height() * image->height()) / (bbox.width() * image->width());
                 if (ratio > MIN_RATIO && ratio < MAX_RATIO &&
                     bbox.height() > MIN_HEIGHT && bbox.height() < MAX_HEIGHT &&
-                    bbox.xmin() > MIN_X && bbox.xmax() < MAX_X && quality > MIN_QUALITY)
+                    bbox.xmin() > MIN_X && bbox.xmax() < MAX_X)
                 {
-                    crop_rois.emplace_back(detection);
+                    // Estimate the quality only for boxes that pass the cheap geometric checks
+                    float quality = quality_estimation(image->get_matrices()[0], bbox);
+                    if (quality > MIN_QUALITY && re_id_cache.should_crop(roi->get_stream_id(), tracking_id, detection, quality))
+                        crop_rois.emplace_back(detection);
                 }
             }
         }
     }
     return crop_rois;
 }
+
+void crop_cache_stats(uint64_t *hits, uint64_t *misses)
+{
+    *hits = re_id_cache.hits();
+    *misses = re_id_cache.misses();
+}
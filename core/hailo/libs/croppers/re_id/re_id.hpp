@@ -8,8 +8,10 @@
 #include "hailo_objects.hpp"
 #include "hailo_common.hpp"
 #include "hailomat.hpp"
+#include "track_crop_cache.hpp"
 
 __BEGIN_DECLS
 std::vector<HailoROIPtr> create_crops(std::shared_ptr<HailoMat> image, HailoROIPtr roi);
+void crop_cache_stats(uint64_t *hits, uint64_t *misses);
 
 __END_DECLS
\ No newline at end of file
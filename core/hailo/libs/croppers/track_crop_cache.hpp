@@ -0,0 +1,184 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "hailo_objects.hpp"
+
+/**
+ * @brief Thresholds of a TrackCropCache, set by the cropper function that owns the cache.
+ */
+struct TrackCropCacheParams
+{
+    uint max_age;       // Frames a track's results stay fresh after its crop, 0 crops every frame
+    float scale_thr;    // Relative change of the box area since the crop that forces a new crop
+    float quality_gain; // Relative gain of quality over the cropped frame that forces a new crop
+    uint window;        // Frames a stale track may wait for its best quality frame before it is cropped anyway
+
+    TrackCropCacheParams(uint max_age, float scale_thr = 0.3f, float quality_gain = 0.2f, uint window = 5)
+        : max_age(max_age), scale_thr(scale_thr), quality_gain(quality_gain), window(window) {}
+};
+
+/**
+ * @brief Decides which tracked detections a cropper should send to the second stage network.
+ *
+ *        A track is cropped when it is new, and then only once its results are stale (older than max_age frames),
+ *        its box scale changed by more than scale_thr, or its quality rose by more than quality_gain.
+ *        A stale track is cropped on the best quality frame of the last window frames it was seen in.
+ *        The results of the last crop (objects of the given types found on the detection) are remembered,
+ *        and attached back to the detection on frames that are not cropped if the tracker did not keep them.
+ *        Frames are counted per stream, by calls to new_frame.
+ */
+class TrackCropCache
+{
+private:
+    struct Entry
+    {
+        uint64_t last_seen = 0;
+        uint64_t cropped_at = 0;
+        bool cropped = false;
+        float crop_area = 0.0f;
+        float crop_quality = 0.0f;
+        std::deque<float> qualities;
+        std::vector<HailoObjectPtr> results;
+    };
+
+    TrackCropCacheParams m_params;
+    std::vector<hailo_object_t> m_result_types;
+    std::map<std::string, uint64_t> m_frames;
+    std::map<std::pair<std::string, int>, Entry> m_entries;
+    std::mutex m_mutex;
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+
+    std::vector<HailoObjectPtr> get_results(HailoDetectionPtr detection)
+    {
+        std::vector<HailoObjectPtr> results;
+        for (hailo_object_t type : m_result_types)
+        {
+            auto objects = detection->get_objects_typed(type);
+            results.insert(results.end(), objects.begin(), objects.end());
+        }
+        return results;
+    }
+
+    bool is_fresh(const Entry &entry, uint64_t frame, float area, float quality)
+    {
+        if (frame - entry.cropped_at >= m_params.max_age)
+            return false;
+        if (entry.crop_area > 0.0f && std::fabs(area / entry.crop_area - 1.0f) > m_params.scale_thr)
+            return false;
+        return entry.crop_quality <= 0.0f || quality <= entry.crop_quality * (1.0f + m_params.quality_gain);
+    }
+
+public:
+    /**
+     * @brief Construct a new TrackCropCache.
+     *
+     * @param params  -  TrackCropCacheParams
+     *        The cache thresholds.
+     *
+     * @param result_types  -  std::vector<hailo_object_t>
+     *        The types of the objects the second stage adds to a cropped detection, empty to never attach results.
+     */
+    TrackCropCache(TrackCropCacheParams params, std::vector<hailo_object_t> result_types = {})
+        : m_params(params), m_result_types(std::move(result_types)) {}
+
+    /**
+     * @brief Start a new frame of a stream, and drop the tracks of the stream that were not seen for a while.
+     *
+     * @param stream_id  -  const std::string &
+     *        The stream of the frame.
+     */
+    void new_frame(const std::string &stream_id)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint64_t frame = ++m_frames[stream_id];
+        uint64_t keep = 2 * (uint64_t(m_params.max_age) + m_params.window) + 1;
+        if (frame % keep != 0)
+            return;
+        for (auto it = m_entries.lower_bound({stream_id, INT32_MIN}); it != m_entries.end() && it->first.first == stream_id;)
+        {
+            if (frame - it->second.last_seen > keep)
+                it = m_entries.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    /**
+     * @brief Returns whether a tracked detection should be cropped in the current frame.
+     *        When it should not, the remembered results are attached to the detection if it has none.
+     *
+     * @param stream_id  -  const std::string &
+     *        The stream of the detection.
+     *
+     * @param track_id  -  int
+     *        The tracking id of the detection.
+     *
+     * @param detection  -  HailoDetectionPtr
+     *        The tracked detection.
+     *
+     * @param quality  -  float
+     *        The quality of the detection in this frame, higher is better.
+     *
+     * @return bool
+     *         True if the detection should be cropped.
+     */
+    bool should_crop(const std::string &stream_id, int track_id, HailoDetectionPtr detection, float quality)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint64_t frame = m_frames[stream_id];
+        Entry &entry = m_entries[{stream_id, track_id}];
+        entry.last_seen = frame;
+        float area = detection->get_bbox().width() * detection->get_bbox().height();
+
+        // Remember the results of the last crop, the tracker attaches them to the detection
+        auto results = get_results(detection);
+        if (!results.empty())
+            entry.results = std::move(results);
+
+        entry.qualities.push_back(quality);
+        if (entry.qualities.size() > m_params.window + 1)
+            entry.qualities.pop_front();
+
+        bool crop = !entry.cropped || !is_fresh(entry, frame, area, quality);
+        if (crop && entry.cropped && m_params.max_age > 0 && frame - entry.cropped_at < uint64_t(m_params.max_age) + m_params.window)
+        {
+            // Stale within the window - wait for the best quality frame of the window
+            crop = quality >= *std::max_element(entry.qualities.begin(), entry.qualities.end()) ||
+                   frame - entry.cropped_at < m_params.max_age;
+        }
+
+        if (crop)
+        {
+            m_misses++;
+            entry.cropped = true;
+            entry.cropped_at = frame;
+            entry.crop_area = area;
+            entry.crop_quality = quality;
+            entry.qualities.clear();
+            return true;
+        }
+
+        m_hits++;
+        if (!entry.results.empty() && get_results(detection).empty())
+        {
+            for (HailoObjectPtr &object : entry.results)
+                detection->add_object(object);
+        }
+        return false;
+    }
+
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+};
@@ -11,8 +11,11 @@
 #define FACE_ATTRIBUTES_CROP_SCALE_FACTOR (1.58f)
 #define FACE_ATTRIBUTES_CROP_HIGHT_OFFSET_FACTOR (0.10f)
 #define TRACK_UPDATE 60
+#define FACE_RECOGNITION_TRACK_UPDATE 15
 
-std::map<int, int> track_counter;
+TrackCropCache face_attributes_cache(TrackCropCacheParams(TRACK_UPDATE), {HAILO_CLASSIFICATION});
+TrackCropCache person_attributes_cache(TrackCropCacheParams(TRACK_UPDATE), {HAILO_CLASSIFICATION});
+TrackCropCache face_recognition_cache(TrackCropCacheParams(FACE_RECOGNITION_TRACK_UPDATE), {HAILO_MATRIX});
 
 /**
 * @brief Get the tracking Hailo Unique Id object from a Hailo Detection.
@@ -45,42 +48,19 @@ bool box_contains_nan(HailoBBox box)
 }
 
 /**
-* @brief Returns a boolean indicating if traker update is required for a given detection.
-*       It is determined by the number of frames since the last update.
-*       How many frames to wait for an update are defined in TRACK_UPDATE.
-* 
+* @brief Returns a boolean indicating if a detection should be cropped in this frame.
+*       Detections without a tracking id are always cropped, tracked ones are gated by the cache.
+*
+* @param cache TrackCropCache of the calling cropper, nullptr to always crop
+* @param roi HailoROIPtr the main ROI of the frame
 * @param detection HailoDetectionPtr
-* @param use_track_update boolean can override the default behaviour, false will always require an update
-* @return boolean indicating if traker update is required.
+* @return boolean indicating if the detection should be cropped.
 */
-bool track_update(HailoDetectionPtr detection, bool use_track_update)
+bool track_update(TrackCropCache *cache, HailoROIPtr roi, HailoDetectionPtr detection)
 {
     auto tracking_obj = get_tracking_id(detection);
-    if (tracking_obj && use_track_update)
-    {
-        int tracking_id = tracking_obj->get_id();
-        auto counter = track_counter.find(tracking_id);
-        if (counter == track_counter.end())
-        {
-            // Emplace new element to the track_counter map. track update required.
-            track_counter.emplace(tracking_id, 0);
-            return true;
-        }
-        else if (counter->second >= TRACK_UPDATE)
-        {
-            // Counter passed the TRACK_UPDATE limit - set existing track to 0. track update required.
-            track_counter[tracking_id] = 0;
-            return true;
-        }
-        else if (counter->second < TRACK_UPDATE)
-        {
-            // Counter is still below TRACK_UPDATE_LIMIT - increasing the exising value. track update should be skipped. 
-            track_counter[tracking_id] += 1;
-        }
-
-        return false;
-    }
-
+    if (tracking_obj && cache)
+        return cache->should_crop(roi->get_stream_id(), tracking_obj->get_id(), detection, detection->get_confidence());
     return true;
 }
 
@@ -89,11 +69,14 @@ bool track_update(HailoDetectionPtr detection, bool use_track_update)
  *
  * @param image The original picture (cv::Mat).
  * @param roi The main ROI of this picture.
+ * @param cache TrackCropCache gating the tracked persons, nullptr to crop every person.
  * @return std::vector<HailoROIPtr> vector of ROI's to crop and resize.
  */
-std::vector<HailoROIPtr> person_crop(std::shared_ptr<HailoMat> image, HailoROIPtr roi, bool use_track_update=false)
+std::vector<HailoROIPtr> person_crop(std::shared_ptr<HailoMat> image, HailoROIPtr roi, TrackCropCache *cache=nullptr)
 {
     std::vector<HailoROIPtr> crop_rois;
+    if (cache)
+        cache->new_frame(roi->get_stream_id());
     // Get all detections.
     std::vector<HailoDetectionPtr> detections_ptrs = hailo_common::get_hailo_detections(roi);
     for (HailoDetectionPtr &detection : detections_ptrs)
@@ -101,7 +84,7 @@ std::vector<HailoROIPtr> person_crop(std::shared_ptr<HailoMat> image, HailoROIPt
         // Modify only detections with "person" label.
         if (std::string(PERSON_LABEL) == detection->get_label())
         {
-            if (track_update(detection, use_track_update))
+            if (track_update(cache, roi, detection))
                 crop_rois.emplace_back(detection);
         }
     }
@@ -187,12 +170,14 @@ HailoDetectionPtr clone_detection_object(HailoDetectionPtr detection)
  *
  * @param image The original picture (cv::Mat).
  * @param roi The main ROI of this picture.
- * @param track_update update track every X frames.
+ * @param cache TrackCropCache gating the tracked faces, nullptr to crop every face.
  * @return std::vector<HailoROIPtr> vector of ROI's to crop and resize.
  */
-std::vector<HailoROIPtr> face_crop(std::shared_ptr<HailoMat> image, HailoROIPtr roi, bool use_track_update=false)
+std::vector<HailoROIPtr> face_crop(std::shared_ptr<HailoMat> image, HailoROIPtr roi, TrackCropCache *cache=nullptr)
 {
     std::vector<HailoROIPtr> crop_rois;
+    if (cache)
+        cache->new_frame(roi->get_stream_id());
     // Get all detections.
     std::vector<HailoDetectionPtr> detections_ptrs = hailo_common::get_hailo_detections(roi);
     for (HailoDetectionPtr &detection : detections_ptrs)
@@ -200,7 +185,7 @@ std::vector<HailoROIPtr> face_crop(std::shared_ptr<HailoMat> image, HailoROIPtr
         // Modify only detections with "face" label.
         if (std::string(FACE_LABEL) == detection->get_label() && !box_contains_nan(detection->get_bbox()))
         {
-            if (track_update(detection, use_track_update))
+            if (track_update(cache, roi, detection))
             {
                 // Modifies a rectengle according to a cropping algorithm only on faces
                 auto new_bbox = algorithm_face_crop(image->native_width(), image->native_height(), detection->get_bbox(), FACE_ATTRIBUTES_CROP_SCALE_FACTOR, FACE_ATTRIBUTES_CROP_HIGHT_OFFSET_FACTOR);
@@ -218,15 +203,26 @@ std::vector<HailoROIPtr> face_crop(std::shared_ptr<HailoMat> image, HailoROIPtr
 
 std::vector<HailoROIPtr> face_recognition(std::shared_ptr<HailoMat> image, HailoROIPtr roi)
 {
-    return face_crop(image, roi, false);
+    return face_crop(image, roi);
+}
+
+std::vector<HailoROIPtr> face_recognition_cached(std::shared_ptr<HailoMat> image, HailoROIPtr roi)
+{
+    return face_crop(image, roi, &face_recognition_cache);
 }
 
 std::vector<HailoROIPtr> face_attributes(std::shared_ptr<HailoMat> image, HailoROIPtr roi)
 {
-    return face_crop(image, roi, true);
+    return face_crop(image, roi, &face_attributes_cache);
 }
 
 std::vector<HailoROIPtr> person_attributes(std::shared_ptr<HailoMat> image, HailoROIPtr roi)
 {
-    return person_crop(image, roi, true);
-}
\ No newline at end of file
+    return person_crop(image, roi, &person_attributes_cache);
+}
+
+void crop_cache_stats(uint64_t *hits, uint64_t *misses)
+{
+    *hits = face_attributes_cache.hits() + person_attributes_cache.hits() + face_recognition_cache.hits();
+    *misses = face_attributes_cache.misses() + person_attributes_cache.misses() + face_recognition_cache.misses();
+}
@@ -8,10 +8,13 @@
 #include "hailo_objects.hpp"
 #include "hailo_common.hpp"
 #include "hailomat.hpp"
+#include "track_crop_cache.hpp"
 
 __BEGIN_DECLS
 std::vector<HailoROIPtr> person_attributes(std::shared_ptr<HailoMat> mat, HailoROIPtr roi);
 std::vector<HailoROIPtr> face_attributes(std::shared_ptr<HailoMat> image, HailoROIPtr roi);
 std::vector<HailoROIPtr> face_recognition(std::shared_ptr<HailoMat> image, HailoROIPtr roi);
+std::vector<HailoROIPtr> face_recognition_cached(std::shared_ptr<HailoMat> image, HailoROIPtr roi);
+void crop_cache_stats(uint64_t *hits, uint64_t *misses);
 
 __END_DECLS
\ No newline at end of file
@@ -18,7 +18,6 @@
 
 void top1(HailoROIPtr roi, std::string layer_name, int label_offset)
 {
-    const int k = 1;
     std::string label = "";
 
     if (!roi->has_tensors())
@@ -29,14 +28,11 @@ void top1(HailoROIPtr roi, std::string layer_name, int label_offset)
     // Extract the relevant output tensor.
     HailoTensorPtr scores = roi->get_tensor(layer_name);
 
-    // Convert the tensor to xarray.
-    xt::xarray<uint8_t> xscores = common::get_xtensor(scores);
-
-    // Find the topk scores.
-    xt::xarray<int> top_k_scores = common::top_k(xscores, k);
+    // Find the top score on the quantized scores.
+    const uint8_t *data = scores->data();
+    int index = int(common::argmax(data, scores->size())) - label_offset;
 
     // Extrats the label of the top score.
-    int index = top_k_scores[0] - label_offset;
     std::string labels = common::imagenet_labels[index];
 
     // If there are multiple synonyms for this class, take only the first.
@@ -45,7 +41,7 @@ void top1(HailoROIPtr roi, std::string layer_name, int label_offset)
         label = labels.substr(0, comma_pos);
     else
         label = labels;
-    float confidence = scores->fix_scale(xscores(index));
+    float confidence = scores->fix_scale(data[index]);
     // Update the tensor with the classification result.
     hailo_common::add_classification(roi,
                                      std::string("imagenet"),
@@ -4,6 +4,15 @@
  **/
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "hailo_simd.hpp"
+
 #include "xtensor/xarray.hpp"
 #include "xtensor/xeval.hpp"
 #include "xtensor/xsort.hpp"
@@ -13,22 +22,267 @@
 namespace common
 {
 
+    //-------------------------------
+    // QUANTIZED KERNELS
+    //-------------------------------
+    // Dequantization ((x - zp) * scale, scale > 0) keeps the order of the values, so ranking
+    // and thresholding run on the raw tensor data. uint8 and uint16 data is scanned with SIMD.
+    // Decoders use these kernels rather than their own argmax or threshold loops.
+
+    template <typename T>
+    constexpr bool is_simd_quantized_v = std::is_same<T, uint8_t>::value || std::is_same<T, uint16_t>::value;
+
+#if defined(HAILO_SIMD_SSE2)
+    // Byte mask of the lanes that are at least threshold. SSE2 has no unsigned 16 bit compare, so those lanes are compared signed with their sign bit flipped
+    inline int at_least_mask(const uint8_t *data, __m128i threshold)
+    {
+        __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(values, threshold), values));
+    }
+    inline int at_least_mask(const uint16_t *data, __m128i threshold)
+    {
+        const __m128i flip = _mm_set1_epi16(int16_t(0x8000));
+        __m128i values = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), flip);
+        __m128i below = _mm_cmplt_epi16(values, _mm_xor_si128(threshold, flip));
+        return ~_mm_movemask_epi8(below) & 0xffff;
+    }
+#endif
+
+    /**
+     * @brief Index of the first value in data[begin, end) that is at least threshold, or end if there is none.
+     *
+     * @param data values
+     * @param begin first index to check
+     * @param end one past the last index to check
+     * @param threshold threshold, in the same quantization as data
+     * @return size_t
+     */
+    template <typename T>
+    size_t find_at_least(const T *data, size_t begin, size_t end, T threshold)
+    {
+        size_t i = begin;
+        if constexpr (is_simd_quantized_v<T>)
+        {
+#if defined(HAILO_SIMD_SSE2)
+            constexpr size_t lanes = 16 / sizeof(T);
+            const __m128i threshold_vec = sizeof(T) == 1 ? _mm_set1_epi8(char(threshold)) : _mm_set1_epi16(int16_t(threshold));
+            for (; i + lanes <= end; i += lanes)
+            {
+                int mask = at_least_mask(data + i, threshold_vec);
+                if (mask != 0)
+                    return i + __builtin_ctz(mask) / sizeof(T);
+            }
+#elif defined(HAILO_SIMD_NEON)
+            if constexpr (sizeof(T) == 1)
+            {
+                const uint8x16_t threshold_vec = vdupq_n_u8(threshold);
+                for (; i + 16 <= end; i += 16)
+                {
+                    if (vmaxvq_u8(vcgeq_u8(vld1q_u8(data + i), threshold_vec)) != 0)
+                        break;
+                }
+            }
+            else
+            {
+                const uint16x8_t threshold_vec = vdupq_n_u16(threshold);
+                for (; i + 8 <= end; i += 8)
+                {
+                    if (vmaxvq_u16(vcgeq_u16(vld1q_u16(data + i), threshold_vec)) != 0)
+                        break;
+                }
+            }
+#endif
+        }
+        for (; i < end; i++)
+        {
+            if (data[i] >= threshold)
+                return i;
+        }
+        return end;
+    }
+
+    /**
+     * @brief Thresholded compaction: calls visit(index) for every value that is at least threshold, in index order.
+     *
+     * @param data values
+     * @param count number of values
+     * @param threshold threshold, in the same quantization as data
+     * @param visit callable taking a size_t index
+     */
+    template <typename T, typename F>
+    void compact_at_least(const T *data, size_t count, T threshold, F &&visit)
+    {
+        for (size_t i = find_at_least(data, 0, count, threshold); i < count; i = find_at_least(data, i + 1, count, threshold))
+            visit(i);
+    }
+
+    /**
+     * @brief Index of the first maximum of count contiguous values.
+     *
+     * @param data values
+     * @param count number of values, at least 1
+     * @param max_value set to the maximum
+     * @return size_t
+     */
+    template <typename T>
+    size_t argmax(const T *data, size_t count, T &max_value)
+    {
+        size_t i = 0;
+        T max = data[0];
+        if constexpr (is_simd_quantized_v<T>)
+        {
+#if defined(HAILO_SIMD_SSE2)
+            if constexpr (sizeof(T) == 1)
+            {
+                __m128i max_vec = _mm_setzero_si128();
+                for (; i + 16 <= count; i += 16)
+                    max_vec = _mm_max_epu8(max_vec, _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)));
+                max_vec = _mm_max_epu8(max_vec, _mm_srli_si128(max_vec, 8));
+                max_vec = _mm_max_epu8(max_vec, _mm_srli_si128(max_vec, 4));
+                max_vec = _mm_max_epu8(max_vec, _mm_srli_si128(max_vec, 2));
+                max_vec = _mm_max_epu8(max_vec, _mm_srli_si128(max_vec, 1));
+                max = std::max(max, T(_mm_cvtsi128_si32(max_vec) & 0xff));
+            }
+            else
+            {
+                // 16 bit unsigned max on sign flipped values
+                const __m128i flip = _mm_set1_epi16(int16_t(0x8000));
+                __m128i max_vec = flip;
+                for (; i + 8 <= count; i += 8)
+                    max_vec = _mm_max_epi16(max_vec, _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)), flip));
+                max_vec = _mm_max_epi16(max_vec, _mm_srli_si128(max_vec, 8));
+                max_vec = _mm_max_epi16(max_vec, _mm_srli_si128(max_vec, 4));
+                max_vec = _mm_max_epi16(max_vec, _mm_srli_si128(max_vec, 2));
+                max = std::max(max, T((_mm_cvtsi128_si32(max_vec) & 0xffff) ^ 0x8000));
+            }
+#elif defined(HAILO_SIMD_NEON)
+            if constexpr (sizeof(T) == 1)
+            {
+                uint8x16_t max_vec = vdupq_n_u8(0);
+                for (; i + 16 <= count; i += 16)
+                    max_vec = vmaxq_u8(max_vec, vld1q_u8(data + i));
+                max = std::max(max, T(vmaxvq_u8(max_vec)));
+            }
+            else
+            {
+                uint16x8_t max_vec = vdupq_n_u16(0);
+                for (; i + 8 <= count; i += 8)
+                    max_vec = vmaxq_u16(max_vec, vld1q_u16(data + i));
+                max = std::max(max, T(vmaxvq_u16(max_vec)));
+            }
+#endif
+        }
+        for (; i < count; i++)
+        {
+            if (data[i] > max)
+                max = data[i];
+        }
+        max_value = max;
+        return find_at_least(data, 0, count, max);
+    }
+
+    template <typename T>
+    size_t argmax(const T *data, size_t count)
+    {
+        T max_value;
+        return argmax(data, count, max_value);
+    }
+
+    /**
+     * @brief Top k of count values read every stride elements, without copying them.
+     *        Indices are written best first, equal values in index order.
+     *
+     * @param data values
+     * @param count number of values
+     * @param stride distance between two values, 1 for contiguous data (scanned with SIMD)
+     * @param k number of indices to take
+     * @param indices output, room for k indices (value i is data[i * stride])
+     * @return size_t number of indices written, min(k, count)
+     */
+    template <typename T>
+    size_t top_k(const T *data, size_t count, size_t stride, size_t k, int *indices)
+    {
+        k = std::min(k, count);
+        if (k == 0)
+            return 0;
+        auto better = [data, stride](int a, int b)
+        {
+            T value_a = data[size_t(a) * stride];
+            T value_b = data[size_t(b) * stride];
+            return value_a > value_b || (value_a == value_b && a < b);
+        };
+        // Heap of the best k so far, its front is the one to evict first
+        size_t i = 0;
+        for (; i < k; i++)
+        {
+            indices[i] = int(i);
+            std::push_heap(indices, indices + i + 1, better);
+        }
+        while (i < count)
+        {
+            T floor = data[size_t(indices[0]) * stride];
+            // Equal values do not evict an earlier index, look for the next strictly greater one
+            if constexpr (std::is_integral<T>::value)
+            {
+                if (floor == std::numeric_limits<T>::max())
+                    break;
+                if (stride == 1)
+                    i = find_at_least(data, i, count, T(floor + 1));
+                else
+                    while (i < count && data[i * stride] <= floor)
+                        i++;
+            }
+            else
+            {
+                while (i < count && !(data[i * stride] > floor))
+                    i++;
+            }
+            if (i == count)
+                break;
+            std::pop_heap(indices, indices + k, better);
+            indices[k - 1] = int(i++);
+            std::push_heap(indices, indices + k, better);
+        }
+        std::sort_heap(indices, indices + k, better);
+        return k;
+    }
+
+    /**
+     * @brief One probability of the softmax of scale * data, computed without the rest of the distribution.
+     *        The zero point of quantized data cancels out of the softmax.
+     *
+     * @param data values
+     * @param count number of values
+     * @param index index of the probability to compute
+     * @param scale dequantization scale
+     * @return float
+     */
+    template <typename T>
+    float softmax_at(const T *data, size_t count, size_t index, float scale)
+    {
+        const float reference = float(data[index]);
+        float sum = 0.0f;
+        for (size_t i = 0; i < count; i++)
+            sum += std::exp(scale * (float(data[i]) - reference));
+        return 1.0f / sum;
+    }
+
     //-------------------------------
     // COMMON FILTERS
     //-------------------------------
+    /**
+     * @brief Flat indices of the k largest values of data, best first.
+     *
+     * @param data array
+     * @param k number of indices to take
+     * @return xt::xarray<int>
+     */
     template <typename T>
     xt::xarray<int> top_k(xt::xarray<T> &data, const int k)
     {
-        // First we negate the array so that we sort in descending order.
-        auto descending_order_array = xt::eval(-data);
-        // Partition the array so the k "smallest" items are first (argpartition returns this as an index array).
-        // Since we negated the values first, we are actually partitioning the largest values.
-        xt::xarray<int> krange = xt::arange<int>(0, k);
-        xt::xarray<int> index_array = xt::argpartition(descending_order_array, krange, xt::xnone());
-
-        // We only want the k first indices, so make a view that "takes" these.
-        auto topk_index_array = xt::view(xt::reshape_view(index_array, data.shape()), xt::all(), xt::range(0, k));
-        return topk_index_array;
+        xt::xarray<int> indices = xt::empty<int>({std::min<size_t>(k, data.size())});
+        top_k(data.data(), data.size(), 1, k, indices.data());
+        return indices;
     }
 
     xt::xarray<float> vector_normalization(xt::xarray<float> &data)
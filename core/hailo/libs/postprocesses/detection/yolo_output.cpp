@@ -26,12 +26,23 @@ std::pair<uint, float> YoloOutputLayer::get_class(uint row, uint col, uint ancho
 float YoloOutputLayer::get_confidence(uint row, uint col, uint anchor)
 {
     uint channel = _tensor->features() / NUM_ANCHORS * anchor + CONF_CHANNEL_OFFSET;
-    float confidence = _tensor->get_full_percision(row, col, channel, _is_uint16);
+    return dequantize_confidence(_is_uint16 ? _tensor->get_uint16(row, col, channel) : _tensor->get(row, col, channel));
+}
+
+float YoloOutputLayer::dequantize_confidence(uint quantized)
+{
+    float confidence = _tensor->fix_scale(quantized);
     if (_perform_sigmoid)
         confidence = sigmoid(confidence);
     return confidence;
 }
 
+YoloOutputLayer::ScoreLayout YoloOutputLayer::get_score_layout(uint anchor)
+{
+    uint anchor_channel = _tensor->features() / NUM_ANCHORS * anchor;
+    return {_tensor, anchor_channel + CONF_CHANNEL_OFFSET, _tensor, anchor_channel + CLASS_CHANNEL_OFFSET + label_offset - 1, _is_uint16};
+}
+
 float YoloOutputLayer::sigmoid(float x)
 {
     // returns the value of the sigmoid function f(x) = 1/(1 + e^-x)
@@ -101,12 +112,23 @@ std::pair<float, float> Yolov3OL::get_center(uint row, uint col, uint anchor)
 
 float Yolov4OL::get_confidence(uint row, uint col, uint anchor)
 {
-    float confidence = _obj->get_full_percision(row, col, anchor, _is_uint16);
+    return dequantize_confidence(_is_uint16 ? _obj->get_uint16(row, col, anchor) : _obj->get(row, col, anchor));
+}
+
+float Yolov4OL::dequantize_confidence(uint quantized)
+{
+    float confidence = _obj->fix_scale(quantized);
     if (_perform_sigmoid)
         confidence = sigmoid(confidence);
     return confidence;
 }
 
+YoloOutputLayer::ScoreLayout Yolov4OL::get_score_layout(uint anchor)
+{
+    // class scores are read as uint8 whatever the format of the other outputs
+    return {_obj, anchor, _cls, _num_classes * anchor + label_offset - 1, false};
+}
+
 uint Yolov4OL::get_class_prob(uint row, uint col, uint anchor, uint class_id)
 {
     uint channel = _num_classes * anchor + class_id - 1;
@@ -173,12 +195,23 @@ std::pair<float, float> TinyYolov4OL::get_shape(uint row, uint col, uint anchor,
 
 float YoloXOL::get_confidence(uint row, uint col, uint anchor)
 {
-    float confidence = _obj->get_full_percision(row, col, 0, _is_uint16);
+    return dequantize_confidence(_is_uint16 ? _obj->get_uint16(row, col, 0) : _obj->get(row, col, 0));
+}
+
+float YoloXOL::dequantize_confidence(uint quantized)
+{
+    float confidence = _obj->fix_scale(quantized);
     if (_perform_sigmoid)
         confidence = sigmoid(confidence);
     return confidence;
 }
 
+YoloOutputLayer::ScoreLayout YoloXOL::get_score_layout(uint anchor)
+{
+    // class scores are read as uint8 whatever the format of the other outputs
+    return {_obj, 0, _cls, uint(label_offset - 1), false};
+}
+
 uint YoloXOL::get_class_prob(uint row, uint col, uint anchor, uint class_id)
 {
     return _cls->get(row, col, class_id - 1);
@@ -81,6 +81,47 @@ public:
      */
     virtual std::pair<float, float> get_shape(uint row, uint col, uint anchor, uint image_width, uint image_height) = 0;
 
+    /**
+     * @brief Where the quantized scores of one anchor are. For cell (row, col) the objectness is at
+     *        obj_channel and the score of class label_offset at cls_channel, the other classes follow it.
+     */
+    struct ScoreLayout
+    {
+        HailoTensorPtr obj;
+        uint obj_channel;
+        HailoTensorPtr cls;
+        uint cls_channel;
+        bool cls_uint16;
+    };
+    /**
+     * @brief Get the score layout of an anchor
+     *
+     * @param anchor
+     * @return ScoreLayout
+     */
+    virtual ScoreLayout get_score_layout(uint anchor);
+    /**
+     * @brief Confidence of a quantized objectness value, as get_confidence computes it.
+     *
+     * @param quantized
+     * @return float
+     */
+    virtual float dequantize_confidence(uint quantized);
+    /**
+     * @brief Get the class confidence of a quantized class score
+     *
+     * @param prob_max
+     * @return float
+     */
+    float class_confidence(uint prob_max) { return get_class_conf(prob_max); }
+    /**
+     * @brief Number of distinct anchors of the layer.
+     *
+     * @return uint
+     */
+    virtual uint num_anchors() { return NUM_ANCHORS; }
+    bool is_uint16() { return _is_uint16; }
+
 protected:
     bool _perform_sigmoid;
     bool _is_uint16;
@@ -176,6 +217,8 @@ public:
     virtual uint get_class_prob(uint row, uint col, uint anchor, uint channel);
     virtual float get_class_conf(uint prob_max);
     virtual std::pair<float, float> get_shape(uint row, uint col, uint anchor, uint image_width, uint image_height);
+    virtual ScoreLayout get_score_layout(uint anchor);
+    virtual float dequantize_confidence(uint quantized);
 
 protected:
     HailoTensorPtr _center;
@@ -227,6 +270,10 @@ public:
     virtual float get_class_conf(uint prob_max);
     virtual std::pair<float, float> get_center(uint row, uint col, uint anchor);
     virtual std::pair<float, float> get_shape(uint row, uint col, uint anchor, uint image_width, uint image_height);
+    virtual ScoreLayout get_score_layout(uint anchor);
+    virtual float dequantize_confidence(uint quantized);
+    // One prediction per cell
+    virtual uint num_anchors() { return NUM_ANCHORS; }
 
 protected:
     HailoTensorPtr _bbox;
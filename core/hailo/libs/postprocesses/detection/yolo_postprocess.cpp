@@ -6,11 +6,13 @@
 #include <cmath>
 #include <vector>
 #include <algorithm>
+#include <limits>
 #include <sstream>
 
 #include "yolo_postprocess.hpp"
-#include "common/nms.hpp"
+#include "hailo_nms.hpp"
 #include "json_config.hpp"
+#include "common/math.hpp"
 
 #include "rapidjson/document.h"
 #include "rapidjson/stringbuffer.h"
@@ -54,13 +56,8 @@ public:
         {
             extract_boxes(layer, objects);
         }
-        common::nms(objects, _iou_thr);
-        if (objects.size() > _max_boxes)
-        {
-            HailoBBox bbox(0, 0, 1, 1);
-            HailoDetection empty_detection(bbox, "None", 0.0);
-            objects.resize(_max_boxes, empty_detection);
-        }
+        // Survivors come out in highest score order, so NMS can stop as soon as _max_boxes were kept.
+        hailo_nms::nms(objects, hailo_nms::NmsConfig{_iou_thr, false, _max_boxes});
 
         return objects;
     }
@@ -79,11 +76,114 @@ public:
      */
     void extract_boxes(std::shared_ptr<YoloOutputLayer> layer,
                        std::vector<HailoDetection> &objects);
+
+private:
+    /**
+     * @brief Extract the boxes of a layer on its quantized scores: objectness is compared to a quantized
+     *        threshold and the class argmax only runs on the cells that pass it.
+     *        Gives the same detections as the generic loop in the same order.
+     *
+     * @param[in] layer Output layer, its scores must be laid out as described by get_score_layout.
+     * @param[out] objects Reference to vector of detections.
+     */
+    template <typename TObj, typename TCls>
+    void extract_quantized_boxes(std::shared_ptr<YoloOutputLayer> layer,
+                                 std::vector<HailoDetection> &objects);
 };
 
+template <typename TObj, typename TCls>
+void YoloPost::extract_quantized_boxes(std::shared_ptr<YoloOutputLayer> layer,
+                                       std::vector<HailoDetection> &objects)
+{
+    // The confidence grows with the quantized objectness, search the smallest value that passes the threshold
+    uint low = 0;
+    uint high = uint(std::numeric_limits<TObj>::max()) + 1;
+    while (low < high)
+    {
+        uint mid = (low + high) / 2;
+        if (layer->dequantize_confidence(mid) < _detection_thr)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low > std::numeric_limits<TObj>::max())
+        return;
+    const TObj obj_threshold = TObj(low);
+
+    const uint num_anchors = layer->num_anchors();
+    const uint num_class_scores = layer->_num_classes - layer->label_offset + 1;
+    const size_t num_cells = size_t(layer->_height) * layer->_width;
+    std::vector<YoloOutputLayer::ScoreLayout> layouts;
+    layouts.reserve(num_anchors);
+    for (uint anchor = 0; anchor < num_anchors; ++anchor)
+        layouts.push_back(layer->get_score_layout(anchor));
+    const HailoTensorPtr &obj_tensor = layouts[0].obj;
+    const TObj *obj = reinterpret_cast<const TObj *>(obj_tensor->data());
+    const uint obj_features = obj_tensor->features();
+
+    auto decode_cell = [&](size_t cell, uint anchor)
+    {
+        const YoloOutputLayer::ScoreLayout &layout = layouts[anchor];
+        uint row = cell / layer->_width;
+        uint col = cell % layer->_width;
+        float confidence = layer->dequantize_confidence(obj[cell * obj_features + layout.obj_channel]);
+        const TCls *class_scores = reinterpret_cast<const TCls *>(layout.cls->data()) + cell * layout.cls->features() + layout.cls_channel;
+        TCls prob_max;
+        size_t class_index = common::argmax(class_scores, num_class_scores, prob_max);
+        // Same tie breaking as get_class: first maximal class, class 1 when every score is 0
+        uint class_id = prob_max > 0 ? layer->label_offset + class_index : 1;
+        confidence = confidence * layer->class_confidence(prob_max);
+        if (confidence > _detection_thr)
+        {
+            float x, y, w, h;
+            std::tie(x, y) = layer->get_center(row, col, anchor);
+            std::tie(w, h) = layer->get_shape(row, col, anchor, m_image_width, m_image_height);
+            objects.push_back(HailoDetection(HailoBBox(x - (w / 2.0f), y - (h / 2.0f), w, h), class_id, m_dataset[class_id], confidence));
+        }
+    };
+
+    bool contiguous_obj = (obj_features == num_anchors);
+    for (uint anchor = 0; anchor < num_anchors; ++anchor)
+        contiguous_obj = contiguous_obj && (layouts[anchor].obj_channel == anchor);
+    if (contiguous_obj)
+    {
+        // Objectness has its own output, scan all the cells and anchors of the layer at once
+        common::compact_at_least(obj, num_cells * num_anchors, obj_threshold, [&](size_t i)
+                                 { decode_cell(i / num_anchors, i % num_anchors); });
+        return;
+    }
+    for (size_t cell = 0; cell < num_cells; ++cell)
+    {
+        const TObj *cell_obj = obj + cell * obj_features;
+        for (uint anchor = 0; anchor < num_anchors; ++anchor)
+        {
+            if (cell_obj[layouts[anchor].obj_channel] >= obj_threshold)
+                decode_cell(cell, anchor);
+        }
+    }
+}
+
 void YoloPost::extract_boxes(std::shared_ptr<YoloOutputLayer> layer,
                              std::vector<HailoDetection> &objects)
 {
+    YoloOutputLayer::ScoreLayout layout = layer->get_score_layout(0);
+    // Scores are compared quantized, which needs a growing dequantization and classes starting at 1
+    if (layer->label_offset >= 1 && uint(layer->label_offset) <= layer->_num_classes &&
+        layout.obj->vstream_info().quant_info.qp_scale > 0 &&
+        layout.obj->width() == layer->_width && layout.obj->height() == layer->_height &&
+        layout.cls->width() == layer->_width && layout.cls->height() == layer->_height)
+    {
+        if (layer->is_uint16() && layout.cls_uint16)
+            extract_quantized_boxes<uint16_t, uint16_t>(layer, objects);
+        else if (layer->is_uint16())
+            extract_quantized_boxes<uint16_t, uint8_t>(layer, objects);
+        else if (layout.cls_uint16)
+            extract_quantized_boxes<uint8_t, uint16_t>(layer, objects);
+        else
+            extract_quantized_boxes<uint8_t, uint8_t>(layer, objects);
+        return;
+    }
+
     uint class_id = 0;
     float x, y, h, w, confidence, class_confidence = 0.0f;
     float xmin, ymin = 0.0f;
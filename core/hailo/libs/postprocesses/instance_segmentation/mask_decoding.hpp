@@ -3,6 +3,8 @@
 #include "xtensor/xmath.hpp"
 #include "xtensor/xadapt.hpp"
 
+#include "hailo_simd.hpp"
+
 
 /**
  * @brief  Compute sigmoid, not in-place (lazy)
@@ -19,90 +21,142 @@ auto xtensor_sigmoid(auto &tensor)
 inline float sigmoid(float x) { return 1.0f / (1.0f + std::exp(-1.0 * x)); }
 
 /**
- * @brief  Compute tensor dot product along specified axes for arrays.
-            In this case along axis 2 of the first matrix and axis 0 of the second.
+ * @brief A quantized proto layer, as received from the network (height x width x channels, uint8).
+ */
+struct QuantizedProto
+{
+    const uint8_t *data;
+    int height;
+    int width;
+    int channels;
+    float qp_zp;
+    float qp_scale;
+};
+
+/**
+ * @brief  Dot product of the channels of one quantized proto pixel with the mask coefficients.
+ *         The quantized values are widened to float in registers, 16 channels per step.
  *
- * @param matrix_1 left matrix in the dot product
- * @param matrix_2 right matrix in the dot product
- * @return xt::xarray<float> the dot product result
+ * @param pixel the proto channels of the pixel
+ * @param coefficients the mask coefficients, one per channel
+ * @param channels number of channels
+ * @return float the dot product
  */
-xt::xarray<float> dot_product_axis_2(xt::xarray<float, xt::layout_type::row_major> matrix_1,
-                                     xt::xarray<float, xt::layout_type::row_major> matrix_2)
+inline float proto_pixel_dot(const uint8_t *pixel, const float *coefficients, int channels)
 {
-    uint axis_length = matrix_1.shape(2);
-    if (axis_length != matrix_2.shape(0))
+    int k = 0;
+    float sum = 0.0f;
+#if defined(HAILO_SIMD_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+    for (; k + 16 <= channels; k += 16)
     {
-        throw std::invalid_argument("dot_product_axis_2 error: axis don't match!");
+        __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixel + k));
+        __m128i low = _mm_unpacklo_epi8(values, zero);
+        __m128i high = _mm_unpackhi_epi8(values, zero);
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), _mm_loadu_ps(coefficients + k)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), _mm_loadu_ps(coefficients + k + 4)));
+        acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), _mm_loadu_ps(coefficients + k + 8)));
+        acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), _mm_loadu_ps(coefficients + k + 12)));
     }
-    float row_sum;
-    xt::xarray<float>::shape_type shape = {matrix_1.shape(0), matrix_1.shape(1)};
-    xt::xarray<float, xt::layout_type::row_major> product_matrix(shape);
-    for (uint i = 0; i < matrix_1.shape(0); ++i)
+    __m128 acc = _mm_add_ps(_mm_add_ps(acc0, acc1), _mm_add_ps(acc2, acc3));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    sum = _mm_cvtss_f32(acc);
+#elif defined(HAILO_SIMD_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f), acc2 = vdupq_n_f32(0.0f), acc3 = vdupq_n_f32(0.0f);
+    for (; k + 16 <= channels; k += 16)
     {
-        for (uint j = 0; j < matrix_1.shape(1); ++j)
-        {
-            row_sum = 0.0;
-            for (uint k = 0; k < axis_length; ++k)
-            {
-                row_sum += matrix_1(i, j, k) * matrix_2(k);
-            }
-            product_matrix(i, j) = row_sum;
-        }
+        uint8x16_t values = vld1q_u8(pixel + k);
+        uint16x8_t low = vmovl_u8(vget_low_u8(values));
+        uint16x8_t high = vmovl_u8(vget_high_u8(values));
+        acc0 = vmlaq_f32(acc0, vcvtq_f32_u32(vmovl_u16(vget_low_u16(low))), vld1q_f32(coefficients + k));
+        acc1 = vmlaq_f32(acc1, vcvtq_f32_u32(vmovl_u16(vget_high_u16(low))), vld1q_f32(coefficients + k + 4));
+        acc2 = vmlaq_f32(acc2, vcvtq_f32_u32(vmovl_u16(vget_low_u16(high))), vld1q_f32(coefficients + k + 8));
+        acc3 = vmlaq_f32(acc3, vcvtq_f32_u32(vmovl_u16(vget_high_u16(high))), vld1q_f32(coefficients + k + 12));
+    }
+    sum = vaddvq_f32(vaddq_f32(vaddq_f32(acc0, acc1), vaddq_f32(acc2, acc3)));
+#endif
+    for (; k < channels; k++)
+    {
+        sum += pixel[k] * coefficients[k];
     }
-    return product_matrix;
+    return sum;
 }
 
 /*
- * @brief Decode the mask coefficients of yolov5seg results into a format that makes sense
- * and add it to the detected instance for future calculation of the final mask
+ * @brief Decode the mask coefficients of a yolov5seg result into a format that makes sense
+ * and add it to the detected instance for future calculation of the final mask.
+ * Only the proto region under the detection box is dequantized and multiplied,
+ * the dequantization is folded into the coefficients: (q - zp) * scale . c = q . (c * scale) - zp * sum(c * scale)
  *
- * @param objects vector of the detected instances
- * @param proto the 32 mask prototypes that the coefficients select portions of to form the mask
+ * @param instance the detected instance
+ * @param proto the mask prototypes that the coefficients select portions of to form the mask
  */
-void decode_masks(std::vector<HailoDetection> &objects, const xt::xarray<float> &proto)
+void decode_mask(HailoDetection &instance, const QuantizedProto &proto)
 {
-    xt::xarray<float>::shape_type mask_shape = {proto.shape(0), proto.shape(1)};
-    int proto_width = proto.shape(0);
-    int proto_height = proto.shape(1);
-    int xmin, ymin, xmax, ymax;
-    for (auto &instance : objects)
+    // Gather the detection bounds for this instance,
+    // they are relative scale so multiply by proto size
+    HailoBBox bbox = instance.get_bbox();
+    int xmin = CLAMP(bbox.xmin() * proto.width, 0, proto.width);
+    int xmax = CLAMP(bbox.xmax() * proto.width, 0, proto.width);
+    int ymin = CLAMP(bbox.ymin() * proto.height, 0, proto.height);
+    int ymax = CLAMP(bbox.ymax() * proto.height, 0, proto.height);
+    HailoMatrixPtr matrix = NULL;
+    for (auto obj : instance.get_objects())
     {
-        // Gather the detection bounds for this instance,
-        // they are relative scale so multiply by proto size
-        HailoBBox bbox = instance.get_bbox();
-        xmin = CLAMP(bbox.xmin() * proto_width, 0, proto_width);
-        xmax = CLAMP(bbox.xmax() * proto_width, 0, proto_width);
-        ymin = CLAMP(bbox.ymin() * proto_height, 0, proto_height);
-        ymax = CLAMP(bbox.ymax() * proto_height, 0, proto_height);
-        // Crop a view of the proto layer of just this instance's detection area
-        auto cropped_proto = xt::view(proto, xt::range(ymin, ymax), xt::range(xmin, xmax));
-        HailoMatrixPtr matrix = NULL;
-        for (auto obj : instance.get_objects())
+        if (obj->get_type() == HAILO_MATRIX)
         {
-            if (obj->get_type() == HAILO_MATRIX)
-            {
-                matrix = std::dynamic_pointer_cast<HailoMatrix>(obj);
-            }
+            matrix = std::dynamic_pointer_cast<HailoMatrix>(obj);
         }
-        if (matrix == NULL) // no mask attached
+    }
+    if (matrix == NULL) // no mask attached
+    {
+        return;
+    }
+    if (matrix->height() != (uint)proto.channels)
+    {
+        throw std::invalid_argument("decode_mask error: axis don't match!");
+    }
+
+    // Scale the coefficients by the proto quantization
+    std::vector<float> coefficients(matrix->get_data());
+    float bias = 0.0f;
+    for (auto &coefficient : coefficients)
+    {
+        coefficient *= proto.qp_scale;
+        bias -= proto.qp_zp * coefficient;
+    }
+    instance.remove_object(matrix); // not needed anymore
+
+    // Multiply the cropped proto region by the coefficients and take the sigmoid, row major (height x width)
+    int mask_width = xmax - xmin;
+    int mask_height = ymax - ymin;
+    std::vector<float> data((size_t)mask_width * mask_height);
+    float *out = data.data();
+    for (int y = ymin; y < ymax; y++)
+    {
+        const uint8_t *pixel = proto.data + ((size_t)y * proto.width + xmin) * proto.channels;
+        for (int x = xmin; x < xmax; x++, pixel += proto.channels)
         {
-            return;
+            *out++ = sigmoid(proto_pixel_dot(pixel, coefficients.data(), proto.channels) + bias);
         }
-        xt::xarray<int>::shape_type shape = {matrix->height()};
-        xt::xarray<float> mask_coefficients = xt::adapt(matrix->get_data().data(), matrix->height(), xt::no_ownership(), shape);
-
-        // Calculate a matrix multiplication of the instance's coefficients and the cropped proto layer and transpose it
-        xt::xarray<float, xt::layout_type::column_major> cropped_mask = xt::transpose(dot_product_axis_2(cropped_proto, mask_coefficients));
-        instance.remove_object(matrix); // not needed anymore
+    }
 
-        // Calculate the sigmoid of the mask
-        cropped_mask = xtensor_sigmoid(cropped_mask);
+    // Add the mask to the object meta
+    instance.add_object(std::make_shared<HailoConfClassMask>(std::move(data), mask_width, mask_height, 0.3, instance.get_class_id()));
+}
 
-        // allocate and memcpy to a new memory so it points to the right data
-        std::vector<float> data(cropped_mask.shape(0) * cropped_mask.shape(1));
-        memcpy(data.data(), cropped_mask.data(), sizeof(float) * cropped_mask.shape(0) * cropped_mask.shape(1));
-        
-        // Add the mask to the object meta
-        instance.add_object(std::make_shared<HailoConfClassMask>(std::move(data), cropped_mask.shape(0), cropped_mask.shape(1), 0.3, instance.get_class_id()));
+/*
+ * @brief Decode the mask coefficients of yolov5seg results, see decode_mask
+ *
+ * @param objects vector of the detected instances
+ * @param proto the mask prototypes that the coefficients select portions of to form the mask
+ */
+void decode_masks(std::vector<HailoDetection> &objects, const QuantizedProto &proto)
+{
+    for (auto &instance : objects)
+    {
+        decode_mask(instance, proto);
     }
 }
@@ -2,8 +2,10 @@
 #include "xtensor/xsort.hpp"
 #include "xtensor/xpad.hpp"
 #include "hailo_common.hpp"
+#include "worker_pool.hpp"
 #include "common/tensors.hpp"
 #include "common/nms.hpp"
+#include "common/math.hpp"
 #include "common/labels/coco_eighty.hpp"
 #include "mask_decoding.hpp"
 
@@ -14,8 +16,6 @@
 #include "rapidjson/filereadstream.h"
 #include "rapidjson/schema.h"
 
-#include <thread>
-#include <future>
 #include <iterator>
 #if __GNUC__ > 8
 #include <filesystem>
@@ -74,165 +74,113 @@ std::tuple<xt::xarray<float>, xt::xarray<float>> make_grid(xt::xarray<float> &an
 }
 
 /*
- * @brief Returns a vector of indices, of detections that have: is_object * max(class_confidence) > score_threshold
+ * @brief Does the decoding and the filtering for one output branch, directly on its quantized data, and returns the HailoDetections.
+ * Each row of the branch holds x, y, w, h, is_object, the class scores and the mask coefficients of one anchor of one cell.
+ * Rows are rejected on the quantized is_object alone, the class argmax is taken on the quantized scores
+ * (dequantization is monotonic), and only surviving rows are dequantized and decoded.
  *
- * @param all_scores an xview with the confidence scores for each class, for each detection
- * @param all_is_object an xview with the confidence that this detection is an object, for each detection
- * @param score_threshold float
- */
-auto filter_above_threshold(auto &all_scores, auto &is_object_threshold, const float score_threshold, const uint16_t threshold_quantized, const float qp_zp, const float qp_scale)
-{
-    std::vector<uint> indices;
-    std::vector<float> scores;
-    std::vector<uint> classes;
-    int this_index;
-    float conf_deq, is_object_deq;
-    uint16_t is_object;
-    for (uint i = 0; i < is_object_threshold.size(); i++)
-    {
-        // first check if the object parameter is bigger than threshold
-        is_object = is_object_threshold(i, 0);
-        if (is_object > threshold_quantized)
-        {
-            this_index = xt::argmax(xt::row(all_scores, i))(0) + 1;
-            // dequantize and decode
-            conf_deq = sigmoid(dequant(all_scores(i, this_index - 1), qp_zp, qp_scale));
-            is_object_deq = sigmoid(dequant(is_object, qp_zp, qp_scale));
-            if (conf_deq*is_object_deq > score_threshold)
-            {
-                indices.emplace_back(i);
-                scores.emplace_back(conf_deq * is_object_deq);
-                classes.emplace_back(this_index);
-        }
-    }
-    }
-    return std::tuple<std::vector<uint>, std::vector<float>, std::vector<uint>>(std::move(indices), std::move(scores), std::move(classes));
-}
-
-/*
- * @brief Gets the xviews of the decoded and filtered results, and adds them to a vector of HailoDetections
- *
- * @param size int representing amount of detections
- * @param boxes xview of (x, y, w, h), x and y are the center of the box
- * @param is_object an xview with the confidence that this detection is an object, for each detection
- * @param scores an xview with the confidence scores for each class, for each detection
- * @param masks an xview with 32 coefficients representing a mask per detection
- * @param objects a vecor of HailoDetections, to which the detections will be added
+ * @param data the quantized output of the branch, {h, w, num_anchors * row_size}
+ * @param h height of the branch
+ * @param w width of the branch
+ * @param channels number of channels of the branch
+ * @param stride
+ * @param grid the grid of this branch, {h, w, num_anchors, 2}
+ * @param anchor_grid the anchor grid of this branch, {h, w, num_anchors, 2}
  *  */
-std::vector<HailoDetection> create_hailo_detections(auto &scores_vec, auto &classes_vec, auto &xy, auto wh, auto &masks, const int input_width, const int input_height)
+std::vector<HailoDetection> yolov5_decoding(const uint16_t *data, const int h, const int w, const int channels, const int stride, const float *grid, const float *anchor_grid, const int num_anchors, const float score_threshold, float qp_zp, float qp_scale, const int input_width, const int input_height)
 {
-    int class_index;
-    float confidence, w, h, x, y = 0.0;
+    const int num_classes = (channels / num_anchors) - BOX_CO - 1 - MASK_CO;
+    const int row_size = BOX_CO + 1 + num_classes + MASK_CO;
+    const int num_rows = num_anchors * h * w;
+    // quantize the score threshold + "undecode" it (do inverse of sigmoid), to avoid doing dequantization and decoding on all class scores
+    const uint16_t threshold_quantized = quant(inverse_sigmoid(score_threshold), qp_zp, qp_scale);
+
     std::vector<HailoDetection> objects;
-    for (uint i = 0; i < scores_vec.size(); i++)
+    for (int i = 0; i < num_rows; i++)
     {
-        // Get the box parameters for this box
-        x = (xy(i, 0)) / input_width;
-        y = (xy(i, 1)) / input_height;
-        w = (wh(i, 0)) / input_width;
-        h = (wh(i, 1)) / input_height;
-        // x and y represented center of box, so they need to be changed to left bottom corner
-        HailoBBox bbox(x - w / 2, y - h / 2, w, h);
-        class_index = classes_vec[i];
-        std::string label = common::coco_eighty[class_index];
-        confidence = scores_vec[i];
-        // create mask
-        xt::xarray<float> mask_coefficients = xt::squeeze(xt::view(masks, xt::keep(i), xt::all()));
-        HailoDetection detected_instance(bbox, class_index, label, confidence);
-        std::vector<float> data(mask_coefficients.shape(0));
-        memcpy(data.data(), mask_coefficients.data(), sizeof(float) * mask_coefficients.shape(0));
-        // create the detection itself
-        detected_instance.add_object((std::make_shared<HailoMatrix>(data, mask_coefficients.shape(0), 1)));
-        objects.push_back(detected_instance);
-    }
-    return objects;
-}
-
-/*
- * @brief Does the decoding and the filtering for the output, and adds the results to the HailoDetections vector
- *
- *  */
-std::vector<HailoDetection> yolov5_decoding(xt::xarray<uint16_t> &output, const int stride, xt::xarray<float> &anchors, xt::xarray<float> &grid, xt::xarray<float> &anchor_grid, const int num_anchors, const float score_threshold, float qp_zp, float qp_scale, const int input_width, const int input_height)
-{
-    int h = output.shape()[0];
-    int w = output.shape()[1];
-    int num_classes = (output.shape()[2] / 3) - BOX_CO - 1 - MASK_CO;
-
-    // prepare data for filter function
-    auto all_decoded = xt::reshape_view(output, {num_anchors * h * w, BOX_CO + 1 + num_classes + MASK_CO}); // {number of detections, 117}
-    auto all_is_object = xt::view(all_decoded, xt::all(), xt::range(4, 5));
-    auto all_scores = xt::view(all_decoded, xt::all(), xt::range(5, num_classes + 5));
-    // quantize the score threshold + "undecode" it (do inverse of sigmoid), to avoid doing dequantization and decoding on all class scores
-    uint16_t threshold_quantized = quant(inverse_sigmoid(score_threshold), qp_zp, qp_scale);
-    auto filtered = filter_above_threshold(all_scores, all_is_object, score_threshold, threshold_quantized, qp_zp, qp_scale);
-    std::vector<uint> indices = std::get<0>(filtered);
-    std::vector<float> scores_vec = std::get<1>(filtered);
-    std::vector<uint> classes_vec = std::get<2>(filtered);
+        const uint16_t *row = data + (size_t)i * row_size;
+        // first check if the object parameter is bigger than threshold
+        const uint16_t is_object = row[BOX_CO];
+        if (is_object <= threshold_quantized)
+            continue;
 
-    // filter xy and grid
-    auto xy = xt::view(all_decoded, xt::all(), xt::range(_, 2));
-    auto reshaped_grid = xt::reshape_view(grid, xy.shape());
-    auto filtered_xy = xt::view(xy, xt::keep(indices), xt::all());
-    auto filtered_grid = xt::view(reshaped_grid, xt::keep(indices), xt::all());
-    // dequantize and decode xy
-    xt::xarray<float> deq_xy = (filtered_xy - qp_zp) * qp_scale;
-    deq_xy = (xtensor_sigmoid(deq_xy) * 2 + filtered_grid) * stride;
+        const uint16_t *class_scores = row + BOX_CO + 1;
+        int class_index = int(common::argmax(class_scores, num_classes));
+        // dequantize and decode
+        float confidence = sigmoid(dequant(class_scores[class_index], qp_zp, qp_scale)) * sigmoid(dequant(is_object, qp_zp, qp_scale));
+        if (confidence <= score_threshold)
+            continue;
 
-    // filter wh and anchor grid
-    auto wh = xt::view(all_decoded, xt::all(), xt::range(2, 4));
-    auto reshaped_anchor_grid = xt::reshape_view(anchor_grid, wh.shape());
-    auto filtered_wh = xt::view(wh, xt::keep(indices), xt::all());
-    auto filtered_anchor_grid = xt::view(reshaped_anchor_grid, xt::keep(indices), xt::all());
-    // dequantize and decode wh
-    xt::xarray<float> deq_wh = (filtered_wh - qp_zp) * qp_scale;
-    deq_wh = xt::square(xtensor_sigmoid(deq_wh) * 2) * filtered_anchor_grid;
+        // decode the box, x and y are the center of the box
+        const float *cell_grid = grid + (size_t)i * 2;
+        const float *cell_anchor_grid = anchor_grid + (size_t)i * 2;
+        float x = (sigmoid(dequant(row[0], qp_zp, qp_scale)) * 2 + cell_grid[0]) * stride / input_width;
+        float y = (sigmoid(dequant(row[1], qp_zp, qp_scale)) * 2 + cell_grid[1]) * stride / input_height;
+        float box_w = sigmoid(dequant(row[2], qp_zp, qp_scale)) * 2;
+        float box_h = sigmoid(dequant(row[3], qp_zp, qp_scale)) * 2;
+        box_w = box_w * box_w * cell_anchor_grid[0] / input_width;
+        box_h = box_h * box_h * cell_anchor_grid[1] / input_height;
+        // x and y represented center of box, so they need to be changed to left bottom corner
+        HailoBBox bbox(x - box_w / 2, y - box_h / 2, box_w, box_h);
 
-    // filter and dequantize masks
-    auto filtered_masks = xt::view(all_decoded, xt::keep(indices), xt::range(num_classes + 5, _));
-    xt::xarray<float> masks = (filtered_masks - qp_zp) * qp_scale;
+        // dequantize the mask coefficients
+        const uint16_t *mask_row = class_scores + num_classes;
+        std::vector<float> mask_coefficients(MASK_CO);
+        for (int k = 0; k < MASK_CO; k++)
+            mask_coefficients[k] = dequant(mask_row[k], qp_zp, qp_scale);
 
-    // create HailoDetections for the NMS and the mask decoding
-    std::vector<HailoDetection> objects = create_hailo_detections(scores_vec, classes_vec, deq_xy, deq_wh, masks, input_width, input_height);
+        // create the detection itself, classes are 1 based
+        HailoDetection detected_instance(bbox, class_index + 1, common::coco_eighty.at(class_index + 1), confidence);
+        detected_instance.add_object(std::make_shared<HailoMatrix>(std::move(mask_coefficients), MASK_CO, 1));
+        objects.push_back(std::move(detected_instance));
+    }
     return objects;
 }
 
 /*
- * @brief Does dequantize and decoding for each output seperately
+ * @brief Does dequantize and decoding for one output
  *
  *  */
-std::vector<HailoDetection> post_per_branch(std::string branch_name, const int index, std::map<std::string, HailoTensorPtr> tensors, std::vector<xt::xarray<float>> anchor_list, std::vector<int> stride_list, const float iou_threshold, const float score_threshold, std::vector<xt::xarray<float>> grids, std::vector<xt::xarray<float>> anchor_grids, const int num_anchors, const int input_width, const int input_height)
+std::vector<HailoDetection> post_per_branch(HailoTensorPtr &tensor, const int index, const Yolov5segParams &params)
 {
-    auto output = common::get_xtensor_uint16(tensors[branch_name]);
-    float qp_zp = tensors[branch_name]->vstream_info().quant_info.qp_zp;
-    float qp_scale = tensors[branch_name]->vstream_info().quant_info.qp_scale;
-    return yolov5_decoding(output, stride_list[index], anchor_list[index], grids[index], anchor_grids[index], num_anchors, score_threshold, qp_zp, qp_scale, input_width, input_height);
+    const uint16_t *data = reinterpret_cast<const uint16_t *>(tensor->data());
+    float qp_zp = tensor->vstream_info().quant_info.qp_zp;
+    float qp_scale = tensor->vstream_info().quant_info.qp_scale;
+    return yolov5_decoding(data, tensor->height(), tensor->width(), tensor->features(), params.strides[index],
+                           params.grids[index].data(), params.anchor_grids[index].data(), params.num_anchors,
+                           params.score_threshold, qp_zp, qp_scale, params.input_shape[0], params.input_shape[1]);
 }
 
 /*
- * @brief Does dequantize and decoding for each output, and then calls nms and decode masks
+ * @brief Does dequantize and decoding for each output, and then calls nms and decode masks.
+ * The branches, and then the masks of the surviving detections, are spread over the shared worker pool.
  *
  *  */
-std::vector<HailoDetection> yolov5seg_post(auto &tensors, auto &anchor_list, auto &stride_list, const float iou_threshold, const float score_threshold, auto &grids, auto &anchor_grids, const int num_anchors, const int input_width, const int input_height, auto &outputs_name)
+std::vector<HailoDetection> yolov5seg_post(std::map<std::string, HailoTensorPtr> &tensors, const Yolov5segParams &params)
 {
-    auto proto_tensor = common::dequantize(common::get_xtensor(tensors[outputs_name[0]]), tensors[outputs_name[0]]->vstream_info().quant_info.qp_scale, tensors[outputs_name[0]]->vstream_info().quant_info.qp_zp);
+    HailoTensorPtr proto_tensor = tensors[params.outputs_name[0]];
+    // branch i of the outputs (outputs_name[i + 1]) is decoded with the anchors of index (2 - i)
+    std::vector<HailoTensorPtr> branches = {tensors[params.outputs_name[1]], tensors[params.outputs_name[2]], tensors[params.outputs_name[3]]};
+    std::vector<std::vector<HailoDetection>> branch_detections(branches.size());
 
     // run the postprocess for each branch seperately
-    std::future<std::vector<HailoDetection>> t2 = std::async(post_per_branch, outputs_name[1], 2, tensors, anchor_list, stride_list, iou_threshold, score_threshold, grids, anchor_grids, num_anchors, input_width, input_height);
-    std::future<std::vector<HailoDetection>> t1 = std::async(post_per_branch, outputs_name[2], 1, tensors, anchor_list, stride_list, iou_threshold, score_threshold, grids, anchor_grids, num_anchors, input_width, input_height);
-    std::future<std::vector<HailoDetection>> t0 = std::async(post_per_branch, outputs_name[3], 0, tensors, anchor_list, stride_list, iou_threshold, score_threshold, grids, anchor_grids, num_anchors, input_width, input_height);
-    std::vector<HailoDetection> d2 = t2.get();
-    std::vector<HailoDetection> d1 = t1.get();
-    std::vector<HailoDetection> d0 = t0.get();
+    WorkerPool &pool = WorkerPool::shared();
+    pool.run(branches.size(), [&](size_t i)
+             { branch_detections[i] = post_per_branch(branches[i], 2 - i, params); });
 
     // concatenate all detections
     std::vector<HailoDetection> all_detections;
-    all_detections.reserve(d0.size() + d1.size() + d2.size());
-    all_detections.insert(all_detections.end(), d0.begin(), d0.end());
-    all_detections.insert(all_detections.end(), d1.begin(), d1.end());
-    all_detections.insert(all_detections.end(), d2.begin(), d2.end());
+    all_detections.reserve(branch_detections[0].size() + branch_detections[1].size() + branch_detections[2].size());
+    for (auto it = branch_detections.rbegin(); it != branch_detections.rend(); ++it)
+        std::move(it->begin(), it->end(), std::back_inserter(all_detections));
+
+    common::nms(all_detections, params.iou_threshold);
 
-    common::nms(all_detections, iou_threshold);
-    decode_masks(all_detections, proto_tensor);
+    // decode the masks of the detections that survived, straight from the quantized proto
+    QuantizedProto proto = {proto_tensor->data(), (int)proto_tensor->height(), (int)proto_tensor->width(), (int)proto_tensor->features(),
+                            proto_tensor->vstream_info().quant_info.qp_zp, proto_tensor->vstream_info().quant_info.qp_scale};
+    pool.run(all_detections.size(), [&](size_t i)
+             { decode_mask(all_detections[i], proto); });
     return all_detections;
 }
 
@@ -406,7 +354,7 @@ void yolov5seg(HailoROIPtr roi, void *params_void_ptr)
 {
     Yolov5segParams *params = reinterpret_cast<Yolov5segParams *>(params_void_ptr);
     std::map<std::string, HailoTensorPtr> tensors = roi->get_tensors_by_name();
-    std::vector<HailoDetection> detections = yolov5seg_post(tensors, params->anchors, params->strides, params->iou_threshold, params->score_threshold, params->grids, params->anchor_grids, params->num_anchors, params->input_shape[0], params->input_shape[1], params->outputs_name);
+    std::vector<HailoDetection> detections = yolov5seg_post(tensors, *params);
     hailo_common::add_detections(roi, detections);
 }
 
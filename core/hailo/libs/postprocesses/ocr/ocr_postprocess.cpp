@@ -35,14 +35,37 @@ void OCR_postprocess(HailoROIPtr roi, const char *layer_name)
         return;
     }
 
-    xt::xarray<float> output_dequantize;
-    output_dequantize = common::get_xtensor_float(net_output);
-
-    xt::xarray<float> prebs = xt::mean(output_dequantize, 0);
-    xt::xarray<int> preb_label = xt::argmax(prebs, 1);
-
-    common::softmax_2D(prebs.data(), prebs.shape(0), prebs.shape(1));
-    xt::xarray<float> conf_label = xt::amax(prebs, {1});
+    // The predictions are the mean of the output over its height. The mean of the dequantized values is
+    // the dequantized mean, so the labels and their softmax confidence are taken on the quantized sums.
+    const uint height = net_output->height();
+    const uint width = net_output->width();
+    const uint num_chars = net_output->features();
+    const float scale = net_output->vstream_info().quant_info.qp_scale / height;
+    std::vector<int> preb_label(width);
+    std::vector<float> conf_label(width);
+    auto decode_positions = [&](const auto *prebs)
+    {
+        for (uint i = 0; i < width; i++)
+        {
+            preb_label[i] = common::argmax(prebs + i * num_chars, num_chars);
+            conf_label[i] = common::softmax_at(prebs + i * num_chars, num_chars, preb_label[i], scale);
+        }
+    };
+    if (height == 1)
+    {
+        decode_positions(net_output->data());
+    }
+    else
+    {
+        const uint8_t *data = net_output->data();
+        std::vector<uint32_t> prebs(data, data + width * num_chars);
+        for (uint row = 1; row < height; row++)
+        {
+            for (uint i = 0; i < width * num_chars; i++)
+                prebs[i] += data[row * width * num_chars + i];
+        }
+        decode_positions(prebs.data());
+    }
 
     std::vector<int> no_repeat_label_index;
     // this will hold the indices of the recognized chars, from the AVAILABLE_CHARS vector declared in the hpp file
@@ -8,6 +8,7 @@
 
 // Hailo includes
 #include "hailo_xtensor.hpp"
+#include "hailo_nms.hpp"
 #include "common/math.hpp"
 #include "common/tensors.hpp"
 #include "common/labels/coco_eighty.hpp"
@@ -87,56 +88,12 @@ std::pair<std::vector<KeyPt>, std::vector<PairPairs>> filter_keypoints(const std
     return std::make_pair(filtered_keypoints, filtered_pairs);
 }
 
-float iou_calc(const HailoBBox &box_1, const HailoBBox &box_2)
-{
-    // Calculate IOU between two detection boxes
-    const float width_of_overlap_area = std::min(box_1.xmax(), box_2.xmax()) - std::max(box_1.xmin(), box_2.xmin());
-    const float height_of_overlap_area = std::min(box_1.ymax(), box_2.ymax()) - std::max(box_1.ymin(), box_2.ymin());
-    const float positive_width_of_overlap_area = std::max(width_of_overlap_area, 0.0f);
-    const float positive_height_of_overlap_area = std::max(height_of_overlap_area, 0.0f);
-    const float area_of_overlap = positive_width_of_overlap_area * positive_height_of_overlap_area;
-    const float box_1_area = (box_1.ymax() - box_1.ymin()) * (box_1.xmax() - box_1.xmin());
-    const float box_2_area = (box_2.ymax() - box_2.ymin()) * (box_2.xmax() - box_2.xmin());
-    // The IOU is a ratio of how much the boxes overlap vs their size outside the overlap.
-    // Boxes that are similar will have a higher overlap threshold.
-    return area_of_overlap / (box_1_area + box_2_area - area_of_overlap);
-}
-
 std::vector<Decodings> nms(std::vector<Decodings> &decodings, const float iou_thr, bool should_nms_cross_classes = false) {
-
-    std::vector<Decodings> decodings_after_nms;
-
-    for (uint index = 0; index < decodings.size(); index++)
-    {
-        if (decodings[index].detection_box.get_confidence() != 0.0f)
-        {
-            for (uint jindex = index + 1; jindex < decodings.size(); jindex++)
-            {
-                if ((should_nms_cross_classes || (decodings[index].detection_box.get_class_id() == decodings[jindex].detection_box.get_class_id())) &&
-                    decodings[jindex].detection_box.get_confidence() != 0.0f)
-                {
-                    // For each detection, calculate the IOU against each following detection.
-                    float iou = iou_calc(decodings[index].detection_box.get_bbox(), decodings[jindex].detection_box.get_bbox());
-                    // If the IOU is above threshold, then we have two similar detections,
-                    // and want to delete the one.
-                    if (iou >= iou_thr)
-                    {
-                        // The detections are arranged in highest score order,
-                        // so we want to erase the latter detection.
-                        decodings[jindex].detection_box.set_confidence(0.0f);
-                    }
-                }
-            }
-        }
-    }
-    for (uint index = 0; index < decodings.size(); index++)
-    {
-        if (decodings[index].detection_box.get_confidence() != 0.0f)
-        {
-            decodings_after_nms.push_back(Decodings{decodings[index].detection_box, decodings[index].keypoints, decodings[index].joint_pairs});
-        }
-    }
-    return decodings_after_nms;
+    // Survivors are moved to the front in highest score order, the suppressed decodings are erased.
+    hailo_nms::nms(decodings, hailo_nms::NmsConfig{iou_thr, should_nms_cross_classes},
+                   [](Decodings &decoding) -> HailoDetection &
+                   { return decoding.detection_box; });
+    return std::move(decodings);
 }
 
 
@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <cxxopts.hpp>
+
+#define RAPIDJSON_HAS_STDSTRING 1
+#include "rapidjson/document.h"
+#include "rapidjson/error/en.h"
+#include "rapidjson/filereadstream.h"
+#include "rapidjson/filewritestream.h"
+#include "rapidjson/prettywriter.h"
+
+#include "gallery/gallery_store.hpp"
+
+//******************************************************************
+// MAIN
+//******************************************************************
+/**
+ * @brief Build command line arguments.
+ *
+ * @return cxxopts::Options
+ *         The available user arguments.
+ */
+cxxopts::Options build_arg_parser()
+{
+    cxxopts::Options options("hailo_gallery_tool", "Convert hailogallery files between the JSON and the binary gallery formats");
+    options.add_options()
+    ("h,help", "Show this help")
+    ("import", "Append the identities of a JSON gallery to the binary gallery given by --gallery", cxxopts::value<std::string>())
+    ("export", "Write the binary gallery given by --gallery to a JSON gallery", cxxopts::value<std::string>())
+    ("compact", "Fold the log of the binary gallery given by --gallery into its snapshot")
+    ("g,gallery", "Binary gallery path", cxxopts::value<std::string>());
+    return options;
+}
+
+/**
+ * @brief Append the embeddings of a JSON gallery to a store, every embedding of an entry is saved with the entry name.
+ */
+size_t import_json(const std::string &json_path, GalleryStore &store)
+{
+    FILE *json_file = fopen(json_path.c_str(), "r");
+    if (json_file == nullptr)
+        throw std::runtime_error("Gallery JSON file " + json_path + " can not be opened");
+    char read_buffer[65536];
+    rapidjson::FileReadStream stream(json_file, read_buffer, sizeof(read_buffer));
+    rapidjson::Document document;
+    document.ParseStream(stream);
+    fclose(json_file);
+    if (document.HasParseError() || !document.IsArray())
+        throw std::runtime_error("Gallery JSON file " + json_path + " is not valid: " + rapidjson::GetParseError_En(document.GetParseError()));
+
+    size_t count = 0;
+    std::vector<float> data;
+    for (rapidjson::Value &entry : document.GetArray())
+    {
+        if (!entry.HasMember("FaceRecognition"))
+            continue;
+        rapidjson::Value &recognition = entry["FaceRecognition"];
+        std::string name = recognition["Name"].GetString();
+        for (rapidjson::Value &embedding : recognition["Embeddings"].GetArray())
+        {
+            rapidjson::Value &matrix = embedding["HailoMatrix"];
+            data.clear();
+            for (rapidjson::Value &value : matrix["data"].GetArray())
+                data.push_back(value.GetFloat());
+            uint32_t height = matrix["height"].GetUint();
+            uint32_t width = matrix["width"].GetUint();
+            uint32_t features = matrix["features"].GetUint();
+            if (data.size() != size_t(height) * width * features)
+                throw std::runtime_error("Gallery JSON file " + json_path + " has an embedding of the wrong size");
+            store.append(++count, name, data.data(), height, width, features);
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Write a store as a JSON gallery, in the format hailogallery saves JSON galleries.
+ */
+size_t export_json(GalleryStore &store, const std::string &json_path)
+{
+    FILE *json_file = fopen(json_path.c_str(), "w");
+    if (json_file == nullptr)
+        throw std::runtime_error("Gallery JSON file " + json_path + " can not be created");
+    char write_buffer[65536];
+    rapidjson::FileWriteStream stream(json_file, write_buffer, sizeof(write_buffer));
+    rapidjson::PrettyWriter<rapidjson::FileWriteStream> writer(stream);
+    writer.StartArray();
+    size_t count = store.load([&writer](const GalleryStoreRecord &record)
+                              {
+                                  writer.StartObject();
+                                  writer.Key("FaceRecognition");
+                                  writer.StartObject();
+                                  writer.Key("Name");
+                                  writer.String(record.name);
+                                  writer.Key("Embeddings");
+                                  writer.StartArray();
+                                  writer.StartObject();
+                                  writer.Key("HailoMatrix");
+                                  writer.StartObject();
+                                  writer.Key("width");
+                                  writer.Uint(record.width);
+                                  writer.Key("height");
+                                  writer.Uint(record.height);
+                                  writer.Key("features");
+                                  writer.Uint(record.features);
+                                  writer.Key("data");
+                                  writer.StartArray();
+                                  for (size_t i = 0; i < record.size(); i++)
+                                      writer.Double(record.data[i]);
+                                  writer.EndArray();
+                                  writer.EndObject();
+                                  writer.EndObject();
+                                  writer.EndArray();
+                                  writer.EndObject();
+                                  writer.EndObject();
+                              });
+    writer.EndArray();
+    stream.Flush();
+    fclose(json_file);
+    return count;
+}
+
+int main(int argc, char *argv[])
+{
+    // Parse user arguments
+    cxxopts::Options options = build_arg_parser();
+    auto result = options.parse(argc, argv);
+    if (result.count("help") || !result.count("gallery") || (result.count("import") + result.count("export") + result.count("compact")) != 1)
+    {
+        std::cout << options.help() << std::endl;
+        return result.count("help") ? 0 : 1;
+    }
+
+    try
+    {
+        GalleryStore store(result["gallery"].as<std::string>());
+        if (result.count("import"))
+        {
+            size_t count = import_json(result["import"].as<std::string>(), store);
+            store.compact();
+            std::cout << "Imported " << count << " embeddings" << std::endl;
+        }
+        else if (result.count("export"))
+        {
+            std::cout << "Exported " << export_json(store, result["export"].as<std::string>()) << " embeddings" << std::endl;
+        }
+        else
+        {
+            std::cout << "Gallery holds " << store.compact() << " embeddings" << std::endl;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
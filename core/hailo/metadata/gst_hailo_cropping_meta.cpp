@@ -46,6 +46,8 @@ static gboolean gst_hailo_cropping_meta_init(GstMeta *meta, gpointer params, Gst
 {
     GstHailoCroppingMeta *gst_hailo_cropping_meta = (GstHailoCroppingMeta *)meta;
     gst_hailo_cropping_meta->num_of_crops = 0;
+    gst_hailo_cropping_meta->frame_id = 0;
+    gst_hailo_cropping_meta->outer_states = NULL;
     return TRUE;
 }
 
@@ -53,13 +55,35 @@ static void gst_hailo_cropping_meta_free(GstMeta *meta, GstBuffer *buffer)
 {
     GstHailoCroppingMeta *gst_hailo_cropping_meta = (GstHailoCroppingMeta *)meta;
     gst_hailo_cropping_meta->num_of_crops = 0;
+    if (gst_hailo_cropping_meta->outer_states)
+    {
+        g_array_free(gst_hailo_cropping_meta->outer_states, TRUE);
+        gst_hailo_cropping_meta->outer_states = NULL;
+    }
 }
 
 static gboolean gst_hailo_cropping_meta_transform(GstBuffer *transbuf, GstMeta *meta, GstBuffer *buffer,
                                                   GQuark type, gpointer data)
 {
     GstHailoCroppingMeta *gst_hailo_cropping_meta = (GstHailoCroppingMeta *)meta;
-    gst_buffer_add_hailo_cropping_meta(transbuf, gst_hailo_cropping_meta->num_of_crops);
+    GstHailoCroppingMeta *transformed_meta = gst_buffer_get_hailo_cropping_meta(transbuf);
+    if (transformed_meta == NULL)
+        transformed_meta = (GstHailoCroppingMeta *)gst_buffer_add_meta(transbuf, GST_HAILO_CROPPING_META_INFO, NULL);
+    if (transformed_meta == NULL)
+        return FALSE;
+    transformed_meta->num_of_crops = gst_hailo_cropping_meta->num_of_crops;
+    transformed_meta->frame_id = gst_hailo_cropping_meta->frame_id;
+    if (transformed_meta->outer_states)
+    {
+        g_array_free(transformed_meta->outer_states, TRUE);
+        transformed_meta->outer_states = NULL;
+    }
+    if (gst_hailo_cropping_meta->outer_states && gst_hailo_cropping_meta->outer_states->len > 0)
+    {
+        GArray *outer_states = gst_hailo_cropping_meta->outer_states;
+        transformed_meta->outer_states = g_array_sized_new(FALSE, FALSE, sizeof(GstHailoCroppingMetaState), outer_states->len);
+        g_array_append_vals(transformed_meta->outer_states, outer_states->data, outer_states->len);
+    }
     return TRUE;
 }
 
@@ -78,7 +102,20 @@ GstHailoCroppingMeta *gst_buffer_add_hailo_cropping_meta(GstBuffer *buffer, guin
     if (!gst_buffer_is_writable(buffer))
         return gst_hailo_cropping_meta;
 
-    gst_hailo_cropping_meta = (GstHailoCroppingMeta *)gst_buffer_add_meta(buffer, GST_HAILO_CROPPING_META_INFO, NULL);
+    gst_hailo_cropping_meta = gst_buffer_get_hailo_cropping_meta(buffer);
+    if (gst_hailo_cropping_meta)
+    {
+        // Nested croppers, keep the outer state to restore it when the inner aggregator is done with the buffer
+        GstHailoCroppingMetaState outer_state = {gst_hailo_cropping_meta->num_of_crops, gst_hailo_cropping_meta->frame_id};
+        if (gst_hailo_cropping_meta->outer_states == NULL)
+            gst_hailo_cropping_meta->outer_states = g_array_new(FALSE, FALSE, sizeof(GstHailoCroppingMetaState));
+        g_array_append_val(gst_hailo_cropping_meta->outer_states, outer_state);
+        gst_hailo_cropping_meta->frame_id = 0;
+    }
+    else
+    {
+        gst_hailo_cropping_meta = (GstHailoCroppingMeta *)gst_buffer_add_meta(buffer, GST_HAILO_CROPPING_META_INFO, NULL);
+    }
 
     gst_hailo_cropping_meta->num_of_crops = number_of_crops;
 
@@ -97,5 +134,15 @@ gboolean gst_buffer_remove_hailo_cropping_meta(GstBuffer *buffer)
     if (!gst_buffer_is_writable(buffer))
         return FALSE;
 
+    if (meta->outer_states && meta->outer_states->len > 0)
+    {
+        guint last = meta->outer_states->len - 1;
+        GstHailoCroppingMetaState outer_state = g_array_index(meta->outer_states, GstHailoCroppingMetaState, last);
+        g_array_remove_index(meta->outer_states, last);
+        meta->num_of_crops = outer_state.num_of_crops;
+        meta->frame_id = outer_state.frame_id;
+        return TRUE;
+    }
+
     return gst_buffer_remove_meta(buffer, &meta->meta);
 }
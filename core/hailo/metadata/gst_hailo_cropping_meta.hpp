@@ -13,11 +13,22 @@ G_BEGIN_DECLS
 typedef struct _GstHailoCroppingMeta GstHailoCroppingMeta;
 typedef struct _GstHailoCropping GstHailoCropping;
 
+// The cropping state of a buffer that went through an outer cropper, saved while an inner cropper uses the meta.
+typedef struct _GstHailoCroppingMetaState
+{
+    guint num_of_crops;
+    guint64 frame_id;
+} GstHailoCroppingMetaState;
+
 struct _GstHailoCroppingMeta
 {
 
     GstMeta meta;
     guint num_of_crops;
+    // Identifies the main frame among the frames of the cropper, its crops carry the same id.
+    guint64 frame_id;
+    // States of the outer croppers, innermost last. NULL when the buffer went through a single cropper.
+    GArray *outer_states;
 };
 
 GType gst_hailo_cropping_meta_api_get_type(void);
@@ -25,9 +36,12 @@ GType gst_hailo_cropping_meta_api_get_type(void);
 GST_EXPORT
 const GstMetaInfo *gst_hailo_cropping_meta_get_info(void);
 
+// A buffer has at most one cropping meta. When it already has one, for example a crop of an outer cropper fed to
+// an inner cropper, the current state is saved and the meta is reused with number_of_crops and no frame id.
 GST_EXPORT
 GstHailoCroppingMeta *gst_buffer_add_hailo_cropping_meta(GstBuffer *buffer, guint number_of_crops);
 
+// Restores the state saved by the last gst_buffer_add_hailo_cropping_meta, removes the meta when none was saved.
 GST_EXPORT
 gboolean gst_buffer_remove_hailo_cropping_meta(GstBuffer *buffer);
 
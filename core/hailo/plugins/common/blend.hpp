@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file blend.hpp
+ * @authors Hailo
+ *
+ * Alpha blending of 8 bit image rows, shared by the text renderer and the mask compositor.
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "hailo_simd.hpp"
+
+/**
+ * @brief Blends a row of bytes toward a color: dst = dst + (color - dst) * alpha / 255, rounded.
+ *        Alpha and color are given per byte, so interleaved formats are handled by expanding them per channel.
+ */
+inline void blend_row(uint8_t *dst, const uint8_t *alpha, const uint8_t *color, size_t count)
+{
+    size_t i = 0;
+#if defined(HAILO_SIMD_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i half = _mm_set1_epi16(128);
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(alpha + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, zero)) == 0xFFFF)
+            continue;
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(color + i));
+        __m128i result[2];
+        for (int part = 0; part < 2; part++)
+        {
+            __m128i a16 = part ? _mm_unpackhi_epi8(a, zero) : _mm_unpacklo_epi8(a, zero);
+            __m128i d16 = part ? _mm_unpackhi_epi8(d, zero) : _mm_unpacklo_epi8(d, zero);
+            __m128i c16 = part ? _mm_unpackhi_epi8(c, zero) : _mm_unpacklo_epi8(c, zero);
+            __m128i x = _mm_add_epi16(_mm_mullo_epi16(d16, _mm_sub_epi16(full, a16)), _mm_mullo_epi16(c16, a16));
+            x = _mm_add_epi16(x, half);
+            result[part] = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(result[0], result[1]));
+    }
+#elif defined(HAILO_SIMD_NEON)
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16_t a = vld1q_u8(alpha + i);
+        if (vmaxvq_u8(a) == 0)
+            continue;
+        uint8x16_t d = vld1q_u8(dst + i);
+        uint8x16_t c = vld1q_u8(color + i);
+        uint8x16_t inverse = vmvnq_u8(a);
+        uint16x8_t low = vmlal_u8(vmull_u8(vget_low_u8(d), vget_low_u8(inverse)), vget_low_u8(c), vget_low_u8(a));
+        uint16x8_t high = vmlal_u8(vmull_u8(vget_high_u8(d), vget_high_u8(inverse)), vget_high_u8(c), vget_high_u8(a));
+        low = vaddq_u16(low, vdupq_n_u16(128));
+        high = vaddq_u16(high, vdupq_n_u16(128));
+        low = vaddq_u16(low, vshrq_n_u16(low, 8));
+        high = vaddq_u16(high, vshrq_n_u16(high, 8));
+        vst1q_u8(dst + i, vcombine_u8(vshrn_n_u16(low, 8), vshrn_n_u16(high, 8)));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        if (alpha[i] == 0)
+            continue;
+        uint32_t x = dst[i] * (255 - alpha[i]) + color[i] * alpha[i] + 128;
+        dst[i] = (x + (x >> 8)) >> 8;
+    }
+}
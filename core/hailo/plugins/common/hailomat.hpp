@@ -18,6 +18,7 @@
 #include <opencv2/opencv.hpp>
 #include "hailo_common.hpp"
 #include "hailo_objects.hpp"
+#include "text_renderer.hpp"
 
 // Transformations were taken from https://stackoverflow.com/questions/17892346/how-to-convert-rgb-yuv-rgb-both-ways.
 #define RGB2Y(R, G, B) CLIP((0.257 * (R) + 0.504 * (G) + 0.098 * (B)) + 16)
@@ -80,6 +81,7 @@ protected:
     int m_line_thickness;
     int m_font_thickness;
     std::vector<cv::Mat> m_matrices;
+    TextRenderer *m_text_renderer = nullptr; // When set, draw_text blends cached glyphs instead of calling cv::putText
     cv::Rect get_bounding_rect(HailoBBox bbox, uint channel_width, uint channel_height)
     {
         cv::Rect rect;
@@ -107,6 +109,7 @@ public:
     uint native_width() { return m_native_width; };
     uint native_height() { return m_native_height; };
     std::vector<cv::Mat> &get_matrices() { return m_matrices; }
+    void set_text_renderer(TextRenderer *text_renderer) { m_text_renderer = text_renderer; }
     virtual void draw_rectangle(cv::Rect rect, const cv::Scalar color) = 0;
     virtual void draw_text(std::string text, cv::Point position, double font_scale, const cv::Scalar color) = 0;
     virtual void draw_line(cv::Point point1, cv::Point point2, const cv::Scalar color, int thickness, int line_type) = 0;
@@ -185,7 +188,10 @@ public:
     }
     virtual void draw_text(std::string text, cv::Point position, double font_scale, const cv::Scalar color)
     {
-        cv::putText(m_matrices[0], text, position, cv::FONT_HERSHEY_SIMPLEX, font_scale, color, m_font_thickness);
+        if (m_text_renderer)
+            m_text_renderer->draw(m_matrices[0], text, position, font_scale, m_font_thickness, color);
+        else
+            cv::putText(m_matrices[0], text, position, cv::FONT_HERSHEY_SIMPLEX, font_scale, color, m_font_thickness);
     }
     virtual void draw_line(cv::Point point1, cv::Point point2, const cv::Scalar color, int thickness, int line_type)
     {
@@ -236,7 +242,10 @@ public:
     }
     virtual void draw_text(std::string text, cv::Point position, double font_scale, const cv::Scalar color)
     {
-        cv::putText(m_matrices[0], text, position, cv::FONT_HERSHEY_SIMPLEX, font_scale, get_rgba_color(color), m_font_thickness);
+        if (m_text_renderer)
+            m_text_renderer->draw(m_matrices[0], text, position, font_scale, m_font_thickness, get_rgba_color(color));
+        else
+            cv::putText(m_matrices[0], text, position, cv::FONT_HERSHEY_SIMPLEX, font_scale, get_rgba_color(color), m_font_thickness);
     }
     virtual void draw_line(cv::Point point1, cv::Point point2, const cv::Scalar color, int thickness, int line_type)
     {
@@ -380,6 +389,11 @@ public:
     virtual void draw_text(std::string text, cv::Point position, double font_scale, const cv::Scalar color)
     {
         cv::Scalar yuv_color = get_nv12_color(color);
+        if (m_text_renderer)
+        {
+            m_text_renderer->draw_nv12(m_matrices[0], m_matrices[1], text, position, font_scale, m_font_thickness, yuv_color);
+            return;
+        }
         cv::Point y_position = cv::Point(position.x, position.y);
         cv::Point uv_position = cv::Point(position.x / 2, position.y / 2);
         cv::putText(m_matrices[0], text, y_position, cv::FONT_HERSHEY_SIMPLEX, font_scale, cv::Scalar(yuv_color[0]), m_font_thickness);
@@ -0,0 +1,323 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file text_renderer.hpp
+ * @authors Hailo
+ *
+ * Text drawing from pre-rasterized glyphs.
+ * Glyphs of the Hershey font are rasterized once per (scale, thickness) into an atlas, labels are composed
+ * from the atlas into a coverage bitmap that is cached between frames, and drawing a label is an alpha blend
+ * of the cached coverage into the image planes. For NV12 the chroma coverage is kept at half resolution,
+ * so both planes are blended from the same label without rasterizing it twice.
+ **/
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cmath>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "blend.hpp"
+
+#define TEXT_RENDERER_FONT (cv::FONT_HERSHEY_SIMPLEX)
+// Font scales are rounded to this step, so labels of boxes that change size slightly share an atlas and a cache entry
+#define TEXT_RENDERER_SCALE_STEP (0.05)
+// Rendered labels kept between frames
+#define TEXT_RENDERER_LABEL_CACHE_SIZE (1024)
+#define TEXT_RENDERER_FIRST_GLYPH (32)
+#define TEXT_RENDERER_LAST_GLYPH (126)
+
+typedef enum
+{
+    TEXT_LAYOUT_GRAY,
+    TEXT_LAYOUT_RGB,
+    TEXT_LAYOUT_RGBA,
+    TEXT_LAYOUT_NV12
+} text_layout_t;
+
+/**
+ * @brief A label rendered for one layout: per plane coverage, expanded to one alpha byte per channel.
+ */
+struct TextLabel
+{
+    std::vector<cv::Mat> alpha; // CV_8UC1 per plane, cols = pixels * channels
+    cv::Point origin;           // Top left corner relative to the text position (bottom left of the baseline)
+};
+using TextLabelPtr = std::shared_ptr<const TextLabel>;
+
+/**
+ * @brief Draws text into image planes from cached glyph atlases and labels.
+ *        One renderer may be shared by any number of threads and overlay instances.
+ */
+class TextRenderer
+{
+private:
+    struct Glyph
+    {
+        cv::Mat coverage; // atlas height rows, pen at column `pad`
+        float advance;
+    };
+
+    struct GlyphAtlas
+    {
+        double scale;
+        int thickness;
+        int pad;
+        int ascent;  // rows above the baseline
+        int height;  // total rows, including padding
+        std::vector<Glyph> glyphs;
+    };
+
+    std::mutex m_mutex;
+    std::map<std::pair<int, int>, std::unique_ptr<GlyphAtlas>> m_atlases;
+    std::list<std::pair<std::string, TextLabelPtr>> m_lru;
+    std::unordered_map<std::string, std::list<std::pair<std::string, TextLabelPtr>>::iterator> m_labels;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+
+    static std::unique_ptr<GlyphAtlas> build_atlas(double scale, int thickness)
+    {
+        auto atlas = std::make_unique<GlyphAtlas>();
+        atlas->scale = scale;
+        atlas->thickness = thickness;
+        atlas->pad = thickness + 1;
+
+        int ascent = 0, descent = 0;
+        for (int c = TEXT_RENDERER_FIRST_GLYPH; c <= TEXT_RENDERER_LAST_GLYPH; c++)
+        {
+            int baseline = 0;
+            cv::Size size = cv::getTextSize(std::string(1, char(c)), TEXT_RENDERER_FONT, scale, thickness, &baseline);
+            ascent = std::max(ascent, size.height);
+            descent = std::max(descent, baseline);
+        }
+        atlas->ascent = ascent;
+        atlas->height = ascent + descent + 2 * atlas->pad;
+
+        for (int c = TEXT_RENDERER_FIRST_GLYPH; c <= TEXT_RENDERER_LAST_GLYPH; c++)
+        {
+            std::string single(1, char(c));
+            int baseline = 0;
+            int width = cv::getTextSize(single, TEXT_RENDERER_FONT, scale, thickness, &baseline).width;
+            // The pen advance of a run of the glyph, to keep the rounding error of a single glyph out of it
+            int run_width = cv::getTextSize(std::string(16, char(c)), TEXT_RENDERER_FONT, scale, thickness, &baseline).width;
+
+            Glyph glyph;
+            glyph.advance = float(run_width - width) / 15.0f;
+            glyph.coverage = cv::Mat::zeros(atlas->height, width + 2 * atlas->pad, CV_8UC1);
+            cv::putText(glyph.coverage, single, cv::Point(atlas->pad, atlas->pad + ascent), TEXT_RENDERER_FONT, scale, cv::Scalar(255), thickness);
+            atlas->glyphs.emplace_back(std::move(glyph));
+        }
+        return atlas;
+    }
+
+    // Called with the lock held
+    GlyphAtlas &atlas(int scale_step, int thickness)
+    {
+        auto key = std::make_pair(scale_step, thickness);
+        auto &atlas = m_atlases[key];
+        if (!atlas)
+            atlas = build_atlas(key.first * TEXT_RENDERER_SCALE_STEP, thickness);
+        return *atlas;
+    }
+
+    // Single channel coverage of the whole text, the baseline starts at (pad, pad + ascent)
+    static cv::Mat compose(const GlyphAtlas &atlas, const std::string &text)
+    {
+        bool printable = true;
+        for (unsigned char c : text)
+            printable &= (c >= TEXT_RENDERER_FIRST_GLYPH && c <= TEXT_RENDERER_LAST_GLYPH);
+        if (!printable)
+        {
+            // Not in the atlas, rasterize the whole text once, it is cached like any other label
+            int baseline = 0;
+            cv::Size size = cv::getTextSize(text, TEXT_RENDERER_FONT, atlas.scale, atlas.thickness, &baseline);
+            cv::Mat coverage = cv::Mat::zeros(atlas.height, size.width + 2 * atlas.pad, CV_8UC1);
+            cv::putText(coverage, text, cv::Point(atlas.pad, atlas.pad + atlas.ascent), TEXT_RENDERER_FONT, atlas.scale, cv::Scalar(255), atlas.thickness);
+            return coverage;
+        }
+
+        int width = 0;
+        float pen = 0;
+        for (unsigned char c : text)
+        {
+            const Glyph &glyph = atlas.glyphs[c - TEXT_RENDERER_FIRST_GLYPH];
+            width = std::max(width, int(std::lround(pen)) + glyph.coverage.cols);
+            pen += glyph.advance;
+        }
+        cv::Mat coverage = cv::Mat::zeros(atlas.height, std::max(width, 1), CV_8UC1);
+        pen = 0;
+        for (unsigned char c : text)
+        {
+            const Glyph &glyph = atlas.glyphs[c - TEXT_RENDERER_FIRST_GLYPH];
+            cv::Mat target = coverage(cv::Rect(int(std::lround(pen)), 0, glyph.coverage.cols, atlas.height));
+            cv::max(target, glyph.coverage, target);
+            pen += glyph.advance;
+        }
+        return coverage;
+    }
+
+    static cv::Mat expand(const cv::Mat &coverage, int channels)
+    {
+        if (channels == 1)
+            return coverage;
+        cv::Mat expanded;
+        cv::merge(std::vector<cv::Mat>(channels, coverage), expanded);
+        return expanded.reshape(1);
+    }
+
+    static TextLabelPtr render(const GlyphAtlas &atlas, const std::string &text, text_layout_t layout)
+    {
+        auto label = std::make_shared<TextLabel>();
+        cv::Mat coverage = compose(atlas, text);
+        label->origin = cv::Point(-atlas.pad, -atlas.pad - atlas.ascent);
+        switch (layout)
+        {
+        case TEXT_LAYOUT_RGB:
+            label->alpha.push_back(expand(coverage, 3));
+            break;
+        case TEXT_LAYOUT_RGBA:
+            label->alpha.push_back(expand(coverage, 4));
+            break;
+        case TEXT_LAYOUT_NV12:
+        {
+            // Even sized, so each chroma sample covers exactly 2x2 luma pixels of the label
+            cv::copyMakeBorder(coverage, coverage, 0, coverage.rows % 2, 0, coverage.cols % 2, cv::BORDER_CONSTANT, cv::Scalar(0));
+            cv::Mat chroma;
+            cv::resize(coverage, chroma, cv::Size(coverage.cols / 2, coverage.rows / 2), 0, 0, cv::INTER_AREA);
+            label->alpha.push_back(coverage);
+            label->alpha.push_back(expand(chroma, 2));
+            break;
+        }
+        default:
+            label->alpha.push_back(coverage);
+            break;
+        }
+        return label;
+    }
+
+    // Blends a label plane whose top left corner lands on (x, y) of the plane, clipped to the plane
+    static void blend(cv::Mat &plane, const cv::Mat &alpha, int x, int y, const uint8_t *color, int channels)
+    {
+        int label_width = alpha.cols / channels;
+        int x0 = std::max(x, 0), y0 = std::max(y, 0);
+        int x1 = std::min(x + label_width, plane.cols), y1 = std::min(y + alpha.rows, plane.rows);
+        if (x0 >= x1 || y0 >= y1)
+            return;
+
+        size_t count = size_t(x1 - x0) * channels;
+        std::vector<uint8_t> color_row(count);
+        for (size_t i = 0; i < count; i++)
+            color_row[i] = color[i % channels];
+        for (int row = y0; row < y1; row++)
+            blend_row(plane.ptr<uint8_t>(row) + size_t(x0) * channels, alpha.ptr<uint8_t>(row - y) + size_t(x0 - x) * channels, color_row.data(), count);
+    }
+
+public:
+    TextRenderer() = default;
+    TextRenderer(const TextRenderer &) = delete;
+    TextRenderer &operator=(const TextRenderer &) = delete;
+
+    /**
+     * @brief The renderer shared by every overlay in the process, so atlases and labels are built once for all streams.
+     *
+     * @return TextRenderer&
+     */
+    static TextRenderer &shared()
+    {
+        static TextRenderer renderer;
+        return renderer;
+    }
+
+    /**
+     * @brief Gets the rendered label of a text, from the cache when it was drawn before.
+     *
+     * @param text  -  const std::string &
+     * @param font_scale  -  double
+     *        Hershey font scale, rounded to TEXT_RENDERER_SCALE_STEP.
+     * @param thickness  -  int
+     * @param layout  -  text_layout_t
+     *        Layout of the target image.
+     * @return TextLabelPtr
+     */
+    TextLabelPtr label(const std::string &text, double font_scale, int thickness, text_layout_t layout)
+    {
+        thickness = std::max(thickness, 1);
+        int scale_step = std::max(1, int(std::lround(font_scale / TEXT_RENDERER_SCALE_STEP)));
+        std::string key = std::to_string(layout) + ':' + std::to_string(thickness) + ':' + std::to_string(scale_step) + ':' + text;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_labels.find(key);
+        if (found != m_labels.end())
+        {
+            m_hits++;
+            m_lru.splice(m_lru.begin(), m_lru, found->second);
+            return found->second->second;
+        }
+
+        m_misses++;
+        TextLabelPtr label = render(atlas(scale_step, thickness), text, layout);
+        m_lru.emplace_front(key, label);
+        m_labels[key] = m_lru.begin();
+        if (m_lru.size() > TEXT_RENDERER_LABEL_CACHE_SIZE)
+        {
+            m_labels.erase(m_lru.back().first);
+            m_lru.pop_back();
+        }
+        return label;
+    }
+
+    /**
+     * @brief Draws text into a single interleaved plane (gray, RGB or RGBA), at the position cv::putText would.
+     *
+     * @param plane  -  cv::Mat &
+     *        CV_8UC1, CV_8UC3 or CV_8UC4 image.
+     * @param color  -  cv::Scalar
+     *        Value of each channel.
+     */
+    void draw(cv::Mat &plane, const std::string &text, cv::Point position, double font_scale, int thickness, const cv::Scalar &color)
+    {
+        int channels = plane.channels();
+        text_layout_t layout = channels == 3 ? TEXT_LAYOUT_RGB : channels == 4 ? TEXT_LAYOUT_RGBA : TEXT_LAYOUT_GRAY;
+        TextLabelPtr rendered = label(text, font_scale, thickness, layout);
+        uint8_t color_bytes[4];
+        for (int i = 0; i < 4; i++)
+            color_bytes[i] = cv::saturate_cast<uint8_t>(color[i]);
+        blend(plane, rendered->alpha[0], position.x + rendered->origin.x, position.y + rendered->origin.y, color_bytes, channels);
+    }
+
+    /**
+     * @brief Draws text into the Y and interleaved UV planes of an NV12 image.
+     *        The label is placed on even luma coordinates so both planes stay aligned.
+     *
+     * @param yuv_color  -  cv::Scalar
+     *        Y, U and V values.
+     */
+    void draw_nv12(cv::Mat &y_plane, cv::Mat &uv_plane, const std::string &text, cv::Point position, double font_scale, int thickness, const cv::Scalar &yuv_color)
+    {
+        TextLabelPtr rendered = label(text, font_scale, thickness, TEXT_LAYOUT_NV12);
+        int x = (position.x + rendered->origin.x) & ~1;
+        int y = (position.y + rendered->origin.y) & ~1;
+        uint8_t y_color = cv::saturate_cast<uint8_t>(yuv_color[0]);
+        uint8_t uv_color[2] = {cv::saturate_cast<uint8_t>(yuv_color[1]), cv::saturate_cast<uint8_t>(yuv_color[2])};
+        blend(y_plane, rendered->alpha[0], x, y, &y_color, 1);
+        blend(uv_plane, rendered->alpha[1], x / 2, y / 2, uv_color, 2);
+    }
+
+    /**
+     * @brief Number of label lookups served from the cache and rendered, for profiling.
+     */
+    std::pair<uint64_t, uint64_t> cache_stats()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return std::make_pair(m_hits, m_misses);
+    }
+};
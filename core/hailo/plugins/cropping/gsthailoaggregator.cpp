@@ -11,6 +11,7 @@
  */
 #include "cropping/gsthailoaggregator.hpp"
 #include <gst/video/video.h>
+#include <algorithm>
 #include <iostream>
 #include "gst_hailo_cropping_meta.hpp"
 #include "hailo_objects.hpp"
@@ -23,14 +24,25 @@ GST_DEBUG_CATEGORY_STATIC(gst_hailoaggregator_debug);
 
 static void gst_hailoaggregator_post_aggregation(GstHailoAggregator *hailoaggregator, HailoROIPtr hailo_roi);
 static void gst_hailoaggregator_handle_sub_frame_roi(GstHailoAggregator *hailoaggregator, HailoROIPtr sub_buffer_roi);
+static void gst_hailoaggregator_handle_reset(GstHailoAggregator *hailoaggregator);
 static GstStateChangeReturn gst_hailoaggregator_change_state(GstElement *element, GstStateChange transition);
 
 #define DEFAULT_FORWARD_STICKY_EVENTS TRUE
 
+#define DEFAULT_MAX_INFLIGHT 1
+#define MAX_MAX_INFLIGHT 64
+#define MIN_MAX_INFLIGHT 1
+
+#define DEFAULT_CROP_TIMEOUT 0
+#define MAX_CROP_TIMEOUT 60000
+#define MIN_CROP_TIMEOUT 0
+
 enum
 {
     PROP_0,
     PROP_FLATTEN_DETECTIONS,
+    PROP_MAX_INFLIGHT,
+    PROP_CROP_TIMEOUT,
 };
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE("sink",
@@ -60,6 +72,7 @@ static gboolean gst_hailoaggregator_sink_event(GstPad *pad,
                                                GstEvent *event);
 static GstFlowReturn gst_hailoaggregator_chain_main(GstPad *pad, GstObject *parent, GstBuffer *buf);
 static GstFlowReturn gst_hailoaggregator_chain_sub(GstPad *pad, GstObject *parent, GstBuffer *buf);
+static gboolean gst_hailoaggregator_src_activate_mode(GstPad *pad, GstObject *parent, GstPadMode mode, gboolean active);
 
 static gboolean gst_hailoaggregator_sink_query(GstPad *pad,
                                                  GstObject *parent, GstQuery *query);
@@ -85,11 +98,25 @@ gst_hailoaggregator_class_init(GstHailoAggregatorClass *klass)
 
     hailoaggregator_class->handle_main_roi_post_aggregation = gst_hailoaggregator_post_aggregation;
     hailoaggregator_class->handle_sub_frame_roi = gst_hailoaggregator_handle_sub_frame_roi;
+    hailoaggregator_class->handle_reset = gst_hailoaggregator_handle_reset;
     gstelement_class->change_state = gst_hailoaggregator_change_state;
 
     g_object_class_install_property(gobject_class, PROP_FLATTEN_DETECTIONS,
                                     g_param_spec_boolean("flatten-detections", "Flatten detections", "perform a 'flattening' functionality on the detection metadata when receiving each frame", false,
                                                          (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MAX_INFLIGHT,
+                                    g_param_spec_uint("max-inflight", "Max inflight frames",
+                                                      "Maximum number of main frames waiting for their crops at the same time. "
+                                                      "Raising it lets the crops of the next frames be inferred while the current frame is still aggregated. "
+                                                      "Frames are always pushed downstream in the order they arrived.",
+                                                      MIN_MAX_INFLIGHT, MAX_MAX_INFLIGHT, DEFAULT_MAX_INFLIGHT,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_CROP_TIMEOUT,
+                                    g_param_spec_uint("crop-timeout", "Crop timeout",
+                                                      "Time in ms to wait for the crops of a main frame before giving up on the missing ones, "
+                                                      "the frame is then pushed with the metadata of the crops that did arrive and late crops are dropped. 0 - wait forever",
+                                                      MIN_CROP_TIMEOUT, MAX_CROP_TIMEOUT, DEFAULT_CROP_TIMEOUT,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
 }
 
 static void
@@ -112,15 +139,22 @@ gst_hailoaggregator_init(GstHailoAggregator *hailoaggregator)
 
     // SrcPad
     hailoaggregator->srcpad = gst_pad_new_from_static_template(&src_template, "src");
+    gst_pad_set_activatemode_function(hailoaggregator->srcpad, GST_DEBUG_FUNCPTR(gst_hailoaggregator_src_activate_mode));
     gst_pad_use_fixed_caps(hailoaggregator->srcpad);
 
     gst_element_add_pad(GST_ELEMENT(hailoaggregator), hailoaggregator->srcpad);
-    hailoaggregator->num_of_frames = 0;
     hailoaggregator->mainframe = NULL;
+    hailoaggregator->pending_frames.clear();
+    hailoaggregator->flushing = false;
 
     hailoaggregator->flatten_detections = false;
+    hailoaggregator->max_inflight = DEFAULT_MAX_INFLIGHT;
+    hailoaggregator->crop_timeout = DEFAULT_CROP_TIMEOUT;
     hailoaggregator->eos_main = false;
     hailoaggregator->eos_sub = false;
+    hailoaggregator->src_task = false;
+    hailoaggregator->src_result = GST_FLOW_OK;
+    hailoaggregator->held_eos = NULL;
 }
 
 static void
@@ -134,6 +168,12 @@ gst_hailoaggregator_set_property(GObject *object, guint prop_id,
     case PROP_FLATTEN_DETECTIONS:
         hailoaggregator->flatten_detections = g_value_get_boolean(value);
         break;
+    case PROP_MAX_INFLIGHT:
+        hailoaggregator->max_inflight = g_value_get_uint(value);
+        break;
+    case PROP_CROP_TIMEOUT:
+        hailoaggregator->crop_timeout = g_value_get_uint(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -151,6 +191,12 @@ gst_hailoaggregator_get_property(GObject *object, guint prop_id, GValue *value,
     case PROP_FLATTEN_DETECTIONS:
         g_value_set_boolean(value, hailoaggregator->flatten_detections);
         break;
+    case PROP_MAX_INFLIGHT:
+        g_value_set_uint(value, hailoaggregator->max_inflight);
+        break;
+    case PROP_CROP_TIMEOUT:
+        g_value_set_uint(value, hailoaggregator->crop_timeout);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -230,6 +276,251 @@ gst_hailoaggregator_update_eos(GstHailoAggregator *hailoaggregator, GstPad *pad,
     }
 }
 
+/**
+ * Gives up on the missing crops of pending frames, so they can be pushed with the crops that did arrive.
+ * Must be called with the mutex held.
+ *
+ * @param[in] hailoaggregator   aggregator element.
+ * @param[in] expire_all        expire all the pending frames, not only the ones that passed their deadline.
+ */
+static void
+gst_hailoaggregator_expire_frames_unlocked(GstHailoAggregator *hailoaggregator, bool expire_all)
+{
+    gint64 now = g_get_monotonic_time();
+    for (GstHailoAggregatorPendingFrame &frame : hailoaggregator->pending_frames)
+    {
+        if (frame.complete)
+            continue;
+        if (!expire_all && (frame.deadline == 0 || frame.deadline > now))
+            continue;
+        GST_WARNING_OBJECT(hailoaggregator, "Got %u out of %u crops of frame with offset %" G_GUINT64_FORMAT ", pushing it without the rest",
+                           frame.received_crops, frame.expected_crops, frame.offset);
+        frame.complete = true;
+    }
+}
+
+/**
+ * Releases all the pending frames and events without pushing them, and lets derived elements drop their per frame state.
+ * Called on flush-stop of the main pad and when the element stops.
+ * Must be called with the mutex held.
+ */
+static void
+gst_hailoaggregator_clear_pending_frames_unlocked(GstHailoAggregator *hailoaggregator)
+{
+    for (GstHailoAggregatorPendingFrame &frame : hailoaggregator->pending_frames)
+    {
+        if (frame.buffer)
+            gst_buffer_unref(frame.buffer);
+        else
+            gst_event_unref(frame.event);
+    }
+    hailoaggregator->pending_frames.clear();
+    if (hailoaggregator->held_eos)
+    {
+        gst_event_unref(hailoaggregator->held_eos);
+        hailoaggregator->held_eos = NULL;
+    }
+    GST_HAILO_AGGREGATOR_GET_CLASS(hailoaggregator)->handle_reset(hailoaggregator);
+}
+
+/**
+ * Counts the pending main frames, leaving out the events queued between them.
+ * Must be called with the mutex held.
+ */
+static size_t
+gst_hailoaggregator_num_pending_frames_unlocked(GstHailoAggregator *hailoaggregator)
+{
+    return std::count_if(hailoaggregator->pending_frames.begin(), hailoaggregator->pending_frames.end(),
+                         [](const GstHailoAggregatorPendingFrame &frame)
+                         { return frame.buffer != NULL; });
+}
+
+/**
+ * Waits until the head of the pending frames is complete.
+ * Frames whose crops did not arrive before their deadline (or at all, once the sub pad got eos) are expired meanwhile.
+ *
+ * @param[in] hailoaggregator   aggregator element.
+ * @param[in] lock              lock holding the mutex.
+ * @param[in] cv                condition variable the calling thread is notified on.
+ * @return false if the element started flushing while waiting, true otherwise.
+ */
+static bool
+gst_hailoaggregator_wait_for_head_unlocked(GstHailoAggregator *hailoaggregator, std::unique_lock<std::mutex> &lock,
+                                           std::condition_variable &cv)
+{
+    while (!hailoaggregator->flushing)
+    {
+        gst_hailoaggregator_expire_frames_unlocked(hailoaggregator, hailoaggregator->eos_sub);
+        if (!hailoaggregator->pending_frames.empty() && hailoaggregator->pending_frames.front().complete)
+            return true;
+
+        gint64 deadline = 0;
+        for (GstHailoAggregatorPendingFrame &frame : hailoaggregator->pending_frames)
+        {
+            if (!frame.complete && frame.deadline != 0 && (deadline == 0 || frame.deadline < deadline))
+                deadline = frame.deadline;
+        }
+        if (deadline == 0)
+            cv.wait(lock);
+        else
+            cv.wait_for(lock, std::chrono::microseconds(MAX(deadline - g_get_monotonic_time(), 0)));
+    }
+    return false;
+}
+
+/**
+ * Pushes a completed main frame into the src pad, after the post aggregation of derived elements.
+ *
+ * @param[in] hailoaggregator   aggregator element.
+ * @param[in] buf               the main frame, owned by the call.
+ * @param[in] forward_sticky    forward the sticky events of the main pad first. Only valid from the main streaming
+ *                              thread, the src pad task pushes the events of the main pad in order instead.
+ * @return The flow return of the push.
+ */
+static GstFlowReturn
+gst_hailoaggregator_push_frame(GstHailoAggregator *hailoaggregator, GstBuffer *buf, bool forward_sticky)
+{
+    HailoROIPtr hailo_roi = get_hailo_main_roi(buf);
+    GST_HAILO_AGGREGATOR_GET_CLASS(hailoaggregator)->handle_main_roi_post_aggregation(hailoaggregator, hailo_roi);
+
+    if (forward_sticky)
+        gst_pad_sticky_events_foreach(hailoaggregator->sinkpad_main, forward_events, hailoaggregator->srcpad);
+
+    // Give the main frame back the cropping meta of an outer cropper, or remove it.
+    buf = gst_buffer_make_writable(buf);
+    if (!gst_buffer_remove_hailo_cropping_meta(buf))
+    {
+        GST_ERROR_OBJECT(hailoaggregator, "Failed to remove cropping meta from main frame");
+    }
+
+    // Push main buffer into the src pad.
+    return gst_pad_push(hailoaggregator->srcpad, buf);
+}
+
+/**
+ * Body of the src pad task, used when max-inflight is above 1.
+ * Pushes the frames and the serialized events of the main pad in the order they arrived, each frame once all its
+ * crops arrived or were given up on. Runs with the src pad stream lock held.
+ *
+ * @param[in] user_data   aggregator element.
+ */
+static void
+gst_hailoaggregator_src_loop(gpointer user_data)
+{
+    GstHailoAggregator *hailoaggregator = GST_HAILO_AGGREGATOR_CAST(user_data);
+    GstHailoAggregatorPendingFrame head;
+    {
+        std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
+        if (!gst_hailoaggregator_wait_for_head_unlocked(hailoaggregator, lock, hailoaggregator->cv_task))
+        {
+            lock.unlock();
+            gst_pad_pause_task(hailoaggregator->srcpad);
+            return;
+        }
+        head = hailoaggregator->pending_frames.front();
+        hailoaggregator->pending_frames.erase(hailoaggregator->pending_frames.begin());
+        // There is room for another main frame.
+        hailoaggregator->cv_main.notify_all();
+
+        // EOS goes downstream only once the crops are done as well.
+        if (head.event && GST_EVENT_TYPE(head.event) == GST_EVENT_EOS && !hailoaggregator->eos_sub)
+        {
+            hailoaggregator->held_eos = head.event;
+            return;
+        }
+    }
+
+    if (head.event)
+    {
+        gst_pad_push_event(hailoaggregator->srcpad, head.event);
+        return;
+    }
+
+    GstFlowReturn ret = gst_hailoaggregator_push_frame(hailoaggregator, head.buffer, false);
+    if (ret != GST_FLOW_OK && ret != GST_FLOW_FLUSHING)
+    {
+        GST_DEBUG_OBJECT(hailoaggregator, "Push of main frame failed: %s", gst_flow_get_name(ret));
+        std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
+        hailoaggregator->src_result = ret;
+    }
+}
+
+/**
+ * Handles an event of a sink pad while the src pad task pushes the frames.
+ * Serialized events of the main pad are queued behind the frames that arrived before them, so the task pushes
+ * them in order and they cannot overtake those frames. Flushes pause the task and restart it.
+ */
+static gboolean
+gst_hailoaggregator_sink_event_task(GstHailoAggregator *hailoaggregator, GstPad *pad, GstEvent *event)
+{
+    gboolean res = TRUE;
+
+    switch (GST_EVENT_TYPE(event))
+    {
+    case GST_EVENT_FLUSH_START:
+        // Unblock a push of the task downstream before waiting for it to pause.
+        res = gst_pad_push_event(hailoaggregator->srcpad, event);
+        gst_pad_pause_task(hailoaggregator->srcpad);
+        return res;
+    case GST_EVENT_FLUSH_STOP:
+        GST_PAD_STREAM_LOCK(hailoaggregator->srcpad);
+        {
+            std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
+            gst_hailoaggregator_update_eos(hailoaggregator, pad, false);
+            if (pad == hailoaggregator->sinkpad_main)
+                gst_hailoaggregator_clear_pending_frames_unlocked(hailoaggregator);
+            hailoaggregator->flushing = false;
+            hailoaggregator->src_result = GST_FLOW_OK;
+        }
+        res = gst_pad_push_event(hailoaggregator->srcpad, event);
+        gst_pad_start_task(hailoaggregator->srcpad, gst_hailoaggregator_src_loop, hailoaggregator, NULL);
+        GST_PAD_STREAM_UNLOCK(hailoaggregator->srcpad);
+        return res;
+    default:
+        break;
+    }
+
+    if (!GST_EVENT_IS_SERIALIZED(event))
+        return gst_pad_push_event(hailoaggregator->srcpad, event);
+
+    std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
+    if (GST_EVENT_TYPE(event) == GST_EVENT_EOS)
+    {
+        gst_hailoaggregator_update_eos(hailoaggregator, pad, true);
+        // Let the sub chain function stop waiting for main frames, and the task give up on missing crops.
+        hailoaggregator->cv_sub.notify_all();
+        hailoaggregator->cv_task.notify_all();
+        if (pad == hailoaggregator->sinkpad_sub && hailoaggregator->held_eos)
+        {
+            // The main pad EOS already reached the head of the queue, it can go downstream now.
+            GstHailoAggregatorPendingFrame eos = {};
+            eos.event = hailoaggregator->held_eos;
+            eos.complete = true;
+            hailoaggregator->held_eos = NULL;
+            hailoaggregator->pending_frames.insert(hailoaggregator->pending_frames.begin(), eos);
+        }
+    }
+
+    // Only the main pad events go downstream.
+    if (pad != hailoaggregator->sinkpad_main)
+    {
+        gst_event_unref(event);
+        return TRUE;
+    }
+    if (hailoaggregator->flushing)
+    {
+        gst_event_unref(event);
+        return FALSE;
+    }
+    GstHailoAggregatorPendingFrame pending_event = {};
+    pending_event.event = event;
+    pending_event.offset = GST_BUFFER_OFFSET_NONE;
+    pending_event.complete = true;
+    hailoaggregator->pending_frames.push_back(pending_event);
+    hailoaggregator->cv_task.notify_all();
+    return TRUE;
+}
+
 static gboolean
 gst_hailoaggregator_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
 {
@@ -240,6 +531,21 @@ gst_hailoaggregator_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
 
     GST_DEBUG_OBJECT(pad, "received event %" GST_PTR_FORMAT, event);
 
+    if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_START)
+    {
+        // Release the chain functions and the task waiting for frames or crops.
+        std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
+        hailoaggregator->flushing = true;
+        hailoaggregator->cv_main.notify_all();
+        hailoaggregator->cv_sub.notify_all();
+        hailoaggregator->cv_task.notify_all();
+    }
+
+    if (hailoaggregator->src_task)
+        return gst_hailoaggregator_sink_event_task(hailoaggregator, pad, event);
+
+    // Without the task the main chain function returns only once its frame was pushed, so serialized events of the
+    // main pad always come after the frames that arrived before them.
     if (GST_EVENT_IS_STICKY(event))
     {
         unlock = TRUE;
@@ -248,11 +554,14 @@ gst_hailoaggregator_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
         if (GST_EVENT_TYPE(event) == GST_EVENT_EOS)
         {
             GST_OBJECT_LOCK(hailoaggregator);
-            gst_hailoaggregator_update_eos(hailoaggregator, pad, true);
-            // Unlocking both condition variables in order to finish the chain function.
-            // After that the pads can be freed by the change_state of base class.
-            hailoaggregator->cv_main.notify_all();
-            hailoaggregator->cv_sub.notify_all();
+            {
+                std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
+                gst_hailoaggregator_update_eos(hailoaggregator, pad, true);
+                // Unlocking both condition variables in order to finish the chain function.
+                // After that the pads can be freed by the change_state of base class.
+                hailoaggregator->cv_main.notify_all();
+                hailoaggregator->cv_sub.notify_all();
+            }
             forward = gst_hailoaggregator_all_sinkpads_eos_unlocked(hailoaggregator);
             GST_OBJECT_UNLOCK(hailoaggregator);
         }
@@ -266,7 +575,13 @@ gst_hailoaggregator_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
         unlock = TRUE;
         GST_PAD_STREAM_LOCK(hailoaggregator->srcpad);
         GST_OBJECT_LOCK(hailoaggregator);
-        gst_hailoaggregator_update_eos(hailoaggregator, pad, false);
+        {
+            std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
+            gst_hailoaggregator_update_eos(hailoaggregator, pad, false);
+            if (pad == hailoaggregator->sinkpad_main)
+                gst_hailoaggregator_clear_pending_frames_unlocked(hailoaggregator);
+            hailoaggregator->flushing = false;
+        }
         GST_OBJECT_UNLOCK(hailoaggregator);
     }
 
@@ -298,6 +613,42 @@ gst_hailoaggregator_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
     return res;
 }
 
+/**
+ * Starts the src pad task when the pad is activated with max-inflight above 1, and stops it on deactivation.
+ */
+static gboolean
+gst_hailoaggregator_src_activate_mode(GstPad *pad, GstObject *parent, GstPadMode mode, gboolean active)
+{
+    GstHailoAggregator *hailoaggregator = GST_HAILO_AGGREGATOR_CAST(parent);
+
+    if (mode != GST_PAD_MODE_PUSH)
+        return FALSE;
+
+    if (active)
+    {
+        {
+            std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
+            hailoaggregator->flushing = false;
+            hailoaggregator->src_result = GST_FLOW_OK;
+            hailoaggregator->src_task = (hailoaggregator->max_inflight > 1);
+        }
+        if (hailoaggregator->src_task)
+            return gst_pad_start_task(pad, gst_hailoaggregator_src_loop, hailoaggregator, NULL);
+        return TRUE;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
+        hailoaggregator->flushing = true;
+        hailoaggregator->cv_main.notify_all();
+        hailoaggregator->cv_sub.notify_all();
+        hailoaggregator->cv_task.notify_all();
+    }
+    if (hailoaggregator->src_task)
+        return gst_pad_stop_task(pad);
+    return TRUE;
+}
+
 static GstFlowReturn
 gst_hailoaggregator_chain_sub(GstPad *pad, GstObject *parent, GstBuffer *buf)
 {
@@ -306,26 +657,71 @@ gst_hailoaggregator_chain_sub(GstPad *pad, GstObject *parent, GstBuffer *buf)
 
     std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
 
-    // Wait until main frame is not null & the offset of main frame is not smaller.
-    if (hailoaggregator->mainframe == NULL || hailoaggregator->mainframe->offset < buf->offset)
+    // Find the main frame of this crop by the id the cropper gave both.
+    // Crops of croppers that give no id fall back to the first pending frame with the same offset that still waits for crops.
+    GstHailoCroppingMeta *cropping_meta = gst_buffer_get_hailo_cropping_meta(buf);
+    guint64 frame_id = cropping_meta ? cropping_meta->frame_id : 0;
+    GstHailoAggregatorPendingFrame *frame = NULL;
+    bool stale = false;
+    while (!hailoaggregator->flushing)
     {
+        for (GstHailoAggregatorPendingFrame &pending_frame : hailoaggregator->pending_frames)
+        {
+            if (pending_frame.buffer == NULL)
+                continue;
+            if (frame_id != 0)
+            {
+                if (pending_frame.frame_id == frame_id)
+                {
+                    // A frame that gave up on its crops drops the late ones.
+                    if (!pending_frame.complete)
+                        frame = &pending_frame;
+                    else
+                        stale = true;
+                    break;
+                }
+                // A newer frame is already pending, so the main frame of this crop was already pushed.
+                if (pending_frame.frame_id > frame_id)
+                    stale = true;
+                continue;
+            }
+            if (!pending_frame.complete && pending_frame.offset == buf->offset)
+            {
+                frame = &pending_frame;
+                break;
+            }
+            // A newer frame is already pending, so the main frame of this crop was already pushed.
+            if (pending_frame.offset != GST_BUFFER_OFFSET_NONE && pending_frame.offset > buf->offset)
+                stale = true;
+        }
+        if (frame != NULL || stale || hailoaggregator->eos_main)
+            break;
+        // Wait until the main frame of this crop arrives.
         hailoaggregator->cv_sub.wait(lock);
     }
 
-    if (hailoaggregator->mainframe != NULL)
+    if (frame != NULL)
     {
+        hailoaggregator->mainframe = frame->buffer;
         HailoROIPtr sub_buffer_roi = get_hailo_main_roi(buf);
         hailoaggregator_class->handle_sub_frame_roi(hailoaggregator, sub_buffer_roi);
+        hailoaggregator->mainframe = NULL;
 
-        // Increase the number of received frames.
-        hailoaggregator->num_of_frames++;
-        if (hailoaggregator->num_of_frames >= hailoaggregator->expected_frames)
+        // Increase the number of received crops.
+        frame->received_crops++;
+        if (frame->received_crops >= frame->expected_crops)
         {
-            // Release the mutex in the main chain if all the frames received.
-            hailoaggregator->cv_main.notify_one();
-            hailoaggregator->num_of_frames = 0;
+            // The frame is pushed by the main streaming thread or the src pad task, never from this one.
+            frame->complete = true;
+            hailoaggregator->cv_main.notify_all();
+            hailoaggregator->cv_task.notify_all();
         }
     }
+    else
+    {
+        GST_DEBUG_OBJECT(hailoaggregator, "Dropping crop with offset %" G_GUINT64_FORMAT ", its main frame is gone", buf->offset);
+    }
+    lock.unlock();
 
     gst_buffer_remove_hailo_meta(buf);
     gst_buffer_unref(buf);
@@ -335,38 +731,64 @@ gst_hailoaggregator_chain_sub(GstPad *pad, GstObject *parent, GstBuffer *buf)
 static GstFlowReturn
 gst_hailoaggregator_chain_main(GstPad *pad, GstObject *parent, GstBuffer *buf)
 {
-    GstFlowReturn ret = GST_FLOW_ERROR;
     GstHailoAggregator *hailoaggregator = GST_HAILO_AGGREGATOR_CAST(parent);
-    GstHailoAggregatorClass *hailoaggregator_class = GST_HAILO_AGGREGATOR_GET_CLASS(hailoaggregator);
-    std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
-
-    // Get excpected frames from the main frame ROI
-    HailoROIPtr hailo_roi = get_hailo_main_roi(buf);
 
-    hailoaggregator->expected_frames = gst_buffer_get_hailo_cropping_meta(buf)->num_of_crops;
+    // Get excpected crops from the main frame cropping meta
+    GstHailoCroppingMeta *cropping_meta = gst_buffer_get_hailo_cropping_meta(buf);
+    uint expected_crops = cropping_meta->num_of_crops;
+    guint64 frame_id = cropping_meta->frame_id;
 
-    if (hailoaggregator->expected_frames != 0 && !hailoaggregator->eos_sub)
+    std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
+    // Wait for room in the pending frames, the src pad task makes it as it pushes them.
+    while (!hailoaggregator->flushing && hailoaggregator->src_result == GST_FLOW_OK &&
+           gst_hailoaggregator_num_pending_frames_unlocked(hailoaggregator) >= hailoaggregator->max_inflight)
     {
-        hailoaggregator->mainframe = buf;
-        hailoaggregator->cv_sub.notify_one();
         hailoaggregator->cv_main.wait(lock);
-        hailoaggregator->mainframe = NULL;
     }
-    lock.unlock();
-
-    
-    hailoaggregator_class->handle_main_roi_post_aggregation(hailoaggregator, hailo_roi);
-
-    gst_pad_sticky_events_foreach(hailoaggregator->sinkpad_main, forward_events, hailoaggregator->srcpad);
+    if (hailoaggregator->flushing || hailoaggregator->src_result != GST_FLOW_OK)
+    {
+        GstFlowReturn ret = hailoaggregator->flushing ? GST_FLOW_FLUSHING : hailoaggregator->src_result;
+        lock.unlock();
+        gst_buffer_unref(buf);
+        return ret;
+    }
 
-    // Remove the cropping meta from the main frame.
-    if (! gst_buffer_remove_hailo_cropping_meta(buf))
+    GstHailoAggregatorPendingFrame frame;
+    frame.buffer = buf;
+    frame.event = NULL;
+    frame.offset = buf->offset;
+    frame.frame_id = frame_id;
+    frame.expected_crops = expected_crops;
+    frame.received_crops = 0;
+    frame.deadline = (hailoaggregator->crop_timeout == 0) ? 0 : g_get_monotonic_time() + (gint64)hailoaggregator->crop_timeout * G_TIME_SPAN_MILLISECOND;
+    frame.complete = (expected_crops == 0 || hailoaggregator->eos_sub);
+    hailoaggregator->pending_frames.push_back(frame);
+    hailoaggregator->cv_sub.notify_all();
+
+    if (hailoaggregator->src_task)
     {
-        GST_ERROR_OBJECT(hailoaggregator, "Failed to remove cropping meta from main frame");
+        hailoaggregator->cv_task.notify_all();
+        return GST_FLOW_OK;
     }
 
-    // Push main buffer into the src pad.
-    ret = gst_pad_push(hailoaggregator->srcpad, buf);
+    // Without the task, wait for the crops of this frame and push it from this thread. A frame left pending by a
+    // flush of the sub pad alone is pushed before it. Frames stay pending on flush, to be released by flush-stop
+    // of the main pad or when the element stops.
+    GstBuffer *head = NULL;
+    GstFlowReturn ret = GST_FLOW_OK;
+    while (head != buf)
+    {
+        if (!gst_hailoaggregator_wait_for_head_unlocked(hailoaggregator, lock, hailoaggregator->cv_main))
+            return GST_FLOW_FLUSHING;
+        head = hailoaggregator->pending_frames.front().buffer;
+        hailoaggregator->pending_frames.erase(hailoaggregator->pending_frames.begin());
+        lock.unlock();
+
+        GST_PAD_STREAM_LOCK(hailoaggregator->srcpad);
+        ret = gst_hailoaggregator_push_frame(hailoaggregator, head, true);
+        GST_PAD_STREAM_UNLOCK(hailoaggregator->srcpad);
+        lock.lock();
+    }
     return ret;
 }
 
@@ -394,7 +816,7 @@ static void gst_hailoaggregator_handle_sub_frame_roi(GstHailoAggregator *hailoag
 
 /**
  * Functionality to perform after all frames are aggregated succesfully.
- * Called from the chain_main method before releasing the mutex and the buffers.
+ * Called right before the main frame is pushed, from the main chain function or from the src pad task when max-inflight is above 1.
  * Base implementation does nothing, derived elements can override.
  * 
  * @param[in] hailoaggregator   GstHailoAggregator.
@@ -403,6 +825,16 @@ static void gst_hailoaggregator_handle_sub_frame_roi(GstHailoAggregator *hailoag
  */
 static void gst_hailoaggregator_post_aggregation(GstHailoAggregator *hailoaggregator, HailoROIPtr hailo_roi) {}
 
+/**
+ * Functionality to perform when the pending frames are dropped, on flush-stop and when the element stops.
+ * Called with the mutex held, the frames it was given sub frames of will never reach post aggregation.
+ * Base implementation does nothing, derived elements can override.
+ *
+ * @param[in] hailoaggregator   GstHailoAggregator.
+ * @return void.
+ */
+static void gst_hailoaggregator_handle_reset(GstHailoAggregator *hailoaggregator) {}
+
 static GstStateChangeReturn
 gst_hailoaggregator_change_state(GstElement *element, GstStateChange transition)
 {
@@ -411,10 +843,19 @@ gst_hailoaggregator_change_state(GstElement *element, GstStateChange transition)
     {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
     {
-        // Unlocking both condition variables in order to finish the chain function.
+        // Unlocking the condition variables in order to finish the chain functions and the src pad task.
         // After that the pads can be freed by the change_state of base class.
+        std::unique_lock<std::mutex> lock(aggregator->mutex);
+        aggregator->flushing = true;
         aggregator->cv_main.notify_all();
         aggregator->cv_sub.notify_all();
+        aggregator->cv_task.notify_all();
+        break;
+    }
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+    {
+        std::unique_lock<std::mutex> lock(aggregator->mutex);
+        aggregator->flushing = false;
         break;
     }
     default:
@@ -426,5 +867,12 @@ gst_hailoaggregator_change_state(GstElement *element, GstStateChange transition)
     if (ret == GST_STATE_CHANGE_FAILURE)
         return ret;
 
+    if (transition == GST_STATE_CHANGE_PAUSED_TO_READY)
+    {
+        // The pads are deactivated and the src pad task stopped, drop the frames that never got pushed.
+        std::unique_lock<std::mutex> lock(aggregator->mutex);
+        gst_hailoaggregator_clear_pending_frames_unlocked(aggregator);
+    }
+
     return ret;
 }
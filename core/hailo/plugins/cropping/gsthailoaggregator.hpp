@@ -12,6 +12,7 @@
 #include <gst/gst.h>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
 
 #include "hailo_objects.hpp"
 
@@ -31,6 +32,23 @@ G_BEGIN_DECLS
 #define GST_HAILO_AGGREGATOR_GET_CLASS(obj) \
         (G_TYPE_INSTANCE_GET_CLASS ((obj), GST_TYPE_HAILO_AGGREGATOR, GstHailoAggregatorClass))
 
+/**
+ * A main frame waiting for its crops to come back from the sub branch.
+ * While the src pad task pushes the frames, serialized events of the main pad wait in the same queue so they keep
+ * their place between the frames, those entries hold the event instead of a buffer and are always complete.
+ */
+typedef struct
+{
+    GstBuffer *buffer;
+    GstEvent *event;
+    guint64 offset;
+    guint64 frame_id; // id the cropper gave the frame and its crops, 0 - none, crops are then matched by offset.
+    uint expected_crops;
+    uint received_crops;
+    gint64 deadline; // monotonic time (us) after which missing crops are given up on, 0 - never.
+    bool complete;
+} GstHailoAggregatorPendingFrame;
+
 typedef struct _GstHailoAggregator GstHailoAggregator;
 typedef struct _GstHailoAggregatorClass GstHailoAggregatorClass;
 
@@ -44,15 +62,25 @@ struct _GstHailoAggregator
     bool eos_main;
     GstPad *sinkpad_sub;
     bool eos_sub;
+    // The main frame of the sub frame currently being handled (valid during handle_sub_frame_roi).
     GstBuffer *mainframe;
-    uint num_of_frames;
-    uint expected_frames;
-    uint last_offset;
     gboolean flatten_detections;
+    uint max_inflight;
+    uint crop_timeout;
+    gboolean flushing;
 
+    // Main frames in arrival order, pushed downstream in that order once all their crops arrived.
+    std::vector<GstHailoAggregatorPendingFrame> pending_frames;
     std::mutex mutex;
     std::condition_variable cv_main;
     std::condition_variable cv_sub;
+    // With max-inflight above 1 the frames are pushed by a task of the src pad, otherwise by the main streaming thread.
+    bool src_task;
+    std::condition_variable cv_task;
+    // Result of the last push of the src pad task, returned upstream by the main chain function.
+    GstFlowReturn src_result;
+    // EOS of the main pad that reached the head of the queue before the sub pad got its own.
+    GstEvent *held_eos;
 };
 
 struct _GstHailoAggregatorClass
@@ -61,6 +89,7 @@ struct _GstHailoAggregatorClass
 
     void (*handle_main_roi_post_aggregation) (GstHailoAggregator *hailoaggregator, HailoROIPtr hailo_roi);
     void (*handle_sub_frame_roi) (GstHailoAggregator *hailoaggregator, HailoROIPtr sub_buffer_roi);
+    void (*handle_reset) (GstHailoAggregator *hailoaggregator);
 };
 
 G_GNUC_INTERNAL GType gst_hailoaggregator_get_type(void);
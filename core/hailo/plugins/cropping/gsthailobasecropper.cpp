@@ -34,6 +34,8 @@ enum
     PROP_DROP_UNCROPPED_BUFFERS,
     PROP_CROPPING_PERIOD,
     PROP_FILTER_STREAMS,
+    PROP_BATCH_CROPS,
+    PROP_CROP_THREADS,
 #ifdef HAILO15_TARGET
     PROP_USE_DSP,
     PROP_POOL_SIZE,
@@ -120,6 +122,17 @@ gst_hailo_basecropper_class_init(GstHailoBaseCropperClass *klass)
                                                                              "Filter stream", "",
                                                                              (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)),
                                                          (GParamFlags)(G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_BATCH_CROPS,
+                                    g_param_spec_boolean("batch-crops", "Batch Crops",
+                                                         "If true, all the crops of a buffer are prepared together: caps are read once, output buffers are drawn from a pool "
+                                                         "and the resizes run in parallel on crop-threads threads, the crops are pushed in order. Default false.",
+                                                         false,
+                                                         (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_CROP_THREADS,
+                                    g_param_spec_uint("crop-threads", "Crop Threads",
+                                                      "Number of threads resizing the crops of a buffer when batch-crops is enabled, 0 uses one per CPU core. Default 0.",
+                                                      0, 64, 0,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
 
 #ifdef HAILO15_TARGET
     g_object_class_install_property(gobject_class, PROP_USE_DSP,
@@ -171,7 +184,11 @@ gst_hailo_basecropper_init(GstHailoBaseCropper *hailo_basecropper)
 #endif
     hailo_basecropper->use_internal_offset = false;
     hailo_basecropper->internal_offset = 0;
+    hailo_basecropper->next_frame_id = 1;
     hailo_basecropper->cropping_period = 1;
+    hailo_basecropper->batch_crops = false;
+    hailo_basecropper->crop_threads = 0;
+    hailo_basecropper->crop_workers = nullptr;
     hailo_basecropper->num_streams_to_filter = 0;
     hailo_basecropper->drop_uncropped_buffers = false;
     hailo_basecropper->buffer_pool = NULL;
@@ -205,14 +222,63 @@ static void gst_hailo_basecropper_dispose(GObject *object)
         hailo_basecropper->buffer_pool = NULL;
     }
 
+    if (hailo_basecropper->crop_workers)
+    {
+        delete hailo_basecropper->crop_workers;
+        hailo_basecropper->crop_workers = nullptr;
+    }
+
     G_OBJECT_CLASS(gst_hailo_basecropper_parent_class)->dispose(object);
 }
 
+/**
+ * Creates the pool the batched crop path draws its output buffers from (system memory).
+ *
+ * @param[in] hailo_basecropper Cropping element.
+ * @param[in] caps              Caps of the crop src pad.
+ * @return Upon success, returns true. Otherwise, returns false.
+ */
+static gboolean
+gst_hailo_basecropper_create_batch_pool(GstHailoBaseCropper *hailo_basecropper, GstCaps *caps)
+{
+    if (hailo_basecropper->buffer_pool)
+    {
+        gst_buffer_pool_set_active(hailo_basecropper->buffer_pool, FALSE);
+        gst_object_unref(hailo_basecropper->buffer_pool);
+        hailo_basecropper->buffer_pool = NULL;
+    }
+
+    GstBufferPool *pool = gst_buffer_pool_new();
+    GstStructure *config = gst_buffer_pool_get_config(pool);
+    gst_buffer_pool_config_set_params(config, caps, get_size(caps), HAILO_BASE_CROPPER_BATCH_POOL_MIN_BUFFERS, 0);
+    if (!gst_buffer_pool_set_config(pool, config) || !gst_buffer_pool_set_active(pool, TRUE))
+    {
+        GST_ERROR_OBJECT(hailo_basecropper, "Failed to configure the batched crops buffer pool");
+        gst_object_unref(pool);
+        return FALSE;
+    }
+
+    GST_INFO_OBJECT(hailo_basecropper, "Batched crops buffer pool created");
+    hailo_basecropper->buffer_pool = pool;
+    return TRUE;
+}
+
 static gboolean
 gst_hailo_basecropper_decide_allocation(GstHailoBaseCropper *hailo_basecropper, GstQuery *query)
 {
     gboolean ret = TRUE;
 
+    if (hailo_basecropper->batch_crops
+#ifdef HAILO15_TARGET
+        && !hailo_basecropper->use_dsp
+#endif
+    )
+    {
+        GstCaps *caps = NULL;
+        gst_query_parse_allocation(query, &caps, NULL);
+        return caps != NULL && gst_hailo_basecropper_create_batch_pool(hailo_basecropper, caps);
+    }
+
 #ifdef HAILO15_TARGET
     if (!hailo_basecropper->use_dsp)
         return ret;
@@ -302,6 +368,15 @@ gst_hailo_basecropper_set_property(GObject *object, guint prop_id,
     case PROP_FILTER_STREAMS:
         set_filter_streams(hailo_basecropper, value);
         break;
+    case PROP_BATCH_CROPS:
+        hailo_basecropper->batch_crops = g_value_get_boolean(value);
+        break;
+    case PROP_CROP_THREADS:
+        hailo_basecropper->crop_threads = g_value_get_uint(value);
+        // The workers are created again with the new size on the next batch
+        delete hailo_basecropper->crop_workers;
+        hailo_basecropper->crop_workers = nullptr;
+        break;
 #ifdef HAILO15_TARGET
     case PROP_USE_DSP:
         hailo_basecropper->use_dsp = g_value_get_boolean(value);
@@ -336,6 +411,12 @@ gst_hailo_basecropper_get_property(GObject *object, guint prop_id,
     case PROP_FILTER_STREAMS:
         get_filter_streams(hailo_basecropper, value);
         break;
+    case PROP_BATCH_CROPS:
+        g_value_set_boolean(value, hailo_basecropper->batch_crops);
+        break;
+    case PROP_CROP_THREADS:
+        g_value_set_uint(value, hailo_basecropper->crop_threads);
+        break;
 #ifdef HAILO15_TARGET
     case PROP_USE_DSP:
         g_value_set_boolean(value, hailo_basecropper->use_dsp);
@@ -591,14 +672,21 @@ static GstBuffer *gst_hailo_basecropper_allocate_new_buffer(GstHailoBaseCropper
             GST_ERROR_OBJECT(hailo_basecropper, "Failed to acquire buffer from pool");
             return NULL;
         }
+        return output_buffer;
     }
-    else
+#endif
+
+    // The batched crop path draws from its own pool, the per crop path allocates
+    if (hailo_basecropper->buffer_pool)
     {
-        output_buffer = gst_buffer_new_allocate(NULL, buffer_size, NULL);
+        if (gst_buffer_pool_acquire_buffer(hailo_basecropper->buffer_pool, &output_buffer, NULL) != GST_FLOW_OK)
+        {
+            GST_ERROR_OBJECT(hailo_basecropper, "Failed to acquire buffer from pool");
+            return NULL;
+        }
+        return output_buffer;
     }
-#else
     output_buffer = gst_buffer_new_allocate(NULL, buffer_size, NULL);
-#endif
 
     return output_buffer;
 }
@@ -712,23 +800,24 @@ static gboolean opencv_crop_and_resize(GstHailoBaseCropper *hailo_basecropper, s
 }
 
 /**
- * Create a new GstBuffer, crop and resize the frame to match the crop_roi, add the buffer to the metadata.
+ * Reads the video info of the input and of the crops from the current caps of the pads.
  *
- * @param[in] hailo_basecropper Cropping element.
- * @param[in] input_buffer      Buffer to crop & resize.
- * @param[in] crop_roi          Reference to a ROI Object to crop dimensions.
- * @return A new buffer, cropped and scaled for a second network.
+ * @param[in] hailo_basecropper   Cropping element.
+ * @param[out] full_image_info    Video info of the input buffers.
+ * @param[out] resized_image_info Video info of the cropped buffers.
+ * @param[out] buffer_size        Size of a cropped buffer.
+ * @return Upon success, returns true. Otherwise (missing caps or different formats), returns false.
  */
-static GstBuffer *handle_one_crop(GstHailoBaseCropper *hailo_basecropper, GstBuffer *input_buffer, HailoROIPtr crop_roi)
+static gboolean get_crop_video_info(GstHailoBaseCropper *hailo_basecropper, GstVideoInfo *full_image_info,
+                                    GstVideoInfo *resized_image_info, size_t *buffer_size)
 {
     GstCaps *incaps, *outcaps;
-    GstBuffer *output_buffer = NULL;
 
     incaps = gst_pad_get_current_caps(hailo_basecropper->sinkpad);
     if (!incaps)
     {
         GST_ERROR_OBJECT(hailo_basecropper, "Failed to get input CAPS from sinkpad");
-        return NULL;
+        return FALSE;
     }
 
     outcaps = gst_pad_get_current_caps(hailo_basecropper->srcpad_crop);
@@ -736,7 +825,7 @@ static GstBuffer *handle_one_crop(GstHailoBaseCropper *hailo_basecropper, GstBuf
     {
         GST_ERROR_OBJECT(hailo_basecropper, "Failed to get output CAPS from srcpad (crop)");
         gst_caps_unref(incaps);
-        return NULL;
+        return FALSE;
     }
 
     // Check both caps have the same format:
@@ -754,82 +843,233 @@ static GstBuffer *handle_one_crop(GstHailoBaseCropper *hailo_basecropper, GstBuf
         std::cerr << "ERROR: Hailo Cropper Input and output caps have different formats" << std::endl;
         gst_caps_unref(incaps);
         gst_caps_unref(outcaps);
-        return NULL;
+        return FALSE;
     }
 
-    GstVideoInfo *full_image_info = gst_video_info_new();
     gst_video_info_from_caps(full_image_info, incaps);
-
-    GstVideoInfo *resized_image_info = gst_video_info_new();
     gst_video_info_from_caps(resized_image_info, outcaps);
+    *buffer_size = get_size(outcaps);
 
+    gst_caps_unref(incaps);
+    gst_caps_unref(outcaps);
+    return TRUE;
+}
+
+/**
+ * Whether a crop can reuse the input buffer as is: the crop ROI is the whole buffer
+ * and the input and output resolutions are the same.
+ */
+static bool crop_is_whole_buffer(HailoROIPtr crop_roi, GstVideoInfo *full_image_info, GstVideoInfo *resized_image_info)
+{
     HailoBBox roi_bbox = crop_roi->get_bbox();
     bool crop_roi_is_whole_buffer = (roi_bbox.width() == 1.0f && roi_bbox.height() == 1.0f && roi_bbox.xmin() == 0.0f && roi_bbox.ymin() == 0.0f);
     bool input_res_equals_output_res = (full_image_info->width == resized_image_info->width && full_image_info->height == resized_image_info->height);
+    return crop_roi_is_whole_buffer && input_res_equals_output_res;
+}
+
+/**
+ * Create a new GstBuffer, crop and resize the frame to match the crop_roi, add the buffer to the metadata.
+ *
+ * @param[in] hailo_basecropper Cropping element.
+ * @param[in] input_buffer      Buffer to crop & resize.
+ * @param[in] crop_roi          Reference to a ROI Object to crop dimensions.
+ * @return A new buffer, cropped and scaled for a second network.
+ */
+static GstBuffer *handle_one_crop(GstHailoBaseCropper *hailo_basecropper, GstBuffer *input_buffer, HailoROIPtr crop_roi)
+{
+    GstBuffer *output_buffer = NULL;
+    GstVideoInfo full_image_info, resized_image_info;
+    size_t buffer_size;
+
+    if (!get_crop_video_info(hailo_basecropper, &full_image_info, &resized_image_info, &buffer_size))
+        return NULL;
 
     // If the crop ROI is the whole buffer and the input and output resolutions are the same, we can just return a copy of the buffer
-    if (crop_roi_is_whole_buffer && input_res_equals_output_res)
+    if (crop_is_whole_buffer(crop_roi, &full_image_info, &resized_image_info))
     {
         GST_DEBUG_OBJECT(hailo_basecropper, "Crop ROI is the whole buffer and input and output resolutions are the same, returning a copy of the buffer");
         output_buffer = gst_buffer_ref(input_buffer);
         gst_buffer_add_hailo_meta(output_buffer, crop_roi);
-        gst_video_info_free(full_image_info);
-        gst_video_info_free(resized_image_info);
-        gst_caps_unref(incaps);
-        gst_caps_unref(outcaps);
         return output_buffer;
     }
 
-    size_t buffer_size = get_size(outcaps);
     GST_DEBUG_OBJECT(hailo_basecropper, "Allocating output buffer size: %d", (int)buffer_size);
     // Allocate new GstBuffer
     output_buffer = gst_hailo_basecropper_allocate_new_buffer(hailo_basecropper, buffer_size);
 
     // Get cv matrix of full image from buffer
-    std::shared_ptr<HailoMat> full_image = get_mat_by_format(input_buffer, full_image_info);
+    std::shared_ptr<HailoMat> full_image = get_mat_by_format(input_buffer, &full_image_info);
 
     // Get cv matrix of cropped image from buffer
-    std::shared_ptr<HailoMat> resized_image = get_mat_by_format(output_buffer, resized_image_info);
+    std::shared_ptr<HailoMat> resized_image = get_mat_by_format(output_buffer, &resized_image_info);
 
 // Crop and resize the frame
 #ifdef HAILO15_TARGET
     if (hailo_basecropper->use_dsp)
     {
         cv::Rect crop_rect = full_image->get_crop_rect(crop_roi);
-        dsp_crop_and_resize(hailo_basecropper, crop_rect, resized_image, input_buffer, full_image_info, output_buffer, resized_image_info);
+        dsp_crop_and_resize(hailo_basecropper, crop_rect, resized_image, input_buffer, &full_image_info, output_buffer, &resized_image_info);
     }
     else
     {
-        opencv_crop_and_resize(hailo_basecropper, resized_image, full_image, full_image_info, crop_roi);
+        opencv_crop_and_resize(hailo_basecropper, resized_image, full_image, &full_image_info, crop_roi);
     }
 #else
-    opencv_crop_and_resize(hailo_basecropper, resized_image, full_image, full_image_info, crop_roi);
+    opencv_crop_and_resize(hailo_basecropper, resized_image, full_image, &full_image_info, crop_roi);
 #endif
 
     GST_DEBUG_OBJECT(hailo_basecropper, "Crop and resize done, freeing resources and returning buffer");
 
-    gst_video_info_free(full_image_info);
-    gst_video_info_free(resized_image_info);
-
     // Add the croopped ROI to the buffer
     gst_buffer_add_hailo_meta(output_buffer, crop_roi);
 
-    gst_caps_unref(incaps);
-    gst_caps_unref(outcaps);
-
     return output_buffer;
 }
 
+/**
+ * One crop of a batch: its output buffer and the mat wrapping it.
+ */
+struct CropJob
+{
+    HailoROIPtr roi;
+    GstBuffer *buffer = NULL;
+    std::shared_ptr<HailoMat> resized_image;
+    bool succeeded = true;
+};
+
+/**
+ * Marks a crop buffer with the id of its main frame, so the aggregator matches it to that frame.
+ * A crop that is the main buffer itself already carries the main frame's cropping meta.
+ *
+ * @param[in] crop      Crop buffer.
+ * @param[in] frame_id  Id of the main frame.
+ */
+static void tag_crop(GstBuffer *crop, guint64 frame_id)
+{
+    if (gst_buffer_get_hailo_cropping_meta(crop))
+        return;
+    GstHailoCroppingMeta *meta = gst_buffer_add_hailo_cropping_meta(crop, 0);
+    if (meta)
+        meta->frame_id = frame_id;
+}
+
+/**
+ * Creates the crop buffers of all the given HailoROIs at once:
+ * the caps are read once, every output buffer is drawn from the pool before any resize,
+ * the resizes run on the crop workers (DSP crops run one after the other), then the crops are pushed in order.
+ *
+ * @param[in] hailo_basecropper Cropping element.
+ * @param[in] buf               Buffer to crop.
+ * @param[in] crop_rois         Vector of HailoROI of buf to crop from.
+ * @param[in] frame_id          Id of the main frame, given to every crop.
+ * @return boolean, whether all cropping were successful.
+ */
+static gboolean handle_crops_batched(GstHailoBaseCropper *hailo_basecropper, GstBuffer *buf, std::vector<HailoROIPtr> &crop_rois, guint64 frame_id)
+{
+    if (!gst_pad_is_active(hailo_basecropper->srcpad_crop))
+    {
+        GST_INFO_OBJECT(hailo_basecropper, "Crop src pad is not active, dropping buffer");
+        return TRUE;
+    }
+
+    GstVideoInfo full_image_info, resized_image_info;
+    size_t buffer_size;
+    if (!get_crop_video_info(hailo_basecropper, &full_image_info, &resized_image_info, &buffer_size))
+    {
+        GST_WARNING_OBJECT(hailo_basecropper, "Could not crop buffer with offset %jd", buf->offset);
+        return FALSE;
+    }
+    std::shared_ptr<HailoMat> full_image = get_mat_by_format(buf, &full_image_info);
+
+    // Draw all the output buffers up front
+    std::vector<CropJob> jobs(crop_rois.size());
+    for (size_t i = 0; i < crop_rois.size(); i++)
+    {
+        CropJob &job = jobs[i];
+        job.roi = crop_rois[i];
+        if (crop_is_whole_buffer(job.roi, &full_image_info, &resized_image_info))
+        {
+            job.buffer = gst_buffer_ref(buf);
+            continue;
+        }
+        job.buffer = gst_hailo_basecropper_allocate_new_buffer(hailo_basecropper, buffer_size);
+        if (job.buffer)
+            job.resized_image = get_mat_by_format(job.buffer, &resized_image_info);
+        else
+            job.succeeded = false;
+    }
+
+    // Crop and resize the frames
+#ifdef HAILO15_TARGET
+    if (hailo_basecropper->use_dsp)
+    {
+        for (CropJob &job : jobs)
+        {
+            if (!job.resized_image)
+                continue;
+            cv::Rect crop_rect = full_image->get_crop_rect(job.roi);
+            job.succeeded = dsp_crop_and_resize(hailo_basecropper, crop_rect, job.resized_image, buf, &full_image_info, job.buffer, &resized_image_info);
+        }
+    }
+    else
+#endif
+    {
+        if (!hailo_basecropper->crop_workers)
+            hailo_basecropper->crop_workers = new WorkerPool(hailo_basecropper->crop_threads);
+        auto crop_and_resize = [&](size_t i)
+        {
+            CropJob &job = jobs[i];
+            if (!job.resized_image)
+                return;
+            try
+            {
+                job.succeeded = opencv_crop_and_resize(hailo_basecropper, job.resized_image, full_image, &full_image_info, job.roi);
+            }
+            catch (const std::exception &e)
+            {
+                GST_ERROR_OBJECT(hailo_basecropper, "Crop and resize failed: %s", e.what());
+                job.succeeded = false;
+            }
+        };
+        hailo_basecropper->crop_workers->run(jobs.size(), crop_and_resize);
+    }
+
+    // Push the cropped buffers into the crop src pad, in the order of the rois
+    gboolean ret = TRUE;
+    for (CropJob &job : jobs)
+    {
+        job.resized_image.reset();
+        if (!ret || !job.succeeded)
+        {
+            if (job.buffer)
+                gst_buffer_unref(job.buffer);
+            if (ret)
+                GST_WARNING_OBJECT(hailo_basecropper, "Could not crop buffer with offset %jd", buf->offset);
+            ret = FALSE;
+            continue;
+        }
+        gst_buffer_add_hailo_meta(job.buffer, job.roi);
+        job.buffer->offset = buf->offset;
+        tag_crop(job.buffer, frame_id);
+        gst_pad_push(hailo_basecropper->srcpad_crop, job.buffer);
+    }
+    return ret;
+}
+
 /**
  * Creates new crop buffers from given HailoROIs
  *
  * @param[in] hailo_basecropper      cropping element.
  * @param[in] buf               Buffer to crop.
  * @param[in] crop_rois        Vector of HailoROI of buf to crop from.
+ * @param[in] frame_id         Id of the main frame, given to every crop.
  * @return boolean, whether all cropping were successful.
  */
-static gboolean handle_crops(GstHailoBaseCropper *hailo_basecropper, GstBuffer *buf, std::vector<HailoROIPtr> &crop_rois)
+static gboolean handle_crops(GstHailoBaseCropper *hailo_basecropper, GstBuffer *buf, std::vector<HailoROIPtr> &crop_rois, guint64 frame_id)
 {
+    if (hailo_basecropper->batch_crops)
+        return handle_crops_batched(hailo_basecropper, buf, crop_rois, frame_id);
+
     for (HailoROIPtr &crop_roi : crop_rois)
     {
         if (!gst_pad_is_active(hailo_basecropper->srcpad_crop))
@@ -844,6 +1084,7 @@ static gboolean handle_crops(GstHailoBaseCropper *hailo_basecropper, GstBuffer *
             return FALSE;
         }
         newbuf->offset = buf->offset;
+        tag_crop(newbuf, frame_id);
 
         // Push the cropped buffer into the crop src pad.
         gst_pad_push(hailo_basecropper->srcpad_crop, newbuf);
@@ -909,7 +1150,10 @@ static GstFlowReturn gst_hailo_basecropper_chain(GstPad *pad, GstObject *parent,
     }
     hailo_basecropper->stream_ids_buff_offset[streamid_key]++;
 
-    gst_buffer_add_hailo_cropping_meta(buf, crop_rois.size());
+    guint64 frame_id = hailo_basecropper->next_frame_id++;
+    GstHailoCroppingMeta *cropping_meta = gst_buffer_add_hailo_cropping_meta(buf, crop_rois.size());
+    if (cropping_meta)
+        cropping_meta->frame_id = frame_id;
 
     // Push the main buffer into the main src pad.
     if (crop_rois.empty())
@@ -919,7 +1163,7 @@ static GstFlowReturn gst_hailo_basecropper_chain(GstPad *pad, GstObject *parent,
     else
     {
         gst_pad_push(hailo_basecropper->srcpad_main, gst_buffer_ref(buf));
-        gboolean handle_crops_ret = handle_crops(hailo_basecropper, buf, crop_rois);
+        gboolean handle_crops_ret = handle_crops(hailo_basecropper, buf, crop_rois, frame_id);
         gst_buffer_unref(buf);
         if (!handle_crops_ret)
         {
@@ -8,6 +8,7 @@
 #include <gst/video/video-format.h>
 #include <opencv2/opencv.hpp>
 #include "hailo_objects.hpp"
+#include "worker_pool.hpp"
 
 G_BEGIN_DECLS
 
@@ -24,6 +25,8 @@ G_BEGIN_DECLS
 #define HAILO_BASE_CROPPER_SUPPORTED_FORMATS "{ RGB, RGBA, YUY2, NV12 }"
 #define HAILO_BASE_CROPPER_VIDEO_CAPS \
     GST_VIDEO_CAPS_MAKE(HAILO_BASE_CROPPER_SUPPORTED_FORMATS)
+// Buffers allocated up front by the pool of the batched crop path, it grows past that on demand
+#define HAILO_BASE_CROPPER_BATCH_POOL_MIN_BUFFERS 16
 
 typedef struct _GstHailoBaseCropper GstHailoBaseCropper;
 typedef struct _GstHailoBaseCropperClass GstHailoBaseCropperClass;
@@ -34,7 +37,12 @@ struct _GstHailoBaseCropper
     gboolean use_internal_offset;
     gboolean drop_uncropped_buffers;
     uint internal_offset;
+    // Id of the next main frame, written in the cropping meta of the frame and of its crops.
+    guint64 next_frame_id;
     uint cropping_period;
+    gboolean batch_crops;
+    guint crop_threads;
+    WorkerPool *crop_workers;
     #ifdef HAILO15_TARGET
     bool use_dsp;
     guint bufferpool_max_size;
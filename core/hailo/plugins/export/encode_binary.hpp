@@ -0,0 +1,417 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * Compact binary wire format for a HailoROI object tree, the binary counterpart of encode_json.
+ *
+ * All values are little-endian. A message is a fixed header followed by a single ROI record:
+ *
+ *   Header  := magic "HROI" | u16 version | u16 header size | i64 timestamp (ms) | u64 buffer offset | u64 reserved
+ *   Record  := u16 tag | u16 flags | u32 body length | body
+ *   String  := u32 length | bytes (no terminator)
+ *   Payload := u32 byte count | zero padding up to an 8 byte boundary (from the message start) | raw bytes
+ *
+ * Record bodies (containers end with their child records, up to the body length):
+ *   ROI             := bbox (4 x f32: xmin, ymin, width, height) | children
+ *   DETECTION       := bbox | f32 confidence | i32 class id | String label | children
+ *   CLASSIFICATION  := f32 confidence | i32 class id | String type | String label
+ *   LANDMARKS       := String type | f32 threshold | u32 count | count x (f32 x, f32 y, f32 confidence) | u32 count | count x (i32, i32)
+ *   TILE            := bbox | u32 index | u32 layer | u32 mode | f32 overlap x | f32 overlap y | children
+ *   UNIQUE_ID       := i32 id | i32 mode
+ *   DEPTH_MASK      := i32 width | i32 height | f32 transparency | Payload (f32)
+ *   CLASS_MASK      := i32 width | i32 height | f32 transparency | Payload (u8)
+ *   CONF_CLASS_MASK := i32 width | i32 height | f32 transparency | i32 class id | Payload (f32)
+ *   MATRIX          := u32 width | u32 height | u32 features | Payload (f32)
+ *   TENSOR          := String name | u32 format type | u32 format order | u32 format flags | u32 height | u32 width | u32 features |
+ *                      f32 qp_zp | f32 qp_scale | f32 limvals_min | f32 limvals_max | Payload
+ *
+ * Readers skip records with an unknown tag (their length is known), so new record types can be added
+ * without bumping the version. The version is bumped when an existing record changes.
+ **/
+#pragma once
+
+// General cpp includes
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "hailo_common.hpp"
+
+#if !defined(__BYTE_ORDER__) || (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error "The hailo binary metadata format is only implemented for little-endian hosts"
+#endif
+
+typedef enum
+{
+    HAILO_META_FORMAT_JSON = 0,
+    HAILO_META_FORMAT_BINARY = 1,
+} hailo_meta_format_t;
+
+namespace binary_format
+{
+    static const char MAGIC[4] = {'H', 'R', 'O', 'I'};
+    static const uint16_t VERSION = 1;
+    static const uint16_t HEADER_SIZE = 32;
+    static const uint16_t RECORD_HEADER_SIZE = 8;
+    static const size_t PAYLOAD_ALIGNMENT = 8;
+
+    typedef enum
+    {
+        RECORD_ROI = 1,
+        RECORD_DETECTION = 2,
+        RECORD_CLASSIFICATION = 3,
+        RECORD_LANDMARKS = 4,
+        RECORD_TILE = 5,
+        RECORD_UNIQUE_ID = 6,
+        RECORD_DEPTH_MASK = 7,
+        RECORD_CLASS_MASK = 8,
+        RECORD_CONF_CLASS_MASK = 9,
+        RECORD_MATRIX = 10,
+        RECORD_TENSOR = 11,
+    } record_tag_t;
+
+    /**
+     * @brief Size in bytes of one element of a tensor, 0 when the tensor can not be serialized
+     *        (NMS tensors, whose byte size does not follow from the shape, or an unresolved format).
+     */
+    inline size_t tensor_element_size(const hailo_vstream_info_t &info)
+    {
+        if (info.format.order == HAILO_FORMAT_ORDER_HAILO_NMS)
+            return 0;
+        switch (info.format.type)
+        {
+        case HAILO_FORMAT_TYPE_UINT8:
+            return 1;
+        case HAILO_FORMAT_TYPE_UINT16:
+            return 2;
+        case HAILO_FORMAT_TYPE_FLOAT32:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    /**
+     * @brief Serializes values into a caller provided buffer.
+     *        With no buffer it only counts bytes, so the same encoding pass
+     *        computes the message size and then fills a message of that size.
+     *        Writes past the capacity are dropped and flag an overflow.
+     */
+    class BinaryWriter
+    {
+    private:
+        uint8_t *m_data;
+        size_t m_capacity;
+        size_t m_size;
+        bool m_overflow;
+
+        void put(const void *src, size_t size)
+        {
+            if (m_data != nullptr)
+            {
+                if (m_size + size <= m_capacity)
+                    std::memcpy(m_data + m_size, src, size);
+                else
+                    m_overflow = true;
+            }
+            m_size += size;
+        }
+
+    public:
+        BinaryWriter(uint8_t *data = nullptr, size_t capacity = 0) : m_data(data), m_capacity(capacity), m_size(0), m_overflow(false) {}
+
+        size_t size() const { return m_size; }
+        bool overflow() const { return m_overflow; }
+
+        template <typename T>
+        void write(T value) { put(&value, sizeof(T)); }
+
+        void write_string(const std::string &str)
+        {
+            write<uint32_t>(str.size());
+            put(str.data(), str.size());
+        }
+
+        void write_bbox(HailoBBox bbox)
+        {
+            write<float>(bbox.xmin());
+            write<float>(bbox.ymin());
+            write<float>(bbox.width());
+            write<float>(bbox.height());
+        }
+
+        void write_payload(const void *src, size_t size)
+        {
+            write<uint32_t>(size);
+            size_t padding = (PAYLOAD_ALIGNMENT - m_size % PAYLOAD_ALIGNMENT) % PAYLOAD_ALIGNMENT;
+            static const uint8_t zeros[PAYLOAD_ALIGNMENT] = {0};
+            put(zeros, padding);
+            put(src, size);
+        }
+
+        /**
+         * @brief Starts a record, returns its position to pass to end_record once the body is written.
+         */
+        size_t begin_record(record_tag_t tag)
+        {
+            size_t position = m_size;
+            write<uint16_t>(tag);
+            write<uint16_t>(0);
+            write<uint32_t>(0);
+            return position;
+        }
+
+        void end_record(size_t position)
+        {
+            uint32_t length = m_size - position - RECORD_HEADER_SIZE;
+            if (m_data != nullptr && position + RECORD_HEADER_SIZE <= m_capacity)
+                std::memcpy(m_data + position + 4, &length, sizeof(length));
+        }
+    };
+}
+
+namespace encode_binary
+{
+    void encode_hailo_objects(binary_format::BinaryWriter &writer, HailoROIPtr roi, bool include_tensors);
+
+    template <class T>
+    void encode_mask_fields(binary_format::BinaryWriter &writer, T mask)
+    {
+        writer.write<int32_t>(mask->get_width());
+        writer.write<int32_t>(mask->get_height());
+        writer.write<float>(mask->get_transparency());
+    }
+
+    inline void encode_detection(binary_format::BinaryWriter &writer, HailoDetectionPtr detection, bool include_tensors)
+    {
+        size_t record = writer.begin_record(binary_format::RECORD_DETECTION);
+        writer.write_bbox(detection->get_bbox());
+        writer.write<float>(detection->get_confidence());
+        writer.write<int32_t>(detection->get_class_id());
+        writer.write_string(detection->get_label());
+        encode_hailo_objects(writer, detection, include_tensors);
+        writer.end_record(record);
+    }
+
+    inline void encode_classification(binary_format::BinaryWriter &writer, HailoClassificationPtr classification)
+    {
+        size_t record = writer.begin_record(binary_format::RECORD_CLASSIFICATION);
+        writer.write<float>(classification->get_confidence());
+        writer.write<int32_t>(classification->get_class_id());
+        writer.write_string(classification->get_classification_type());
+        writer.write_string(classification->get_label());
+        writer.end_record(record);
+    }
+
+    inline void encode_landmarks(binary_format::BinaryWriter &writer, HailoLandmarksPtr landmarks)
+    {
+        size_t record = writer.begin_record(binary_format::RECORD_LANDMARKS);
+        writer.write_string(landmarks->get_landmarks_type());
+        writer.write<float>(landmarks->get_threshold());
+        std::vector<HailoPoint> points = landmarks->get_points();
+        writer.write<uint32_t>(points.size());
+        for (auto &point : points)
+        {
+            writer.write<float>(point.x());
+            writer.write<float>(point.y());
+            writer.write<float>(point.confidence());
+        }
+        std::vector<std::pair<int, int>> pairs = landmarks->get_pairs();
+        writer.write<uint32_t>(pairs.size());
+        for (auto &pair : pairs)
+        {
+            writer.write<int32_t>(pair.first);
+            writer.write<int32_t>(pair.second);
+        }
+        writer.end_record(record);
+    }
+
+    inline void encode_tile(binary_format::BinaryWriter &writer, HailoTileROIPtr tile, bool include_tensors)
+    {
+        size_t record = writer.begin_record(binary_format::RECORD_TILE);
+        writer.write_bbox(tile->get_bbox());
+        writer.write<uint32_t>(tile->get_index());
+        writer.write<uint32_t>(tile->get_layer());
+        writer.write<uint32_t>(tile->get_mode());
+        writer.write<float>(tile->get_overlap_x_axis());
+        writer.write<float>(tile->get_overlap_y_axis());
+        encode_hailo_objects(writer, tile, include_tensors);
+        writer.end_record(record);
+    }
+
+    inline void encode_unique_id(binary_format::BinaryWriter &writer, HailoUniqueIDPtr id)
+    {
+        size_t record = writer.begin_record(binary_format::RECORD_UNIQUE_ID);
+        writer.write<int32_t>(id->get_id());
+        writer.write<int32_t>(id->get_mode());
+        writer.end_record(record);
+    }
+
+    inline void encode_depth_mask(binary_format::BinaryWriter &writer, HailoDepthMaskPtr mask)
+    {
+        size_t record = writer.begin_record(binary_format::RECORD_DEPTH_MASK);
+        encode_mask_fields(writer, mask);
+        if (mask->is_view())
+        {
+            // dequantize into a scratch buffer, without caching a copy in the mask
+            std::vector<float> data(mask->size());
+            mask->dequantize(data.data());
+            writer.write_payload(data.data(), data.size() * sizeof(float));
+        }
+        else
+        {
+            const std::vector<float> &data = mask->get_data();
+            writer.write_payload(data.data(), data.size() * sizeof(float));
+        }
+        writer.end_record(record);
+    }
+
+    inline void encode_class_mask(binary_format::BinaryWriter &writer, HailoClassMaskPtr mask)
+    {
+        size_t record = writer.begin_record(binary_format::RECORD_CLASS_MASK);
+        encode_mask_fields(writer, mask);
+        writer.write_payload(mask->data(), mask->size());
+        writer.end_record(record);
+    }
+
+    inline void encode_conf_class_mask(binary_format::BinaryWriter &writer, HailoConfClassMaskPtr mask)
+    {
+        size_t record = writer.begin_record(binary_format::RECORD_CONF_CLASS_MASK);
+        encode_mask_fields(writer, mask);
+        writer.write<int32_t>(mask->get_class_id());
+        const std::vector<float> &data = mask->get_data();
+        writer.write_payload(data.data(), data.size() * sizeof(float));
+        writer.end_record(record);
+    }
+
+    inline void encode_matrix(binary_format::BinaryWriter &writer, HailoMatrixPtr matrix)
+    {
+        size_t record = writer.begin_record(binary_format::RECORD_MATRIX);
+        writer.write<uint32_t>(matrix->width());
+        writer.write<uint32_t>(matrix->height());
+        writer.write<uint32_t>(matrix->features());
+        const std::vector<float> &data = matrix->get_data();
+        writer.write_payload(data.data(), data.size() * sizeof(float));
+        writer.end_record(record);
+    }
+
+    inline void encode_tensor(binary_format::BinaryWriter &writer, HailoTensorPtr tensor)
+    {
+        hailo_vstream_info_t &info = tensor->vstream_info();
+        size_t element_size = binary_format::tensor_element_size(info);
+        if (element_size == 0)
+            return;
+
+        size_t record = writer.begin_record(binary_format::RECORD_TENSOR);
+        writer.write_string(tensor->name());
+        writer.write<uint32_t>(info.format.type);
+        writer.write<uint32_t>(info.format.order);
+        writer.write<uint32_t>(info.format.flags);
+        writer.write<uint32_t>(info.shape.height);
+        writer.write<uint32_t>(info.shape.width);
+        writer.write<uint32_t>(info.shape.features);
+        writer.write<float>(info.quant_info.qp_zp);
+        writer.write<float>(info.quant_info.qp_scale);
+        writer.write<float>(info.quant_info.limvals_min);
+        writer.write<float>(info.quant_info.limvals_max);
+        writer.write_payload(tensor->data(), (size_t)tensor->size() * element_size);
+        writer.end_record(record);
+    }
+
+    inline void encode_hailo_objects(binary_format::BinaryWriter &writer, HailoROIPtr roi, bool include_tensors)
+    {
+        if (include_tensors)
+        {
+            for (auto &tensor : roi->get_tensors())
+                encode_tensor(writer, tensor);
+        }
+
+        for (auto obj : roi->get_objects())
+        {
+            switch (obj->get_type())
+            {
+            case HAILO_DETECTION:
+                encode_detection(writer, std::dynamic_pointer_cast<HailoDetection>(obj), include_tensors);
+                break;
+            case HAILO_CLASSIFICATION:
+                encode_classification(writer, std::dynamic_pointer_cast<HailoClassification>(obj));
+                break;
+            case HAILO_LANDMARKS:
+                encode_landmarks(writer, std::dynamic_pointer_cast<HailoLandmarks>(obj));
+                break;
+            case HAILO_TILE:
+                encode_tile(writer, std::dynamic_pointer_cast<HailoTileROI>(obj), include_tensors);
+                break;
+            case HAILO_UNIQUE_ID:
+                encode_unique_id(writer, std::dynamic_pointer_cast<HailoUniqueID>(obj));
+                break;
+            case HAILO_DEPTH_MASK:
+                encode_depth_mask(writer, std::dynamic_pointer_cast<HailoDepthMask>(obj));
+                break;
+            case HAILO_CLASS_MASK:
+                encode_class_mask(writer, std::dynamic_pointer_cast<HailoClassMask>(obj));
+                break;
+            case HAILO_CONF_CLASS_MASK:
+                encode_conf_class_mask(writer, std::dynamic_pointer_cast<HailoConfClassMask>(obj));
+                break;
+            case HAILO_MATRIX:
+                encode_matrix(writer, std::dynamic_pointer_cast<HailoMatrix>(obj));
+                break;
+            default:
+                // continue
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief Encodes a HailoROI and its object tree into a binary message.
+     *        Call once without a buffer to get the message size, then again with a buffer of that size.
+     *
+     * @param roi  -  HailoROIPtr
+     *        The roi to encode.
+     *
+     * @param timestamp  -  int64_t
+     *        Timestamp of the message, in ms.
+     *
+     * @param buffer_offset  -  uint64_t
+     *        Index of the buffer in the stream.
+     *
+     * @param include_tensors  -  bool
+     *        Encode the output tensors attached to the objects as well.
+     *
+     * @param data  -  uint8_t *
+     *        The buffer to fill, or nullptr to only compute the size.
+     *
+     * @param capacity  -  size_t
+     *        Size of the buffer.
+     *
+     * @return size_t
+     *         The size of the message, 0 if the buffer was too small.
+     */
+    inline size_t encode_hailo_roi(HailoROIPtr roi, int64_t timestamp, uint64_t buffer_offset, bool include_tensors,
+                                   uint8_t *data = nullptr, size_t capacity = 0)
+    {
+        binary_format::BinaryWriter writer(data, capacity);
+        writer.write<char>(binary_format::MAGIC[0]);
+        writer.write<char>(binary_format::MAGIC[1]);
+        writer.write<char>(binary_format::MAGIC[2]);
+        writer.write<char>(binary_format::MAGIC[3]);
+        writer.write<uint16_t>(binary_format::VERSION);
+        writer.write<uint16_t>(binary_format::HEADER_SIZE);
+        writer.write<int64_t>(timestamp);
+        writer.write<uint64_t>(buffer_offset);
+        writer.write<uint64_t>(0);
+
+        size_t record = writer.begin_record(binary_format::RECORD_ROI);
+        writer.write_bbox(roi->get_bbox());
+        encode_hailo_objects(writer, roi, include_tensors);
+        writer.end_record(record);
+
+        return writer.overflow() ? 0 : writer.size();
+    }
+}
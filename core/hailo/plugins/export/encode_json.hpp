@@ -172,6 +172,11 @@ namespace encode_json
         object_json.AddMember("HailoUniqueID", entry_object, allocator);
     }
 
+    // Element accessors for encode_mask, masks viewing a tensor are read in place
+    inline float mask_value(HailoDepthMaskPtr mask, size_t index) { return mask->get_value(index); }
+    inline uint8_t mask_value(HailoClassMaskPtr mask, size_t index) { return mask->data()[index]; }
+    inline float mask_value(HailoConfClassMaskPtr mask, size_t index) { return mask->get_data()[index]; }
+
     template <class T>
     rapidjson::Value encode_mask(rapidjson::Document::AllocatorType& allocator, T mask)
     {
@@ -188,9 +193,10 @@ namespace encode_json
         entry_object.AddMember( "transparency", transparency, allocator );
 
         rapidjson::Value data_array(rapidjson::kArrayType);
-        auto data = mask->get_data();
-        for (uint i=0; i < data.size(); i++)
-            data_array.PushBack(rapidjson::Value(data[i]), allocator);
+        size_t size = size_t(mask->get_width()) * mask->get_height();
+        data_array.Reserve(size, allocator);
+        for (size_t i=0; i < size; i++)
+            data_array.PushBack(rapidjson::Value(mask_value(mask, i)), allocator);
         entry_object.AddMember( "data", data_array, allocator );
 
         return entry_object;
@@ -45,8 +45,30 @@ enum
 {
     PROP_0,
     PROP_ADDRESS,
+    PROP_FORMAT,
+    PROP_EXPORT_TENSORS,
 };
 
+#define DEFAULT_FORMAT (HAILO_META_FORMAT_JSON)
+#define DEFAULT_EXPORT_TENSORS (FALSE)
+
+#define GST_TYPE_HAILO_EXPORT_ZMQ_FORMAT (gst_hailoexportzmq_format_get_type())
+static GType
+gst_hailoexportzmq_format_get_type(void)
+{
+    static GType hailoexportzmq_format_type = 0;
+    static const GEnumValue hailoexportzmq_format_types[] = {
+        {HAILO_META_FORMAT_JSON, "JSON text", "json"},
+        {HAILO_META_FORMAT_BINARY, "Compact binary records, mask and tensor data sent raw", "binary"},
+        {0, NULL, NULL},
+    };
+    if (!hailoexportzmq_format_type)
+    {
+        hailoexportzmq_format_type = g_enum_register_static("GstHailoExportZMQFormat", hailoexportzmq_format_types);
+    }
+    return hailoexportzmq_format_type;
+}
+
 static void
 gst_hailoexportzmq_class_init(GstHailoExportZMQClass *klass)
 {
@@ -54,9 +76,9 @@ gst_hailoexportzmq_class_init(GstHailoExportZMQClass *klass)
     GstBaseTransformClass *base_transform_class =
         GST_BASE_TRANSFORM_CLASS(klass);
 
-    const char *description = "Exports HailoObjects in JSON format to a ZMQ socket."
+    const char *description = "Exports HailoObjects in JSON or binary format to a ZMQ socket."
                               "\n\t\t\t   "
-                              "Encodes classes contained by HailoROI objects to JSON.";
+                              "Encodes classes contained by HailoROI objects to JSON or binary records.";
     /* Setting up pads and setting metadata should be moved to
        base_class_init if you intend to subclass this class. */
     gst_element_class_add_pad_template(GST_ELEMENT_CLASS(klass),
@@ -78,6 +100,18 @@ gst_hailoexportzmq_class_init(GstHailoExportZMQClass *klass)
                                     g_param_spec_string("address", "Endpoint address.",
                                                         "Address to bind the socket to.", "tcp://*:5555",
                                                         (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_FORMAT,
+                                    g_param_spec_enum("format", "Message format",
+                                                      "Format of the sent messages, the importing side must use the same format. \n\
+                                    json (default) - human readable, masks and matrices are sent as number arrays. \n\
+                                    binary - compact records, masks, matrices and tensors are sent as raw data.",
+                                                      GST_TYPE_HAILO_EXPORT_ZMQ_FORMAT, DEFAULT_FORMAT,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_EXPORT_TENSORS,
+                                    g_param_spec_boolean("export-tensors", "Export tensors",
+                                                         "Also send the output tensors attached to the objects (binary format only).",
+                                                         DEFAULT_EXPORT_TENSORS,
+                                                         (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
 
     gobject_class->dispose = gst_hailoexportzmq_dispose;
     gobject_class->finalize = gst_hailoexportzmq_finalize;
@@ -91,6 +125,8 @@ gst_hailoexportzmq_init(GstHailoExportZMQ *hailoexportzmq)
 {
     hailoexportzmq->address = g_strdup("tcp://*:5555");
     hailoexportzmq->buffer_offset = 0;
+    hailoexportzmq->format = DEFAULT_FORMAT;
+    hailoexportzmq->export_tensors = DEFAULT_EXPORT_TENSORS;
 }
 
 void gst_hailoexportzmq_set_property(GObject *object, guint property_id,
@@ -105,6 +141,12 @@ void gst_hailoexportzmq_set_property(GObject *object, guint property_id,
     case PROP_ADDRESS:
         hailoexportzmq->address = g_strdup(g_value_get_string(value));
         break;
+    case PROP_FORMAT:
+        hailoexportzmq->format = (hailo_meta_format_t)g_value_get_enum(value);
+        break;
+    case PROP_EXPORT_TENSORS:
+        hailoexportzmq->export_tensors = g_value_get_boolean(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -123,6 +165,12 @@ void gst_hailoexportzmq_get_property(GObject *object, guint property_id,
     case PROP_ADDRESS:
         g_value_set_string(value, hailoexportzmq->address);
         break;
+    case PROP_FORMAT:
+        g_value_set_enum(value, hailoexportzmq->format);
+        break;
+    case PROP_EXPORT_TENSORS:
+        g_value_set_boolean(value, hailoexportzmq->export_tensors);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -178,37 +226,65 @@ gst_hailoexportzmq_stop(GstBaseTransform *trans)
     return TRUE;
 }
 
-static GstFlowReturn
-gst_hailoexportzmq_transform_ip(GstBaseTransform *trans,
-                                 GstBuffer *buffer)
+/**
+ * @brief Encodes the roi as JSON into a new message.
+ */
+static zmq::message_t
+encode_json_message(HailoROIPtr hailo_roi, int64_t timestamp, uint buffer_offset)
 {
-    GstHailoExportZMQ *hailoexportzmq = GST_HAILO_EXPORT_ZMQ(trans);
-
-    // Get the roi from the current buffer and encode it to a JSON entry
-    HailoROIPtr hailo_roi = get_hailo_main_roi(buffer, true);
     rapidjson::Document encoded_roi = encode_json::encode_hailo_roi(hailo_roi);
 
     // Add a timestamp
-    auto timenow = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-    encoded_roi.AddMember("timestamp (ms)", rapidjson::Value(timenow), encoded_roi.GetAllocator());
-    encoded_roi.AddMember("buffer_offset", rapidjson::Value(hailoexportzmq->buffer_offset), encoded_roi.GetAllocator());
+    encoded_roi.AddMember("timestamp (ms)", rapidjson::Value(timestamp), encoded_roi.GetAllocator());
+    encoded_roi.AddMember("buffer_offset", rapidjson::Value(buffer_offset), encoded_roi.GetAllocator());
 
     // Get the buffer of the json
     rapidjson::StringBuffer json_buffer;
     rapidjson::Writer<rapidjson::StringBuffer> writer(json_buffer);
     encoded_roi.Accept(writer);
 
-    // Send the message
     zmq::message_t json_message(json_buffer.GetSize());
     // Copy is required since zmq::message_t would only wrap the data, so if the buffer is freed/overwritten
     // while the message is sending you will get garbage data or a segfault.
-    std::memcpy(json_message.data(), json_buffer.GetString(), json_buffer.GetSize()); 
+    std::memcpy(json_message.data(), json_buffer.GetString(), json_buffer.GetSize());
+    return json_message;
+}
+
+/**
+ * @brief Encodes the roi in binary format straight into a new message,
+ *        a first pass measures the message so no intermediate buffer is needed.
+ */
+static zmq::message_t
+encode_binary_message(HailoROIPtr hailo_roi, int64_t timestamp, uint buffer_offset, bool export_tensors)
+{
+    size_t size = encode_binary::encode_hailo_roi(hailo_roi, timestamp, buffer_offset, export_tensors);
+    zmq::message_t binary_message(size);
+    encode_binary::encode_hailo_roi(hailo_roi, timestamp, buffer_offset, export_tensors,
+                                    static_cast<uint8_t *>(binary_message.data()), binary_message.size());
+    return binary_message;
+}
+
+static GstFlowReturn
+gst_hailoexportzmq_transform_ip(GstBaseTransform *trans,
+                                 GstBuffer *buffer)
+{
+    GstHailoExportZMQ *hailoexportzmq = GST_HAILO_EXPORT_ZMQ(trans);
+
+    // Get the roi from the current buffer and encode it in the requested format
+    HailoROIPtr hailo_roi = get_hailo_main_roi(buffer, true);
+    auto timenow = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    zmq::message_t message = (hailoexportzmq->format == HAILO_META_FORMAT_BINARY)
+                                 ? encode_binary_message(hailo_roi, timenow, hailoexportzmq->buffer_offset, hailoexportzmq->export_tensors)
+                                 : encode_json_message(hailo_roi, timenow, hailoexportzmq->buffer_offset);
+    size_t message_size = message.size();
+
+    // Send the message
 #if (CPPZMQ_VERSION_MAJOR >= 4 && CPPZMQ_VERSION_MINOR >= 6 && CPPZMQ_VERSION_PATCH >= 0)
-    zmq::send_result_t result = hailoexportzmq->socket->send(json_message, zmq::send_flags(ZMQ_DONTWAIT));
+    zmq::send_result_t result = hailoexportzmq->socket->send(message, zmq::send_flags(ZMQ_DONTWAIT));
 #else
-    zmq::detail::send_result_t result = hailoexportzmq->socket->send(json_message, zmq::send_flags(ZMQ_DONTWAIT));
+    zmq::detail::send_result_t result = hailoexportzmq->socket->send(message, zmq::send_flags(ZMQ_DONTWAIT));
 #endif
-    if (result != json_message.size())
+    if (result != message_size)
         GST_WARNING("hailoexportzmq failed to send buffer!");
 
     hailoexportzmq->buffer_offset++;
@@ -7,6 +7,7 @@
 #include <gst/base/gstbasetransform.h>
 #include "hailo_objects.hpp"
 #include "export/encode_json.hpp"
+#include "export/encode_binary.hpp"
 #include <cstdio>
 #include <zmq.hpp>
 
@@ -26,6 +27,8 @@ struct _GstHailoExportZMQ
     GstBaseTransform base_hailoexportzmq;
     gchar *address;
     uint buffer_offset;
+    hailo_meta_format_t format;
+    gboolean export_tensors;
     zmq::context_t *context;
     zmq::socket_t *socket;
 };
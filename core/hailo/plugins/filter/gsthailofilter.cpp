@@ -6,10 +6,18 @@
 #include "tensor_meta.hpp"
 #include "gst_hailo_meta.hpp"
 #include "hailo/hailort.h"
+#include "worker_pool.hpp"
 #include <gst/video/video.h>
 #include <gst/gst.h>
 #include <dlfcn.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <iostream>
 
 GST_DEBUG_CATEGORY_STATIC(gst_hailofilter_debug_category);
@@ -17,6 +25,43 @@ GST_DEBUG_CATEGORY_STATIC(gst_hailofilter_debug_category);
 #define DEFAULT_FUNCTION_NAME "filter"
 #define INIT_FUNC_NAME "init"
 #define FREE_FUNC_NAME "free_resources"
+#define BATCH_FUNC_SUFFIX "_batch"
+#define DEFAULT_MAX_IN_FLIGHT (4)
+#define DEFAULT_BATCH_TIMEOUT (10000)
+
+/**
+ * @brief A buffer held by the element in async or batch mode.
+ */
+struct HailofilterFrame
+{
+    GstBuffer *buffer;
+    HailoROIPtr roi;
+    GstVideoFrame video_frame;
+    gboolean mapped = false;
+    std::chrono::steady_clock::time_point submitted;
+    bool done = false;
+    bool dropped = false;
+};
+
+/**
+ * @brief Frames held by the element in async or batch mode, oldest first.
+ *        A frame stays in the queue until it is pushed, so an empty queue means everything left the element.
+ */
+struct HailofilterAsync
+{
+    std::mutex mutex;
+    std::condition_variable done_cv;  // a frame finished filtering, or stop was requested
+    std::condition_variable space_cv; // a frame left the element
+    std::condition_variable batch_cv; // a batch was started, or stop was requested
+    std::deque<std::unique_ptr<HailofilterFrame>> frames;
+    std::vector<HailofilterFrame *> batch; // frames queued but not yet handed to the filter
+    std::chrono::steady_clock::time_point batch_deadline;
+    std::mutex filter_mutex; // without async, a timed out batch and a full one are not passed to the batch function at once
+    GstFlowReturn flow = GST_FLOW_OK;
+    bool stop = false;
+    std::thread pusher;
+    std::thread batch_timer;
+};
 
 static void gst_hailofilter_set_property(GObject *object,
                                          guint property_id, const GValue *value, GParamSpec *pspec);
@@ -29,6 +74,11 @@ static gboolean gst_hailofilter_start(GstBaseTransform *trans);
 static gboolean gst_hailofilter_stop(GstBaseTransform *trans);
 static GstFlowReturn gst_hailofilter_transform_ip(GstBaseTransform *trans,
                                                   GstBuffer *buffer);
+static GstFlowReturn gst_hailofilter_generate_output(GstBaseTransform *trans,
+                                                     GstBuffer **outbuf);
+static gboolean gst_hailofilter_sink_event(GstBaseTransform *trans, GstEvent *event);
+static void push_async_frames(GstHailofilter *hailofilter);
+static void flush_timed_out_batches(GstHailofilter *hailofilter);
 
 enum
 {
@@ -38,6 +88,11 @@ enum
     PROP_USE_GST_BUFFER,
     PROP_CONFIG_FILE_PATH,
     PROP_REMOVE_TENSORS,
+    PROP_ASYNC,
+    PROP_MAX_IN_FLIGHT,
+    PROP_MAX_LATENCY,
+    PROP_BATCH_SIZE,
+    PROP_BATCH_TIMEOUT,
 };
 
 G_DEFINE_TYPE_WITH_CODE(GstHailofilter, gst_hailofilter, GST_TYPE_BASE_TRANSFORM,
@@ -82,12 +137,29 @@ gst_hailofilter_class_init(GstHailofilterClass *klass)
     g_object_class_install_property(gobject_class, PROP_REMOVE_TENSORS,
                                     g_param_spec_boolean("remove-tensors", "remove-tensors", "whether hailofilter should delete tensors at the end", true,
                                                          (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_ASYNC,
+                                    g_param_spec_boolean("async", "async", "Run the filter function on a process-wide worker pool, keeping up to max-in-flight frames in flight. Buffers leave in the order they arrived. The filter function must be safe to call concurrently for different frames.", false,
+                                                         (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MAX_IN_FLIGHT,
+                                    g_param_spec_uint("max-in-flight", "max-in-flight", "Maximum number of frames inside the element in async mode, further buffers block until the oldest one is pushed.", 1, G_MAXUINT, DEFAULT_MAX_IN_FLIGHT,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MAX_LATENCY,
+                                    g_param_spec_uint("max-latency", "max-latency", "In async mode, drop frames that waited more than this many milliseconds for a worker, without filtering them. 0 never drops.", 0, G_MAXUINT, 0,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_BATCH_SIZE,
+                                    g_param_spec_uint("batch-size", "batch-size", "Number of frames filtered together. They are passed at once to <function-name>_batch when the so provides it, else filtered in parallel on the worker pool, in which case the filter function must be safe to call concurrently. 1 calls function-name for every frame as it arrives.", 1, G_MAXUINT, 1,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_BATCH_TIMEOUT,
+                                    g_param_spec_uint("batch-timeout", "batch-timeout", "Microseconds after the first frame of a batch at which a partial batch is filtered. 0 waits for a full batch, which stalls if upstream can not produce batch-size buffers at once.", 0, G_MAXUINT, DEFAULT_BATCH_TIMEOUT,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
 
     gobject_class->dispose = gst_hailofilter_dispose;
     gobject_class->finalize = gst_hailofilter_finalize;
     base_transform_class->start = GST_DEBUG_FUNCPTR(gst_hailofilter_start);
     base_transform_class->stop = GST_DEBUG_FUNCPTR(gst_hailofilter_stop);
     base_transform_class->transform_ip = GST_DEBUG_FUNCPTR(gst_hailofilter_transform_ip);
+    base_transform_class->generate_output = GST_DEBUG_FUNCPTR(gst_hailofilter_generate_output);
+    base_transform_class->sink_event = GST_DEBUG_FUNCPTR(gst_hailofilter_sink_event);
 }
 
 static void
@@ -97,6 +169,14 @@ gst_hailofilter_init(GstHailofilter *hailofilter)
     hailofilter->remove_tensors = true;
     hailofilter->params = nullptr;
     hailofilter->config_path = g_strdup("NULL");
+    hailofilter->async = false;
+    hailofilter->max_in_flight = DEFAULT_MAX_IN_FLIGHT;
+    hailofilter->max_latency = 0;
+    hailofilter->async_state = nullptr;
+    hailofilter->handler_batch = nullptr;
+    hailofilter->handler_batch_no_config = nullptr;
+    hailofilter->batch_size = 1;
+    hailofilter->batch_timeout = DEFAULT_BATCH_TIMEOUT;
 }
 
 void gst_hailofilter_set_property(GObject *object, guint property_id,
@@ -123,6 +203,21 @@ void gst_hailofilter_set_property(GObject *object, guint property_id,
     case PROP_REMOVE_TENSORS:
         hailofilter->remove_tensors = g_value_get_boolean(value);
         break;
+    case PROP_ASYNC:
+        hailofilter->async = g_value_get_boolean(value);
+        break;
+    case PROP_MAX_IN_FLIGHT:
+        hailofilter->max_in_flight = g_value_get_uint(value);
+        break;
+    case PROP_MAX_LATENCY:
+        hailofilter->max_latency = g_value_get_uint(value);
+        break;
+    case PROP_BATCH_SIZE:
+        hailofilter->batch_size = g_value_get_uint(value);
+        break;
+    case PROP_BATCH_TIMEOUT:
+        hailofilter->batch_timeout = g_value_get_uint(value);
+        break;
 
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
@@ -154,6 +249,21 @@ void gst_hailofilter_get_property(GObject *object, guint property_id,
     case PROP_REMOVE_TENSORS:
         g_value_set_boolean(value, hailofilter->remove_tensors);
         break;
+    case PROP_ASYNC:
+        g_value_set_boolean(value, hailofilter->async);
+        break;
+    case PROP_MAX_IN_FLIGHT:
+        g_value_set_uint(value, hailofilter->max_in_flight);
+        break;
+    case PROP_MAX_LATENCY:
+        g_value_set_uint(value, hailofilter->max_latency);
+        break;
+    case PROP_BATCH_SIZE:
+        g_value_set_uint(value, hailofilter->batch_size);
+        break;
+    case PROP_BATCH_TIMEOUT:
+        g_value_set_uint(value, hailofilter->batch_timeout);
+        break;
 
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
@@ -206,6 +316,18 @@ void gst_hailofilter_finalize(GObject *object)
     G_OBJECT_CLASS(gst_hailofilter_parent_class)->finalize(object);
 }
 
+// Whether frames are collected in batches before they are filtered
+static bool batching(GstHailofilter *hailofilter)
+{
+    return hailofilter->batch_size > 1;
+}
+
+// Whether batches go through the batch variant of the filter function, else the element fans their frames out
+static bool has_batch_function(GstHailofilter *hailofilter)
+{
+    return hailofilter->handler_batch != nullptr || hailofilter->handler_batch_no_config != nullptr;
+}
+
 static gboolean gst_hailofilter_start(GstBaseTransform *trans)
 {
     GstHailofilter *hailofilter = GST_HAILO_FILTER(trans);
@@ -275,6 +397,30 @@ static gboolean gst_hailofilter_start(GstBaseTransform *trans)
         dlclose(hailofilter->loaded_lib);
     }
 
+    // The batch variant is optional, without it the frames of a batch go through the single frame function on the worker pool
+    hailofilter->handler_batch = nullptr;
+    hailofilter->handler_batch_no_config = nullptr;
+    if (batching(hailofilter) && !dlsym_error && !hailofilter->use_gst_buffer)
+    {
+        std::string batch_function_name = std::string(hailofilter->function_name) + BATCH_FUNC_SUFFIX;
+        void *batch_func = dlsym(hailofilter->loaded_lib, batch_function_name.c_str());
+        if (batch_func == nullptr)
+            GST_INFO_OBJECT(hailofilter, "%s has no %s, filtering the frames of a batch in parallel", hailofilter->lib_path, batch_function_name.c_str());
+        else if (hailofilter->use_config)
+            hailofilter->handler_batch = (void (*)(std::vector<HailoROIPtr> &, void *))batch_func;
+        else
+            hailofilter->handler_batch_no_config = (void (*)(std::vector<HailoROIPtr> &))batch_func;
+        dlerror();
+    }
+
+    if (hailofilter->async || batching(hailofilter))
+    {
+        hailofilter->async_state = new HailofilterAsync();
+        hailofilter->async_state->pusher = std::thread(push_async_frames, hailofilter);
+        if (batching(hailofilter) && hailofilter->batch_timeout > 0)
+            hailofilter->async_state->batch_timer = std::thread(flush_timed_out_batches, hailofilter);
+    }
+
     GST_DEBUG_OBJECT(hailofilter, "start");
 
     return TRUE;
@@ -285,6 +431,26 @@ gst_hailofilter_stop(GstBaseTransform *trans)
 {
     GstHailofilter *hailofilter = GST_HAILO_FILTER(trans);
 
+    // The pads are already inactive, so the frames still in flight finish filtering and are released.
+    // Frames of a partial batch are released without filtering.
+    if (hailofilter->async_state)
+    {
+        {
+            std::lock_guard<std::mutex> lock(hailofilter->async_state->mutex);
+            for (HailofilterFrame *frame : hailofilter->async_state->batch)
+                frame->done = true;
+            hailofilter->async_state->batch.clear();
+            hailofilter->async_state->stop = true;
+        }
+        hailofilter->async_state->done_cv.notify_all();
+        hailofilter->async_state->batch_cv.notify_all();
+        if (hailofilter->async_state->batch_timer.joinable())
+            hailofilter->async_state->batch_timer.join();
+        hailofilter->async_state->pusher.join();
+        delete hailofilter->async_state;
+        hailofilter->async_state = nullptr;
+    }
+
     GST_DEBUG_OBJECT(hailofilter, "stop");
 
     return TRUE;
@@ -314,7 +480,10 @@ void get_tensors_from_meta(GstBuffer *buffer, HailoROIPtr roi)
             continue;
         }
         const hailo_vstream_info_t vstream_info = reinterpret_cast<GstHailoTensorMeta *>(gst_buffer_get_meta(pmeta->buffer, g_type_from_name(TENSOR_META_API_NAME)))->info;
-        roi->add_tensor(std::make_shared<HailoTensor>(reinterpret_cast<uint8_t *>(info.data), vstream_info));
+        // The tensor holds a reference to its buffer, so objects viewing the tensor (e.g. masks) outlive the meta
+        std::shared_ptr<void> owner(gst_buffer_ref(pmeta->buffer), [](void *tensor_buffer)
+                                    { gst_buffer_unref(GST_BUFFER(tensor_buffer)); });
+        roi->add_tensor(std::make_shared<HailoTensor>(reinterpret_cast<uint8_t *>(info.data), vstream_info, std::move(owner)));
         gst_buffer_unmap(pmeta->buffer, &info);
     }
 }
@@ -346,46 +515,71 @@ gboolean remove_tensors(GstBuffer *buffer, HailoROIPtr roi)
     return true;
 }
 
-static GstFlowReturn gst_hailofilter_transform_ip(GstBaseTransform *trans,
-                                                  GstBuffer *buffer)
+/**
+ * @brief Get the main ROI of the buffer with its output tensors attached, and the stream id set.
+ *
+ * @param trans The filter element.
+ * @param buffer The buffer to filter.
+ * @return HailoROIPtr
+ */
+static HailoROIPtr prepare_roi(GstBaseTransform *trans, GstBuffer *buffer)
 {
-    GstHailofilter *hailofilter = GST_HAILO_FILTER(trans);
-
     HailoROIPtr hailo_roi = get_hailo_main_roi(buffer, true);
     get_tensors_from_meta(buffer, hailo_roi);
-    GstPad *srcpad = trans->srcpad;
 
     if (hailo_roi->get_stream_id().length() == 0)
     {
-        gchar *id = gst_pad_get_stream_id(srcpad);
+        gchar *id = gst_pad_get_stream_id(trans->srcpad);
         std::string stream_id = std::string(reinterpret_cast<char *>(id));
         g_free(id);
         hailo_roi->set_stream_id(stream_id);
     }
+    return hailo_roi;
+}
 
-    // Call all functions.
+/**
+ * @brief Map the buffer as a video frame, by the current caps of the src pad.
+ *
+ * @param trans The filter element.
+ * @param buffer The buffer to map, must be writable.
+ * @param frame The frame to map into.
+ * @return gboolean whether the mapping succeeded.
+ */
+static gboolean map_video_frame(GstBaseTransform *trans, GstBuffer *buffer, GstVideoFrame *frame)
+{
+    GstCaps *caps = gst_pad_get_current_caps(trans->srcpad);
+    GstVideoInfo info;
+    gst_video_info_from_caps(&info, caps);
+    gst_caps_unref(caps);
+    if (!gst_video_frame_map(frame, &info, buffer, GstMapFlags(GST_MAP_READ | GST_MAP_WRITE)))
+    {
+        std::cerr << "Cannot map buffer to frame" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Call the filter function of the loaded so.
+ *
+ * @param hailofilter The filter element.
+ * @param hailo_roi The main ROI of the buffer.
+ * @param frame The mapped buffer, used only with use-gst-buffer.
+ */
+static void run_filter(GstHailofilter *hailofilter, HailoROIPtr hailo_roi, GstVideoFrame *frame)
+{
     if (hailofilter->use_gst_buffer)
     {
-        GstCaps *caps = gst_pad_get_current_caps(srcpad);
-        GstVideoFrame frame;
-        GstVideoInfo info;
-        gst_video_info_from_caps(&info, caps);
-        gst_caps_unref(caps);
-        if (!gst_video_frame_map(&frame, &info, buffer, GstMapFlags(GST_MAP_READ | GST_MAP_WRITE)))
-        {
-            std::cerr << "Cannot map buffer to frame" << std::endl;
-        }
         if (hailofilter->use_config)
         {
             auto handler = hailofilter->handler_gst;
-            handler(hailo_roi, &frame, hailofilter->params);
+            handler(hailo_roi, frame, hailofilter->params);
         }
         else
         {
             auto handler = hailofilter->handler_gst_no_config;
-            handler(hailo_roi, &frame);
+            handler(hailo_roi, frame);
         }
-        gst_video_frame_unmap(&frame);
     }
     else
     {
@@ -400,6 +594,28 @@ static GstFlowReturn gst_hailofilter_transform_ip(GstBaseTransform *trans,
             handler(hailo_roi);
         }
     }
+}
+
+static GstFlowReturn gst_hailofilter_transform_ip(GstBaseTransform *trans,
+                                                  GstBuffer *buffer)
+{
+    GstHailofilter *hailofilter = GST_HAILO_FILTER(trans);
+
+    HailoROIPtr hailo_roi = prepare_roi(trans, buffer);
+
+    // Call all functions.
+    if (hailofilter->use_gst_buffer)
+    {
+        GstVideoFrame frame;
+        gboolean mapped = map_video_frame(trans, buffer, &frame);
+        run_filter(hailofilter, hailo_roi, &frame);
+        if (mapped)
+            gst_video_frame_unmap(&frame);
+    }
+    else
+    {
+        run_filter(hailofilter, hailo_roi, nullptr);
+    }
 
     if (hailofilter->remove_tensors)
     {
@@ -409,3 +625,268 @@ static GstFlowReturn gst_hailofilter_transform_ip(GstBaseTransform *trans,
     GST_DEBUG_OBJECT(hailofilter, "transform_ip");
     return GST_FLOW_OK;
 }
+
+/**
+ * @brief Call the batch variant of the filter function of the loaded so.
+ *
+ * @param hailofilter The filter element.
+ * @param rois The main ROIs of the buffers, oldest first.
+ */
+static void run_filter_batch(GstHailofilter *hailofilter, std::vector<HailoROIPtr> &rois)
+{
+    if (hailofilter->use_config)
+    {
+        auto handler = hailofilter->handler_batch;
+        handler(rois, hailofilter->params);
+    }
+    else
+    {
+        auto handler = hailofilter->handler_batch_no_config;
+        handler(rois);
+    }
+}
+
+/**
+ * @brief Filter frames, in one batch call when the so has one, skipping those that waited longer than max-latency.
+ *
+ * @param hailofilter The filter element.
+ * @param frames The frames, owned by the async queue until the pusher releases them.
+ */
+static void filter_async_frames(GstHailofilter *hailofilter, const std::vector<HailofilterFrame *> &frames)
+{
+    HailofilterAsync *async = hailofilter->async_state;
+    auto now = std::chrono::steady_clock::now();
+    std::vector<HailoROIPtr> rois;
+    for (HailofilterFrame *frame : frames)
+    {
+        if (hailofilter->max_latency > 0 && now - frame->submitted > std::chrono::milliseconds(hailofilter->max_latency))
+            frame->dropped = true;
+        else if (has_batch_function(hailofilter))
+            rois.push_back(frame->roi);
+        else if (!hailofilter->use_gst_buffer || frame->mapped)
+            run_filter(hailofilter, frame->roi, &frame->video_frame);
+    }
+    if (!rois.empty())
+        run_filter_batch(hailofilter, rois);
+
+    // Notify under the lock, once the frames are done the element may stop and free the state
+    std::lock_guard<std::mutex> lock(async->mutex);
+    for (HailofilterFrame *frame : frames)
+        frame->done = true;
+    async->done_cv.notify_one();
+}
+
+/**
+ * @brief Hand frames to the filter.
+ *        Frames without a batch function are fanned out one per WorkerPool job.
+ *        A batch for the batch function is one WorkerPool job in async mode, or else runs on the calling thread.
+ *
+ * @param hailofilter The filter element.
+ * @param frames The frames, already in the async queue.
+ */
+static void dispatch_frames(GstHailofilter *hailofilter, std::vector<HailofilterFrame *> frames)
+{
+    auto now = std::chrono::steady_clock::now();
+    for (HailofilterFrame *frame : frames)
+        frame->submitted = now;
+
+    if (!has_batch_function(hailofilter))
+    {
+        for (HailofilterFrame *frame : frames)
+            WorkerPool::shared().submit([hailofilter, frame]
+                                        { filter_async_frames(hailofilter, {frame}); });
+    }
+    else if (hailofilter->async)
+    {
+        WorkerPool::shared().submit([hailofilter, frames]
+                                    { filter_async_frames(hailofilter, frames); });
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(hailofilter->async_state->filter_mutex);
+        filter_async_frames(hailofilter, frames);
+    }
+}
+
+/**
+ * @brief Release one filtered frame downstream, or drop it.
+ *
+ * @param hailofilter The filter element.
+ * @param frame The frame to release.
+ * @return GstFlowReturn of the push.
+ */
+static GstFlowReturn finish_async_frame(GstHailofilter *hailofilter, HailofilterFrame *frame)
+{
+    if (frame->mapped)
+        gst_video_frame_unmap(&frame->video_frame);
+
+    if (frame->dropped)
+    {
+        GST_DEBUG_OBJECT(hailofilter, "Dropping buffer with offset %jd, it waited more than %u ms for a worker", frame->buffer->offset, hailofilter->max_latency);
+        gst_buffer_unref(frame->buffer);
+        return GST_FLOW_OK;
+    }
+
+    if (hailofilter->remove_tensors)
+    {
+        remove_tensors(frame->buffer, frame->roi);
+    }
+    return gst_pad_push(GST_BASE_TRANSFORM_SRC_PAD(hailofilter), frame->buffer);
+}
+
+/**
+ * @brief Pusher thread of async mode, pushes frames in arrival order as soon as the oldest one is filtered.
+ *
+ * @param hailofilter The filter element.
+ */
+static void push_async_frames(GstHailofilter *hailofilter)
+{
+    HailofilterAsync *async = hailofilter->async_state;
+    std::unique_lock<std::mutex> lock(async->mutex);
+    while (true)
+    {
+        async->done_cv.wait(lock, [async]
+                            { return (!async->frames.empty() && async->frames.front()->done) || (async->stop && async->frames.empty()); });
+        if (async->frames.empty())
+            return;
+
+        HailofilterFrame *frame = async->frames.front().get();
+        lock.unlock();
+        GstFlowReturn ret = finish_async_frame(hailofilter, frame);
+        lock.lock();
+        async->frames.pop_front();
+        async->flow = ret;
+        async->space_cv.notify_all();
+    }
+}
+
+/**
+ * @brief Batch timer thread, filters a partial batch once batch-timeout passed since its first frame.
+ *
+ * @param hailofilter The filter element.
+ */
+static void flush_timed_out_batches(GstHailofilter *hailofilter)
+{
+    HailofilterAsync *async = hailofilter->async_state;
+    std::unique_lock<std::mutex> lock(async->mutex);
+    while (true)
+    {
+        async->batch_cv.wait(lock, [async]
+                             { return async->stop || !async->batch.empty(); });
+        if (async->stop)
+            return;
+
+        // Wake early when the batch filled up, or was flushed and a new one started
+        auto deadline = async->batch_deadline;
+        if (async->batch_cv.wait_until(lock, deadline, [async, deadline]
+                                       { return async->stop || async->batch.empty() || async->batch_deadline != deadline; }))
+            continue;
+
+        std::vector<HailofilterFrame *> batch;
+        batch.swap(async->batch);
+        lock.unlock();
+        dispatch_frames(hailofilter, std::move(batch));
+        lock.lock();
+    }
+}
+
+/**
+ * @brief Filter the partial batch, then wait until every frame in flight has been pushed.
+ *
+ * @param hailofilter The filter element.
+ */
+static void drain_async_frames(GstHailofilter *hailofilter)
+{
+    HailofilterAsync *async = hailofilter->async_state;
+    std::vector<HailofilterFrame *> batch;
+    {
+        std::lock_guard<std::mutex> lock(async->mutex);
+        batch.swap(async->batch);
+    }
+    if (!batch.empty())
+        dispatch_frames(hailofilter, std::move(batch));
+
+    std::unique_lock<std::mutex> lock(async->mutex);
+    async->space_cv.wait(lock, [async]
+                         { return async->frames.empty(); });
+}
+
+/**
+ * @brief In async or batch mode take the input buffer instead of transforming it in place, and queue it for the filter.
+ *        Nothing is returned for the base class to push, the pusher thread pushes the buffer once it is filtered.
+ */
+static GstFlowReturn gst_hailofilter_generate_output(GstBaseTransform *trans, GstBuffer **outbuf)
+{
+    GstHailofilter *hailofilter = GST_HAILO_FILTER(trans);
+    HailofilterAsync *async = hailofilter->async_state;
+    if (async == nullptr)
+        return GST_BASE_TRANSFORM_CLASS(gst_hailofilter_parent_class)->generate_output(trans, outbuf);
+
+    *outbuf = NULL;
+    GstBuffer *buffer = trans->queued_buf;
+    trans->queued_buf = NULL;
+    if (buffer == NULL)
+        return GST_FLOW_OK;
+    buffer = gst_buffer_make_writable(buffer);
+
+    auto frame = std::make_unique<HailofilterFrame>();
+    frame->buffer = buffer;
+    frame->roi = prepare_roi(trans, buffer);
+    // Map on the streaming thread, where the current caps of the src pad are the ones of this buffer
+    if (hailofilter->use_gst_buffer)
+        frame->mapped = map_video_frame(trans, buffer, &frame->video_frame);
+    HailofilterFrame *job = frame.get();
+
+    GstFlowReturn ret;
+    std::vector<HailofilterFrame *> ready;
+    {
+        std::unique_lock<std::mutex> lock(async->mutex);
+        // A batch must fit in flight, or it would never fill up
+        size_t max_in_flight = std::max(hailofilter->max_in_flight, batching(hailofilter) ? hailofilter->batch_size : 1);
+        async->space_cv.wait(lock, [async, max_in_flight]
+                             { return async->frames.size() < max_in_flight; });
+        async->frames.push_back(std::move(frame));
+        if (!batching(hailofilter))
+        {
+            ready.push_back(job);
+        }
+        else
+        {
+            async->batch.push_back(job);
+            if (async->batch.size() >= hailofilter->batch_size)
+            {
+                ready.swap(async->batch);
+            }
+            else if (async->batch.size() == 1)
+            {
+                async->batch_deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(hailofilter->batch_timeout);
+                async->batch_cv.notify_one();
+            }
+        }
+        ret = async->flow;
+    }
+    if (!ready.empty())
+        dispatch_frames(hailofilter, std::move(ready));
+
+    GST_DEBUG_OBJECT(hailofilter, "generate_output");
+    return ret;
+}
+
+static gboolean gst_hailofilter_sink_event(GstBaseTransform *trans, GstEvent *event)
+{
+    GstHailofilter *hailofilter = GST_HAILO_FILTER(trans);
+    HailofilterAsync *async = hailofilter->async_state;
+
+    // Serialized events (caps, segment, eos...) must not overtake the frames in flight
+    if (async != nullptr && GST_EVENT_IS_SERIALIZED(event))
+    {
+        drain_async_frames(hailofilter);
+        if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP)
+        {
+            std::lock_guard<std::mutex> lock(async->mutex);
+            async->flow = GST_FLOW_OK;
+        }
+    }
+
+    return GST_BASE_TRANSFORM_CLASS(gst_hailofilter_parent_class)->sink_event(trans, event);
+}
@@ -20,6 +20,7 @@ G_BEGIN_DECLS
 
 typedef struct _GstHailofilter GstHailofilter;
 typedef struct _GstHailofilterClass GstHailofilterClass;
+struct HailofilterAsync;
 
 struct _GstHailofilter
 {
@@ -38,6 +39,18 @@ struct _GstHailofilter
     void (*handler_gst)(HailoROIPtr, GstVideoFrame *, void *);
     void (*handler_gst_no_config)(HailoROIPtr, GstVideoFrame *);
     gboolean use_gst_buffer;
+
+    // Batch mode, an optional <function-name>_batch symbol filters up to batch_size frames per call
+    void (*handler_batch)(std::vector<HailoROIPtr> &, void *);
+    void (*handler_batch_no_config)(std::vector<HailoROIPtr> &);
+    guint batch_size;
+    guint batch_timeout;
+
+    // Async mode, the filter function runs on the shared WorkerPool
+    gboolean async;
+    guint max_in_flight;
+    guint max_latency;
+    HailofilterAsync *async_state;
 };
 
 struct _GstHailofilterClass
@@ -7,12 +7,15 @@
 #include <cstdio>
 #include <string>
 #include <ostream>
+#include <memory>
 #include <filesystem>
 #include "xtensor/xarray.hpp"
 #include "xtensor/xadapt.hpp"
 #include "xtensor/xsort.hpp"
 #include "xtensor/xio.hpp"
 #include "hailo_objects.hpp"
+#include "gallery_index.hpp"
+#include "gallery_store.hpp"
 #include "export/encode_json.hpp"
 #include "import/decode_json.hpp"
 
@@ -24,75 +27,39 @@
 #include "rapidjson/writer.h"
 #include "rapidjson/prettywriter.h"
 
-static xt::xarray<float> gallery_get_xtensor(HailoMatrixPtr matrix)
-{
-    // Adapt a HailoTensorPtr to an xarray (quantized)
-    xt::xarray<float> xtensor = xt::adapt(matrix->get_data().data(), matrix->size(), xt::no_ownership(), matrix->shape());
-    return xt::squeeze(xtensor);
-}
-
-static float gallery_one_dim_dot_product(xt::xarray<float> array1, xt::xarray<float> array2)
-{
-    if (array1.dimension() > 1 || array2.dimension() > 1)
-    {
-        throw std::runtime_error("One of the arrays has more than 1 dimension");
-    }
-    if (array1.shape(0) != array2.shape(0))
-    {
-        throw std::runtime_error("Arrays are with different shape");
-    }
-    return xt::sum(array1 * array2)[0];
-}
-
 class Gallery
 {
 private:
-    // Each embedding is represented by HailoMatrixPtr
-    // Each global_id has a vector of embeddings (I.e. vector of HailoMatrixPtr)
-    // of all the embeddings related to this ID.
-    // For the whole gallery there is a vector of global id's (i.e. vector of vectors of HailoMatrixPtr)
-    // where the global ID is represented by the outer vector's index.
-    std::vector<std::vector<HailoMatrixPtr>> m_embeddings;
+    // Each global_id keeps the newest queue_size embeddings related to this ID.
+    // The embeddings of the whole gallery are held by the index, which also finds the closest global ID
+    // of a new embedding (see gallery_index.hpp).
+    GalleryIndex m_index;
     std::map<int, int> tracking_id_to_global_id;
     std::vector<std::string> m_embedding_names;
     float m_similarity_thr;
-    uint m_queue_size;
     FILE *m_json_file;
     bool m_save_new_embeddings;
     char *m_json_file_path;
     bool m_load_local_embeddings;
+    // Binary gallery file new identities are saved to, when the gallery file is not a JSON file (see gallery_store.hpp)
+    std::unique_ptr<GalleryStore> m_store;
+    GalleryFormat m_file_format;
 
 public:
-    Gallery(float similarity_thr = 0.15, uint queue_size = 100) : m_similarity_thr(similarity_thr), m_queue_size(queue_size),
+    Gallery(float similarity_thr = 0.15, uint queue_size = 100) : m_index(GALLERY_INDEX_FLAT, queue_size), m_similarity_thr(similarity_thr),
                                                                   m_json_file(nullptr), m_save_new_embeddings(false),
-                                                                  m_json_file_path(nullptr), m_load_local_embeddings(false){};
+                                                                  m_json_file_path(nullptr), m_load_local_embeddings(false),
+                                                                  m_file_format(GALLERY_FORMAT_AUTO){};
 
-    static float get_distance(std::vector<HailoMatrixPtr> embeddings_queue, HailoMatrixPtr matrix)
-    {
-        xt::xarray<float> new_embedding = gallery_get_xtensor(matrix);
-        float max_thr = 0.0f;
-        float thr;
-        for (HailoMatrixPtr embedding_mat : embeddings_queue)
-        {
-            xt::xarray<float> embedding = gallery_get_xtensor(embedding_mat);
-            thr = gallery_one_dim_dot_product(embedding, new_embedding);
-            max_thr = thr > max_thr ? thr : max_thr;
-        }
-        return 1.0f - max_thr;
-    }
-
-    xt::xarray<float> get_embeddings_distances(HailoMatrixPtr matrix)
+    void init_local_gallery_file(const char *file_path)
     {
-        std::vector<float> distances;
-        for (auto embeddings_queue : m_embeddings)
+        if (GalleryStore::is_store(file_path, m_file_format))
         {
-            distances.push_back(get_distance(embeddings_queue, matrix));
+            m_store = std::make_unique<GalleryStore>(file_path);
+            this->m_save_new_embeddings = true;
+            return;
         }
-        return xt::adapt(distances);
-    }
 
-    void init_local_gallery_file(const char *file_path)
-    {
         if (!std::filesystem::exists(file_path))
         {
             this->m_json_file = fopen(file_path, "w");
@@ -105,6 +72,29 @@ public:
         this->m_save_new_embeddings = true;
     }
 
+    void load_local_gallery(const char *file_path)
+    {
+        if (GalleryStore::is_store(file_path, m_file_format))
+            load_local_gallery_from_store(file_path);
+        else
+            load_local_gallery_from_json(file_path);
+    }
+
+    void load_local_gallery_from_store(const char *file_path)
+    {
+        if (!std::filesystem::exists(file_path))
+            throw std::runtime_error("Gallery file does not exist");
+
+        // The embeddings are added to the index straight from the mapped file
+        GalleryStore store(file_path);
+        store.load([this](const GalleryStoreRecord &record)
+                   {
+                       this->m_embedding_names.emplace_back(record.name);
+                       m_index.add(create_new_global_id(), record.data, record.size());
+                   });
+        this->m_load_local_embeddings = true;
+    }
+
     void load_local_gallery_from_json(const char *file_path)
     {
         if (!std::filesystem::exists(file_path))
@@ -139,12 +129,7 @@ public:
 
     void add_embedding(uint global_id, HailoMatrixPtr matrix)
     {
-        global_id--;
-        if (m_embeddings[global_id].size() >= m_queue_size)
-        {
-            m_embeddings[global_id].pop_back();
-        }
-        m_embeddings[global_id].insert(m_embeddings[global_id].begin(), matrix);
+        m_index.add(global_id, matrix->get_data().data(), matrix->size());
     }
 
     void write_to_json_file(rapidjson::Document document)
@@ -175,28 +160,38 @@ public:
         this->m_json_file = nullptr;
     }
 
-    void save_embedding_to_json_file(HailoMatrixPtr matrix, const uint global_id)
+    void save_embedding(HailoMatrixPtr matrix, const uint global_id)
     {
         if (this->m_save_new_embeddings)
         {
             std::string name = "Unknown" + std::to_string(global_id);
-            write_to_json_file(encode_json::encode_hailo_face_recognition_result(matrix, name.c_str()));
+            if (m_store)
+                m_store->append(global_id, name, matrix->get_data().data(), matrix->height(), matrix->width(), matrix->features());
+            else
+                write_to_json_file(encode_json::encode_hailo_face_recognition_result(matrix, name.c_str()));
+        }
+    }
+
+    /**
+     * @brief Write the identities still queued for the gallery file, and fold the log of a binary gallery file into its snapshot.
+     */
+    void close_local_gallery_file()
+    {
+        if (m_store)
+        {
+            m_store->compact();
+            m_store.reset();
         }
     }
 
     uint create_new_global_id()
     {
-        std::vector<HailoMatrixPtr> queue;
-        m_embeddings.push_back(queue);
-        uint global_id = m_embeddings.size();
-        return global_id;
+        return m_index.create_id();
     }
 
     std::pair<uint, float> get_closest_global_id(HailoMatrixPtr matrix)
     {
-        auto distances = get_embeddings_distances(matrix);
-        auto global_id = xt::argpartition(distances, 1, xt::xnone())[0];
-        return std::pair<uint, float>(global_id + 1, distances[global_id]);
+        return m_index.closest(matrix->get_data().data(), matrix->size());
     }
 
     HailoMatrixPtr get_embedding_matrix(HailoDetectionPtr detection)
@@ -261,11 +256,11 @@ public:
             return;
         }
 
-        if (m_embeddings.empty())
+        if (m_index.num_ids() == 0)
         {
             // Gallery is empty, adding new global id
             uint global_id = create_new_global_id();
-            save_embedding_to_json_file(new_embedding, global_id);
+            save_embedding(new_embedding, global_id);
             update_embeddings_and_add_id_to_object(new_embedding, detection, global_id, track_id);
             return;
         }
@@ -280,7 +275,7 @@ public:
             if (!this->m_load_local_embeddings)
             {
                 uint global_id = create_new_global_id();
-                save_embedding_to_json_file(new_embedding, global_id);
+                save_embedding(new_embedding, global_id);
                 update_embeddings_and_add_id_to_object(new_embedding, detection, global_id, track_id);
             }
         }
@@ -305,7 +300,13 @@ public:
         }
     };
     void set_similarity_threshold(float thr) { this->m_similarity_thr = thr; };
-    void set_queue_size(uint size) { m_queue_size = size; };
+    void set_queue_size(uint size) { m_index.set_queue_size(size); };
+    void set_index_type(GalleryIndexType type) { m_index.set_type(type); };
+    void set_index_nprobe(uint nprobe) { m_index.set_nprobe(nprobe); };
+    void set_file_format(GalleryFormat format) { m_file_format = format; };
     float get_similarity_threshold() { return m_similarity_thr; };
-    uint get_queue_size() { return m_queue_size; };
+    uint get_queue_size() { return m_index.get_queue_size(); };
+    GalleryIndexType get_index_type() { return m_index.get_type(); };
+    uint get_index_nprobe() { return m_index.get_nprobe(); };
+    GalleryFormat get_file_format() { return m_file_format; };
 };
@@ -0,0 +1,490 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file gallery_index.hpp
+ * @authors Hailo
+ *
+ * Embedding index of the gallery. Embeddings are stored normalized in one contiguous, aligned,
+ * row-major float matrix (rows padded with zeros to a multiple of GALLERY_INDEX_ROW_FLOATS), and a
+ * query is scored against 4 rows at a time with SSE2 / NEON dot product kernels (scalar fallback elsewhere).
+ * The IVF index adds a k-means coarse quantizer over the same matrix, so a search only scans the
+ * rows of the lists closest to the query - approximate, but much faster on large galleries.
+ **/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "hailo_simd.hpp"
+
+#define GALLERY_INDEX_ROW_FLOATS (8)
+#define GALLERY_INDEX_ALIGNMENT (64)
+
+// IVF defaults: the index falls back to a flat scan until the gallery holds IVF_MIN_TRAIN_ROWS embeddings,
+// and is re-trained every time the number of embeddings doubles.
+#define GALLERY_INDEX_IVF_MIN_TRAIN_ROWS (1024)
+#define GALLERY_INDEX_IVF_MAX_LISTS (256)
+#define GALLERY_INDEX_IVF_SAMPLES_PER_LIST (16)
+#define GALLERY_INDEX_IVF_TRAIN_ITERATIONS (8)
+#define GALLERY_INDEX_IVF_DEFAULT_NPROBE (8)
+
+typedef enum
+{
+    GALLERY_INDEX_FLAT = 0,
+    GALLERY_INDEX_IVF = 1,
+} GalleryIndexType;
+
+namespace gallery_index
+{
+    /**
+     * @brief Allocator returning GALLERY_INDEX_ALIGNMENT aligned memory, so every matrix row starts on a cache line.
+     */
+    template <typename T>
+    struct AlignedAllocator
+    {
+        using value_type = T;
+        AlignedAllocator() = default;
+        template <typename U>
+        AlignedAllocator(const AlignedAllocator<U> &) {}
+
+        T *allocate(std::size_t n)
+        {
+            std::size_t bytes = ((n * sizeof(T) + GALLERY_INDEX_ALIGNMENT - 1) / GALLERY_INDEX_ALIGNMENT) * GALLERY_INDEX_ALIGNMENT;
+            void *ptr = std::aligned_alloc(GALLERY_INDEX_ALIGNMENT, bytes);
+            if (ptr == nullptr)
+                throw std::bad_alloc();
+            return static_cast<T *>(ptr);
+        }
+        void deallocate(T *ptr, std::size_t) { std::free(ptr); }
+
+        template <typename U>
+        bool operator==(const AlignedAllocator<U> &) const { return true; }
+        template <typename U>
+        bool operator!=(const AlignedAllocator<U> &) const { return false; }
+    };
+    using AlignedFloats = std::vector<float, AlignedAllocator<float>>;
+
+    /**
+     * @brief Dot product of two padded rows.
+     *
+     * @param a  -  const float *
+     *        First row, aligned and padded to a multiple of GALLERY_INDEX_ROW_FLOATS.
+     *
+     * @param b  -  const float *
+     *        Second row, aligned and padded to a multiple of GALLERY_INDEX_ROW_FLOATS.
+     *
+     * @param stride  -  size_t
+     *        Padded length of the rows.
+     *
+     * @return float
+     *         The dot product.
+     */
+    inline float dot(const float *a, const float *b, size_t stride)
+    {
+#if defined(HAILO_SIMD_SSE2)
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        for (size_t i = 0; i < stride; i += GALLERY_INDEX_ROW_FLOATS)
+        {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_load_ps(a + i), _mm_load_ps(b + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_load_ps(a + i + 4), _mm_load_ps(b + i + 4)));
+        }
+        float sums[4];
+        _mm_storeu_ps(sums, _mm_add_ps(acc0, acc1));
+        return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#elif defined(HAILO_SIMD_NEON)
+        float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+        for (size_t i = 0; i < stride; i += GALLERY_INDEX_ROW_FLOATS)
+        {
+            acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+            acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        }
+        return vaddvq_f32(vaddq_f32(acc0, acc1));
+#else
+        float sum = 0.0f;
+        for (size_t i = 0; i < stride; i++)
+            sum += a[i] * b[i];
+        return sum;
+#endif
+    }
+
+    /**
+     * @brief Dot products of a query against 4 rows at once, each block of the query is loaded once for all 4 rows.
+     *
+     * @param query  -  const float *
+     *        The query row, aligned and padded.
+     *
+     * @param rows  -  const float *const *
+     *        Pointers to the 4 rows to score, aligned and padded.
+     *
+     * @param stride  -  size_t
+     *        Padded length of the rows.
+     *
+     * @param scores  -  float *
+     *        Output, the 4 dot products.
+     */
+    inline void dot4(const float *query, const float *const *rows, size_t stride, float *scores)
+    {
+#if defined(HAILO_SIMD_SSE2)
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+        for (size_t i = 0; i < stride; i += 4)
+        {
+            __m128 q = _mm_load_ps(query + i);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(q, _mm_load_ps(rows[0] + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(q, _mm_load_ps(rows[1] + i)));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(q, _mm_load_ps(rows[2] + i)));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(q, _mm_load_ps(rows[3] + i)));
+        }
+        // Transpose so lane k holds the partial sums of row k, then add the lanes.
+        _MM_TRANSPOSE4_PS(acc0, acc1, acc2, acc3);
+        _mm_storeu_ps(scores, _mm_add_ps(_mm_add_ps(acc0, acc1), _mm_add_ps(acc2, acc3)));
+#elif defined(HAILO_SIMD_NEON)
+        float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f), acc2 = vdupq_n_f32(0.0f), acc3 = vdupq_n_f32(0.0f);
+        for (size_t i = 0; i < stride; i += 4)
+        {
+            float32x4_t q = vld1q_f32(query + i);
+            acc0 = vfmaq_f32(acc0, q, vld1q_f32(rows[0] + i));
+            acc1 = vfmaq_f32(acc1, q, vld1q_f32(rows[1] + i));
+            acc2 = vfmaq_f32(acc2, q, vld1q_f32(rows[2] + i));
+            acc3 = vfmaq_f32(acc3, q, vld1q_f32(rows[3] + i));
+        }
+        scores[0] = vaddvq_f32(acc0);
+        scores[1] = vaddvq_f32(acc1);
+        scores[2] = vaddvq_f32(acc2);
+        scores[3] = vaddvq_f32(acc3);
+#else
+        for (int r = 0; r < 4; r++)
+            scores[r] = dot(query, rows[r], stride);
+#endif
+    }
+
+    /**
+     * @brief Copies an embedding into a padded row and normalizes it (a zero embedding is left as is).
+     */
+    inline void load_normalized(const float *data, size_t size, float *row, size_t stride)
+    {
+        float norm = 0.0f;
+        for (size_t i = 0; i < size; i++)
+            norm += data[i] * data[i];
+        float scale = (norm > 0.0f) ? 1.0f / std::sqrt(norm) : 1.0f;
+        for (size_t i = 0; i < size; i++)
+            row[i] = data[i] * scale;
+        std::fill(row + size, row + stride, 0.0f);
+    }
+} // namespace gallery_index
+
+/**
+ * @brief Index of the gallery embeddings, grouped by global ID.
+ *        Each global ID keeps its newest queue_size embeddings, the best match of a query is the
+ *        global ID owning the embedding with the highest cosine similarity.
+ */
+class GalleryIndex
+{
+private:
+    GalleryIndexType m_type;
+    uint m_queue_size;
+    uint m_nprobe;
+    size_t m_dim;
+    size_t m_stride;
+
+    // Embedding matrix, one padded row per embedding, and the (0 based) global ID owning each row.
+    gallery_index::AlignedFloats m_rows;
+    std::vector<uint32_t> m_row_owner;
+    // Rows of each global ID, oldest first.
+    std::vector<std::vector<uint32_t>> m_id_rows;
+
+    // IVF coarse quantizer: normalized centroids, the rows assigned to each list and the list of each row.
+    gallery_index::AlignedFloats m_centroids;
+    std::vector<std::vector<uint32_t>> m_lists;
+    std::vector<uint32_t> m_row_list;
+    size_t m_trained_rows;
+
+    // Scratch buffers reused between searches.
+    gallery_index::AlignedFloats m_query;
+    std::vector<std::pair<float, uint32_t>> m_list_scores;
+
+    size_t num_rows() const { return m_row_owner.size(); }
+    float *row(size_t r) { return m_rows.data() + r * m_stride; }
+    bool ivf_trained() const { return !m_lists.empty(); }
+
+    void check_dim(size_t size)
+    {
+        if (m_dim == 0)
+        {
+            m_dim = size;
+            m_stride = ((size + GALLERY_INDEX_ROW_FLOATS - 1) / GALLERY_INDEX_ROW_FLOATS) * GALLERY_INDEX_ROW_FLOATS;
+        }
+        else if (size != m_dim)
+        {
+            throw std::runtime_error("Arrays are with different shape");
+        }
+    }
+
+    static void replace_in(std::vector<uint32_t> &vec, uint32_t from, uint32_t to)
+    {
+        *std::find(vec.begin(), vec.end(), from) = to;
+    }
+
+    static void erase_from(std::vector<uint32_t> &vec, uint32_t value)
+    {
+        auto it = std::find(vec.begin(), vec.end(), value);
+        *it = vec.back();
+        vec.pop_back();
+    }
+
+    size_t nearest_list(const float *query)
+    {
+        size_t best_list = 0;
+        float best_score = -2.0f;
+        for (size_t l = 0; l < m_lists.size(); l++)
+        {
+            float score = gallery_index::dot(query, m_centroids.data() + l * m_stride, m_stride);
+            if (score > best_score)
+            {
+                best_score = score;
+                best_list = l;
+            }
+        }
+        return best_list;
+    }
+
+    /**
+     * Removes a row by moving the last row into its place.
+     */
+    void remove_row(uint32_t r)
+    {
+        uint32_t last = num_rows() - 1;
+        if (ivf_trained())
+            erase_from(m_lists[m_row_list[r]], r);
+        if (r != last)
+        {
+            std::copy(row(last), row(last) + m_stride, row(r));
+            m_row_owner[r] = m_row_owner[last];
+            replace_in(m_id_rows[m_row_owner[r]], last, r);
+            if (ivf_trained())
+            {
+                m_row_list[r] = m_row_list[last];
+                replace_in(m_lists[m_row_list[r]], last, r);
+            }
+        }
+        m_row_owner.pop_back();
+        m_rows.resize(m_row_owner.size() * m_stride);
+        if (ivf_trained())
+            m_row_list.pop_back();
+    }
+
+    /**
+     * Trains the coarse quantizer with spherical k-means on an evenly spaced sample of the rows,
+     * then assigns all the rows to their nearest list.
+     */
+    void train_ivf()
+    {
+        size_t rows = num_rows();
+        size_t nlist = std::clamp<size_t>(std::sqrt(rows), 1, GALLERY_INDEX_IVF_MAX_LISTS);
+        size_t samples = std::min(rows, nlist * GALLERY_INDEX_IVF_SAMPLES_PER_LIST);
+        std::vector<uint32_t> sample_rows(samples);
+        for (size_t i = 0; i < samples; i++)
+            sample_rows[i] = i * rows / samples;
+
+        m_lists.assign(nlist, {});
+        m_centroids.assign(nlist * m_stride, 0.0f);
+        for (size_t l = 0; l < nlist; l++)
+            std::copy(row(sample_rows[l * samples / nlist]), row(sample_rows[l * samples / nlist]) + m_stride, m_centroids.data() + l * m_stride);
+
+        std::vector<uint32_t> assignment(samples);
+        gallery_index::AlignedFloats sums(nlist * m_stride);
+        for (int iteration = 0; iteration < GALLERY_INDEX_IVF_TRAIN_ITERATIONS; iteration++)
+        {
+            for (size_t i = 0; i < samples; i++)
+                assignment[i] = nearest_list(row(sample_rows[i]));
+
+            std::fill(sums.begin(), sums.end(), 0.0f);
+            for (size_t i = 0; i < samples; i++)
+            {
+                const float *src = row(sample_rows[i]);
+                float *dst = sums.data() + assignment[i] * m_stride;
+                for (size_t k = 0; k < m_dim; k++)
+                    dst[k] += src[k];
+            }
+            // An empty list keeps its previous centroid.
+            for (size_t l = 0; l < nlist; l++)
+            {
+                float *sum = sums.data() + l * m_stride;
+                if (std::any_of(sum, sum + m_dim, [](float v) { return v != 0.0f; }))
+                    gallery_index::load_normalized(sum, m_dim, m_centroids.data() + l * m_stride, m_stride);
+            }
+        }
+
+        m_row_list.resize(rows);
+        for (size_t r = 0; r < rows; r++)
+        {
+            m_row_list[r] = nearest_list(row(r));
+            m_lists[m_row_list[r]].push_back(r);
+        }
+        m_trained_rows = rows;
+    }
+
+    /**
+     * Scores the query against the given rows, keeping the best scoring row.
+     */
+    template <typename RowAt>
+    void scan(size_t count, RowAt row_at, float &best_score, int64_t &best_row)
+    {
+        const float *query = m_query.data();
+        size_t i = 0;
+        const float *rows[4];
+        float scores[4];
+        for (; i + 4 <= count; i += 4)
+        {
+            for (int k = 0; k < 4; k++)
+                rows[k] = row(row_at(i + k));
+            gallery_index::dot4(query, rows, m_stride, scores);
+            for (int k = 0; k < 4; k++)
+            {
+                if (scores[k] > best_score)
+                {
+                    best_score = scores[k];
+                    best_row = row_at(i + k);
+                }
+            }
+        }
+        for (; i < count; i++)
+        {
+            float score = gallery_index::dot(query, row(row_at(i)), m_stride);
+            if (score > best_score)
+            {
+                best_score = score;
+                best_row = row_at(i);
+            }
+        }
+    }
+
+public:
+    GalleryIndex(GalleryIndexType type = GALLERY_INDEX_FLAT, uint queue_size = 100) : m_type(type), m_queue_size(queue_size),
+                                                                                      m_nprobe(GALLERY_INDEX_IVF_DEFAULT_NPROBE),
+                                                                                      m_dim(0), m_stride(0), m_trained_rows(0){};
+
+    /**
+     * @brief Creates a new, empty global ID.
+     *
+     * @return uint
+     *         The new global ID (1 based).
+     */
+    uint create_id()
+    {
+        m_id_rows.emplace_back();
+        return m_id_rows.size();
+    }
+
+    size_t num_ids() const { return m_id_rows.size(); }
+
+    /**
+     * @brief Adds an embedding to a global ID, dropping the ID's oldest embedding if it already holds queue_size of them.
+     *
+     * @param global_id  -  uint
+     *        The global ID (1 based).
+     *
+     * @param data  -  const float *
+     *        The embedding.
+     *
+     * @param size  -  size_t
+     *        Length of the embedding.
+     */
+    void add(uint global_id, const float *data, size_t size)
+    {
+        check_dim(size);
+        std::vector<uint32_t> &id_rows = m_id_rows[global_id - 1];
+        while (!id_rows.empty() && id_rows.size() >= m_queue_size)
+        {
+            uint32_t oldest = id_rows.front();
+            id_rows.erase(id_rows.begin());
+            remove_row(oldest);
+        }
+
+        uint32_t r = num_rows();
+        m_rows.resize((r + 1) * m_stride);
+        gallery_index::load_normalized(data, size, row(r), m_stride);
+        m_row_owner.push_back(global_id - 1);
+        id_rows.push_back(r);
+
+        if (m_type != GALLERY_INDEX_IVF)
+            return;
+        if (num_rows() >= GALLERY_INDEX_IVF_MIN_TRAIN_ROWS && num_rows() >= 2 * m_trained_rows)
+        {
+            train_ivf();
+        }
+        else if (ivf_trained())
+        {
+            m_row_list.push_back(nearest_list(row(r)));
+            m_lists[m_row_list.back()].push_back(r);
+        }
+    }
+
+    /**
+     * @brief Finds the global ID closest to an embedding.
+     *
+     * @param data  -  const float *
+     *        The embedding.
+     *
+     * @param size  -  size_t
+     *        Length of the embedding.
+     *
+     * @return std::pair<uint, float>
+     *         The closest global ID (1 based) and its cosine distance, 1 - max(0, similarity).
+     */
+    std::pair<uint, float> closest(const float *data, size_t size)
+    {
+        check_dim(size);
+        m_query.resize(m_stride);
+        gallery_index::load_normalized(data, size, m_query.data(), m_stride);
+
+        float best_score = 0.0f;
+        int64_t best_row = -1;
+        if (m_type == GALLERY_INDEX_IVF && ivf_trained())
+        {
+            // Score the centroids, then scan only the nprobe closest lists.
+            m_list_scores.resize(m_lists.size());
+            for (size_t l = 0; l < m_lists.size(); l++)
+                m_list_scores[l] = {gallery_index::dot(m_query.data(), m_centroids.data() + l * m_stride, m_stride), l};
+            size_t nprobe = std::min<size_t>(m_nprobe, m_lists.size());
+            std::partial_sort(m_list_scores.begin(), m_list_scores.begin() + nprobe, m_list_scores.end(),
+                              [](const std::pair<float, uint32_t> &a, const std::pair<float, uint32_t> &b) { return a.first > b.first; });
+            for (size_t p = 0; p < nprobe; p++)
+            {
+                const std::vector<uint32_t> &list = m_lists[m_list_scores[p].second];
+                scan(list.size(), [&list](size_t i) { return list[i]; }, best_score, best_row);
+            }
+        }
+        else
+        {
+            scan(num_rows(), [](size_t i) { return i; }, best_score, best_row);
+        }
+
+        uint global_id = (best_row < 0) ? 1 : m_row_owner[best_row] + 1;
+        return std::pair<uint, float>(global_id, 1.0f - best_score);
+    }
+
+    void set_type(GalleryIndexType type)
+    {
+        m_type = type;
+        if (m_type != GALLERY_INDEX_IVF)
+        {
+            m_lists.clear();
+            m_centroids.clear();
+            m_row_list.clear();
+            m_trained_rows = 0;
+        }
+    }
+    GalleryIndexType get_type() { return m_type; }
+    void set_queue_size(uint size) { m_queue_size = size; }
+    uint get_queue_size() { return m_queue_size; }
+    void set_nprobe(uint nprobe) { m_nprobe = std::max(nprobe, 1u); }
+    uint get_nprobe() { return m_nprobe; }
+};
@@ -0,0 +1,542 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file gallery_store.hpp
+ * @authors Hailo
+ *
+ * Binary persistence of the gallery. A store is a snapshot file and an append-only log next to it
+ * (<path>.log), both made of a GalleryStoreFileHeader followed by records:
+ *   GalleryStoreRecordHeader | name (padded to 4 bytes) | height * width * features float32 values
+ * in native byte order. New identities are appended to the log by a background thread, so saving never
+ * blocks the caller on disk. Loading maps both files and hands out pointers to the embeddings in place.
+ * compact() folds the log into a new snapshot, written aside and renamed over the old one. The headers carry
+ * generations: a snapshot remembers the last log it absorbed, so a log left behind by a crash right after
+ * the rename is recognized and not loaded twice. A torn record at the end of the log (crash while
+ * appending) is dropped when the store is opened.
+ **/
+#pragma once
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define GALLERY_STORE_MAGIC "HGALLERY"
+#define GALLERY_STORE_VERSION (1)
+#define GALLERY_STORE_LOG_SUFFIX ".log"
+
+/**
+ * @brief Format of a gallery file. AUTO reads the format from the file itself: a file starting with
+ *        GALLERY_STORE_MAGIC is a gallery store, any other file is a JSON gallery, and a file that does not exist yet
+ *        is created as a JSON gallery.
+ */
+typedef enum
+{
+    GALLERY_FORMAT_AUTO = 0,
+    GALLERY_FORMAT_JSON = 1,
+    GALLERY_FORMAT_BINARY = 2,
+} GalleryFormat;
+
+struct GalleryStoreFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t generation; // Log: its generation. Snapshot: generation of the last log folded into it.
+};
+
+struct GalleryStoreRecordHeader
+{
+    uint32_t size;     // Bytes following this header, a multiple of 4.
+    uint32_t checksum; // FNV-1a of the bytes following this header.
+    uint32_t id;
+    uint32_t name_size;
+    uint32_t height;
+    uint32_t width;
+    uint32_t features;
+    uint32_t reserved;
+};
+
+/**
+ * @brief A record of the store. data points into the mapped file and is valid during the load callback only.
+ */
+struct GalleryStoreRecord
+{
+    uint32_t id;
+    std::string name;
+    uint32_t height;
+    uint32_t width;
+    uint32_t features;
+    const float *data;
+    size_t size() const { return size_t(height) * width * features; }
+};
+
+namespace gallery_store
+{
+    inline uint32_t checksum(const uint8_t *data, size_t size, uint32_t hash = 2166136261u)
+    {
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ data[i]) * 16777619u;
+        return hash;
+    }
+
+    inline size_t padded_name_size(size_t name_size)
+    {
+        return (name_size + 3) & ~size_t(3);
+    }
+
+    /**
+     * @brief Serialize a record, header included.
+     */
+    inline void encode_record(std::vector<uint8_t> &out, uint32_t id, const std::string &name, const float *data,
+                              uint32_t height, uint32_t width, uint32_t features)
+    {
+        size_t data_size = size_t(height) * width * features * sizeof(float);
+        size_t name_size = padded_name_size(name.size());
+        GalleryStoreRecordHeader header = {};
+        header.size = uint32_t(sizeof(GalleryStoreRecordHeader) - 2 * sizeof(uint32_t) + name_size + data_size);
+        header.id = id;
+        header.name_size = uint32_t(name.size());
+        header.height = height;
+        header.width = width;
+        header.features = features;
+
+        size_t begin = out.size();
+        out.resize(begin + sizeof(header) + name_size + data_size, 0);
+        uint8_t *record = out.data() + begin;
+        std::memcpy(record + sizeof(header), name.data(), name.size());
+        std::memcpy(record + sizeof(header) + name_size, data, data_size);
+        std::memcpy(record, &header, sizeof(header));
+        header.checksum = checksum(record + 2 * sizeof(uint32_t), header.size);
+        std::memcpy(record, &header, sizeof(header));
+    }
+
+    /**
+     * @brief Walk the records of a mapped store file.
+     *
+     * @param data  -  const uint8_t *
+     *        The file, starting with its GalleryStoreFileHeader.
+     *
+     * @param size  -  size_t
+     *        Size of the file.
+     *
+     * @param visit  -  std::function<void(const GalleryStoreRecord &)>
+     *        Called for every valid record, may be empty.
+     *
+     * @return size_t
+     *         Size of the valid prefix of the file, the walk stops at the first incomplete or corrupted record.
+     */
+    inline size_t walk_records(const uint8_t *data, size_t size, const std::function<void(const GalleryStoreRecord &)> &visit)
+    {
+        size_t offset = sizeof(GalleryStoreFileHeader);
+        while (offset + sizeof(GalleryStoreRecordHeader) <= size)
+        {
+            GalleryStoreRecordHeader header;
+            std::memcpy(&header, data + offset, sizeof(header));
+            size_t name_size = padded_name_size(header.name_size);
+            size_t data_size = size_t(header.height) * header.width * header.features * sizeof(float);
+            if (header.size % 4 != 0 || offset + sizeof(header) + name_size + data_size > size ||
+                header.size != sizeof(header) - 2 * sizeof(uint32_t) + name_size + data_size ||
+                header.checksum != checksum(data + offset + 2 * sizeof(uint32_t), header.size))
+                break;
+            if (visit)
+            {
+                const char *name = reinterpret_cast<const char *>(data + offset + sizeof(header));
+                visit(GalleryStoreRecord{header.id, std::string(name, header.name_size), header.height, header.width, header.features,
+                                         reinterpret_cast<const float *>(data + offset + sizeof(header) + name_size)});
+            }
+            offset += sizeof(header) + name_size + data_size;
+        }
+        return offset;
+    }
+
+    /**
+     * @brief Read only mapping of a whole file, empty if the file does not exist or is empty.
+     */
+    class MappedFile
+    {
+    private:
+        void *m_data = MAP_FAILED;
+        size_t m_size = 0;
+
+    public:
+        explicit MappedFile(const std::string &path)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return;
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+                m_data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (m_data != MAP_FAILED)
+                {
+                    m_size = st.st_size;
+                    madvise(m_data, m_size, MADV_SEQUENTIAL);
+                }
+            }
+            ::close(fd);
+        }
+        ~MappedFile()
+        {
+            if (m_data != MAP_FAILED)
+                munmap(m_data, m_size);
+        }
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        const uint8_t *data() const { return static_cast<const uint8_t *>(m_data); }
+        size_t size() const { return m_size; }
+    };
+
+    inline bool read_file_header(const MappedFile &file, GalleryStoreFileHeader &header)
+    {
+        if (file.size() < sizeof(header))
+            return false;
+        std::memcpy(&header, file.data(), sizeof(header));
+        return std::memcmp(header.magic, GALLERY_STORE_MAGIC, sizeof(header.magic)) == 0 && header.version == GALLERY_STORE_VERSION;
+    }
+
+    inline void write_all(int fd, const uint8_t *data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("Gallery store write failed: " + std::string(strerror(errno)));
+            }
+            data += written;
+            size -= written;
+        }
+    }
+
+    /**
+     * @brief Whether a file starts with the gallery store magic. False if it can not be read.
+     */
+    inline bool has_store_magic(const std::string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        char magic[sizeof(GalleryStoreFileHeader::magic)];
+        ssize_t size = ::read(fd, magic, sizeof(magic));
+        ::close(fd);
+        return size == ssize_t(sizeof(magic)) && std::memcmp(magic, GALLERY_STORE_MAGIC, sizeof(magic)) == 0;
+    }
+
+    /**
+     * @brief fsync the directory holding a file, so a rename into it survives a power loss.
+     */
+    inline void sync_parent_directory(const std::string &path)
+    {
+        size_t slash = path.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+        int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0)
+            throw std::runtime_error("Gallery store directory " + directory + " can not be opened");
+        int result = fsync(fd);
+        ::close(fd);
+        if (result != 0)
+            throw std::runtime_error("Gallery store directory " + directory + " can not be synced");
+    }
+
+    inline void write_file_header(int fd, uint32_t generation)
+    {
+        GalleryStoreFileHeader header = {};
+        std::memcpy(header.magic, GALLERY_STORE_MAGIC, sizeof(header.magic));
+        header.version = GALLERY_STORE_VERSION;
+        header.generation = generation;
+        write_all(fd, reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+    }
+}
+
+class GalleryStore
+{
+private:
+    std::string m_path;
+    std::string m_log_path;
+    int m_log_fd;
+    uint32_t m_log_generation;
+    std::mutex m_mutex;       // Guards the pending records and the flush progress
+    std::mutex m_write_mutex; // Guards the log file
+    std::condition_variable m_cv;
+    std::condition_variable m_flushed_cv;
+    std::vector<uint8_t> m_pending;
+    uint64_t m_queued = 0;
+    uint64_t m_written = 0;
+    bool m_stop = false;
+    std::string m_error;
+    std::thread m_flush_thread;
+
+    // Empties the log and starts a new generation
+    void reset_log(uint32_t generation)
+    {
+        if (ftruncate(m_log_fd, 0) != 0 || lseek(m_log_fd, 0, SEEK_SET) < 0)
+            throw std::runtime_error("Gallery store log " + m_log_path + " can not be truncated");
+        gallery_store::write_file_header(m_log_fd, generation);
+        m_log_generation = generation;
+    }
+
+    void flush_loop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_cv.wait(lock, [this]
+                      { return m_stop || !m_pending.empty(); });
+            if (m_pending.empty())
+                return;
+            std::vector<uint8_t> batch;
+            batch.swap(m_pending);
+            uint64_t queued = m_queued;
+            lock.unlock();
+            std::string error;
+            {
+                std::lock_guard<std::mutex> write_lock(m_write_mutex);
+                try
+                {
+                    gallery_store::write_all(m_log_fd, batch.data(), batch.size());
+                    fdatasync(m_log_fd);
+                }
+                catch (const std::exception &e)
+                {
+                    error = e.what();
+                }
+            }
+            lock.lock();
+            if (!error.empty())
+                m_error = error;
+            m_written = queued;
+            m_flushed_cv.notify_all();
+        }
+    }
+
+public:
+    /**
+     * @brief Open a gallery store, creating it if needed.
+     *
+     * @param path  -  const std::string &
+     *        Path of the snapshot file, the log is kept at path + GALLERY_STORE_LOG_SUFFIX.
+     */
+    explicit GalleryStore(const std::string &path) : m_path(path), m_log_path(path + GALLERY_STORE_LOG_SUFFIX)
+    {
+        GalleryStoreFileHeader snapshot_header, log_header;
+        bool log_valid;
+        size_t log_size;
+        {
+            gallery_store::MappedFile snapshot(m_path);
+            if (snapshot.size() == 0)
+            {
+                int fd = ::open(m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                if (fd < 0)
+                    throw std::runtime_error("Gallery store file " + m_path + " can not be created");
+                gallery_store::write_file_header(fd, 0);
+                ::close(fd);
+                snapshot_header.generation = 0;
+            }
+            else if (!gallery_store::read_file_header(snapshot, snapshot_header))
+            {
+                throw std::runtime_error("Gallery store file " + m_path + " is not a gallery store");
+            }
+            gallery_store::MappedFile log(m_log_path);
+            log_valid = gallery_store::read_file_header(log, log_header);
+            if (log.size() > 0 && !log_valid)
+                throw std::runtime_error("Gallery store log " + m_log_path + " is not a gallery store log");
+            log_size = log_valid ? gallery_store::walk_records(log.data(), log.size(), nullptr) : 0;
+        }
+        m_log_fd = ::open(m_log_path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (m_log_fd < 0)
+            throw std::runtime_error("Gallery store log " + m_log_path + " can not be opened");
+        try
+        {
+            if (!log_valid || log_header.generation <= snapshot_header.generation)
+            {
+                // New store, or a log that was already folded into the snapshot
+                reset_log(snapshot_header.generation + 1);
+            }
+            else
+            {
+                m_log_generation = log_header.generation;
+                if (ftruncate(m_log_fd, log_size) != 0 || lseek(m_log_fd, 0, SEEK_END) < 0)
+                    throw std::runtime_error("Gallery store log " + m_log_path + " can not be truncated");
+            }
+        }
+        catch (...)
+        {
+            ::close(m_log_fd);
+            throw;
+        }
+        m_flush_thread = std::thread(&GalleryStore::flush_loop, this);
+    }
+
+    // Writes the pending records before closing the log
+    ~GalleryStore()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        m_flush_thread.join();
+        ::close(m_log_fd);
+    }
+
+    GalleryStore(const GalleryStore &) = delete;
+    GalleryStore &operator=(const GalleryStore &) = delete;
+
+    const std::string &path() const { return m_path; }
+
+    /**
+     * @brief Whether a gallery file is a gallery store, as opposed to a JSON gallery.
+     *
+     * @param path  -  const std::string &
+     *        Path of the gallery file.
+     *
+     * @param format  -  GalleryFormat
+     *        Format requested by the user, AUTO checks the magic of the snapshot, or of its log
+     *        when the snapshot is missing.
+     *
+     * @return bool
+     */
+    static bool is_store(const std::string &path, GalleryFormat format)
+    {
+        if (format != GALLERY_FORMAT_AUTO)
+            return format == GALLERY_FORMAT_BINARY;
+        if (access(path.c_str(), F_OK) == 0)
+            return gallery_store::has_store_magic(path);
+        return gallery_store::has_store_magic(path + GALLERY_STORE_LOG_SUFFIX);
+    }
+
+    /**
+     * @brief Visit every record of the store, snapshot first then log, in the order they were saved.
+     *        Records appended by this instance are included once they were flushed.
+     *
+     * @param visit  -  std::function<void(const GalleryStoreRecord &)>
+     *        Called for every record, the record data points into the mapped files.
+     *
+     * @return size_t
+     *         Number of records visited.
+     */
+    size_t load(const std::function<void(const GalleryStoreRecord &)> &visit)
+    {
+        std::lock_guard<std::mutex> write_lock(m_write_mutex);
+        size_t count = 0;
+        auto counted_visit = [&](const GalleryStoreRecord &record)
+        {
+            count++;
+            if (visit)
+                visit(record);
+        };
+        GalleryStoreFileHeader header;
+        for (const std::string &path : {m_path, m_log_path})
+        {
+            gallery_store::MappedFile file(path);
+            if (gallery_store::read_file_header(file, header))
+                gallery_store::walk_records(file.data(), file.size(), counted_visit);
+        }
+        return count;
+    }
+
+    /**
+     * @brief Queue a record for the log and return, the background thread writes it to disk.
+     *
+     * @param id  -  uint32_t
+     *        Global ID of the embedding.
+     *
+     * @param name  -  const std::string &
+     *        Name of the identity.
+     *
+     * @param data  -  const float *
+     *        The embedding, height * width * features values, copied before returning.
+     */
+    void append(uint32_t id, const std::string &name, const float *data, uint32_t height, uint32_t width, uint32_t features)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            gallery_store::encode_record(m_pending, id, name, data, height, width, features);
+            m_queued++;
+        }
+        m_cv.notify_one();
+    }
+
+    /**
+     * @brief Wait until every record appended so far is on disk.
+     *        Throws if a write of the background thread failed.
+     */
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        uint64_t target = m_queued;
+        m_flushed_cv.wait(lock, [this, target]
+                          { return m_written >= target; });
+        if (!m_error.empty())
+        {
+            std::string error = std::move(m_error);
+            m_error.clear();
+            throw std::runtime_error(error);
+        }
+    }
+
+    /**
+     * @brief Fold the log into the snapshot. The new snapshot is written next to the old one and renamed over it.
+     *        Records appended meanwhile wait for the new log.
+     *
+     * @return size_t
+     *         Number of records in the new snapshot.
+     */
+    size_t compact()
+    {
+        flush();
+        std::lock_guard<std::mutex> write_lock(m_write_mutex);
+        std::string tmp_path = m_path + ".tmp";
+        int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            throw std::runtime_error("Gallery store file " + tmp_path + " can not be created");
+        size_t count = 0;
+        try
+        {
+            gallery_store::write_file_header(fd, m_log_generation);
+            GalleryStoreFileHeader header;
+            for (const std::string &path : {m_path, m_log_path})
+            {
+                gallery_store::MappedFile file(path);
+                if (!gallery_store::read_file_header(file, header))
+                    continue;
+                size_t end = gallery_store::walk_records(file.data(), file.size(), [&count](const GalleryStoreRecord &)
+                                                         { count++; });
+                // Valid records are copied as they are
+                gallery_store::write_all(fd, file.data() + sizeof(GalleryStoreFileHeader), end - sizeof(GalleryStoreFileHeader));
+            }
+            if (fsync(fd) != 0)
+                throw std::runtime_error("Gallery store file " + tmp_path + " can not be synced");
+        }
+        catch (...)
+        {
+            ::close(fd);
+            unlink(tmp_path.c_str());
+            throw;
+        }
+        ::close(fd);
+        if (rename(tmp_path.c_str(), m_path.c_str()) != 0)
+            throw std::runtime_error("Gallery store file " + m_path + " can not be replaced");
+        // The log is only emptied once the new snapshot is durable under its name
+        gallery_store::sync_parent_directory(m_path);
+        reset_log(m_log_generation + 1);
+        return count;
+    }
+};
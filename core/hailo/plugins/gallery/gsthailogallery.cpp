@@ -21,6 +21,7 @@ static void gst_hailo_gallery_set_property(GObject *object, guint property_id, c
 static void gst_hailo_gallery_get_property(GObject *object, guint property_id, GValue *value, GParamSpec *pspec);
 static void gst_hailo_gallery_dispose(GObject *object);
 static gboolean gst_hailo_gallery_start(GstBaseTransform *trans);
+static gboolean gst_hailo_gallery_stop(GstBaseTransform *trans);
 static GstFlowReturn gst_hailo_gallery_transform_ip(GstBaseTransform *trans, GstBuffer *buffer);
 
 enum
@@ -32,8 +33,46 @@ enum
     PROP_LOAD_GALLERY,
     PROP_SAVE_GALLERY,
     PROP_LOCAL_GALLERY_FILE_PATH,
+    PROP_GALLERY_INDEX,
+    PROP_GALLERY_INDEX_NPROBE,
+    PROP_GALLERY_FORMAT,
 };
 
+#define GST_TYPE_HAILO_GALLERY_INDEX (gst_hailo_gallery_index_get_type())
+static GType
+gst_hailo_gallery_index_get_type(void)
+{
+    static GType hailo_gallery_index_type = 0;
+    static const GEnumValue hailo_gallery_index_types[] = {
+        {GALLERY_INDEX_FLAT, "Flat index (exact search, SIMD dot products against all the embeddings)", "flat"},
+        {GALLERY_INDEX_IVF, "IVF index (approximate search, only the embeddings of the closest clusters are compared)", "ivf"},
+        {0, NULL, NULL},
+    };
+    if (!hailo_gallery_index_type)
+    {
+        hailo_gallery_index_type = g_enum_register_static("GstHailoGalleryIndex", hailo_gallery_index_types);
+    }
+    return hailo_gallery_index_type;
+}
+
+#define GST_TYPE_HAILO_GALLERY_FORMAT (gst_hailo_gallery_format_get_type())
+static GType
+gst_hailo_gallery_format_get_type(void)
+{
+    static GType hailo_gallery_format_type = 0;
+    static const GEnumValue hailo_gallery_format_types[] = {
+        {GALLERY_FORMAT_AUTO, "Read the format from the file, new files are JSON", "auto"},
+        {GALLERY_FORMAT_JSON, "JSON gallery", "json"},
+        {GALLERY_FORMAT_BINARY, "Binary gallery store (snapshot and append-only log)", "binary"},
+        {0, NULL, NULL},
+    };
+    if (!hailo_gallery_format_type)
+    {
+        hailo_gallery_format_type = g_enum_register_static("GstHailoGalleryFormat", hailo_gallery_format_types);
+    }
+    return hailo_gallery_format_type;
+}
+
 //******************************************************************
 // PAD TEMPLATES
 //******************************************************************
@@ -79,6 +118,7 @@ gst_hailo_gallery_class_init(GstHailoGalleryClass *klass)
     gobject_class->get_property = gst_hailo_gallery_get_property;
 
     base_transform_class->start = gst_hailo_gallery_start;
+    base_transform_class->stop = gst_hailo_gallery_stop;
 
     g_object_class_install_property(gobject_class, PROP_CLASS_ID,
                                     g_param_spec_int("class-id", "class-id", "The class id of the class to update into the gallery. Default -1 crosses classes.", G_MININT, G_MAXINT, -1,
@@ -96,22 +136,40 @@ gst_hailo_gallery_class_init(GstHailoGalleryClass *klass)
 
     g_object_class_install_property(gobject_class, PROP_LOCAL_GALLERY_FILE_PATH,
                                     g_param_spec_string("gallery-file-path", "Load Gallery",
-                                                        "Gallery JSON file path to load",
+                                                        "Gallery file path to load or save, in the format set by gallery-format.",
                                                         "",
                                                         (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
     g_object_class_install_property(gobject_class, PROP_LOAD_GALLERY,
                                     g_param_spec_boolean("load-local-gallery", "Load Gallery",
-                                                         "Load Gallery from JSON file",
+                                                         "Load Gallery from file",
                                                          FALSE,
                                                          (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
     g_object_class_install_property(gobject_class, PROP_SAVE_GALLERY,
                                     g_param_spec_boolean("save-local-gallery", "Save Gallery",
-                                                         "Save Gallery to JSON file",
+                                                         "Save Gallery to file",
                                                          FALSE,
                                                          (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
+    g_object_class_install_property(gobject_class, PROP_GALLERY_INDEX,
+                                    g_param_spec_enum("gallery-index", "Gallery index",
+                                                      "Index used to search the gallery. flat - exact search, ivf - approximate search for large galleries "
+                                                      "(exact until the gallery holds 1024 embeddings).",
+                                                      GST_TYPE_HAILO_GALLERY_INDEX, GALLERY_INDEX_FLAT,
+                                                      (GParamFlags)(GST_PARAM_MUTABLE_READY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_GALLERY_INDEX_NPROBE,
+                                    g_param_spec_uint("gallery-index-nprobe", "Gallery index nprobe",
+                                                      "Number of clusters to search when using the ivf gallery index. Higher is more accurate and slower.",
+                                                      1, GALLERY_INDEX_IVF_MAX_LISTS, GALLERY_INDEX_IVF_DEFAULT_NPROBE,
+                                                      (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_GALLERY_FORMAT,
+                                    g_param_spec_enum("gallery-format", "Gallery format",
+                                                      "Format of the gallery file. auto - detected from the file header, a file that does not exist yet is created as JSON. "
+                                                      "binary - append-only <path>.log compacted into <path> on stop.",
+                                                      GST_TYPE_HAILO_GALLERY_FORMAT, GALLERY_FORMAT_AUTO,
+                                                      (GParamFlags)(GST_PARAM_MUTABLE_READY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
     // Set virtual functions
     gobject_class->dispose = gst_hailo_gallery_dispose;
     base_transform_class->transform_ip = GST_DEBUG_FUNCPTR(gst_hailo_gallery_transform_ip);
@@ -143,7 +201,7 @@ gst_hailo_gallery_start(GstBaseTransform *trans)
     if (hailogallery->load_gallery)
     {
         GST_DEBUG_OBJECT(hailogallery, "Loading gallery from file");
-        hailogallery->gallery.load_local_gallery_from_json(hailogallery->local_gallery_file_path);
+        hailogallery->gallery.load_local_gallery(hailogallery->local_gallery_file_path);
     } else if (hailogallery->save_gallery)
     {
         GST_DEBUG_OBJECT(hailogallery, "Saving gallery to file");
@@ -153,6 +211,25 @@ gst_hailo_gallery_start(GstBaseTransform *trans)
     return TRUE;
 }
 
+static gboolean
+gst_hailo_gallery_stop(GstBaseTransform *trans)
+{
+    GstHailoGallery *hailogallery = GST_HAILO_GALLERY(trans);
+    GST_DEBUG_OBJECT(hailogallery, "Stopping gallery");
+
+    try
+    {
+        hailogallery->gallery.close_local_gallery_file();
+    }
+    catch (const std::exception &e)
+    {
+        GST_ELEMENT_ERROR(hailogallery, RESOURCE, WRITE, ("Failed to save the gallery: %s", e.what()), (NULL));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 //******************************************************************
 // PROPERTY HANDLING
 //******************************************************************
@@ -184,6 +261,15 @@ void gst_hailo_gallery_set_property(GObject *object, guint property_id,
     case PROP_SAVE_GALLERY:
         hailogallery->save_gallery = g_value_get_boolean(value);
         break;
+    case PROP_GALLERY_INDEX:
+        hailogallery->gallery.set_index_type((GalleryIndexType)g_value_get_enum(value));
+        break;
+    case PROP_GALLERY_INDEX_NPROBE:
+        hailogallery->gallery.set_index_nprobe(g_value_get_uint(value));
+        break;
+    case PROP_GALLERY_FORMAT:
+        hailogallery->gallery.set_file_format((GalleryFormat)g_value_get_enum(value));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -218,6 +304,15 @@ void gst_hailo_gallery_get_property(GObject *object, guint property_id,
     case PROP_SAVE_GALLERY:
         g_value_set_boolean(value, hailogallery->save_gallery);
         break;
+    case PROP_GALLERY_INDEX:
+        g_value_set_enum(value, hailogallery->gallery.get_index_type());
+        break;
+    case PROP_GALLERY_INDEX_NPROBE:
+        g_value_set_uint(value, hailogallery->gallery.get_index_nprobe());
+        break;
+    case PROP_GALLERY_FORMAT:
+        g_value_set_enum(value, hailogallery->gallery.get_file_format());
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
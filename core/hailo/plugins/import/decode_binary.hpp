@@ -0,0 +1,472 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * Decoder of the binary wire format described in export/encode_binary.hpp.
+ * Every read is bounds checked, a malformed message makes the decode fail instead of reading past the buffer.
+ * Masks and matrices are filled with a single copy into the vector they own,
+ * tensors point straight into the message and hold a reference to it.
+ **/
+#pragma once
+
+// General cpp includes
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "hailo_common.hpp"
+#include "export/encode_binary.hpp"
+
+namespace binary_format
+{
+    /**
+     * @brief Bounds checked reader over a received message.
+     *        A failed read leaves the reader in a failed state, every later read fails too.
+     */
+    class BinaryReader
+    {
+    private:
+        const uint8_t *m_data;
+        size_t m_end;
+        size_t m_position;
+        bool m_failed;
+
+    public:
+        BinaryReader(const uint8_t *data, size_t size, size_t position = 0) : m_data(data), m_end(size), m_position(position), m_failed(position > size) {}
+
+        size_t position() const { return m_position; }
+        bool failed() const { return m_failed; }
+        bool at_end() const { return m_failed || m_position >= m_end; }
+        size_t remaining() const { return m_failed ? 0 : m_end - m_position; }
+
+        bool skip(size_t size)
+        {
+            if (m_failed || size > m_end - m_position)
+                return !(m_failed = true);
+            m_position += size;
+            return true;
+        }
+
+        template <typename T>
+        T read()
+        {
+            T value{};
+            if (m_failed || sizeof(T) > m_end - m_position)
+            {
+                m_failed = true;
+                return value;
+            }
+            std::memcpy(&value, m_data + m_position, sizeof(T));
+            m_position += sizeof(T);
+            return value;
+        }
+
+        std::string read_string()
+        {
+            uint32_t size = read<uint32_t>();
+            const uint8_t *start = m_data + m_position;
+            if (!skip(size))
+                return std::string();
+            return std::string((const char *)start, size);
+        }
+
+        HailoBBox read_bbox()
+        {
+            float xmin = read<float>();
+            float ymin = read<float>();
+            float width = read<float>();
+            float height = read<float>();
+            return HailoBBox(xmin, ymin, width, height);
+        }
+
+        /**
+         * @brief Reads a payload, returns a pointer to its bytes inside the message or nullptr on failure.
+         *        The payload is aligned to PAYLOAD_ALIGNMENT relative to the message start.
+         */
+        const uint8_t *read_payload(size_t &size)
+        {
+            size = read<uint32_t>();
+            size_t padding = (PAYLOAD_ALIGNMENT - m_position % PAYLOAD_ALIGNMENT) % PAYLOAD_ALIGNMENT;
+            if (!skip(padding))
+                return nullptr;
+            const uint8_t *start = m_data + m_position;
+            if (!skip(size))
+                return nullptr;
+            return start;
+        }
+
+        /**
+         * @brief Reads a record header, returns a reader limited to the record body.
+         *        The parent reader moves past the whole record.
+         */
+        BinaryReader read_record(uint16_t &tag)
+        {
+            tag = read<uint16_t>();
+            read<uint16_t>(); // flags
+            uint32_t length = read<uint32_t>();
+            size_t start = m_position;
+            if (!skip(length))
+                return BinaryReader(m_data, 0, 1);
+            return BinaryReader(m_data, start + length, start);
+        }
+    };
+}
+
+namespace decode_binary
+{
+    bool decode_hailo_objects(binary_format::BinaryReader &reader, const std::shared_ptr<void> &message, HailoROIPtr roi);
+
+    /**
+     * @brief Number of elements of a width x height x features object, 0 if a dimension is not positive.
+     *        Fails (returns false) if the count can not fit in what is left of the message,
+     *        so a corrupted header can not make the decoder allocate more than the message holds.
+     */
+    template <typename T>
+    bool element_count(const binary_format::BinaryReader &reader, int64_t width, int64_t height, int64_t features, size_t &count)
+    {
+        count = 0;
+        if (width <= 0 || height <= 0 || features <= 0)
+            return !reader.failed();
+        size_t limit = reader.remaining() / sizeof(T);
+        if ((uint64_t)width > limit || (uint64_t)height > limit / width || (uint64_t)features > limit / (width * height))
+            return false;
+        count = (size_t)width * height * features;
+        return !reader.failed();
+    }
+
+    /**
+     * @brief Copies a payload of count elements of T into a new vector, fails if the sizes disagree.
+     */
+    template <typename T>
+    bool read_vector(binary_format::BinaryReader &reader, size_t count, std::vector<T> &vector)
+    {
+        if (count > reader.remaining() / sizeof(T))
+            return false;
+        size_t size = 0;
+        const uint8_t *payload = reader.read_payload(size);
+        if (payload == nullptr || size != count * sizeof(T))
+            return false;
+        vector.resize(count);
+        if (size > 0)
+            std::memcpy(vector.data(), payload, size);
+        return true;
+    }
+
+    inline bool decode_detection(binary_format::BinaryReader &reader, const std::shared_ptr<void> &message, HailoROIPtr roi)
+    {
+        HailoBBox bbox = reader.read_bbox();
+        float confidence = reader.read<float>();
+        int class_id = reader.read<int32_t>();
+        std::string label = reader.read_string();
+        if (reader.failed())
+            return false;
+
+        HailoDetectionPtr detection = std::make_shared<HailoDetection>(bbox, class_id, label, confidence);
+        // Add this detection object to the parent
+        roi->add_object(detection);
+        // Recurse this object
+        return decode_hailo_objects(reader, message, detection);
+    }
+
+    inline bool decode_classification(binary_format::BinaryReader &reader, HailoROIPtr roi)
+    {
+        float confidence = reader.read<float>();
+        int class_id = reader.read<int32_t>();
+        std::string type = reader.read_string();
+        std::string label = reader.read_string();
+        if (reader.failed())
+            return false;
+
+        roi->add_object(std::make_shared<HailoClassification>(type, class_id, label, confidence));
+        return true;
+    }
+
+    inline bool decode_landmarks(binary_format::BinaryReader &reader, HailoROIPtr roi)
+    {
+        std::string type = reader.read_string();
+        float threshold = reader.read<float>();
+
+        uint32_t points_count = reader.read<uint32_t>();
+        if (reader.failed() || points_count > reader.remaining() / (3 * sizeof(float)))
+            return false;
+        std::vector<HailoPoint> points;
+        points.reserve(points_count);
+        for (uint32_t i = 0; i < points_count && !reader.failed(); i++)
+        {
+            float x = reader.read<float>();
+            float y = reader.read<float>();
+            float confidence = reader.read<float>();
+            points.emplace_back(x, y, confidence);
+        }
+
+        uint32_t pairs_count = reader.read<uint32_t>();
+        if (reader.failed() || pairs_count > reader.remaining() / (2 * sizeof(int32_t)))
+            return false;
+        std::vector<std::pair<int, int>> pairs;
+        pairs.reserve(pairs_count);
+        for (uint32_t i = 0; i < pairs_count && !reader.failed(); i++)
+        {
+            int first = reader.read<int32_t>();
+            int second = reader.read<int32_t>();
+            pairs.emplace_back(first, second);
+        }
+        if (reader.failed())
+            return false;
+
+        roi->add_object(std::make_shared<HailoLandmarks>(type, std::move(points), threshold, pairs));
+        return true;
+    }
+
+    inline bool decode_tile(binary_format::BinaryReader &reader, const std::shared_ptr<void> &message, HailoROIPtr roi)
+    {
+        HailoBBox bbox = reader.read_bbox();
+        uint index = reader.read<uint32_t>();
+        uint layer = reader.read<uint32_t>();
+        uint mode = reader.read<uint32_t>();
+        float overlap_x = reader.read<float>();
+        float overlap_y = reader.read<float>();
+        if (reader.failed())
+            return false;
+
+        HailoTileROIPtr tile = std::make_shared<HailoTileROI>(bbox, index, overlap_x, overlap_y, layer, (hailo_tiling_mode_t)mode);
+        // Add this tile object to the parent
+        roi->add_object(tile);
+        // Recurse this object
+        return decode_hailo_objects(reader, message, tile);
+    }
+
+    inline bool decode_unique_id(binary_format::BinaryReader &reader, HailoROIPtr roi)
+    {
+        int id = reader.read<int32_t>();
+        int mode = reader.read<int32_t>();
+        if (reader.failed())
+            return false;
+
+        roi->add_object(std::make_shared<HailoUniqueID>(id, (hailo_unique_id_mode_t)mode));
+        return true;
+    }
+
+    inline bool decode_depth_mask(binary_format::BinaryReader &reader, HailoROIPtr roi)
+    {
+        int width = reader.read<int32_t>();
+        int height = reader.read<int32_t>();
+        float transparency = reader.read<float>();
+        std::vector<float> data;
+        size_t count = 0;
+        if (!element_count<float>(reader, width, height, 1, count) || !read_vector(reader, count, data))
+            return false;
+
+        roi->add_object(std::make_shared<HailoDepthMask>(std::move(data), width, height, transparency));
+        return true;
+    }
+
+    inline bool decode_class_mask(binary_format::BinaryReader &reader, HailoROIPtr roi)
+    {
+        int width = reader.read<int32_t>();
+        int height = reader.read<int32_t>();
+        float transparency = reader.read<float>();
+        std::vector<uint8_t> data;
+        size_t count = 0;
+        if (!element_count<uint8_t>(reader, width, height, 1, count) || !read_vector(reader, count, data))
+            return false;
+
+        roi->add_object(std::make_shared<HailoClassMask>(std::move(data), width, height, transparency));
+        return true;
+    }
+
+    inline bool decode_conf_class_mask(binary_format::BinaryReader &reader, HailoROIPtr roi)
+    {
+        int width = reader.read<int32_t>();
+        int height = reader.read<int32_t>();
+        float transparency = reader.read<float>();
+        int class_id = reader.read<int32_t>();
+        std::vector<float> data;
+        size_t count = 0;
+        if (!element_count<float>(reader, width, height, 1, count) || !read_vector(reader, count, data))
+            return false;
+
+        roi->add_object(std::make_shared<HailoConfClassMask>(std::move(data), width, height, transparency, class_id));
+        return true;
+    }
+
+    inline bool decode_matrix(binary_format::BinaryReader &reader, HailoROIPtr roi)
+    {
+        uint32_t width = reader.read<uint32_t>();
+        uint32_t height = reader.read<uint32_t>();
+        uint32_t features = reader.read<uint32_t>();
+        std::vector<float> data;
+        size_t count = 0;
+        if (!element_count<float>(reader, width, height, features, count) || !read_vector(reader, count, data))
+            return false;
+
+        roi->add_object(std::make_shared<HailoMatrix>(std::move(data), height, width, features));
+        return true;
+    }
+
+    inline bool decode_tensor(binary_format::BinaryReader &reader, const std::shared_ptr<void> &message, HailoROIPtr roi)
+    {
+        hailo_vstream_info_t info{};
+        std::string name = reader.read_string();
+        info.format.type = (hailo_format_type_t)reader.read<uint32_t>();
+        info.format.order = (hailo_format_order_t)reader.read<uint32_t>();
+        info.format.flags = (hailo_format_flags_t)reader.read<uint32_t>();
+        info.shape.height = reader.read<uint32_t>();
+        info.shape.width = reader.read<uint32_t>();
+        info.shape.features = reader.read<uint32_t>();
+        info.quant_info.qp_zp = reader.read<float>();
+        info.quant_info.qp_scale = reader.read<float>();
+        info.quant_info.limvals_min = reader.read<float>();
+        info.quant_info.limvals_max = reader.read<float>();
+        size_t element_size = binary_format::tensor_element_size(info);
+        size_t count = 0;
+        if (element_size == 0 || !element_count<uint8_t>(reader, info.shape.width, info.shape.height,
+                                                          (int64_t)info.shape.features * element_size, count))
+            return false;
+        size_t size = 0;
+        const uint8_t *payload = reader.read_payload(size);
+        if (payload == nullptr || size != count)
+            return false;
+
+        std::strncpy(info.name, name.c_str(), sizeof(info.name) - 1);
+        // The tensor points into the message and keeps it alive, whichever buffer or roi copy it ends up in
+        roi->add_tensor(std::make_shared<HailoTensor>(const_cast<uint8_t *>(payload), info, message));
+        return true;
+    }
+
+    /**
+     * @brief Decodes the child records of a container record into roi, up to the end of the reader.
+     */
+    inline bool decode_hailo_objects(binary_format::BinaryReader &reader, const std::shared_ptr<void> &message, HailoROIPtr roi)
+    {
+        while (!reader.at_end())
+        {
+            uint16_t tag = 0;
+            binary_format::BinaryReader record = reader.read_record(tag);
+            if (reader.failed())
+                return false;
+
+            bool decoded = true;
+            switch (tag)
+            {
+            case binary_format::RECORD_DETECTION:
+                decoded = decode_detection(record, message, roi);
+                break;
+            case binary_format::RECORD_CLASSIFICATION:
+                decoded = decode_classification(record, roi);
+                break;
+            case binary_format::RECORD_LANDMARKS:
+                decoded = decode_landmarks(record, roi);
+                break;
+            case binary_format::RECORD_TILE:
+                decoded = decode_tile(record, message, roi);
+                break;
+            case binary_format::RECORD_UNIQUE_ID:
+                decoded = decode_unique_id(record, roi);
+                break;
+            case binary_format::RECORD_DEPTH_MASK:
+                decoded = decode_depth_mask(record, roi);
+                break;
+            case binary_format::RECORD_CLASS_MASK:
+                decoded = decode_class_mask(record, roi);
+                break;
+            case binary_format::RECORD_CONF_CLASS_MASK:
+                decoded = decode_conf_class_mask(record, roi);
+                break;
+            case binary_format::RECORD_MATRIX:
+                decoded = decode_matrix(record, roi);
+                break;
+            case binary_format::RECORD_TENSOR:
+                decoded = decode_tensor(record, message, roi);
+                break;
+            default:
+                // Unknown record, already skipped by its length
+                break;
+            }
+            if (!decoded)
+                return false;
+        }
+        return !reader.failed();
+    }
+
+    /**
+     * @brief Decodes a binary message into the sub objects of a HailoROI.
+     *
+     * @param data  -  const uint8_t *
+     *        The message, aligned to 8 bytes. Decoded tensors point into it.
+     *
+     * @param size  -  size_t
+     *        Size of the message.
+     *
+     * @param message  -  std::shared_ptr<void>
+     *        Owner of the message bytes, every decoded tensor holds a reference to it.
+     *
+     * @param roi  -  HailoROIPtr
+     *        The roi to add the decoded objects to.
+     *
+     * @param timestamp  -  int64_t *
+     *        If not null, set to the timestamp of the message (ms).
+     *
+     * @param buffer_offset  -  uint64_t *
+     *        If not null, set to the buffer offset of the message.
+     *
+     * @return bool
+     *         False if the message is not a supported binary message or is malformed,
+     *         the roi is left untouched in that case.
+     */
+    inline bool decode_hailo_roi(const uint8_t *data, size_t size, const std::shared_ptr<void> &message, HailoROIPtr roi,
+                                 int64_t *timestamp = nullptr, uint64_t *buffer_offset = nullptr)
+    {
+        binary_format::BinaryReader reader(data, size);
+        char magic[4];
+        for (char &c : magic)
+            c = reader.read<char>();
+        uint16_t version = reader.read<uint16_t>();
+        uint16_t header_size = reader.read<uint16_t>();
+        int64_t message_timestamp = reader.read<int64_t>();
+        uint64_t message_buffer_offset = reader.read<uint64_t>();
+        if (reader.failed() || std::memcmp(magic, binary_format::MAGIC, sizeof(magic)) != 0 ||
+            version != binary_format::VERSION || header_size < binary_format::HEADER_SIZE)
+            return false;
+        if (timestamp != nullptr)
+            *timestamp = message_timestamp;
+        if (buffer_offset != nullptr)
+            *buffer_offset = message_buffer_offset;
+
+        binary_format::BinaryReader body(data, size, header_size);
+        uint16_t tag = 0;
+        binary_format::BinaryReader record = body.read_record(tag);
+        if (body.failed() || tag != binary_format::RECORD_ROI)
+            return false;
+        // The main roi keeps its own bbox, only its sub objects are imported
+        record.read_bbox();
+        // Decode into a scratch roi so a malformed message rejects the whole frame
+        HailoROIPtr decoded = std::make_shared<HailoROI>(roi->get_bbox(), roi->get_stream_id());
+        try
+        {
+            if (!decode_hailo_objects(record, message, decoded))
+                return false;
+        }
+        catch (const std::invalid_argument &e)
+        {
+            // A value out of range for the object it belongs to (confidence, bbox...)
+            return false;
+        }
+        catch (const std::exception &e)
+        {
+            // Allocation failures and the like, the message is rejected as well
+            return false;
+        }
+        // Scaling was already applied against the same bbox
+        for (HailoObjectPtr &object : decoded->get_objects())
+            roi->add_unscaled_object(object);
+        for (HailoTensorPtr &tensor : decoded->get_tensors())
+            roi->add_tensor(tensor);
+        return true;
+    }
+}
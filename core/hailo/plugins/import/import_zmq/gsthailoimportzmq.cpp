@@ -9,6 +9,7 @@
 #include "gst_hailo_meta.hpp"
 #include <chrono>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <gst/video/video.h>
 #include <gst/gst.h>
@@ -49,10 +50,29 @@ enum
 {
     PROP_0,
     PROP_ADDRESS,
+    PROP_FORMAT,
 };
 
 // Default import node
 const gchar *DEFAULT_ADDRESS = "tcp://localhost:5555";
+#define DEFAULT_FORMAT (HAILO_META_FORMAT_JSON)
+
+#define GST_TYPE_HAILO_IMPORT_ZMQ_FORMAT (gst_hailoimportzmq_format_get_type())
+static GType
+gst_hailoimportzmq_format_get_type(void)
+{
+    static GType hailoimportzmq_format_type = 0;
+    static const GEnumValue hailoimportzmq_format_types[] = {
+        {HAILO_META_FORMAT_JSON, "JSON text", "json"},
+        {HAILO_META_FORMAT_BINARY, "Compact binary records, mask and tensor data sent raw", "binary"},
+        {0, NULL, NULL},
+    };
+    if (!hailoimportzmq_format_type)
+    {
+        hailoimportzmq_format_type = g_enum_register_static("GstHailoImportZMQFormat", hailoimportzmq_format_types);
+    }
+    return hailoimportzmq_format_type;
+}
 
 static void
 gst_hailoimportzmq_class_init(GstHailoImportZMQClass *klass)
@@ -61,9 +81,9 @@ gst_hailoimportzmq_class_init(GstHailoImportZMQClass *klass)
     GstBaseTransformClass *base_transform_class =
         GST_BASE_TRANSFORM_CLASS(klass);
 
-    const char *description = "Imports HailoObjects in JSON format from a ZMQ socket."
+    const char *description = "Imports HailoObjects in JSON or binary format from a ZMQ socket."
                               "\n\t\t\t   "
-                              "Decodes classes contained by JSON to HailoROI objects.";
+                              "Decodes classes contained by JSON or binary records to HailoROI objects.";
     /* Setting up pads and setting metadata should be moved to
        base_class_init if you intend to subclass this class. */
     gst_element_class_add_pad_template(GST_ELEMENT_CLASS(klass),
@@ -85,6 +105,13 @@ gst_hailoimportzmq_class_init(GstHailoImportZMQClass *klass)
                                     g_param_spec_string("address", "Endpoint address.",
                                                         "Address to bind the socket to.", "tcp://localhost:5555",
                                                         (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_FORMAT,
+                                    g_param_spec_enum("format", "Message format",
+                                                      "Format of the received messages, must match the format of the exporting side. \n\
+                                    json (default) - human readable text. \n\
+                                    binary - compact records, tensors are imported without copying.",
+                                                      GST_TYPE_HAILO_IMPORT_ZMQ_FORMAT, DEFAULT_FORMAT,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
 
     gobject_class->dispose = gst_hailoimportzmq_dispose;
     gobject_class->finalize = gst_hailoimportzmq_finalize;
@@ -97,6 +124,7 @@ static void
 gst_hailoimportzmq_init(GstHailoImportZMQ *hailoimportzmq)
 {
     hailoimportzmq->address = g_strdup(DEFAULT_ADDRESS);
+    hailoimportzmq->format = DEFAULT_FORMAT;
 }
 
 void gst_hailoimportzmq_set_property(GObject *object, guint property_id,
@@ -111,6 +139,9 @@ void gst_hailoimportzmq_set_property(GObject *object, guint property_id,
     case PROP_ADDRESS:
         hailoimportzmq->address = g_strdup(g_value_get_string(value));
         break;
+    case PROP_FORMAT:
+        hailoimportzmq->format = (hailo_meta_format_t)g_value_get_enum(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -129,6 +160,9 @@ void gst_hailoimportzmq_get_property(GObject *object, guint property_id,
     case PROP_ADDRESS:
         g_value_set_string(value, hailoimportzmq->address);
         break;
+    case PROP_FORMAT:
+        g_value_set_enum(value, hailoimportzmq->format);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -217,6 +251,26 @@ gst_hailoimportzmq_transform_ip(GstBaseTransform *trans,
     if (recv_succeeded <= 0)
         GST_WARNING("hailoimportzmq failed to send buffer!");
 
+    if (hailoimportzmq->format == HAILO_META_FORMAT_BINARY)
+    {
+        // Decoded tensors point into the message and share its ownership, it lives as long as the last of them
+        std::shared_ptr<zmq::message_t> message;
+        if (reinterpret_cast<uintptr_t>(recv_message.data()) % binary_format::PAYLOAD_ALIGNMENT == 0)
+        {
+            message = std::make_shared<zmq::message_t>(std::move(recv_message));
+        }
+        else
+        {
+            message = std::make_shared<zmq::message_t>(recv_message.size());
+            std::memcpy(message->data(), recv_message.data(), recv_message.size());
+        }
+        if (!decode_binary::decode_hailo_roi(static_cast<const uint8_t *>(message->data()), message->size(), message, hailo_roi))
+            GST_ERROR("hailoimportzmq failed to decode binary message, frame metadata dropped!");
+
+        GST_DEBUG_OBJECT(hailoimportzmq, "transform_ip");
+        return GST_FLOW_OK;
+    }
+
     // Decode the recvd JSON
     std::string rx_str;
     rx_str.assign(static_cast<char *>(recv_message.data()), recv_message.size());
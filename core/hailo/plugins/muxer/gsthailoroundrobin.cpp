@@ -45,6 +45,14 @@ GType gst_hailo_round_robin_pad_get_type(void);
 #define MAX_PREROLL_FRAMES 30
 #define MIN_PREROLL_FRAMES 1
 
+#define DEFAULT_PAD_WEIGHT 1
+#define MAX_PAD_WEIGHT 100
+#define MIN_PAD_WEIGHT 1
+
+#define DEFAULT_PAD_DEADLINE 0
+#define MAX_PAD_DEADLINE 10000
+#define MIN_PAD_DEADLINE 0
+
 typedef struct _GstHailoRoundRobinPad GstHailoRoundRobinPad;
 typedef struct _GstHailoRoundRobinPadClass GstHailoRoundRobinPadClass;
 
@@ -57,6 +65,7 @@ gst_hailoroundrobin_mode_get_type(void)
         {GST_HAILO_ROUND_ROBIN_MODE_FUNNEL_MODE, "Funnel Mode (push every buffer when it is ready)", "funnel-mode"},
         {GST_HAILO_ROUND_ROBIN_MODE_BLOCKING, "Blocking Mode (push every buffer when it is its pad's turn, and if the buffer is not ready, block until ready)", "blocking-mode"},
         {GST_HAILO_ROUND_ROBIN_MODE_NON_BLOCKING, "Non Blocking Mode (push every buffer when it is its pad's turn, and if the buffer is not ready, skip it)", "non-blocking-mode"},
+        {GST_HAILO_ROUND_ROBIN_MODE_WEIGHTED_FAIR, "Weighted Fair Mode (push ready buffers by weighted fair queuing between the pads, buffers that passed their pad's deadline go first)", "weighted-fair-mode"},
         {0, NULL, NULL},
     };
     if (!hailoroundrobin_mode_type)
@@ -71,6 +80,10 @@ struct _GstHailoRoundRobinPad
 {
     GstPad parent;
     gboolean got_eos;
+    guint weight;                           // Share of the src pad in weighted-fair mode.
+    guint deadline;                         // Max time in ms a buffer should wait in weighted-fair mode (0 - no deadline).
+    gdouble virtual_finish;                 // Weighted fair queuing finish tag of the last buffer scheduled from this pad.
+    std::atomic<guint64> scheduled_buffers; // Number of scheduling decisions that picked this pad.
 };
 
 struct _GstHailoRoundRobinPadClass
@@ -100,17 +113,102 @@ enum
     PROP_QUEUE_SIZE,
     PROP_WAIT_TIME,
     PROP_PREROLL_FRAMES,
+    PROP_SCHEDULING_DECISIONS,
+};
+
+enum
+{
+    PROP_PAD_0,
+    PROP_PAD_WEIGHT,
+    PROP_PAD_DEADLINE,
+    PROP_PAD_SCHEDULED_BUFFERS,
 };
 
+static void
+gst_hailo_round_robin_pad_set_property(GObject *object, guint prop_id,
+                                       const GValue *value, GParamSpec *pspec)
+{
+    GstHailoRoundRobinPad *pad = GST_HAILO_ROUND_ROBIN_PAD(object);
+    switch (prop_id)
+    {
+    case PROP_PAD_WEIGHT:
+        pad->weight = g_value_get_uint(value);
+        break;
+    case PROP_PAD_DEADLINE:
+        pad->deadline = g_value_get_uint(value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+gst_hailo_round_robin_pad_get_property(GObject *object, guint prop_id, GValue *value,
+                                       GParamSpec *pspec)
+{
+    GstHailoRoundRobinPad *pad = GST_HAILO_ROUND_ROBIN_PAD(object);
+    switch (prop_id)
+    {
+    case PROP_PAD_WEIGHT:
+        g_value_set_uint(value, pad->weight);
+        break;
+    case PROP_PAD_DEADLINE:
+        g_value_set_uint(value, pad->deadline);
+        break;
+    case PROP_PAD_SCHEDULED_BUFFERS:
+        g_value_set_uint64(value, pad->scheduled_buffers.load());
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
 static void
 gst_hailo_round_robin_pad_class_init(GstHailoRoundRobinPadClass *klass)
 {
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    gobject_class->set_property = gst_hailo_round_robin_pad_set_property;
+    gobject_class->get_property = gst_hailo_round_robin_pad_get_property;
+
+    g_object_class_install_property(gobject_class,
+                                    PROP_PAD_WEIGHT,
+                                    g_param_spec_uint("weight",
+                                                      "Weight",
+                                                      "Share of the output given to this pad relative to the other pads (only relevant when using weighted-fair mode)",
+                                                      MIN_PAD_WEIGHT,
+                                                      MAX_PAD_WEIGHT,
+                                                      DEFAULT_PAD_WEIGHT,
+                                                      (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class,
+                                    PROP_PAD_DEADLINE,
+                                    g_param_spec_uint("deadline",
+                                                      "Deadline",
+                                                      "Time in ms after which a queued buffer of this pad is pushed before any other pad's turn, 0 to disable (only relevant when using weighted-fair mode)",
+                                                      MIN_PAD_DEADLINE,
+                                                      MAX_PAD_DEADLINE,
+                                                      DEFAULT_PAD_DEADLINE,
+                                                      (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class,
+                                    PROP_PAD_SCHEDULED_BUFFERS,
+                                    g_param_spec_uint64("scheduled-buffers",
+                                                        "Scheduled buffers",
+                                                        "Number of buffers the element scheduled from this pad",
+                                                        0,
+                                                        G_MAXUINT64,
+                                                        0,
+                                                        (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
 }
 
 static void
 gst_hailo_round_robin_pad_init(GstHailoRoundRobinPad *pad)
 {
     pad->got_eos = FALSE;
+    pad->weight = DEFAULT_PAD_WEIGHT;
+    pad->deadline = DEFAULT_PAD_DEADLINE;
+    pad->virtual_finish = 0.0;
+    pad->scheduled_buffers = 0;
 }
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE("sink_%u",
@@ -214,6 +312,9 @@ gst_hailo_round_robin_get_property(GObject *object, guint prop_id, GValue *value
     case PROP_PREROLL_FRAMES:
         g_value_set_uint(value, GST_HAILO_ROUND_ROBIN(object)->preroll_frames);
         break;
+    case PROP_SCHEDULING_DECISIONS:
+        g_value_set_uint64(value, GST_HAILO_ROUND_ROBIN(object)->scheduling_decisions.load());
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -265,71 +366,202 @@ forward_events(GstPad *pad, GstEvent **event, gpointer user_data)
     return res;
 }
 
-void schedule(GstHailoRoundRobin *hailo_round_robin)
+/**
+ * Push a buffer to the src pad on behalf of a sink pad.
+ * Adds the stream meta, forwards the sink pad's sticky events and counts the scheduling decision.
+ */
+static GstFlowReturn push_buffer(GstHailoRoundRobin *hailo_round_robin, GstPad *pad, GstBuffer *buf)
 {
-    GstFlowReturn res;
-    while (!hailo_round_robin->stop_thread)
+    buf = gst_buffer_make_writable(buf);
+
+    gchar *pad_name = gst_pad_get_name(pad);
+    gchar *stream_id = gst_pad_get_stream_id(pad);
+
+    // Add stream meta to the buffer including the pad name and stream id.
+    gst_buffer_add_hailo_stream_meta(buf, pad_name, stream_id);
+
+    // Forward sticky events.
+    gst_pad_sticky_events_foreach(pad, forward_events, hailo_round_robin->srcpad);
+
+    hailo_round_robin->scheduling_decisions++;
+    GST_HAILO_ROUND_ROBIN_PAD_CAST(pad)->scheduled_buffers++;
+
+    // Push out_buffer forward.
+    GstFlowReturn ret = gst_pad_push(hailo_round_robin->srcpad, buf);
+
+    g_free(pad_name);
+    g_free(stream_id);
+    return ret;
+}
+
+/**
+ * Pop the first buffer of a pad queue, clearing the pad's ready bit when its queue drains.
+ * Must be called with schedule_mutex held.
+ */
+static GstBuffer *pop_pad_queue(GstHailoRoundRobin *hailo_round_robin, size_t pad_num)
+{
+    GstBuffer *buf = hailo_round_robin->pad_queues[pad_num]->front().buffer;
+    hailo_round_robin->pad_queues[pad_num]->pop();
+    if (hailo_round_robin->pad_queues[pad_num]->empty())
     {
-        // iterate the pad queues and push the first buffer in each queueq
-        for (uint i = 0; i < hailo_round_robin->pad_queues.size(); i++)
+        hailo_round_robin->ready_pads[pad_num] = false;
+        hailo_round_robin->num_ready_pads--;
+    }
+    // There is room in the queue now, wake the pad if it is waiting to queue a buffer.
+    hailo_round_robin->condition_vars_non_blocking[pad_num]->notify_one();
+    return buf;
+}
+
+/**
+ * Drop all the buffers queued on a pad. Must be called with schedule_mutex held.
+ */
+static void flush_pad_queue(GstHailoRoundRobin *hailo_round_robin, size_t pad_num)
+{
+    while (!hailo_round_robin->pad_queues[pad_num]->empty())
+        gst_buffer_unref(pop_pad_queue(hailo_round_robin, pad_num));
+}
+
+/**
+ * Non blocking mode: give every pad its turn in order. A pad that has nothing queued on its turn
+ * is waited on for up to retries-num * wait-time ms (woken as soon as a buffer arrives), then skipped.
+ * Must be called with schedule_mutex held (through lock).
+ */
+static gboolean pick_round_robin_pad(GstHailoRoundRobin *hailo_round_robin, std::unique_lock<std::mutex> &lock, size_t &pad_num)
+{
+    size_t num_of_pads = hailo_round_robin->pad_queues.size();
+    auto turn_timeout = std::chrono::milliseconds(hailo_round_robin->wait_time * hailo_round_robin->retries_num);
+    for (size_t n = 0; n < num_of_pads && !hailo_round_robin->stop_thread; n++)
+    {
+        size_t i = (hailo_round_robin->next_pad_num + n) % num_of_pads;
+        GstPad *pad = hailo_round_robin->sink_pads[i];
+        if (pad == NULL)
+            continue;
+        if (!hailo_round_robin->ready_pads[i] && !GST_HAILO_ROUND_ROBIN_PAD_CAST(pad)->got_eos)
+        {
+            hailo_round_robin->schedule_cv->wait_for(lock, turn_timeout, [hailo_round_robin, i]
+                                                     { return hailo_round_robin->stop_thread || hailo_round_robin->ready_pads[i] || hailo_round_robin->sink_pads[i] == NULL; });
+        }
+        if (hailo_round_robin->ready_pads[i] && hailo_round_robin->sink_pads[i] != NULL)
+        {
+            pad_num = i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * Weighted fair mode: among the ready pads, a pad whose oldest buffer passed its deadline goes first
+ * (earliest deadline first), otherwise the pad with the smallest weighted fair queuing finish tag is picked.
+ * Must be called with schedule_mutex held.
+ */
+static gboolean pick_weighted_fair_pad(GstHailoRoundRobin *hailo_round_robin, size_t &pad_num)
+{
+    gint64 now = g_get_monotonic_time();
+    gboolean found = FALSE;
+    gboolean found_overdue = FALSE;
+    gint64 earliest_deadline = G_MAXINT64;
+    gdouble smallest_finish = G_MAXDOUBLE;
+    for (size_t i = 0; i < hailo_round_robin->pad_queues.size(); i++)
+    {
+        if (!hailo_round_robin->ready_pads[i] || hailo_round_robin->sink_pads[i] == NULL)
+            continue;
+        GstHailoRoundRobinPad *pad = GST_HAILO_ROUND_ROBIN_PAD_CAST(hailo_round_robin->sink_pads[i]);
+        if (pad->deadline != 0)
         {
-            if (hailo_round_robin->pad_queues[i] != NULL)
+            gint64 deadline = hailo_round_robin->pad_queues[i]->front().arrival_time + (gint64)pad->deadline * G_TIME_SPAN_MILLISECOND;
+            if (deadline <= now && deadline < earliest_deadline)
             {
-                for (uint j = 0; j <= hailo_round_robin->retries_num; j++)
-                {
-                    if (hailo_round_robin->pad_queues[i]->empty())
-                    {
-                        if (j < hailo_round_robin->retries_num) // don't sleep on the last iteration
-                        {
-                            sleep((float)hailo_round_robin->wait_time / 1000.0);
-                        }
-                    }
-                    else
-                    {
-                        set_current_pad_num(hailo_round_robin, i);
-                        GstBuffer *buf = hailo_round_robin->pad_queues[i]->front();
-                        hailo_round_robin->pad_queues[i]->pop();
-                        if (hailo_round_robin->condition_vars_non_blocking[i] == NULL)
-                        {
-                            continue;
-                        }
-                        hailo_round_robin->condition_vars_non_blocking[i]->notify_one();
-
-                        GstPad *pad = gst_element_get_static_pad(GST_ELEMENT_CAST(hailo_round_robin), ("sink_" + std::to_string(i)).c_str());
-
-                        if (pad == NULL) // not found, will try different method - maybe the pad names are hailoroundrobinpad0, hailoroundrobinpad1, etc.
-                        {
-                            pad = gst_element_get_static_pad(GST_ELEMENT_CAST(hailo_round_robin), ("hailoroundrobinpad" + std::to_string(i)).c_str());
-                            if (pad == NULL)
-                            {
-                                GST_ERROR_OBJECT(hailo_round_robin, "Failed to get pad %d", i);
-                                continue;
-                            }
-                        }
-                        gchar *pad_name = gst_pad_get_name(pad);
-                        gchar *stream_id = gst_pad_get_stream_id(pad);
-
-                        // Add stream meta to the buffer including the pad name and stream id.
-                        gst_buffer_add_hailo_stream_meta(buf, pad_name, stream_id);
-
-                        // Forward sticky events.
-                        gst_pad_sticky_events_foreach(pad, forward_events, hailo_round_robin->srcpad);
-
-                        // Push out_buffer forward.
-                        res = gst_pad_push(hailo_round_robin->srcpad, buf);
-                        if (res != GST_FLOW_OK)
-                        {
-                            GST_ERROR_OBJECT(hailo_round_robin, "Failed to push buffer to srcpad");
-                        }
-                        gst_object_unref(pad);
-                        g_free(pad_name);
-                        g_free(stream_id);
-                        break; // make sure it only pushes 1 buffer per pad
-                    }
-                }
+                earliest_deadline = deadline;
+                pad_num = i;
+                found = found_overdue = TRUE;
             }
         }
+        if (found_overdue)
+            continue;
+        gdouble finish = MAX(hailo_round_robin->virtual_time, pad->virtual_finish) + 1.0 / pad->weight;
+        if (finish < smallest_finish)
+        {
+            smallest_finish = finish;
+            pad_num = i;
+            found = TRUE;
+        }
+    }
+
+    if (found)
+    {
+        // Advance the virtual clock, an idle pad does not accumulate credit while it has nothing queued.
+        GstHailoRoundRobinPad *pad = GST_HAILO_ROUND_ROBIN_PAD_CAST(hailo_round_robin->sink_pads[pad_num]);
+        gdouble start = MAX(hailo_round_robin->virtual_time, pad->virtual_finish);
+        pad->virtual_finish = start + 1.0 / pad->weight;
+        hailo_round_robin->virtual_time = start;
+    }
+    return found;
+}
+
+void schedule(GstHailoRoundRobin *hailo_round_robin)
+{
+    while (true)
+    {
+        size_t pad_num = 0;
+        GstPad *pad = NULL;
+        GstBuffer *buf = NULL;
+        {
+            std::unique_lock<std::mutex> lock(*hailo_round_robin->schedule_mutex);
+            // Sleep until at least one of the pads has a buffer queued.
+            hailo_round_robin->schedule_cv->wait(lock, [hailo_round_robin]
+                                                 { return hailo_round_robin->stop_thread || hailo_round_robin->num_ready_pads > 0; });
+            if (hailo_round_robin->stop_thread)
+                break;
+
+            gboolean picked = (hailo_round_robin->mode == GST_HAILO_ROUND_ROBIN_MODE_WEIGHTED_FAIR)
+                                  ? pick_weighted_fair_pad(hailo_round_robin, pad_num)
+                                  : pick_round_robin_pad(hailo_round_robin, lock, pad_num);
+            if (!picked)
+                continue;
+
+            buf = pop_pad_queue(hailo_round_robin, pad_num);
+            pad = GST_PAD_CAST(gst_object_ref(hailo_round_robin->sink_pads[pad_num]));
+            hailo_round_robin->next_pad_num = pad_num + 1;
+        }
+
+        set_current_pad_num(hailo_round_robin, pad_num);
+        if (push_buffer(hailo_round_robin, pad, buf) != GST_FLOW_OK)
+        {
+            GST_ERROR_OBJECT(hailo_round_robin, "Failed to push buffer to srcpad");
+        }
+        gst_object_unref(pad);
+    }
+}
+
+static void
+gst_hailo_round_robin_start_scheduler(GstHailoRoundRobin *hailo_round_robin)
+{
+    std::unique_lock<std::mutex> lock(*hailo_round_robin->schedule_mutex);
+    if (hailo_round_robin->thread != NULL)
+        return;
+    hailo_round_robin->stop_thread = false;
+    hailo_round_robin->thread = new std::thread(schedule, hailo_round_robin);
+}
+
+static void
+gst_hailo_round_robin_stop_scheduler(GstHailoRoundRobin *hailo_round_robin)
+{
+    {
+        std::unique_lock<std::mutex> lock(*hailo_round_robin->schedule_mutex);
+        hailo_round_robin->stop_thread = true;
+        hailo_round_robin->schedule_cv->notify_all();
     }
+    if (hailo_round_robin->thread != NULL)
+    {
+        hailo_round_robin->thread->join();
+        delete hailo_round_robin->thread;
+        hailo_round_robin->thread = NULL;
+    }
+
+    std::unique_lock<std::mutex> lock(*hailo_round_robin->schedule_mutex);
+    for (size_t i = 0; i < hailo_round_robin->pad_queues.size(); i++)
+        flush_pad_queue(hailo_round_robin, i);
 }
 
 static void
@@ -359,7 +591,7 @@ gst_hailo_round_robin_class_init(GstHailoRoundRobinClass *klass)
                                     PROP_MODE,
                                     g_param_spec_enum("mode",
                                                       "mode",
-                                                      "Select the mode of the element (0 - funnel mode (push every buffer when it is ready), 1 - blocking mode (push every buffer when it is its pad's turn, and if the buffer is not ready, block until ready), 2 - non blocking mode(push every buffer when it is its pad's turn, and if the buffer is not ready, skip it))",
+                                                      "Select the mode of the element (0 - funnel mode (push every buffer when it is ready), 1 - blocking mode (push every buffer when it is its pad's turn, and if the buffer is not ready, block until ready), 2 - non blocking mode(push every buffer when it is its pad's turn, and if the buffer is not ready, skip it), 3 - weighted fair mode (push ready buffers by weighted fair queuing between the pads, buffers that passed their pad's deadline go first))",
                                                       GST_TYPE_HAILOROUNDROBIN_MODE,
                                                       (gint)GST_HAILO_ROUND_ROBIN_MODE_BLOCKING,
                                                       (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
@@ -377,7 +609,7 @@ gst_hailo_round_robin_class_init(GstHailoRoundRobinClass *klass)
                                     PROP_QUEUE_SIZE,
                                     g_param_spec_uint("queue-size",
                                                       "Queue size",
-                                                      "Size of the queue for each pad (only relevant when using non-blocking mode)",
+                                                      "Size of the queue for each pad (only relevant when using non-blocking or weighted-fair mode)",
                                                       MIN_QUEUE_SIZE,
                                                       MAX_QUEUE_SIZE,
                                                       DEFAULT_QUEUE_SIZE,
@@ -400,6 +632,15 @@ gst_hailo_round_robin_class_init(GstHailoRoundRobinClass *klass)
                                                       MAX_PREROLL_FRAMES,
                                                       DEFAULT_PREROLL_FRAMES,
                                                       (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class,
+                                    PROP_SCHEDULING_DECISIONS,
+                                    g_param_spec_uint64("scheduling-decisions",
+                                                        "Scheduling decisions",
+                                                        "Number of buffers the element scheduled to the src pad (per pad counts are in the sink pads' scheduled-buffers property)",
+                                                        0,
+                                                        G_MAXUINT64,
+                                                        0,
+                                                        (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
 }
 
 static void
@@ -407,7 +648,6 @@ gst_hailo_round_robin_init(GstHailoRoundRobin *hailo_round_robin)
 {
     hailo_round_robin->current_pad_num = 0;
     hailo_round_robin->mutexes_blocking.clear();
-    hailo_round_robin->mutexes_non_blocking.clear();
     hailo_round_robin->pad_queues.clear();
     hailo_round_robin->condition_vars_blocking.clear();
     hailo_round_robin->condition_vars_non_blocking.clear();
@@ -423,6 +663,15 @@ gst_hailo_round_robin_init(GstHailoRoundRobin *hailo_round_robin)
     hailo_round_robin->num_of_sink_pads = 0;
     hailo_round_robin->num_of_pads_mutex = std::make_unique<std::shared_mutex>();
     hailo_round_robin->counter_mutex = std::make_unique<std::shared_mutex>();
+    hailo_round_robin->thread = NULL;
+    hailo_round_robin->schedule_mutex = std::make_unique<std::mutex>();
+    hailo_round_robin->schedule_cv = std::make_unique<std::condition_variable>();
+    hailo_round_robin->sink_pads.clear();
+    hailo_round_robin->ready_pads.clear();
+    hailo_round_robin->num_ready_pads = 0;
+    hailo_round_robin->next_pad_num = 0;
+    hailo_round_robin->virtual_time = 0.0;
+    hailo_round_robin->scheduling_decisions = 0;
     gst_pad_use_fixed_caps(hailo_round_robin->srcpad);
     gst_element_add_pad(GST_ELEMENT(hailo_round_robin), hailo_round_robin->srcpad);
 }
@@ -437,9 +686,11 @@ gst_hailo_round_robin_dispose(GObject *object)
     hailo_round_robin->preroll_buffer_counter = 0;
     hailo_round_robin->num_of_sink_pads = 0;
     hailo_round_robin->mutexes_blocking.clear();
-    hailo_round_robin->mutexes_non_blocking.clear();
     hailo_round_robin->condition_vars_blocking.clear();
     hailo_round_robin->condition_vars_non_blocking.clear();
+    hailo_round_robin->sink_pads.clear();
+    hailo_round_robin->ready_pads.clear();
+    hailo_round_robin->num_ready_pads = 0;
     G_OBJECT_CLASS(parent_class)->dispose(object);
 }
 
@@ -492,6 +743,12 @@ gst_hailo_round_robin_request_new_pad(GstElement *element, GstPadTemplate *templ
         gst_pad_set_chain_function(sinkpad, GST_DEBUG_FUNCPTR(gst_hailo_round_robin_sink_chain_preroll));
         break;
     }
+    case GST_HAILO_ROUND_ROBIN_MODE_WEIGHTED_FAIR:
+    {
+        // buffers are always queued, the scheduler thread is started when the element goes to PAUSED
+        gst_pad_set_chain_function(sinkpad, GST_DEBUG_FUNCPTR(gst_hailo_round_robin_sink_chain_non_blocking_mode));
+        break;
+    }
     }
 
     gst_pad_set_event_function(sinkpad,
@@ -501,12 +758,16 @@ gst_hailo_round_robin_request_new_pad(GstElement *element, GstPadTemplate *templ
     GST_OBJECT_FLAG_SET(sinkpad, GST_PAD_FLAG_PROXY_ALLOCATION);
 
     hailo_round_robin->mutexes_blocking.emplace_back(std::make_unique<std::mutex>());
-    hailo_round_robin->mutexes_non_blocking.emplace_back(std::make_unique<std::mutex>());
-
-    // create a new queue for the new pad
-    hailo_round_robin->pad_queues.emplace_back(std::make_unique<std::queue<GstBuffer *>>());
     hailo_round_robin->condition_vars_blocking.emplace_back(std::make_unique<std::condition_variable>());
-    hailo_round_robin->condition_vars_non_blocking.emplace_back(std::make_unique<std::condition_variable>());
+
+    {
+        // create a new queue for the new pad
+        std::unique_lock<std::mutex> schedule_lock(*hailo_round_robin->schedule_mutex);
+        hailo_round_robin->pad_queues.emplace_back(std::make_unique<std::queue<GstHailoRoundRobinQueuedBuffer>>());
+        hailo_round_robin->condition_vars_non_blocking.emplace_back(std::make_unique<std::condition_variable>());
+        hailo_round_robin->sink_pads.emplace_back(sinkpad);
+        hailo_round_robin->ready_pads.emplace_back(false);
+    }
 
     gst_pad_set_active(sinkpad, TRUE);
 
@@ -557,8 +818,15 @@ gst_hailo_round_robin_release_pad(GstElement *element, GstPad *pad)
     if (hailo_round_robin->condition_vars_blocking[get_pad_num(pad)] != NULL)
         hailo_round_robin->condition_vars_blocking[get_pad_num(pad)]->notify_all();
 
-    if (hailo_round_robin->condition_vars_non_blocking[get_pad_num(pad)] != NULL)
-        hailo_round_robin->condition_vars_non_blocking[get_pad_num(pad)]->notify_all();
+    {
+        // stop scheduling the pad and drop what it still has queued
+        std::unique_lock<std::mutex> schedule_lock(*hailo_round_robin->schedule_mutex);
+        size_t pad_num = get_pad_num(pad);
+        flush_pad_queue(hailo_round_robin, pad_num);
+        hailo_round_robin->sink_pads[pad_num] = NULL;
+        hailo_round_robin->condition_vars_non_blocking[pad_num]->notify_all();
+        hailo_round_robin->schedule_cv->notify_all();
+    }
     gst_element_remove_pad(GST_ELEMENT_CAST(hailo_round_robin), pad);
 }
 
@@ -594,28 +862,14 @@ gst_hailo_round_robin_sink_chain_preroll(GstPad *pad, GstObject *parent, GstBuff
         }
     }
 
-    buf = gst_buffer_make_writable(buf);
-
-    gchar *pad_name = gst_pad_get_name(pad);
-    gchar *stream_id = gst_pad_get_stream_id(pad);
-
-    // Add stream meta to the buffer including the pad name and stream id.
-    gst_buffer_add_hailo_stream_meta(buf, pad_name, stream_id);
-
-    // Forward sticky events.
-    gst_pad_sticky_events_foreach(pad, forward_events, hailo_round_robin->srcpad);
-
-    // Push out_buffer forward.
-    ret = gst_pad_push(hailo_round_robin->srcpad, buf);
+    ret = push_buffer(hailo_round_robin, pad, buf);
 
     increment_buffer_counter_value(hailo_round_robin); // increment only if not equal to -1
 
     if (get_buffer_counter_value(hailo_round_robin) == (int)(hailo_round_robin->mutexes_blocking.size() * hailo_round_robin->preroll_frames))
     {
         set_buffer_counter_value(hailo_round_robin, -1); // don't use it anymore
-        std::thread schedule_thread(schedule, hailo_round_robin);
-        hailo_round_robin->thread = std::move(&schedule_thread);
-        hailo_round_robin->thread->detach();
+        gst_hailo_round_robin_start_scheduler(hailo_round_robin);
         set_chain_to_all_pads(hailo_round_robin, gst_hailo_round_robin_sink_chain_non_blocking_mode);
         hailo_round_robin->current_pad_num = 0;
 
@@ -627,9 +881,6 @@ gst_hailo_round_robin_sink_chain_preroll(GstPad *pad, GstObject *parent, GstBuff
         }
     }
 
-    g_free(pad_name);
-    g_free(stream_id);
-
     if (get_buffer_counter_value(hailo_round_robin) != -1)
     {
         hailo_round_robin->current_pad_num++;
@@ -679,22 +930,7 @@ gst_hailo_round_robin_sink_chain_blocking_mode(GstPad *pad, GstObject *parent, G
         }
     }
 
-    buf = gst_buffer_make_writable(buf);
-
-    gchar *pad_name = gst_pad_get_name(pad);
-    gchar *stream_id = gst_pad_get_stream_id(pad);
-
-    // Add stream meta to the buffer including the pad name and stream id.
-    gst_buffer_add_hailo_stream_meta(buf, pad_name, stream_id);
-
-    // Forward sticky events.
-    gst_pad_sticky_events_foreach(pad, forward_events, hailo_round_robin->srcpad);
-
-    // Push out_buffer forward.
-    ret = gst_pad_push(hailo_round_robin->srcpad, buf);
-
-    g_free(pad_name);
-    g_free(stream_id);
+    ret = push_buffer(hailo_round_robin, pad, buf);
 
     hailo_round_robin->current_pad_num++;
     if (hailo_round_robin->current_pad_num == hailo_round_robin->mutexes_blocking.size())
@@ -713,46 +949,36 @@ gst_hailo_round_robin_sink_chain_blocking_mode(GstPad *pad, GstObject *parent, G
 static GstFlowReturn
 gst_hailo_round_robin_sink_chain_funnel_mode(GstPad *pad, GstObject *parent, GstBuffer *buf)
 {
-    GstFlowReturn ret = GST_FLOW_ERROR;
     GstHailoRoundRobin *hailo_round_robin = GST_HAILO_ROUND_ROBIN_CAST(parent);
-    buf = gst_buffer_make_writable(buf);
-    gchar *pad_name = gst_pad_get_name(pad);
-    gchar *stream_id = gst_pad_get_stream_id(pad);
-
-    // Add stream meta to the buffer including the pad name and stream id.
-    gst_buffer_add_hailo_stream_meta(buf, pad_name, stream_id);
-
-    // Forward sticky events.
-    gst_pad_sticky_events_foreach(pad, forward_events, hailo_round_robin->srcpad);
-
-    ret = gst_pad_push(hailo_round_robin->srcpad, buf);
-    g_free(pad_name);
-    g_free(stream_id);
-    return ret;
+    return push_buffer(hailo_round_robin, pad, buf);
 }
 
 static GstFlowReturn
 gst_hailo_round_robin_sink_chain_non_blocking_mode(GstPad *pad, GstObject *parent, GstBuffer *buf)
 {
-    GstFlowReturn ret = GST_FLOW_ERROR;
     GstHailoRoundRobin *hailo_round_robin = GST_HAILO_ROUND_ROBIN_CAST(parent);
     size_t pad_num = get_pad_num(pad);
 
-    if (hailo_round_robin->condition_vars_non_blocking[pad_num] != NULL)
+    std::unique_lock<std::mutex> lock(*hailo_round_robin->schedule_mutex);
+    hailo_round_robin->condition_vars_non_blocking[pad_num]->wait(lock, [hailo_round_robin, pad_num]
+                                                                  { return hailo_round_robin->stop_thread ||
+                                                                           hailo_round_robin->sink_pads[pad_num] == NULL ||
+                                                                           hailo_round_robin->pad_queues[pad_num]->size() < hailo_round_robin->queue_size; });
+    if (hailo_round_robin->stop_thread || hailo_round_robin->sink_pads[pad_num] == NULL)
     {
-        std::unique_lock lock(*hailo_round_robin->mutexes_non_blocking[pad_num].get());
-        hailo_round_robin->condition_vars_non_blocking[pad_num]->wait(lock, [hailo_round_robin, pad_num]
-                                                                      { return hailo_round_robin->pad_queues[pad_num]->size() < hailo_round_robin->queue_size; });
-
-        hailo_round_robin->pad_queues[pad_num]->push(buf);
+        gst_buffer_unref(buf);
+        return GST_FLOW_FLUSHING;
     }
-    else
+
+    hailo_round_robin->pad_queues[pad_num]->push({buf, g_get_monotonic_time()});
+    if (!hailo_round_robin->ready_pads[pad_num])
     {
-        gst_buffer_unref(buf);
-        return ret;
+        hailo_round_robin->ready_pads[pad_num] = true;
+        hailo_round_robin->num_ready_pads++;
     }
-    ret = GST_FLOW_OK;
-    return ret;
+    // Wake the scheduler, it only sleeps while none of the pads are ready.
+    hailo_round_robin->schedule_cv->notify_one();
+    return GST_FLOW_OK;
 }
 
 static gboolean
@@ -779,6 +1005,7 @@ gst_hailo_round_robin_sink_event(GstPad *pad, GstObject *parent, GstEvent *event
             fpad->got_eos = TRUE;
             hailo_round_robin->condition_vars_blocking[pad_num]->notify_all();
             hailo_round_robin->condition_vars_non_blocking[pad_num]->notify_all();
+            hailo_round_robin->schedule_cv->notify_all();
             forward = gst_hailo_round_robin_all_sinkpads_eos_unlocked(hailo_round_robin);
             GST_OBJECT_UNLOCK(hailo_round_robin);
         }
@@ -832,23 +1059,33 @@ gst_hailo_round_robin_change_state(GstElement *element, GstStateChange transitio
 
     switch (transition)
     {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+    {
+        // Non blocking mode starts its scheduler once preroll is done, or right away when it already was.
+        if (hailo_round_robin->mode == GST_HAILO_ROUND_ROBIN_MODE_WEIGHTED_FAIR ||
+            (hailo_round_robin->mode == GST_HAILO_ROUND_ROBIN_MODE_NON_BLOCKING && get_buffer_counter_value(hailo_round_robin) == -1))
+            gst_hailo_round_robin_start_scheduler(hailo_round_robin);
+        break;
+    }
     case GST_STATE_CHANGE_READY_TO_NULL:
     {
         if (hailo_round_robin->mode != GST_HAILO_ROUND_ROBIN_MODE_FUNNEL_MODE)
         {
-            hailo_round_robin->stop_thread = true;
             for (uint i = 0; i < hailo_round_robin->condition_vars_blocking.size(); i++)
             {
                 if (hailo_round_robin->condition_vars_blocking[i] != NULL)
                     hailo_round_robin->condition_vars_blocking[i]->notify_all();
             }
+            // Stops and joins the scheduler thread, and wakes pads waiting for room in their queue.
+            gst_hailo_round_robin_stop_scheduler(hailo_round_robin);
+            std::unique_lock<std::mutex> schedule_lock(*hailo_round_robin->schedule_mutex);
             for (uint i = 0; i < hailo_round_robin->condition_vars_non_blocking.size(); i++)
             {
                 if (hailo_round_robin->condition_vars_non_blocking[i] != NULL)
                     hailo_round_robin->condition_vars_non_blocking[i]->notify_all();
             }
-            break;
         }
+        break;
     }
 
     default:
@@ -19,6 +19,7 @@
 #include <condition_variable>
 #include <pthread.h>
 #include <thread>
+#include <atomic>
 
 G_BEGIN_DECLS
 
@@ -42,8 +43,18 @@ typedef enum
     GST_HAILO_ROUND_ROBIN_MODE_FUNNEL_MODE = 0,
     GST_HAILO_ROUND_ROBIN_MODE_BLOCKING = 1,
     GST_HAILO_ROUND_ROBIN_MODE_NON_BLOCKING = 2,
+    GST_HAILO_ROUND_ROBIN_MODE_WEIGHTED_FAIR = 3,
 } GstHailoRoundRobinMode;
 
+/**
+ * A buffer waiting in a pad queue, together with the time it arrived (monotonic, in microseconds).
+ */
+typedef struct
+{
+    GstBuffer *buffer;
+    gint64 arrival_time;
+} GstHailoRoundRobinQueuedBuffer;
+
 /**
  * GstHailoRoundRobin:
  *
@@ -62,15 +73,24 @@ struct _GstHailoRoundRobin
     uint wait_time;
     uint preroll_frames;
     std::vector<std::unique_ptr<std::mutex>> mutexes_blocking;
-    std::vector<std::unique_ptr<std::mutex>> mutexes_non_blocking;
     std::unique_ptr<std::shared_mutex> counter_mutex;
     int preroll_buffer_counter;
     std::vector<std::unique_ptr<std::condition_variable>> condition_vars_blocking;
     std::vector<std::unique_ptr<std::condition_variable>> condition_vars_non_blocking;
-    std::vector<std::unique_ptr<std::queue<GstBuffer *>>> pad_queues;
+    std::vector<std::unique_ptr<std::queue<GstHailoRoundRobinQueuedBuffer>>> pad_queues;
     std::thread *thread;
     gboolean stop_thread;
     std::unique_ptr<std::shared_mutex> current_pad_mutex;
+    // Scheduler state (non-blocking and weighted-fair modes), guarded by schedule_mutex.
+    // The sink pads signal schedule_cv whenever their queue becomes ready, so the scheduler never polls.
+    std::unique_ptr<std::mutex> schedule_mutex;
+    std::unique_ptr<std::condition_variable> schedule_cv;
+    std::vector<GstPad *> sink_pads;
+    std::vector<bool> ready_pads;
+    uint num_ready_pads;
+    size_t next_pad_num;
+    gdouble virtual_time;
+    std::atomic<guint64> scheduling_decisions;
 };
 
 struct _GstHailoRoundRobinClass
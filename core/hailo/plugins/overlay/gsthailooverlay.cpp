@@ -46,6 +46,8 @@ enum
     PROP_SHOW_CONF,
     PROP_MASK_OVERLAY_N_THREADS,
     PROP_LOCAL_GALLERY,
+    PROP_TEXT_ATLAS,
+    PROP_MASK_COMPOSITOR,
 };
 
 static void
@@ -89,7 +91,7 @@ gst_hailooverlay_class_init(GstHailoOverlayClass *klass)
                                                          (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
     // install property mask-overlay-n-threads uint default value 0
     g_object_class_install_property(gobject_class, PROP_MASK_OVERLAY_N_THREADS,
-                                    g_param_spec_uint("mask-overlay-n-threads", "mask-overlay-n-threads", "Number of threads to use for parallel mask drawing. Default 0 (Will use the default value OpenCV initializes - effected by the system capabilities).", 0, G_MAXUINT, 0,
+                                    g_param_spec_uint("mask-overlay-n-threads", "mask-overlay-n-threads", "Number of threads to use for parallel mask drawing. Default 0 (Will use the default value OpenCV initializes - effected by the system capabilities). With mask-compositor, number of threads compositing the masks of a frame, including the streaming thread (0 is one thread per hardware thread).", 0, G_MAXUINT, 0,
                                                       (GParamFlags)(GST_PARAM_MUTABLE_READY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
     g_object_class_install_property(gobject_class, PROP_LOCAL_GALLERY,
                                     g_param_spec_boolean("local-gallery", "local-gallery", "Whether to display Identified and UnIdentified ROI's taken from the local gallery, as well as the Global ID they receive.", false,
@@ -97,6 +99,12 @@ gst_hailooverlay_class_init(GstHailoOverlayClass *klass)
     g_object_class_install_property(gobject_class, PROP_LANDMARK_POINT_RADIUS,
                                     g_param_spec_float("landmark-point-radius", "landmark-point-radius", "The radius of the points when drawing landmarks. Default 3.", 0, G_MAXFLOAT, 3,
                                                        (GParamFlags)(GST_PARAM_MUTABLE_READY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_TEXT_ATLAS,
+                                    g_param_spec_boolean("text-atlas", "text-atlas", "Whether to draw text from pre-rasterized glyph atlases, caching rendered labels between frames, instead of rasterizing every label with OpenCV. Font scales are rounded to steps of 0.05.", false,
+                                                         (GParamFlags)(GST_PARAM_MUTABLE_READY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_MASK_COMPOSITOR,
+                                    g_param_spec_boolean("mask-compositor", "mask-compositor", "Whether to composite all the masks of a frame in a single pass, under the boxes and text, instead of drawing each mask in turn. Class masks are sampled nearest instead of interpolated.", false,
+                                                         (GParamFlags)(GST_PARAM_MUTABLE_READY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
     gobject_class->dispose = gst_hailooverlay_dispose;
     gobject_class->finalize = gst_hailooverlay_finalize;
@@ -116,6 +124,9 @@ gst_hailooverlay_init(GstHailoOverlay *hailooverlay)
     hailooverlay->local_gallery = false;
     hailooverlay->landmark_point_radius = 3;
     hailooverlay->mask_overlay_n_threads = 0;
+    hailooverlay->mask_compositor = false;
+    hailooverlay->mask_workers = nullptr;
+    hailooverlay->text_atlas = false;
 }
 
 void gst_hailooverlay_set_property(GObject *object, guint property_id,
@@ -144,10 +155,19 @@ void gst_hailooverlay_set_property(GObject *object, guint property_id,
         break;
     case PROP_MASK_OVERLAY_N_THREADS:
         hailooverlay->mask_overlay_n_threads = g_value_get_uint(value);
+        // The workers are created again with the new size on the next frame
+        delete hailooverlay->mask_workers;
+        hailooverlay->mask_workers = nullptr;
         break;
     case PROP_LOCAL_GALLERY:
         hailooverlay->local_gallery = g_value_get_boolean(value);
         break;
+    case PROP_TEXT_ATLAS:
+        hailooverlay->text_atlas = g_value_get_boolean(value);
+        break;
+    case PROP_MASK_COMPOSITOR:
+        hailooverlay->mask_compositor = g_value_get_boolean(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -184,6 +204,12 @@ void gst_hailooverlay_get_property(GObject *object, guint property_id,
     case PROP_MASK_OVERLAY_N_THREADS:
         g_value_set_uint(value, hailooverlay->mask_overlay_n_threads);
         break;
+    case PROP_TEXT_ATLAS:
+        g_value_set_boolean(value, hailooverlay->text_atlas);
+        break;
+    case PROP_MASK_COMPOSITOR:
+        g_value_set_boolean(value, hailooverlay->mask_compositor);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -196,6 +222,11 @@ void gst_hailooverlay_dispose(GObject *object)
     GST_DEBUG_OBJECT(hailooverlay, "dispose");
 
     /* clean up as possible.  may be called multiple times */
+    if (hailooverlay->mask_workers)
+    {
+        delete hailooverlay->mask_workers;
+        hailooverlay->mask_workers = nullptr;
+    }
 
     G_OBJECT_CLASS(gst_hailooverlay_parent_class)->dispose(object);
 }
@@ -264,13 +295,17 @@ gst_hailooverlay_transform_ip(GstBaseTransform *trans,
 
     if (hmat)
     {
+        if (hailooverlay->mask_compositor && !hailooverlay->mask_workers)
+            hailooverlay->mask_workers = new WorkerPool(hailooverlay->mask_overlay_n_threads);
+        if (hailooverlay->text_atlas)
+            hmat->set_text_renderer(&TextRenderer::shared());
         // Blur faces if face-blur is activated.
         if (hailooverlay->face_blur)
         {
             face_blur(*hmat.get(), hailo_roi);
         }
         // Draw all results of the given roi on mat.
-        ret = draw_all(*hmat.get(), hailo_roi, hailooverlay->landmark_point_radius, hailooverlay->show_confidence, hailooverlay->local_gallery, hailooverlay->mask_overlay_n_threads);
+        ret = draw_all(*hmat.get(), hailo_roi, hailooverlay->landmark_point_radius, hailooverlay->show_confidence, hailooverlay->local_gallery, hailooverlay->mask_overlay_n_threads, hailooverlay->mask_workers);
     }
     if (ret != OVERLAY_STATUS_OK)
     {
@@ -7,6 +7,7 @@
 #include <gst/base/gstbasetransform.h>
 #include <vector>
 #include "hailo_objects.hpp"
+#include "worker_pool.hpp"
 
 G_BEGIN_DECLS
 
@@ -29,6 +30,9 @@ struct _GstHailoOverlay
     gboolean show_confidence;
     gboolean local_gallery;
     guint mask_overlay_n_threads;
+    gboolean mask_compositor;
+    WorkerPool *mask_workers;
+    gboolean text_atlas;
 };
 
 struct _GstHailoOverlayClass
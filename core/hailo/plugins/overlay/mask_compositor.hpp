@@ -0,0 +1,367 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file mask_compositor.hpp
+ * @authors Hailo
+ *
+ * Draws all the masks of a frame in one pass over the image.
+ * Masks are collected as layers, then the frame is split into row tiles that are composited in parallel:
+ * every row of a tile samples each layer covering it (nearest for class ids, bilinear for confidence and depth),
+ * maps the samples to colors and blends them straight into the RGB, RGBA or NV12 planes.
+ * No resized copy of a mask is ever made.
+ **/
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "hailo_objects.hpp"
+#include "common/blend.hpp"
+#include "common/hailomat.hpp"
+#include "worker_pool.hpp"
+
+// A confidence mask paints the pixels above this value
+#define MASK_CONFIDENCE_THRESHOLD (0.5f)
+// Image rows composited by one job, even so NV12 chroma rows are never shared between jobs
+#define MASK_COMPOSITOR_TILE_ROWS (32)
+
+class MaskCompositor
+{
+private:
+    typedef enum
+    {
+        MASK_LAYER_CLASS,
+        MASK_LAYER_CONF,
+        MASK_LAYER_DEPTH
+    } mask_layer_t;
+
+    struct Layer
+    {
+        mask_layer_t type;
+        HailoMaskPtr mask;       // keeps the sampled data alive
+        cv::Rect rect;           // destination in the full resolution plane
+        int src_width;
+        int src_height;
+        const uint8_t *classes;  // MASK_LAYER_CLASS
+        const float *values;     // MASK_LAYER_CONF, MASK_LAYER_DEPTH
+        std::vector<float> dequantized; // depth mask viewing a tensor
+        uint8_t alpha;
+        std::array<std::array<uint8_t, 3>, 256> lut; // class id or depth level to color, RGB until prepared for the target
+        std::array<uint8_t, 3> color;                // MASK_LAYER_CONF
+        float depth_min;
+        float depth_scale;
+        // Horizontal sampling of each destination column, nearest or bilinear
+        std::vector<int> x0;
+        std::vector<int> x1;
+        std::vector<float> fx;
+    };
+
+    std::vector<Layer> m_layers;
+
+    static cv::Rect destination(HailoROIPtr roi, const cv::Mat &plane)
+    {
+        HailoBBox bbox = roi->get_bbox();
+        int roi_xmin = bbox.xmin() * plane.cols;
+        int roi_ymin = bbox.ymin() * plane.rows;
+        int roi_width = plane.cols * bbox.width();
+        int roi_height = plane.rows * bbox.height();
+
+        // clamp the region of interest so it is inside the plane
+        roi_xmin = std::clamp(roi_xmin, 0, plane.cols);
+        roi_ymin = std::clamp(roi_ymin, 0, plane.rows);
+        roi_width = std::clamp(roi_width, 0, plane.cols - roi_xmin);
+        roi_height = std::clamp(roi_height, 0, plane.rows - roi_ymin);
+        return cv::Rect(roi_xmin, roi_ymin, roi_width, roi_height);
+    }
+
+    Layer *add_layer(mask_layer_t type, HailoMaskPtr mask, HailoROIPtr roi, const cv::Mat &plane, float transparency)
+    {
+        cv::Rect rect = destination(roi, plane);
+        if (mask->get_width() == 0 || mask->get_height() == 0 || rect.area() == 0)
+            return nullptr;
+
+        m_layers.emplace_back();
+        Layer &layer = m_layers.back();
+        layer.type = type;
+        layer.mask = mask;
+        layer.rect = rect;
+        layer.src_width = mask->get_width();
+        layer.src_height = mask->get_height();
+        layer.classes = nullptr;
+        layer.values = nullptr;
+        layer.alpha = cv::saturate_cast<uint8_t>(std::clamp(transparency, 0.0f, 1.0f) * 255.0f);
+
+        float scale = float(layer.src_width) / rect.width;
+        layer.x0.resize(rect.width);
+        layer.x1.resize(rect.width);
+        layer.fx.resize(rect.width);
+        for (int j = 0; j < rect.width; j++)
+        {
+            if (type == MASK_LAYER_CLASS)
+            {
+                layer.x0[j] = std::min(int((j + 0.5f) * scale), layer.src_width - 1);
+                continue;
+            }
+            // Same sample positions as cv::INTER_LINEAR
+            float sx = std::max((j + 0.5f) * scale - 0.5f, 0.0f);
+            int x = std::min(int(sx), layer.src_width - 1);
+            layer.x0[j] = x;
+            layer.x1[j] = std::min(x + 1, layer.src_width - 1);
+            layer.fx[j] = sx - x;
+        }
+        return &layer;
+    }
+
+    static std::array<uint8_t, 3> to_yuv(const std::array<uint8_t, 3> &rgb)
+    {
+        return {uint8_t(RGB2Y(rgb[0], rgb[1], rgb[2])), uint8_t(RGB2U(rgb[0], rgb[1], rgb[2])), uint8_t(RGB2V(rgb[0], rgb[1], rgb[2]))};
+    }
+
+    // Vertical sampling of a destination row
+    static void sample_rows(const Layer &layer, int row, int &y0, int &y1, float &fy)
+    {
+        float scale = float(layer.src_height) / layer.rect.height;
+        if (layer.type == MASK_LAYER_CLASS)
+        {
+            y0 = y1 = std::min(int((row + 0.5f) * scale), layer.src_height - 1);
+            fy = 0;
+            return;
+        }
+        float sy = std::max((row + 0.5f) * scale - 0.5f, 0.0f);
+        y0 = std::min(int(sy), layer.src_height - 1);
+        y1 = std::min(y0 + 1, layer.src_height - 1);
+        fy = sy - y0;
+    }
+
+    /**
+     * @brief Shades the columns [begin, end) of a destination row of a layer, every `step` columns,
+     *        writing `channels` alpha and color bytes per sample taken from color channels [first_channel, first_channel + channels).
+     */
+    static void shade(const Layer &layer, int row, int begin, int end, int step, int first_channel, int channels, int stride,
+                      uint8_t *alpha_out, uint8_t *color_out)
+    {
+        int y0, y1;
+        float fy;
+        sample_rows(layer, row, y0, y1, fy);
+        size_t out = 0;
+        int painted = std::min(channels, 3 - first_channel);
+        if (layer.type == MASK_LAYER_CLASS)
+        {
+            const uint8_t *src = layer.classes + size_t(y0) * layer.src_width;
+            for (int j = begin; j < end; j += step, out += stride)
+            {
+                const std::array<uint8_t, 3> &color = layer.lut[src[layer.x0[j]]];
+                for (int c = 0; c < painted; c++)
+                {
+                    alpha_out[out + c] = layer.alpha;
+                    color_out[out + c] = color[first_channel + c];
+                }
+            }
+            return;
+        }
+
+        const float *row0 = layer.values + size_t(y0) * layer.src_width;
+        const float *row1 = layer.values + size_t(y1) * layer.src_width;
+        for (int j = begin; j < end; j += step, out += stride)
+        {
+            float top = row0[layer.x0[j]] + (row0[layer.x1[j]] - row0[layer.x0[j]]) * layer.fx[j];
+            float bottom = row1[layer.x0[j]] + (row1[layer.x1[j]] - row1[layer.x0[j]]) * layer.fx[j];
+            float value = top + (bottom - top) * fy;
+            const std::array<uint8_t, 3> *color;
+            uint8_t alpha = layer.alpha;
+            if (layer.type == MASK_LAYER_CONF)
+            {
+                color = &layer.color;
+                if (value <= MASK_CONFIDENCE_THRESHOLD)
+                    alpha = 0;
+            }
+            else
+            {
+                color = &layer.lut[cv::saturate_cast<uint8_t>(std::clamp((value - layer.depth_min) * layer.depth_scale, 0.0f, 1.0f) * 255.0f)];
+            }
+            for (int c = 0; c < painted; c++)
+            {
+                alpha_out[out + c] = alpha;
+                color_out[out + c] = (*color)[first_channel + c];
+            }
+        }
+    }
+
+    void composite_interleaved(cv::Mat &plane, int row_begin, int row_end, std::vector<uint8_t> &alpha_row, std::vector<uint8_t> &color_row)
+    {
+        int channels = plane.channels();
+        for (int row = row_begin; row < row_end; row++)
+        {
+            uint8_t *dst = plane.ptr<uint8_t>(row);
+            for (const Layer &layer : m_layers)
+            {
+                if (row < layer.rect.y || row >= layer.rect.y + layer.rect.height)
+                    continue;
+                size_t count = size_t(layer.rect.width) * channels;
+                // RGBA keeps its alpha channel
+                std::fill(alpha_row.begin(), alpha_row.begin() + count, 0);
+                shade(layer, row - layer.rect.y, 0, layer.rect.width, 1, 0, 3, channels, alpha_row.data(), color_row.data());
+                blend_row(dst + size_t(layer.rect.x) * channels, alpha_row.data(), color_row.data(), count);
+            }
+        }
+    }
+
+    void composite_nv12(cv::Mat &y_plane, cv::Mat &uv_plane, int row_begin, int row_end, std::vector<uint8_t> &alpha_row, std::vector<uint8_t> &color_row)
+    {
+        for (int row = row_begin; row < row_end; row++)
+        {
+            uint8_t *y_dst = y_plane.ptr<uint8_t>(row);
+            bool chroma_row = (row % 2 == 0) && (row / 2 < uv_plane.rows);
+            uint8_t *uv_dst = chroma_row ? uv_plane.ptr<uint8_t>(row / 2) : nullptr;
+            for (const Layer &layer : m_layers)
+            {
+                if (row < layer.rect.y || row >= layer.rect.y + layer.rect.height)
+                    continue;
+                int local_row = row - layer.rect.y;
+                shade(layer, local_row, 0, layer.rect.width, 1, 0, 1, 1, alpha_row.data(), color_row.data());
+                blend_row(y_dst + layer.rect.x, alpha_row.data(), color_row.data(), layer.rect.width);
+                if (!chroma_row)
+                    continue;
+
+                // Each chroma sample takes the mask at the top left luma pixel of its 2x2 block
+                int first = (layer.rect.x + 1) / 2;
+                int last = std::min((layer.rect.x + layer.rect.width + 1) / 2, uv_plane.cols);
+                if (first >= last)
+                    continue;
+                shade(layer, local_row, 2 * first - layer.rect.x, 2 * last - layer.rect.x, 2, 1, 2, 2, alpha_row.data(), color_row.data());
+                blend_row(uv_dst + size_t(first) * 2, alpha_row.data(), color_row.data(), size_t(last - first) * 2);
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief Adds a mask of class ids, every pixel is painted in the color of its class.
+     *
+     * @param mask  -  HailoClassMaskPtr
+     * @param roi  -  HailoROIPtr
+     *        The ROI the mask covers.
+     * @param plane  -  const cv::Mat &
+     *        The full resolution plane of the frame (the Y plane for NV12), the ROI is scaled to it.
+     * @param class_color  -  std::function<cv::Scalar(size_t)>
+     *        Color of a class id.
+     */
+    void add_class_mask(HailoClassMaskPtr mask, HailoROIPtr roi, const cv::Mat &plane, const std::function<cv::Scalar(size_t)> &class_color)
+    {
+        Layer *layer = add_layer(MASK_LAYER_CLASS, mask, roi, plane, mask->get_transparency());
+        if (!layer)
+            return;
+        layer->classes = mask->data();
+        for (size_t id = 0; id < layer->lut.size(); id++)
+        {
+            cv::Scalar color = class_color(id);
+            layer->lut[id] = {cv::saturate_cast<uint8_t>(color[0]), cv::saturate_cast<uint8_t>(color[1]), cv::saturate_cast<uint8_t>(color[2])};
+        }
+    }
+
+    /**
+     * @brief Adds a confidence mask, the pixels above MASK_CONFIDENCE_THRESHOLD are painted in one color.
+     */
+    void add_conf_class_mask(HailoConfClassMaskPtr mask, HailoROIPtr roi, const cv::Mat &plane, const cv::Scalar &color)
+    {
+        Layer *layer = add_layer(MASK_LAYER_CONF, mask, roi, plane, mask->get_transparency());
+        if (!layer)
+            return;
+        layer->values = mask->get_data().data();
+        layer->color = {cv::saturate_cast<uint8_t>(color[0]), cv::saturate_cast<uint8_t>(color[1]), cv::saturate_cast<uint8_t>(color[2])};
+    }
+
+    /**
+     * @brief Adds a depth mask drawn in gray levels, normalized over [min_distance, max_distance]
+     *        widened to the range of the mask.
+     */
+    void add_depth_mask(HailoDepthMaskPtr mask, HailoROIPtr roi, const cv::Mat &plane, float min_distance, float max_distance)
+    {
+        Layer *layer = add_layer(MASK_LAYER_DEPTH, mask, roi, plane, mask->get_transparency());
+        if (!layer)
+            return;
+        if (mask->is_view())
+        {
+            // dequantized once into the layer, without caching a copy in the mask
+            layer->dequantized.resize(mask->size());
+            mask->dequantize(layer->dequantized.data());
+            layer->values = layer->dequantized.data();
+        }
+        else
+        {
+            layer->values = mask->get_data().data();
+        }
+        auto range = std::minmax_element(layer->values, layer->values + mask->size());
+        float min = std::min(min_distance, *range.first);
+        float max = std::max(max_distance, *range.second);
+        layer->depth_min = min;
+        layer->depth_scale = max > min ? 1.0f / (max - min) : 0.0f;
+        for (size_t level = 0; level < layer->lut.size(); level++)
+            layer->lut[level] = {uint8_t(level), uint8_t(level), uint8_t(level)};
+    }
+
+    bool empty() const
+    {
+        return m_layers.empty();
+    }
+
+    /**
+     * @brief Draws every added mask into the frame, in the order they were added, and clears the layers.
+     *
+     * @param mat  -  HailoMat &
+     *        RGB, RGBA or NV12 frame, other formats are left untouched.
+     * @param workers  -  WorkerPool *
+     *        Runs the row tiles in parallel, nullptr composites on the calling thread.
+     */
+    void composite(HailoMat &mat, WorkerPool *workers)
+    {
+        hailo_mat_t type = mat.get_type();
+        if (m_layers.empty() || (type != HAILO_MAT_RGB && type != HAILO_MAT_RGBA && type != HAILO_MAT_NV12))
+        {
+            m_layers.clear();
+            return;
+        }
+
+        int row_begin = INT32_MAX, row_end = 0, max_width = 0;
+        for (Layer &layer : m_layers)
+        {
+            row_begin = std::min(row_begin, layer.rect.y);
+            row_end = std::max(row_end, layer.rect.y + layer.rect.height);
+            max_width = std::max(max_width, layer.rect.width);
+            if (type == HAILO_MAT_NV12)
+            {
+                for (auto &color : layer.lut)
+                    color = to_yuv(color);
+                layer.color = to_yuv(layer.color);
+            }
+        }
+        row_begin &= ~1;
+        size_t tiles = (row_end - row_begin + MASK_COMPOSITOR_TILE_ROWS - 1) / MASK_COMPOSITOR_TILE_ROWS;
+        std::vector<cv::Mat> &planes = mat.get_matrices();
+
+        std::function<void(size_t)> composite_tile = [&](size_t tile)
+        {
+            int begin = row_begin + int(tile) * MASK_COMPOSITOR_TILE_ROWS;
+            int end = std::min(begin + MASK_COMPOSITOR_TILE_ROWS, row_end);
+            std::vector<uint8_t> alpha_row(size_t(max_width) * 4);
+            std::vector<uint8_t> color_row(size_t(max_width) * 4);
+            if (type == HAILO_MAT_NV12)
+                composite_nv12(planes[0], planes[1], begin, end, alpha_row, color_row);
+            else
+                composite_interleaved(planes[0], begin, end, alpha_row, color_row);
+        };
+        if (workers)
+            workers->run(tiles, composite_tile);
+        else
+            for (size_t tile = 0; tile < tiles; tile++)
+                composite_tile(tile);
+        m_layers.clear();
+    }
+};
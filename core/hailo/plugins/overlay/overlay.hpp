@@ -18,6 +18,7 @@
 #include <vector>
 #include "hailo_objects.hpp"
 #include "common/hailomat.hpp"
+#include "worker_pool.hpp"
 
 typedef enum
 {
@@ -27,7 +28,7 @@ typedef enum
 } overlay_status_t;
 
 __BEGIN_DECLS
-overlay_status_t draw_all(HailoMat &hmat, HailoROIPtr roi, float landmark_point_radius, bool show_confidence = true, bool local_gallery = false, uint mask_overlay_n_threads = 0);
+overlay_status_t draw_all(HailoMat &hmat, HailoROIPtr roi, float landmark_point_radius, bool show_confidence = true, bool local_gallery = false, uint mask_overlay_n_threads = 0, WorkerPool *mask_workers = nullptr);
 void face_blur(HailoMat &mat, HailoROIPtr roi);
 
 cv::Scalar indexToColor(size_t index);
@@ -337,7 +337,10 @@ static void get_tensors_from_meta(GstBuffer *buffer, HailoROIPtr roi)
         pmeta = reinterpret_cast<GstParentBufferMeta *>(meta);
         (void)gst_buffer_map(pmeta->buffer, &info, GST_MAP_READWRITE);
         const hailo_vstream_info_t vstream_info = reinterpret_cast<GstHailoTensorMeta *>(gst_buffer_get_meta(pmeta->buffer, g_type_from_name(TENSOR_META_API_NAME)))->info;
-        roi->add_tensor(std::make_shared<HailoTensor>(reinterpret_cast<uint8_t *>(info.data), vstream_info));
+        // The tensor holds a reference to its buffer, so objects viewing the tensor (e.g. masks) outlive the meta
+        std::shared_ptr<void> owner(gst_buffer_ref(pmeta->buffer), [](void *tensor_buffer)
+                                    { gst_buffer_unref(GST_BUFFER(tensor_buffer)); });
+        roi->add_tensor(std::make_shared<HailoTensor>(reinterpret_cast<uint8_t *>(info.data), vstream_info, std::move(owner)));
         gst_buffer_unmap(pmeta->buffer, &info);
     }
 }
@@ -576,6 +576,7 @@ PYBIND11_MODULE(hailo, m)
                                sizeof(float)}); })
             .def("get_type", &HailoDepthMask::get_type, "Get type")
             .def("get_data", &HailoDepthMask::get_data, "Get data")
+            .def("is_view", &HailoDepthMask::is_view, "Whether the mask views the inference tensor, dequantized on first access")
             .def("__repr__", [](const HailoDepthMask &obj)
                  { return "<hailo.HailoDepthMask"s + "(" +
                           std::to_string(reinterpret_cast<unsigned long>(&obj)) + ")" + ">"; })
@@ -603,7 +604,7 @@ PYBIND11_MODULE(hailo, m)
             .def(py::init<std::vector<uint8_t>, int, int, float>(), py::arg("data_vec"), py::arg("mask_width"), py::arg("mask_height"), py::arg("transparency"))
             .def_buffer([](HailoClassMask &obj) -> py::buffer_info
                         { return py::buffer_info(
-                              const_cast<uint8_t *>(obj.get_data().data()),
+                              const_cast<uint8_t *>(obj.data()),
                               sizeof(uint8_t),
                               py::format_descriptor<uint8_t>::format(),
                               2,
@@ -612,6 +613,7 @@ PYBIND11_MODULE(hailo, m)
                                sizeof(uint8_t)}); })
             .def("get_type", &HailoClassMask::get_type, "Get type")
             .def("get_data", &HailoClassMask::get_data, "Get data")
+            .def("is_view", &HailoClassMask::is_view, "Whether the mask views the inference tensor without copying it")
             .def("__repr__", [](const HailoClassMask &obj)
                  { return "<hailo.HailoClassMask"s + "(" +
                           std::to_string(reinterpret_cast<unsigned long>(&obj)) + ")" + ">"; });
@@ -2,6 +2,7 @@
  * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
  * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
  **/
+#include <algorithm>
 #include <gst/gst.h>
 #include <opencv2/opencv.hpp>
 #include "hailo_objects.hpp"
@@ -21,11 +22,13 @@ enum
     PROP_IOU_THRESHOLD,
     PROP_BORDER_THRESHOLD,
     PROP_REMOVE_LARGE_LANDSCAPE,
+    PROP_MERGE_MODE,
 };
 
 #define DEFAULT_IOU_THRESHOLD 0.3
 #define DEFAULT_BORDER_THRESHOLD 0.1
 #define DEFAULT_REMOVE_LARGE_LANDSCAPE true
+#define DEFAULT_MERGE_MODE TILE_MERGE_NMS
 
 #define LARGE_LANDSCAPE_MASK_WIDTH_HEIGHT_RATIO 1.3
 #define LARGE_LANDSCAPE_MASK_SIZE 0.05
@@ -34,8 +37,24 @@ enum
 
 G_DEFINE_TYPE_WITH_CODE(GstHailoTileAggregator, gst_hailotileaggregator, GST_TYPE_HAILO_AGGREGATOR, _do_init);
 
-static float iou_calc(const HailoBBox &box_1, const HailoBBox &box_2);
-static void nms(HailoROIPtr hailo_roi, const float iou_thr);
+#define GST_TYPE_HAILOTILEAGGREGATOR_MERGE_MODE (gst_hailotileaggregator_merge_mode_get_type())
+static GType
+gst_hailotileaggregator_merge_mode_get_type(void)
+{
+    static GType aggregator_merge_mode = 0;
+    static const GEnumValue hailotileaggregator_merge_modes[] = {
+        {TILE_MERGE_NMS, "Suppress overlapping detections (NMS)", "nms"},
+        {TILE_MERGE_WBF, "Fuse overlapping detections (weighted box fusion)", "wbf"},
+        {0, NULL, NULL},
+    };
+    if (!aggregator_merge_mode)
+    {
+        aggregator_merge_mode =
+            g_enum_register_static("GstHailoTileAggregatorMergeMode", hailotileaggregator_merge_modes);
+    }
+    return aggregator_merge_mode;
+}
+
 static void gst_hailotileaggregator_set_property(GObject *object,
                                                  guint prop_id, const GValue *value, GParamSpec *pspec);
 static void gst_hailotileaggregator_get_property(GObject *object,
@@ -46,6 +65,7 @@ static void gst_hailotileaggregator_finalize(GObject *object);
 
 static void gst_hailotileaggregator_post_aggregation(GstHailoAggregator *hailoaggregator, HailoROIPtr hailo_roi);
 static void gst_hailotileaggregator_handle_sub_frame_roi(GstHailoAggregator *hailoaggregator, HailoROIPtr sub_buffer_roi);
+static void gst_hailotileaggregator_handle_reset(GstHailoAggregator *hailoaggregator);
 
 static void
 gst_hailotileaggregator_class_init(GstHailoTileAggregatorClass *klass)
@@ -65,6 +85,7 @@ gst_hailotileaggregator_class_init(GstHailoTileAggregatorClass *klass)
 
     hailoaggregator_class->handle_main_roi_post_aggregation = gst_hailotileaggregator_post_aggregation;
     hailoaggregator_class->handle_sub_frame_roi = gst_hailotileaggregator_handle_sub_frame_roi;
+    hailoaggregator_class->handle_reset = gst_hailotileaggregator_handle_reset;
 
     gst_element_class_set_static_metadata(gstelement_class,
                                           "hailotileaggregator",
@@ -83,6 +104,11 @@ gst_hailotileaggregator_class_init(GstHailoTileAggregatorClass *klass)
     g_object_class_install_property(gobject_class, PROP_REMOVE_LARGE_LANDSCAPE,
                                     g_param_spec_boolean("remove-large-landscape", "Remove large landscape", "remove large landscape objects when running in multi-scale mode", true,
                                                          (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+
+    g_object_class_install_property(gobject_class, PROP_MERGE_MODE,
+                                    g_param_spec_enum("merge-mode", "Merge mode", "How overlapping detections of different tiles are merged, suppressed (NMS) or fused (weighted box fusion)",
+                                                      GST_TYPE_HAILOTILEAGGREGATOR_MERGE_MODE, DEFAULT_MERGE_MODE,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
 }
 
 static void
@@ -91,6 +117,8 @@ gst_hailotileaggregator_init(GstHailoTileAggregator *hailotileaggregator)
     hailotileaggregator->iou_threshold = DEFAULT_IOU_THRESHOLD;
     hailotileaggregator->border_threshold = DEFAULT_BORDER_THRESHOLD;
     hailotileaggregator->remove_large_landscape = DEFAULT_REMOVE_LARGE_LANDSCAPE;
+    hailotileaggregator->merge_mode = DEFAULT_MERGE_MODE;
+    hailotileaggregator->merger = std::make_unique<TileMerger>();
 }
 
 void gst_hailotileaggregator_dispose(GObject *object)
@@ -104,6 +132,7 @@ void gst_hailotileaggregator_finalize(GObject *object)
 {
     GstHailoTileAggregator *hailotileaggregator = GST_HAILO_TILE_AGGREGATOR(object);
     GST_DEBUG_OBJECT(hailotileaggregator, "finalize");
+    hailotileaggregator->merger.reset();
     G_OBJECT_CLASS(gst_hailotileaggregator_parent_class)->finalize(object);
 }
 
@@ -121,6 +150,9 @@ static void gst_hailotileaggregator_set_property(GObject *object, guint prop_id,
     case PROP_REMOVE_LARGE_LANDSCAPE:
         hailotileaggregator->remove_large_landscape = g_value_get_boolean(value);
         break;
+    case PROP_MERGE_MODE:
+        hailotileaggregator->merge_mode = (tile_merge_mode_t)g_value_get_enum(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -141,6 +173,9 @@ static void gst_hailotileaggregator_get_property(GObject *object, guint prop_id,
     case PROP_REMOVE_LARGE_LANDSCAPE:
         g_value_set_boolean(value, hailotileaggregator->remove_large_landscape);
         break;
+    case PROP_MERGE_MODE:
+        g_value_set_enum(value, hailotileaggregator->merge_mode);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -173,26 +208,74 @@ static void remove_large_landscape(HailoROIPtr hailo_roi, int &frame_width, int
     }
 }
 
+/**
+ * Returns whether another tile of the same layer continues past one border of a tile.
+ * With a full grid this is every border that is not on the frame border, with adaptive tiling
+ * the borders next to tiles that were not scheduled in this frame have no neighbour.
+ *
+ * @param[in] tile_bbox     HailoBBox of the tile.
+ * @param[in] other_bbox    HailoBBox of another tile of the same layer.
+ * @param[in] dx            int, -1 / 1 for the left / right border, 0 for a horizontal border.
+ * @param[in] dy            int, -1 / 1 for the top / bottom border, 0 for a vertical border.
+ * @return bool, true if other_bbox continues the tile past the border.
+ */
+static bool is_border_neighbour(const HailoBBox &tile_bbox, const HailoBBox &other_bbox, int dx, int dy)
+{
+    const float eps = 1e-4f;
+    if (dx != 0)
+    {
+        float overlap = std::min(tile_bbox.ymax(), other_bbox.ymax()) - std::max(tile_bbox.ymin(), other_bbox.ymin());
+        if (overlap < 0.5f * tile_bbox.height())
+            return false;
+        if (dx < 0)
+            return other_bbox.xmin() < tile_bbox.xmin() - eps && other_bbox.xmax() > tile_bbox.xmin() - eps;
+        return other_bbox.xmax() > tile_bbox.xmax() + eps && other_bbox.xmin() < tile_bbox.xmax() + eps;
+    }
+    float overlap = std::min(tile_bbox.xmax(), other_bbox.xmax()) - std::max(tile_bbox.xmin(), other_bbox.xmin());
+    if (overlap < 0.5f * tile_bbox.width())
+        return false;
+    if (dy < 0)
+        return other_bbox.ymin() < tile_bbox.ymin() - eps && other_bbox.ymax() > tile_bbox.ymin() - eps;
+    return other_bbox.ymax() > tile_bbox.ymax() + eps && other_bbox.ymin() < tile_bbox.ymax() + eps;
+}
+
 /**
  * Remove detections close to the boundary of the tile.
- * Not including tile borders that located on one of the borders of the full frame.
+ * Only borders shared with another tile of the frame (same layer) are considered,
+ * not borders on the full frame's border or next to tiles that were not scheduled (adaptive tiling),
+ * since no other tile would detect those objects.
  *
  * @param[in] hailo_tile_roi  HailoTileROIPtr taken from the buffer.
+ * @param[in] tiles  std::vector<HailoTileROIPtr>, the tiles of the frame (from the main ROI).
  * @param[in] border_threshold    float.  threshold - 0 - 1 value of 'close to border' ratio.
  * @return void.
  */
-static void remove_exceeded_bboxes(HailoTileROIPtr hailo_tile_roi, float border_threshold)
+static void remove_exceeded_bboxes(HailoTileROIPtr hailo_tile_roi, const std::vector<HailoTileROIPtr> &tiles, float border_threshold)
 {
     auto detections = hailo_common::get_hailo_detections(hailo_tile_roi);
+    if (detections.empty())
+        return;
     HailoBBox tile_bbox = hailo_tile_roi->get_bbox();
 
+    bool has_xmin = false, has_xmax = false, has_ymin = false, has_ymax = false;
+    for (const HailoTileROIPtr &other : tiles)
+    {
+        if (other == hailo_tile_roi || other->get_layer() != hailo_tile_roi->get_layer())
+            continue;
+        HailoBBox other_bbox = other->get_bbox();
+        has_xmin = has_xmin || is_border_neighbour(tile_bbox, other_bbox, -1, 0);
+        has_xmax = has_xmax || is_border_neighbour(tile_bbox, other_bbox, 1, 0);
+        has_ymin = has_ymin || is_border_neighbour(tile_bbox, other_bbox, 0, -1);
+        has_ymax = has_ymax || is_border_neighbour(tile_bbox, other_bbox, 0, 1);
+    }
+
     for (const HailoDetectionPtr &detection : detections)
     {
         HailoBBox bbox = detection->get_bbox();
-        bool exceed_xmin = (tile_bbox.xmin() != 0 && bbox.xmin() < border_threshold);
-        bool exceed_xmax = (tile_bbox.xmax() != 1 && (1 - bbox.xmax()) < border_threshold);
-        bool exceed_ymin = (tile_bbox.ymin() != 0 && bbox.ymin() < border_threshold);
-        bool exceed_ymax = (tile_bbox.ymax() != 1 && (1 - bbox.ymax()) < border_threshold);
+        bool exceed_xmin = (has_xmin && bbox.xmin() < border_threshold);
+        bool exceed_xmax = (has_xmax && (1 - bbox.xmax()) < border_threshold);
+        bool exceed_ymin = (has_ymin && bbox.ymin() < border_threshold);
+        bool exceed_ymax = (has_ymax && (1 - bbox.ymax()) < border_threshold);
 
         if (exceed_xmin || exceed_xmax || exceed_ymin || exceed_ymax)
             hailo_tile_roi->remove_object(detection);
@@ -210,85 +293,45 @@ gst_hailotileaggregator_post_aggregation(GstHailoAggregator *hailoaggregator, Ha
     auto caps_st = gst_caps_get_structure(caps, 0);
     gst_structure_get_int(caps_st, "width", &frame_width);
     gst_structure_get_int(caps_st, "height", &frame_height);
+    gst_caps_unref(caps);
     if(hailo_roi == nullptr)
         return;
     auto tiles = hailo_common::get_hailo_tiles(hailo_roi);
-    if (tiles[0]->get_mode() == MULTI_SCALE && hailotileaggregator->remove_large_landscape)
+    // With adaptive tiling a frame may have no tiles scheduled at all
+    if (!tiles.empty() && tiles[0]->get_mode() == MULTI_SCALE && hailotileaggregator->remove_large_landscape)
         remove_large_landscape(hailo_roi, frame_width, frame_height);
 
-    // Perform NMS on the main frame's detections after aggragation is done
-    nms(hailo_roi, hailotileaggregator->iou_threshold);
+    // Resolve the overlaps found while the tiles arrived, suppressing (or fusing) the duplicate detections
+    hailotileaggregator->merger->finish_frame(hailo_roi, hailotileaggregator->iou_threshold, hailotileaggregator->merge_mode);
 }
 
 static void
 gst_hailotileaggregator_handle_sub_frame_roi(GstHailoAggregator *hailoaggregator, HailoROIPtr sub_buffer_roi)
 {
+    GstHailoTileAggregator *hailotileaggregator = GST_HAILO_TILE_AGGREGATOR(hailoaggregator);
     HailoTileROIPtr hailo_tile_roi = std::dynamic_pointer_cast<HailoTileROI>(sub_buffer_roi);
+    HailoROIPtr main_roi = get_hailo_main_roi(hailoaggregator->mainframe);
     if (hailo_tile_roi->get_mode() == MULTI_SCALE)
     {
         // Remove tile's exceeded objects (close to boundary) using given border_threshold
-        GstHailoTileAggregator *hailotileaggregator = GST_HAILO_TILE_AGGREGATOR(hailoaggregator);
-        remove_exceeded_bboxes(hailo_tile_roi, hailotileaggregator->border_threshold);
+        auto tiles = hailo_common::get_hailo_tiles(main_roi);
+        remove_exceeded_bboxes(hailo_tile_roi, tiles, hailotileaggregator->border_threshold);
     }
+    auto detections = hailo_common::get_hailo_detections(hailo_tile_roi);
 
     // Calling the base handle_sub_frame_roi of the parent (hailoaggregator)
     GST_HAILO_AGGREGATOR_CLASS(parent_class)->handle_sub_frame_roi(hailoaggregator, sub_buffer_roi);
-}
 
-float iou_calc(const HailoBBox &box_1, const HailoBBox &box_2)
-{
-    // Calculate IOU between two detection boxes
-    const float width_of_overlap_area = std::min(box_1.xmax(), box_2.xmax()) - std::max(box_1.xmin(), box_2.xmin());
-    const float height_of_overlap_area = std::min(box_1.ymax(), box_2.ymax()) - std::max(box_1.ymin(), box_2.ymin());
-    const float positive_width_of_overlap_area = std::max(width_of_overlap_area, 0.0f);
-    const float positive_height_of_overlap_area = std::max(height_of_overlap_area, 0.0f);
-    const float area_of_overlap = positive_width_of_overlap_area * positive_height_of_overlap_area;
-    const float box_1_area = (box_1.ymax() - box_1.ymin()) * (box_1.xmax() - box_1.xmin());
-    const float box_2_area = (box_2.ymax() - box_2.ymin()) * (box_2.xmax() - box_2.xmin());
-    // The IOU is a ratio of how much the boxes overlap vs their size outside the overlap.
-    // Boxes that are similar will have a higher overlap threshold.
-    return area_of_overlap / (box_1_area + box_2_area - area_of_overlap);
+    // Compare the flattened detections with the ones of the tiles that already arrived,
+    // so post aggregation only has to resolve the overlaps
+    if (hailoaggregator->flatten_detections)
+        hailotileaggregator->merger->add_tile(main_roi, detections, hailotileaggregator->iou_threshold);
 }
 
-/**
- * @brief Perform IOU based NMS on detection objects of HailoRoi
- *
- * @param hailo_roi  -  HailoROIPtr
- *        The HailoROI contains detections to perform NMS on.
- *
- * @param iou_thr  -  float
- *        Threshold for IOU filtration
- */
-void nms(HailoROIPtr hailo_roi, const float iou_thr)
+static void
+gst_hailotileaggregator_handle_reset(GstHailoAggregator *hailoaggregator)
 {
-    // The network may propose multiple detections of similar size/score,
-    // which are actually the same detection. We want to filter out the lesser
-    // detections with a simple nms.
-
-    std::vector<HailoDetectionPtr> objects = hailo_common::get_hailo_detections(hailo_roi);
-    std::sort(objects.begin(), objects.end(),
-              [](HailoDetectionPtr a, HailoDetectionPtr b)
-              { return a->get_confidence() > b->get_confidence(); });
-
-    for (uint index = 0; index < objects.size(); index++)
-    {
-        for (uint jindex = index + 1; jindex < objects.size(); jindex++)
-        {
-            if (objects[index]->get_class_id() == objects[jindex]->get_class_id())
-            {
-                // For each detection, calculate the IOU against each following detection.
-                float iou = iou_calc(objects[index]->get_bbox(), objects[jindex]->get_bbox());
-                // If the IOU is above threshold, then we have two similar detections,
-                // and want to delete the one.
-                if (iou >= iou_thr)
-                {
-                    // The detections are arranged in highest score order,
-                    // so we want to erase the latter detection.
-                    hailo_roi->remove_object(objects[jindex]);
-                    objects.erase(objects.begin() + jindex);
-                    jindex--; // Step back jindex since we just erased the current detection.
-                }
-            }
-        }
-    }
-}
\ No newline at end of file
+    GstHailoTileAggregator *hailotileaggregator = GST_HAILO_TILE_AGGREGATOR(hailoaggregator);
+    // Forget the overlaps of the frames that were dropped, they will never be finished
+    hailotileaggregator->merger->reset();
+}
@@ -10,7 +10,9 @@
 #pragma once
 
 #include <gst/gst.h>
+#include <memory>
 #include "cropping/gsthailoaggregator.hpp"
+#include "tiling/tile_merger.hpp"
 
 G_BEGIN_DECLS
 
@@ -31,6 +33,8 @@ struct _GstHailoTileAggregator
     gfloat iou_threshold;
     gfloat border_threshold;
     gboolean remove_large_landscape;
+    tile_merge_mode_t merge_mode;
+    std::unique_ptr<TileMerger> merger;
 };
 
 struct _GstHailoTileAggregatorClass
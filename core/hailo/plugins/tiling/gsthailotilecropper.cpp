@@ -5,6 +5,7 @@
 #include <gst/gst.h>
 #include <opencv2/opencv.hpp>
 
+#include "common/image.hpp"
 #include "gst_hailo_meta.hpp"
 #include "gsthailotilecropper.hpp"
 
@@ -19,6 +20,10 @@ GST_DEBUG_CATEGORY_STATIC(gst_hailotilecropper_debug);
 #define DEFAULT_OVERLAP_X_AXIS 0
 #define DEFAULT_OVERLAP_Y_AXIS 0
 #define DEFAULT_MULTI_SCALE_LEVEL 2
+#define DEFAULT_ADAPTIVE_TILING false
+#define DEFAULT_FULL_SWEEP_PERIOD 10
+#define DEFAULT_ACTIVITY_MARGIN 0.05
+#define DEFAULT_MOTION_THRESHOLD 0
 static const uint scales_template[][2]{{1, 1}, {2, 2}, {3, 3}};
 
 enum
@@ -30,6 +35,10 @@ enum
     PROP_OVERLAP_Y_AXIS,
     PROP_TILING_MODE,
     PROP_MULTI_SCALE_LEVEL,
+    PROP_ADAPTIVE_TILING,
+    PROP_FULL_SWEEP_PERIOD,
+    PROP_ACTIVITY_MARGIN,
+    PROP_MOTION_THRESHOLD,
 };
 
 #define gst_hailotilecropper_parent_class parent_class
@@ -115,6 +124,22 @@ gst_hailotilecropper_class_init(GstHailoTileCropperClass *klass)
     g_object_class_install_property(gobject_class, PROP_MULTI_SCALE_LEVEL,
                                     g_param_spec_uint("scale-level", "Scale level", "Scales (layers of tiles) in addition to the main layer 1: [(1 X 1)] 2: [(1 X 1), (2 X 2)] 3: [(1 X 1), (2 X 2), (3 X 3)]]", 1, 3, 2,
                                                       (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+
+    g_object_class_install_property(gobject_class, PROP_ADAPTIVE_TILING,
+                                    g_param_spec_boolean("adaptive-tiling", "Adaptive tiling", "Crop only the tiles near recent detections (or motion), with a full sweep of all the tiles every full-sweep-period frames", DEFAULT_ADAPTIVE_TILING,
+                                                         (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+
+    g_object_class_install_property(gobject_class, PROP_FULL_SWEEP_PERIOD,
+                                    g_param_spec_uint("full-sweep-period", "Full sweep period", "In adaptive tiling, crop all the tiles once every this many frames", 1, G_MAXUINT, DEFAULT_FULL_SWEEP_PERIOD,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+
+    g_object_class_install_property(gobject_class, PROP_ACTIVITY_MARGIN,
+                                    g_param_spec_float("activity-margin", "Activity margin", "In adaptive tiling, margin (fraction of the frame) around the detections of the last frames that keeps tiles active", 0, 1, DEFAULT_ACTIVITY_MARGIN,
+                                                       (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+
+    g_object_class_install_property(gobject_class, PROP_MOTION_THRESHOLD,
+                                    g_param_spec_float("motion-threshold", "Motion threshold", "In adaptive tiling, fraction of a tile that must change since the previous frame to crop it. 0 disables the motion map", 0, 1, DEFAULT_MOTION_THRESHOLD,
+                                                       (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
 }
 
 static void
@@ -126,6 +151,11 @@ gst_hailotilecropper_init(GstHailoTileCropper *hailotilecropper)
     hailotilecropper->overlap_y_axis = DEFAULT_OVERLAP_Y_AXIS;
     hailotilecropper->tiling_mode = SINGLE_SCALE;
     hailotilecropper->multi_scale_level = DEFAULT_MULTI_SCALE_LEVEL;
+    hailotilecropper->adaptive_tiling = DEFAULT_ADAPTIVE_TILING;
+    hailotilecropper->scheduler_params.full_sweep_period = DEFAULT_FULL_SWEEP_PERIOD;
+    hailotilecropper->scheduler_params.margin = DEFAULT_ACTIVITY_MARGIN;
+    hailotilecropper->scheduler_params.motion_threshold = DEFAULT_MOTION_THRESHOLD;
+    hailotilecropper->scheduler = std::make_unique<TileScheduler>();
 }
 
 void gst_hailotilecropper_dispose(GObject *object)
@@ -139,6 +169,7 @@ void gst_hailotilecropper_finalize(GObject *object)
 {
     GstHailoTileCropper *hailotilecropper = GST_HAILO_TILE_CROPPER(object);
     GST_DEBUG_OBJECT(hailotilecropper, "finalize");
+    hailotilecropper->scheduler.reset();
     G_OBJECT_CLASS(gst_hailotilecropper_parent_class)->finalize(object);
 }
 
@@ -169,6 +200,18 @@ gst_hailotilecropper_set_property(GObject *object, guint prop_id,
         hailotilecropper->tiling_mode = (hailo_tiling_mode_t)g_value_get_enum(value);
         GST_OBJECT_UNLOCK(hailotilecropper);
         break;
+    case PROP_ADAPTIVE_TILING:
+        hailotilecropper->adaptive_tiling = g_value_get_boolean(value);
+        break;
+    case PROP_FULL_SWEEP_PERIOD:
+        hailotilecropper->scheduler_params.full_sweep_period = g_value_get_uint(value);
+        break;
+    case PROP_ACTIVITY_MARGIN:
+        hailotilecropper->scheduler_params.margin = g_value_get_float(value);
+        break;
+    case PROP_MOTION_THRESHOLD:
+        hailotilecropper->scheduler_params.motion_threshold = g_value_get_float(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -203,6 +246,18 @@ gst_hailotilecropper_get_property(GObject *object, guint prop_id,
         g_value_set_enum(value, (gint)hailotilecropper->tiling_mode);
         GST_OBJECT_UNLOCK(hailotilecropper);
         break;
+    case PROP_ADAPTIVE_TILING:
+        g_value_set_boolean(value, hailotilecropper->adaptive_tiling);
+        break;
+    case PROP_FULL_SWEEP_PERIOD:
+        g_value_set_uint(value, hailotilecropper->scheduler_params.full_sweep_period);
+        break;
+    case PROP_ACTIVITY_MARGIN:
+        g_value_set_float(value, hailotilecropper->scheduler_params.margin);
+        break;
+    case PROP_MOTION_THRESHOLD:
+        g_value_set_float(value, hailotilecropper->scheduler_params.motion_threshold);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -232,7 +287,7 @@ static HailoTileROI create_tile_roi(const uint &index, const float &col_overlap,
     return HailoTileROI(HailoBBox(x, y, width, height), index, col_overlap, row_overlap, layer, tiling_mode);
 }
 
-static void prepare_tiles(HailoROIPtr hailo_roi, std::vector<HailoROIPtr> &crop_rois, float tiles_along_x_axis, float tiles_along_y_axis, float overlap_x_axis, float overlap_y_axis, uint layer, hailo_tiling_mode_t tiling_mode)
+static void prepare_tiles(std::vector<HailoTileROIPtr> &tiles, float tiles_along_x_axis, float tiles_along_y_axis, float overlap_x_axis, float overlap_y_axis, uint layer, hailo_tiling_mode_t tiling_mode)
 {
     // Calculate the scale for a tile for col and row
     double row_step = 1 / double(tiles_along_y_axis);
@@ -253,9 +308,7 @@ static void prepare_tiles(HailoROIPtr hailo_roi, std::vector<HailoROIPtr> &crop_
             HailoTileROIPtr tile_roi = std::make_shared<HailoTileROI>(create_tile_roi(index, col_overlap, row_overlap,
                                                                                       col_offset, row_offset, (col_offset + col_step), (row_offset + row_step),
                                                                                       layer, tiling_mode));
-            // Add the tile to the result vector and into the main hailo_roi.
-            crop_rois.emplace_back(tile_roi);
-            hailo_roi->add_object(tile_roi);
+            tiles.emplace_back(tile_roi);
 
             col_offset += col_step;
             index++;
@@ -270,6 +323,8 @@ static void prepare_tiles(HailoROIPtr hailo_roi, std::vector<HailoROIPtr> &crop_
  * overrides hailocropper base functionality.
  * prepares vector of tiles in row/column structure (determined by elemnet properties) (HailoTileROI for each tile).
  * adds each one to the main roi. tiles can overlap each other.
+ * In adaptive tiling only the tiles chosen by the scheduler are prepared and added to the main roi,
+ * so the tiles on the main roi (keeping their grid index) are the scheduling decision of the frame.
  *
  * @param[in] hailocropper    cropping element.
  * @param[in] hailo_roi       main HailoROI taken from the buffer.
@@ -283,7 +338,7 @@ static std::vector<HailoROIPtr> gst_hailotilecropper_prepare_crops(GstHailoBaseC
     HailoROIPtr hailo_roi = get_hailo_main_roi(buf, true);
 
     // Calculate the total number of tiles
-    uint total_num_of_tiles = hailotilecropper->tiles_along_x_axis * hailotilecropper->tiles_along_x_axis;
+    uint total_num_of_tiles = hailotilecropper->tiles_along_x_axis * hailotilecropper->tiles_along_y_axis;
     uint num_of_scales = hailotilecropper->multi_scale_level;
 
     if (hailotilecropper->tiling_mode == MULTI_SCALE)
@@ -293,17 +348,52 @@ static std::vector<HailoROIPtr> gst_hailotilecropper_prepare_crops(GstHailoBaseC
             total_num_of_tiles += (scales_template[i][0] * scales_template[i][1]);
     }
 
-    std::vector<HailoROIPtr> crop_rois;
-    crop_rois.reserve(total_num_of_tiles);
+    std::vector<HailoTileROIPtr> tiles;
+    tiles.reserve(total_num_of_tiles);
 
     // Prepare tiles for the main scale
-    prepare_tiles(hailo_roi, crop_rois, hailotilecropper->tiles_along_x_axis, hailotilecropper->tiles_along_y_axis,
+    prepare_tiles(tiles, hailotilecropper->tiles_along_x_axis, hailotilecropper->tiles_along_y_axis,
                   hailotilecropper->overlap_x_axis, hailotilecropper->overlap_y_axis, 0, hailotilecropper->tiling_mode);
 
     // Prepare tiles for every scale requsted as multi scale
     if (hailotilecropper->tiling_mode == MULTI_SCALE)
         for (uint i = 0; i < num_of_scales; i++)
-            prepare_tiles(hailo_roi, crop_rois, scales_template[i][0], scales_template[i][1], hailotilecropper->overlap_x_axis, hailotilecropper->overlap_y_axis, (i + 1), (hailo_tiling_mode_t)hailotilecropper->tiling_mode);
+            prepare_tiles(tiles, scales_template[i][0], scales_template[i][1], hailotilecropper->overlap_x_axis, hailotilecropper->overlap_y_axis, (i + 1), (hailo_tiling_mode_t)hailotilecropper->tiling_mode);
+
+    std::vector<bool> scheduled(tiles.size(), true);
+    if (hailotilecropper->adaptive_tiling)
+    {
+        std::vector<HailoBBox> tile_boxes;
+        tile_boxes.reserve(tiles.size());
+        for (HailoTileROIPtr &tile : tiles)
+            tile_boxes.emplace_back(tile->get_bbox());
+
+        std::shared_ptr<HailoMat> image;
+        if (hailotilecropper->scheduler_params.motion_threshold > 0)
+        {
+            GstCaps *caps = gst_pad_get_current_caps(hailocropper->sinkpad);
+            GstVideoInfo *info = gst_video_info_new();
+            gst_video_info_from_caps(info, caps);
+            image = get_mat_by_format(buf, info);
+            gst_video_info_free(info);
+            gst_caps_unref(caps);
+        }
+        scheduled = hailotilecropper->scheduler->schedule(hailo_roi->get_stream_id(), hailo_roi, tile_boxes,
+                                                          image ? &image->get_matrices()[0] : nullptr,
+                                                          hailotilecropper->scheduler_params);
+    }
+
+    // Add the scheduled tiles to the result vector and into the main hailo_roi.
+    std::vector<HailoROIPtr> crop_rois;
+    crop_rois.reserve(tiles.size());
+    for (size_t i = 0; i < tiles.size(); i++)
+    {
+        if (!scheduled[i])
+            continue;
+        crop_rois.emplace_back(tiles[i]);
+        hailo_roi->add_object(tiles[i]);
+    }
+    GST_LOG_OBJECT(hailotilecropper, "Scheduled %zu of %zu tiles", crop_rois.size(), tiles.size());
 
     return crop_rois;
 }
@@ -10,8 +10,10 @@
 #pragma once
 
 #include <gst/gst.h>
+#include <memory>
 #include "cropping/gsthailobasecropper.hpp"
 #include "hailo_objects.hpp"
+#include "tiling/tile_scheduler.hpp"
 
 G_BEGIN_DECLS
 
@@ -34,6 +36,9 @@ struct _GstHailoTileCropper
     gfloat overlap_y_axis;
     guint multi_scale_level;
     hailo_tiling_mode_t tiling_mode;
+    gboolean adaptive_tiling;
+    TileSchedulerParams scheduler_params;
+    std::unique_ptr<TileScheduler> scheduler;
 };
 
 struct _GstHailoTileCropperClass
@@ -0,0 +1,257 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "hailo_objects.hpp"
+#include "hailo_common.hpp"
+#include "hailo_nms.hpp"
+
+// Spatial hash cells along each side of the smallest tile, and the bounds of the grid per axis
+#define TILE_MERGE_CELLS_PER_TILE (4)
+#define TILE_MERGE_MIN_CELLS (1)
+#define TILE_MERGE_MAX_CELLS (64)
+// Frames whose merge state is kept when their aggregation never finishes (e.g. flushed frames)
+#define TILE_MERGE_MAX_FRAMES (64)
+
+typedef enum
+{
+    TILE_MERGE_NMS,
+    TILE_MERGE_WBF,
+} tile_merge_mode_t;
+
+/**
+ * @brief Merges the detections of the tiles of a frame, tile by tile as the tiles arrive.
+ *
+ *        Every detection is put in a spatial hash whose cells are a fraction of the smallest tile of the frame,
+ *        in all the cells its box touches. When a detection arrives it is only compared with the detections
+ *        of the same class that share a cell with it - the ones near the same tile borders, or from the
+ *        overlapping tiles of the other scales. The overlaps found are kept as a graph, so finishing the
+ *        frame only resolves the graph greedily by score, which gives the same result as NMS over the whole frame.
+ *        In TILE_MERGE_WBF mode the boxes a detection suppresses are fused into it (weighted box fusion):
+ *        its box becomes the confidence weighted average of the boxes, and it keeps its confidence.
+ *        Frames are told apart by their main ROI, a tile of a frame is only added by one thread at a time.
+ */
+class TileMerger
+{
+private:
+    struct FrameState
+    {
+        HailoROIPtr main_roi;
+        uint64_t sequence = 0;
+        int cols = 0;
+        int rows = 0;
+        std::vector<std::vector<uint32_t>> cells;
+        std::vector<HailoDetectionPtr> detections;
+        std::vector<float> scores;
+        std::vector<std::vector<uint32_t>> overlaps;
+        std::vector<uint32_t> visited;
+        std::unordered_map<HailoDetection *, uint32_t> index_of;
+    };
+
+    std::map<HailoROI *, FrameState> m_frames;
+    std::mutex m_mutex;
+    uint64_t m_sequence = 0;
+
+    FrameState &get_frame(HailoROIPtr main_roi)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_frames.find(main_roi.get());
+        if (it != m_frames.end())
+            return it->second;
+
+        // Drop the oldest frame if too many never finished
+        if (m_frames.size() >= TILE_MERGE_MAX_FRAMES)
+        {
+            auto oldest = std::min_element(m_frames.begin(), m_frames.end(),
+                                           [](const std::pair<HailoROI *const, FrameState> &a, const std::pair<HailoROI *const, FrameState> &b)
+                                           { return a.second.sequence < b.second.sequence; });
+            m_frames.erase(oldest);
+        }
+
+        FrameState &frame = m_frames[main_roi.get()];
+        frame.main_roi = main_roi;
+        frame.sequence = m_sequence++;
+        // Cells follow the smallest tile, so a detection is only compared within the tiles around it
+        float cell_width = 1.0f, cell_height = 1.0f;
+        for (HailoTileROIPtr &tile : hailo_common::get_hailo_tiles(main_roi))
+        {
+            cell_width = std::min(cell_width, tile->get_bbox().width());
+            cell_height = std::min(cell_height, tile->get_bbox().height());
+        }
+        frame.cols = CLAMP(int(std::ceil(TILE_MERGE_CELLS_PER_TILE / std::max(cell_width, 1e-3f))), TILE_MERGE_MIN_CELLS, TILE_MERGE_MAX_CELLS);
+        frame.rows = CLAMP(int(std::ceil(TILE_MERGE_CELLS_PER_TILE / std::max(cell_height, 1e-3f))), TILE_MERGE_MIN_CELLS, TILE_MERGE_MAX_CELLS);
+        frame.cells.resize(frame.cols * frame.rows);
+        return frame;
+    }
+
+    static void add_detection(FrameState &frame, HailoDetectionPtr detection, float iou_threshold)
+    {
+        uint32_t index = frame.detections.size();
+        frame.detections.push_back(detection);
+        frame.scores.push_back(detection->get_confidence());
+        frame.overlaps.emplace_back();
+        frame.visited.push_back(UINT32_MAX);
+
+        HailoBBox bbox = detection->get_bbox();
+        int class_id = detection->get_class_id();
+        int x0 = CLAMP(int(bbox.xmin() * frame.cols), 0, frame.cols - 1);
+        int x1 = CLAMP(int(bbox.xmax() * frame.cols), 0, frame.cols - 1);
+        int y0 = CLAMP(int(bbox.ymin() * frame.rows), 0, frame.rows - 1);
+        int y1 = CLAMP(int(bbox.ymax() * frame.rows), 0, frame.rows - 1);
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                std::vector<uint32_t> &cell = frame.cells[y * frame.cols + x];
+                for (uint32_t other : cell)
+                {
+                    // A pair sharing several cells is only compared once
+                    if (frame.visited[other] == index)
+                        continue;
+                    frame.visited[other] = index;
+                    HailoDetectionPtr &other_detection = frame.detections[other];
+                    if (other_detection->get_class_id() != class_id)
+                        continue;
+                    if (hailo_nms::iou(bbox, other_detection->get_bbox()) >= iou_threshold)
+                    {
+                        frame.overlaps[index].push_back(other);
+                        frame.overlaps[other].push_back(index);
+                    }
+                }
+                cell.push_back(index);
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief Add the detections of a tile, already flattened to the main ROI, to the merge of its frame.
+     *
+     * @param main_roi  -  HailoROIPtr
+     *        The main ROI of the frame.
+     *
+     * @param detections  -  const std::vector<HailoDetectionPtr> &
+     *        The detections of the tile, in the coordinates of the main ROI.
+     *
+     * @param iou_threshold  -  float
+     *        Detections of the same class overlapping by at least this IOU are merged.
+     */
+    void add_tile(HailoROIPtr main_roi, const std::vector<HailoDetectionPtr> &detections, float iou_threshold)
+    {
+        FrameState &frame = get_frame(main_roi);
+        for (const HailoDetectionPtr &detection : detections)
+            add_detection(frame, detection, iou_threshold);
+    }
+
+    /**
+     * @brief Finish the merge of a frame - remove the suppressed detections from the main ROI
+     *        (fusing them into the kept ones in TILE_MERGE_WBF mode) and forget the frame.
+     *        Detections of the main ROI that were not added with add_tile are merged too.
+     *
+     * @param main_roi  -  HailoROIPtr
+     *        The main ROI of the frame.
+     *
+     * @param iou_threshold  -  float
+     *        Detections of the same class overlapping by at least this IOU are merged.
+     *
+     * @param mode  -  tile_merge_mode_t
+     *        Suppress (TILE_MERGE_NMS) or fuse (TILE_MERGE_WBF) the merged detections.
+     */
+    void finish_frame(HailoROIPtr main_roi, float iou_threshold, tile_merge_mode_t mode)
+    {
+        FrameState &frame = get_frame(main_roi);
+
+        // Only the detections still on the main ROI take part, in the order of the main ROI
+        std::vector<HailoDetectionPtr> present = hailo_common::get_hailo_detections(main_roi);
+        std::vector<uint32_t> order;
+        order.reserve(present.size());
+        uint32_t added = frame.detections.size();
+        uint32_t next = 0;
+        for (HailoDetectionPtr &detection : present)
+        {
+            // Flattened detections are usually found on the main ROI in the order they were added
+            if (next < added && frame.detections[next] == detection)
+            {
+                order.push_back(next++);
+                continue;
+            }
+            if (frame.index_of.empty())
+            {
+                for (uint32_t index = 0; index < added; index++)
+                    frame.index_of[frame.detections[index].get()] = index;
+            }
+            auto it = frame.index_of.find(detection.get());
+            if (it != frame.index_of.end())
+            {
+                order.push_back(it->second);
+                next = it->second + 1;
+                continue;
+            }
+            order.push_back(frame.detections.size());
+            add_detection(frame, detection, iou_threshold);
+        }
+
+        // Greedy by descending score, ties broken by the order of the main ROI as NMS does.
+        // 0 - not present, 1 - waiting, 2 - kept or suppressed
+        std::vector<uint8_t> state(frame.detections.size(), 0);
+        std::vector<HailoObjectPtr> removed;
+        for (uint32_t index : order)
+            state[index] = 1;
+        const float *scores = frame.scores.data();
+        std::stable_sort(order.begin(), order.end(), [scores](uint32_t a, uint32_t b)
+                         { return scores[a] > scores[b]; });
+
+        for (uint32_t index : order)
+        {
+            if (state[index] != 1)
+                continue;
+            state[index] = 2;
+            HailoDetectionPtr &kept = frame.detections[index];
+            float weight = scores[index];
+            HailoBBox bbox = kept->get_bbox();
+            float xmin = bbox.xmin() * weight, ymin = bbox.ymin() * weight;
+            float xmax = bbox.xmax() * weight, ymax = bbox.ymax() * weight;
+            bool fused = false;
+            for (uint32_t other : frame.overlaps[index])
+            {
+                // A waiting overlapping detection has a lower score, a higher one would have suppressed this one
+                if (state[other] != 1)
+                    continue;
+                state[other] = 2;
+                HailoDetectionPtr &suppressed = frame.detections[other];
+                if (mode == TILE_MERGE_WBF)
+                {
+                    float other_weight = scores[other];
+                    HailoBBox other_bbox = suppressed->get_bbox();
+                    xmin += other_bbox.xmin() * other_weight;
+                    ymin += other_bbox.ymin() * other_weight;
+                    xmax += other_bbox.xmax() * other_weight;
+                    ymax += other_bbox.ymax() * other_weight;
+                    weight += other_weight;
+                    fused = true;
+                }
+                removed.push_back(suppressed);
+            }
+            if (fused && weight > 0.0f)
+                kept->set_bbox(HailoBBox(xmin / weight, ymin / weight, (xmax - xmin) / weight, (ymax - ymin) / weight));
+        }
+        hailo_common::remove_objects(main_roi, std::move(removed));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frames.erase(main_roi.get());
+    }
+
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frames.clear();
+    }
+};
@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "hailo_objects.hpp"
+#include "hailo_common.hpp"
+
+// Resolution of the motion map, and the change of a motion map pixel that counts as motion
+#define TILE_SCHEDULER_MOTION_MAP_WIDTH (64)
+#define TILE_SCHEDULER_MOTION_MAP_HEIGHT (36)
+#define TILE_SCHEDULER_MOTION_PIXEL_THRESHOLD (20)
+// Frames whose detections keep tiles active
+#define TILE_SCHEDULER_HISTORY (3)
+
+struct TileSchedulerParams
+{
+    uint full_sweep_period; // Every full_sweep_period frames of a stream all the tiles are scheduled
+    float margin;           // Margin (fraction of the frame) added around recent detections
+    float motion_threshold; // Fraction of a tile's motion map that must change to schedule it, 0 disables the motion map
+};
+
+/**
+ * @brief Chooses the tiles worth running inference on, per stream.
+ *
+ *        A tile is scheduled when it intersects a detection of the last TILE_SCHEDULER_HISTORY frames
+ *        (grown by the margin), or, when a motion threshold is set, when enough of it changed since the previous frame.
+ *        The detections are read from the main ROIs of the previous frames, where the tile aggregator
+ *        (and a tracker placed after it, with its predicted boxes) leaves them.
+ *        Frames whose aggregation did not finish yet contribute what is already there.
+ *        Every full_sweep_period frames all the tiles are scheduled, so new objects are found.
+ */
+class TileScheduler
+{
+private:
+    struct StreamState
+    {
+        uint64_t frame = 0;
+        std::deque<HailoROIPtr> history;
+        cv::Mat motion_map;
+    };
+    std::map<std::string, StreamState> m_streams;
+
+    static bool intersects(const HailoBBox &a, const HailoBBox &b, float margin)
+    {
+        return a.xmin() - margin < b.xmax() && b.xmin() < a.xmax() + margin &&
+               a.ymin() - margin < b.ymax() && b.ymin() < a.ymax() + margin;
+    }
+
+    // Update the motion map of a stream, returning the map of changed pixels (empty on the first frame)
+    static cv::Mat update_motion(StreamState &state, const cv::Mat &plane)
+    {
+        cv::Mat small, gray;
+        cv::resize(plane, small, cv::Size(TILE_SCHEDULER_MOTION_MAP_WIDTH, TILE_SCHEDULER_MOTION_MAP_HEIGHT), 0, 0, cv::INTER_AREA);
+        // The first channel is luma (NV12, YUY2) or close enough to it (RGB) for motion
+        if (small.channels() > 1)
+            cv::extractChannel(small, gray, 0);
+        else
+            gray = small;
+
+        cv::Mat changed;
+        if (!state.motion_map.empty())
+        {
+            cv::absdiff(gray, state.motion_map, changed);
+            cv::threshold(changed, changed, TILE_SCHEDULER_MOTION_PIXEL_THRESHOLD, 1, cv::THRESH_BINARY);
+        }
+        state.motion_map = gray;
+        return changed;
+    }
+
+    static float changed_fraction(const cv::Mat &changed, const HailoBBox &tile)
+    {
+        int x0 = CLAMP(int(tile.xmin() * changed.cols), 0, changed.cols - 1);
+        int y0 = CLAMP(int(tile.ymin() * changed.rows), 0, changed.rows - 1);
+        int x1 = CLAMP(int(std::ceil(tile.xmax() * changed.cols)), x0 + 1, changed.cols);
+        int y1 = CLAMP(int(std::ceil(tile.ymax() * changed.rows)), y0 + 1, changed.rows);
+        cv::Mat region = changed(cv::Rect(x0, y0, x1 - x0, y1 - y0));
+        return float(cv::countNonZero(region)) / float(region.total());
+    }
+
+public:
+    /**
+     * @brief Choose the tiles to schedule in a frame.
+     *
+     * @param stream_id  -  const std::string &
+     *        The stream of the frame.
+     *
+     * @param roi  -  HailoROIPtr
+     *        The main ROI of the frame, remembered to read its detections in the next frames.
+     *
+     * @param tiles  -  const std::vector<HailoBBox> &
+     *        The boxes of all the tiles of the frame.
+     *
+     * @param plane  -  const cv::Mat *
+     *        The first plane of the frame for the motion map, nullptr when the motion map is disabled.
+     *
+     * @param params  -  const TileSchedulerParams &
+     *        The scheduling parameters.
+     *
+     * @return std::vector<bool>
+     *         For every tile, whether it is scheduled.
+     */
+    std::vector<bool> schedule(const std::string &stream_id, HailoROIPtr roi, const std::vector<HailoBBox> &tiles,
+                               const cv::Mat *plane, const TileSchedulerParams &params)
+    {
+        StreamState &state = m_streams[stream_id];
+        bool full_sweep = state.history.empty() || params.full_sweep_period <= 1 || (state.frame % params.full_sweep_period) == 0;
+        state.frame++;
+
+        cv::Mat changed;
+        if (plane && params.motion_threshold > 0.0f)
+            changed = update_motion(state, *plane);
+
+        std::vector<bool> scheduled(tiles.size(), full_sweep);
+        if (!full_sweep)
+        {
+            for (HailoROIPtr &past_roi : state.history)
+            {
+                for (HailoDetectionPtr &detection : hailo_common::get_hailo_detections(past_roi))
+                {
+                    HailoBBox bbox = detection->get_bbox();
+                    for (size_t i = 0; i < tiles.size(); i++)
+                        scheduled[i] = scheduled[i] || intersects(bbox, tiles[i], params.margin);
+                }
+            }
+            if (!changed.empty())
+            {
+                for (size_t i = 0; i < tiles.size(); i++)
+                    scheduled[i] = scheduled[i] || changed_fraction(changed, tiles[i]) >= params.motion_threshold;
+            }
+        }
+
+        state.history.push_back(roi);
+        if (state.history.size() > TILE_SCHEDULER_HISTORY)
+            state.history.pop_front();
+        return scheduled;
+    }
+
+    void reset() { m_streams.clear(); }
+};
@@ -51,8 +51,27 @@ enum
     PROP_STD_WEIGHT_VELOCITY_BOX,
     PROP_DEBUG,
     PROP_HAILO_OBJECTS_BLACKLIST,
+    PROP_ASSIGNMENT_SOLVER,
 };
 
+#define GST_TYPE_HAILO_TRACKER_ASSIGNMENT_SOLVER (gst_hailo_tracker_assignment_solver_get_type())
+static GType
+gst_hailo_tracker_assignment_solver_get_type(void)
+{
+    static GType hailo_tracker_assignment_solver_type = 0;
+    static const GEnumValue hailo_tracker_assignment_solver_types[] = {
+        {ASSIGNMENT_SOLVER_LAPJV, "Jonker-Volgenant over the whole cost matrix (optimal)", "lapjv"},
+        {ASSIGNMENT_SOLVER_LAPJV_GATED, "Jonker-Volgenant over each group of objects that pass the gate (optimal, cheaper on sparse scenes)", "lapjv-gated"},
+        {ASSIGNMENT_SOLVER_GREEDY, "Cheapest pairs first (approximate, fastest on crowded scenes)", "greedy"},
+        {0, NULL, NULL},
+    };
+    if (!hailo_tracker_assignment_solver_type)
+    {
+        hailo_tracker_assignment_solver_type = g_enum_register_static("GstHailoTrackerAssignmentSolver", hailo_tracker_assignment_solver_types);
+    }
+    return hailo_tracker_assignment_solver_type;
+}
+
 //******************************************************************
 // PAD TEMPLATES
 //******************************************************************
@@ -189,6 +208,14 @@ gst_hailo_tracker_class_init(GstHailoTrackerClass *klass)
                                     g_param_spec_string("hailo-objects-blacklist", "Hailo objects blacklist",
                                                         "list of hailo objects types that the tracker should not keep, comma separated", "hailo_landmarks,hailo_depth_mask,hailo_class_mask",
                                                         (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_ASSIGNMENT_SOLVER,
+                                    g_param_spec_enum("assignment-solver", "Assignment solver",
+                                                      "Solver used to match tracked objects with new detections. \n\
+                                    lapjv (default) - optimal assignment over the whole cost matrix. \n\
+                                    lapjv-gated - optimal assignment, solved separately for each group of objects that can be matched (within the thresholds), faster when objects are spread out. \n\
+                                    greedy - matches the closest pairs first, approximate but fastest on crowded scenes.",
+                                                      GST_TYPE_HAILO_TRACKER_ASSIGNMENT_SOLVER, DEFAULT_ASSIGNMENT_SOLVER,
+                                                      (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
     // Set virtual functions
     gobject_class->dispose = gst_hailo_tracker_dispose;
     base_transform_class->stop = GST_DEBUG_FUNCPTR(gst_hailo_tracker_stop);
@@ -214,6 +241,8 @@ gst_hailo_tracker_init(GstHailoTracker *hailotracker)
     hailotracker->tracker_params.std_weight_velocity_box = DEFAULT_STD_WEIGHT_VELOCITY_BOX;
     hailotracker->tracker_params.debug = DEFAULT_DEBUG;
     hailotracker->tracker_params.hailo_objects_blacklist = DEFAULT_HAILO_OBJECTS_BLACKLIST;
+    hailotracker->tracker_params.assignment_solver = DEFAULT_ASSIGNMENT_SOLVER;
+    hailotracker->tracker_handles = std::make_unique<std::map<std::string, HailoTrackerHandle>>();
 }
 
 //******************************************************************
@@ -228,66 +257,14 @@ static std::string get_tracker_name(GstHailoTracker *hailotracker, std::string s
 
 void update_active_trackers(GstHailoTracker *hailotracker, guint property_id)
 {
+    // The class id is applied by the element itself
+    if (property_id == PROP_CLASS_ID)
+        return;
+    // Publish the new parameters, each tracker applies them on its next update
     for (auto &stream_id : hailotracker->active_streams)
     {
         std::string tracker_name = get_tracker_name(hailotracker, stream_id);
-        switch (property_id)
-        {
-        case PROP_KALMAN_DIST_THR:
-            HailoTracker::GetInstance().set_kalman_distance(tracker_name,
-                                                            hailotracker->tracker_params.kalman_distance);
-            break;
-        case PROP_IOU_THR:
-            HailoTracker::GetInstance().set_iou_threshold(tracker_name,
-                                                          hailotracker->tracker_params.iou_threshold);
-            break;
-        case PROP_INIT_IOU_THR:
-            HailoTracker::GetInstance().set_init_iou_threshold(tracker_name,
-                                                               hailotracker->tracker_params.init_iou_threshold);
-            break;
-        case PROP_KEEP_TRACKED_FRAMES:
-            HailoTracker::GetInstance().set_keep_tracked_frames(tracker_name,
-                                                                hailotracker->tracker_params.keep_tracked_frames);
-            break;
-        case PROP_KEEP_NEW_FRAMES:
-            HailoTracker::GetInstance().set_keep_new_frames(tracker_name,
-                                                            hailotracker->tracker_params.keep_new_frames);
-            break;
-        case PROP_KEEP_LOST_FRAMES:
-            HailoTracker::GetInstance().set_keep_lost_frames(tracker_name,
-                                                             hailotracker->tracker_params.keep_lost_frames);
-            break;
-        case PROP_KEEP_PAST_METADATA:
-            HailoTracker::GetInstance().set_keep_past_metadata(tracker_name,
-                                                               hailotracker->tracker_params.keep_past_metadata);
-            break;
-        case PROP_STD_WEIGHT_POSITION:
-            HailoTracker::GetInstance().set_std_weight_position(tracker_name,
-                                                                hailotracker->tracker_params.std_weight_position);
-            break;
-        case PROP_STD_WEIGHT_POSITION_BOX:
-            HailoTracker::GetInstance().set_std_weight_position_box(tracker_name,
-                                                                    hailotracker->tracker_params.std_weight_position_box);
-            break;
-        case PROP_STD_WEIGHT_VELOCITY:
-            HailoTracker::GetInstance().set_std_weight_velocity(tracker_name,
-                                                                hailotracker->tracker_params.std_weight_velocity);
-            break;
-        case PROP_STD_WEIGHT_VELOCITY_BOX:
-            HailoTracker::GetInstance().set_std_weight_velocity_box(tracker_name,
-                                                                    hailotracker->tracker_params.std_weight_velocity_box);
-            break;
-        case PROP_HAILO_OBJECTS_BLACKLIST:
-            HailoTracker::GetInstance().set_hailo_objects_blacklist(tracker_name,
-                                                                    hailotracker->tracker_params.hailo_objects_blacklist);
-            break;
-        case PROP_DEBUG:
-            HailoTracker::GetInstance().set_debug(tracker_name,
-                                                  hailotracker->tracker_params.debug);
-            break;
-        default:
-            break;
-        }
+        HailoTracker::GetInstance().set_params(tracker_name, hailotracker->tracker_params);
     }
 }
 
@@ -364,6 +341,9 @@ void gst_hailo_tracker_set_property(GObject *object, guint property_id,
         hailotracker->tracker_params.hailo_objects_blacklist = std::move(hailo_objects_blacklist_vec);
         break;
     }
+    case PROP_ASSIGNMENT_SOLVER:
+        hailotracker->tracker_params.assignment_solver = (assignment_solver_t)g_value_get_enum(value);
+        break;
 
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
@@ -433,6 +413,9 @@ void gst_hailo_tracker_get_property(GObject *object, guint property_id,
         g_value_set_string(value, blacklist.c_str());
         break;
     }
+    case PROP_ASSIGNMENT_SOLVER:
+        g_value_set_enum(value, hailotracker->tracker_params.assignment_solver);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -452,6 +435,7 @@ void gst_hailo_tracker_dispose(GObject *object)
 
     /* clean up as possible.  may be called multiple times */
     g_free(hailotracker->current_stream_id);
+    hailotracker->tracker_handles.reset();
 
     G_OBJECT_CLASS(gst_hailo_tracker_parent_class)->dispose(object);
 }
@@ -466,6 +450,9 @@ gst_hailo_tracker_stop(GstBaseTransform *trans)
         std::string tracker_name = get_tracker_name(hailotracker, stream_id);
         HailoTracker::GetInstance().remove_jde_tracker(tracker_name);
     }
+    GST_OBJECT_LOCK(hailotracker);
+    hailotracker->tracker_handles->clear();
+    GST_OBJECT_UNLOCK(hailotracker);
 
     GST_DEBUG_OBJECT(hailotracker, "stop");
 
@@ -505,13 +492,25 @@ gst_hailo_tracker_transform_frame_ip(GstVideoFilter *filter, GstVideoFrame *fram
         }
     }
 
-    // Swap the detections in the roi with just the online tracked detections
+    // Resolve the tracker of the stream once, later frames reuse its handle until the tracker is removed
+    HailoTrackerHandle tracker;
     GST_OBJECT_LOCK(hailotracker);
-    std::string tracker_name = get_tracker_name(hailotracker, std::string(stream_id));
-    std::vector<HailoDetectionPtr> online_detection_ptrs = HailoTracker::GetInstance().update(tracker_name, detections);
+    auto tracker_handle = hailotracker->tracker_handles->find(stream_id);
+    if (tracker_handle != hailotracker->tracker_handles->end() && !HailoTracker::GetInstance().is_removed(tracker_handle->second))
+    {
+        tracker = tracker_handle->second;
+    }
+    else
+    {
+        tracker = HailoTracker::GetInstance().get_jde_tracker(get_tracker_name(hailotracker, stream_id));
+        (*hailotracker->tracker_handles)[stream_id] = tracker;
+    }
+    GST_OBJECT_UNLOCK(hailotracker);
 
+    // Swap the detections in the roi with just the online tracked detections
+    // The tracker is updated under its own lock, so streams of other trackers are not blocked
+    std::vector<HailoDetectionPtr> online_detection_ptrs = HailoTracker::GetInstance().update(tracker, detections);
     hailo_common::add_detection_pointers(hailo_roi, online_detection_ptrs);
-    GST_OBJECT_UNLOCK(hailotracker);
 
     GST_DEBUG_OBJECT(hailotracker, "transform_frame_ip");
     return GST_FLOW_OK;
@@ -46,6 +46,8 @@ struct _GstHailoTracker
     gint class_id;
     HailoTrackerParams tracker_params;
     std::vector<std::string> active_streams;
+    // Trackers resolved by stream id, so frames do not look them up by name
+    std::unique_ptr<std::map<std::string, HailoTrackerHandle>> tracker_handles;
 };
 
 struct _GstHailoTrackerClass
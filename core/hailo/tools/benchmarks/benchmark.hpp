@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file benchmark.hpp
+ * @authors Hailo
+ *
+ * Timing helpers shared by the benchmarks. Each benchmark runs synthetic inputs, so it needs no device,
+ * and prints one row per case with the median and tail times of the code under test.
+ **/
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace benchmark
+{
+    using clock = std::chrono::steady_clock;
+
+    inline double elapsed_us(clock::time_point begin, clock::time_point end = clock::now())
+    {
+        return std::chrono::duration<double, std::micro>(end - begin).count();
+    }
+
+    /**
+     * @brief Time iterations calls of run, after a few warm-up calls.
+     *
+     * @param iterations  -  size_t
+     *        Number of timed calls.
+     *
+     * @param run  -  callable
+     *        Called with the iteration index.
+     *
+     * @return std::vector<double> - The time of every call in microseconds, sorted.
+     */
+    template <typename Run>
+    std::vector<double> measure(size_t iterations, Run &&run)
+    {
+        for (size_t i = 0; i < std::min<size_t>(3, iterations); i++)
+            run(i);
+        std::vector<double> times;
+        times.reserve(iterations);
+        for (size_t i = 0; i < iterations; i++)
+        {
+            clock::time_point begin = clock::now();
+            run(i);
+            times.push_back(elapsed_us(begin));
+        }
+        std::sort(times.begin(), times.end());
+        return times;
+    }
+
+    inline double percentile(const std::vector<double> &sorted, double fraction)
+    {
+        if (sorted.empty())
+            return 0.0;
+        return sorted[std::min(sorted.size() - 1, size_t(fraction * sorted.size()))];
+    }
+
+    inline void print_header(const char *title)
+    {
+        printf("\n%s\n%-44s %12s %12s %12s\n", title, "case", "p50 [us]", "p90 [us]", "p99 [us]");
+    }
+
+    inline void print_row(const std::string &name, const std::vector<double> &sorted)
+    {
+        printf("%-44s %12.2f %12.2f %12.2f\n", name.c_str(), percentile(sorted, 0.5), percentile(sorted, 0.9), percentile(sorted, 0.99));
+    }
+}
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file gallery_index_benchmark.cpp
+ * @authors Hailo
+ *
+ * Search time of the gallery index for growing galleries of random 512-float embeddings, against the
+ * per-embedding scan the gallery used to run (every stored embedding copied out and dotted on its own).
+ * Queries are noisy copies of stored embeddings, so the expected answer is known and the recall of the
+ * approximate IVF index is reported next to its time.
+ **/
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gallery/gallery_index.hpp"
+#include "benchmark.hpp"
+
+#define EMBEDDING_SIZE (512)
+
+// The previous search: the closest embedding by cosine similarity, each embedding copied before the dot product
+static uint reference_closest(const std::vector<std::vector<float>> &embeddings, const std::vector<float> &query)
+{
+    float max_similarity = 0.0f;
+    uint closest = 0;
+    for (size_t i = 0; i < embeddings.size(); i++)
+    {
+        std::vector<float> embedding = embeddings[i];
+        float similarity = 0.0f;
+        for (size_t k = 0; k < embedding.size(); k++)
+            similarity += embedding[k] * query[k];
+        if (similarity > max_similarity)
+        {
+            max_similarity = similarity;
+            closest = i;
+        }
+    }
+    return closest + 1;
+}
+
+static std::vector<float> random_embedding(std::mt19937 &rng)
+{
+    std::normal_distribution<float> normal;
+    std::vector<float> embedding(EMBEDDING_SIZE);
+    float norm = 0.0f;
+    for (float &value : embedding)
+    {
+        value = normal(rng);
+        norm += value * value;
+    }
+    norm = std::sqrt(norm);
+    for (float &value : embedding)
+        value /= norm;
+    return embedding;
+}
+
+int main()
+{
+    const size_t num_queries = 200;
+    std::mt19937 rng(11);
+    std::normal_distribution<float> noise(0.0f, 0.02f);
+    size_t answer = 0;
+    benchmark::print_header("Gallery search, reference scan vs flat and ivf index (512 floats per embedding)");
+    for (size_t num_ids : {1000, 10000, 50000})
+    {
+        std::vector<std::vector<float>> embeddings;
+        GalleryIndex flat(GALLERY_INDEX_FLAT, 1);
+        GalleryIndex ivf(GALLERY_INDEX_IVF, 1);
+        for (size_t i = 0; i < num_ids; i++)
+        {
+            embeddings.push_back(random_embedding(rng));
+            flat.add(flat.create_id(), embeddings.back().data(), EMBEDDING_SIZE);
+            ivf.add(ivf.create_id(), embeddings.back().data(), EMBEDDING_SIZE);
+        }
+        std::vector<std::vector<float>> queries;
+        std::vector<uint> expected;
+        for (size_t q = 0; q < num_queries; q++)
+        {
+            uint id = uint(rng() % num_ids);
+            queries.push_back(embeddings[id]);
+            for (float &value : queries.back())
+                value += noise(rng);
+            expected.push_back(id + 1);
+        }
+
+        auto reference_times = benchmark::measure(num_queries, [&](size_t q)
+                                                  { answer += reference_closest(embeddings, queries[q]); });
+        auto flat_times = benchmark::measure(num_queries, [&](size_t q)
+                                             { answer += flat.closest(queries[q].data(), EMBEDDING_SIZE).first; });
+        auto ivf_times = benchmark::measure(num_queries, [&](size_t q)
+                                            { answer += ivf.closest(queries[q].data(), EMBEDDING_SIZE).first; });
+        auto recall = [&](GalleryIndex &index)
+        {
+            size_t hits = 0;
+            for (size_t q = 0; q < num_queries; q++)
+                hits += index.closest(queries[q].data(), EMBEDDING_SIZE).first == expected[q];
+            return " recall " + std::to_string(100 * hits / num_queries) + "%";
+        };
+        std::string name = std::to_string(num_ids) + " ids";
+        benchmark::print_row(name + " reference", reference_times);
+        benchmark::print_row(name + " flat" + recall(flat), flat_times);
+        benchmark::print_row(name + " ivf" + recall(ivf), ivf_times);
+    }
+    // Keeps the searches from being optimized out
+    return answer == 0 ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file metadata_serialization_benchmark.cpp
+ * @authors Hailo
+ *
+ * Message size and encode / decode time of the JSON and binary metadata formats of hailoexportzmq /
+ * hailoimportzmq, on synthetic frames with and without segmentation masks. Both formats go through the same
+ * steps as the elements: the JSON document is written to a string and parsed back, the binary message is
+ * measured, written in place and decoded without copying its payloads.
+ * The JSON decoder does not rebuild masks and matrices, it only parses them.
+ **/
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "export/encode_json.hpp"
+#include "export/encode_binary.hpp"
+#include "import/decode_json.hpp"
+#include "import/decode_binary.hpp"
+#include "rapidjson/writer.h"
+#include "benchmark.hpp"
+
+struct FrameContent
+{
+    const char *name;
+    size_t num_detections;
+    int instance_mask_size; // Side of the confidence mask of every detection, 0 for none
+    int semantic_mask_size; // Side of the class mask of the frame, 0 for none
+    size_t embedding_size;  // Length of the embedding of every detection, 0 for none
+};
+
+static HailoROIPtr make_frame(const FrameContent &content, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f));
+    for (size_t i = 0; i < content.num_detections; i++)
+    {
+        HailoDetectionPtr detection = hailo_common::add_detection(roi, HailoBBox(unit(rng) * 0.8f, unit(rng) * 0.8f, 0.1f, 0.2f), "person", unit(rng), 1);
+        hailo_common::add_classification(detection, "color", "red", unit(rng), 3);
+        detection->add_object(std::make_shared<HailoUniqueID>(int(i)));
+        if (content.instance_mask_size > 0)
+        {
+            std::vector<float> mask(size_t(content.instance_mask_size) * content.instance_mask_size);
+            for (float &value : mask)
+                value = unit(rng);
+            detection->add_object(std::make_shared<HailoConfClassMask>(std::move(mask), content.instance_mask_size, content.instance_mask_size, 0.5f, 1));
+        }
+        if (content.embedding_size > 0)
+        {
+            std::vector<float> embedding(content.embedding_size);
+            for (float &value : embedding)
+                value = unit(rng) - 0.5f;
+            detection->add_object(std::make_shared<HailoMatrix>(std::move(embedding), 1, 1, uint32_t(content.embedding_size)));
+        }
+    }
+    if (content.semantic_mask_size > 0)
+    {
+        std::vector<uint8_t> mask(size_t(content.semantic_mask_size) * content.semantic_mask_size);
+        for (uint8_t &value : mask)
+            value = uint8_t(rng() % 20);
+        roi->add_object(std::make_shared<HailoClassMask>(std::move(mask), content.semantic_mask_size, content.semantic_mask_size, 0.5f));
+    }
+    return roi;
+}
+
+static std::string encode_json_message(HailoROIPtr roi, int64_t timestamp, uint buffer_offset)
+{
+    rapidjson::Document encoded_roi = encode_json::encode_hailo_roi(roi);
+    encoded_roi.AddMember("timestamp (ms)", rapidjson::Value(timestamp), encoded_roi.GetAllocator());
+    encoded_roi.AddMember("buffer_offset", rapidjson::Value(buffer_offset), encoded_roi.GetAllocator());
+    rapidjson::StringBuffer json_buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(json_buffer);
+    encoded_roi.Accept(writer);
+    return std::string(json_buffer.GetString(), json_buffer.GetSize());
+}
+
+// The binary message buffer is 8 byte aligned, as the import element makes sure it is
+static std::shared_ptr<std::vector<uint64_t>> encode_binary_message(HailoROIPtr roi, int64_t timestamp, uint buffer_offset, size_t &size)
+{
+    size = encode_binary::encode_hailo_roi(roi, timestamp, buffer_offset, false);
+    auto message = std::make_shared<std::vector<uint64_t>>((size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    encode_binary::encode_hailo_roi(roi, timestamp, buffer_offset, false, reinterpret_cast<uint8_t *>(message->data()), size);
+    return message;
+}
+
+int main()
+{
+    const size_t iterations = 100;
+    const FrameContent contents[] = {
+        {"20 detections", 20, 0, 0, 0},
+        {"20 detections + 512 embeddings", 20, 0, 0, 512},
+        {"20 detections + 64x64 instance masks", 20, 64, 0, 0},
+        {"640x640 semantic mask", 0, 0, 640, 0},
+    };
+    std::mt19937 rng(3);
+    bool all_decoded = true;
+    printf("\nMessage size per frame\n%-44s %12s %12s\n", "case", "json [B]", "binary [B]");
+    std::vector<HailoROIPtr> frames;
+    for (const FrameContent &content : contents)
+    {
+        frames.push_back(make_frame(content, rng));
+        size_t binary_size = 0;
+        encode_binary_message(frames.back(), 0, 0, binary_size);
+        printf("%-44s %12zu %12zu\n", content.name, encode_json_message(frames.back(), 0, 0).size(), binary_size);
+    }
+
+    benchmark::print_header("Encode and decode per frame, json vs binary");
+    for (size_t c = 0; c < frames.size(); c++)
+    {
+        HailoROIPtr roi = frames[c];
+        std::string name = contents[c].name;
+        std::string json_message;
+        size_t binary_size = 0;
+        std::shared_ptr<std::vector<uint64_t>> binary_message;
+        auto json_encode = benchmark::measure(iterations, [&](size_t i)
+                                              { json_message = encode_json_message(roi, 0, uint(i)); });
+        auto binary_encode = benchmark::measure(iterations, [&](size_t i)
+                                                { binary_message = encode_binary_message(roi, 0, uint(i), binary_size); });
+        auto json_decode = benchmark::measure(iterations, [&](size_t)
+                                              {
+                                                  HailoROIPtr decoded = std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f));
+                                                  rapidjson::Document document;
+                                                  document.Parse(json_message);
+                                                  decode_json::decode_hailo_roi(document, decoded);
+                                              });
+        auto binary_decode = benchmark::measure(iterations, [&](size_t)
+                                                {
+                                                    HailoROIPtr decoded = std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f));
+                                                    bool decoded_ok = decode_binary::decode_hailo_roi(reinterpret_cast<const uint8_t *>(binary_message->data()), binary_size,
+                                                                                                      binary_message, decoded);
+                                                    all_decoded = all_decoded && decoded_ok && decoded->get_objects().size() == roi->get_objects().size();
+                                                });
+        benchmark::print_row(name + " json encode", json_encode);
+        benchmark::print_row(name + " binary encode", binary_encode);
+        benchmark::print_row(name + " json decode", json_decode);
+        benchmark::print_row(name + " binary decode", binary_decode);
+    }
+    return all_decoded ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file nms_benchmark.cpp
+ * @authors Hailo
+ *
+ * Compares hailo_nms::nms with the pairwise NMS that common::nms used to run, on random candidate sets
+ * of the sizes a yolo postprocess produces at low detection thresholds. Both must keep the same boxes.
+ **/
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "hailo_nms.hpp"
+#include "benchmark.hpp"
+
+// The previous common::nms: sort by score, then suppress every later box of the same class over the threshold.
+// The comparator takes its detections by value as it did. The sort is stable so that equal scores are kept
+// in the same order as the engine keeps them.
+static void reference_nms(std::vector<HailoDetection> &objects, const float iou_thr, bool cross_classes)
+{
+    std::vector<HailoDetection> objects_after_nms;
+    std::stable_sort(objects.begin(), objects.end(),
+                     [](HailoDetection a, HailoDetection b)
+                     { return a.get_confidence() > b.get_confidence(); });
+    for (uint index = 0; index < objects.size(); index++)
+    {
+        if (objects[index].get_confidence() == 0.0f)
+            continue;
+        for (uint jindex = index + 1; jindex < objects.size(); jindex++)
+        {
+            if ((cross_classes || objects[index].get_class_id() == objects[jindex].get_class_id()) &&
+                objects[jindex].get_confidence() != 0.0f &&
+                hailo_nms::iou(objects[index].get_bbox(), objects[jindex].get_bbox()) >= iou_thr)
+                objects[jindex].set_confidence(0.0f);
+        }
+    }
+    for (HailoDetection &object : objects)
+    {
+        if (object.get_confidence() != 0.0f)
+            objects_after_nms.push_back(object);
+    }
+    objects = objects_after_nms;
+}
+
+// Candidates cluster around a few objects, as anchors of neighbouring cells do
+static std::vector<HailoDetection> make_candidates(size_t count, int num_classes, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float> jitter(0.0f, 0.01f);
+    size_t num_objects = std::max<size_t>(1, count / 20);
+    std::vector<HailoBBox> objects;
+    for (size_t i = 0; i < num_objects; i++)
+        objects.emplace_back(unit(rng) * 0.85f, unit(rng) * 0.85f, 0.02f + unit(rng) * 0.12f, 0.02f + unit(rng) * 0.12f);
+    std::vector<HailoDetection> candidates;
+    candidates.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const HailoBBox &object = objects[i % num_objects];
+        HailoBBox bbox(object.xmin() + jitter(rng), object.ymin() + jitter(rng), object.width() * (1.0f + jitter(rng)), object.height() * (1.0f + jitter(rng)));
+        int class_id = int(i % num_objects) % num_classes + 1;
+        candidates.emplace_back(bbox, class_id, "object", 0.1f + 0.9f * unit(rng));
+    }
+    return candidates;
+}
+
+static bool same_survivors(std::vector<HailoDetection> &a, std::vector<HailoDetection> &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].get_confidence() != b[i].get_confidence() || a[i].get_bbox().xmin() != b[i].get_bbox().xmin())
+            return false;
+    }
+    return true;
+}
+
+int main()
+{
+    const size_t iterations = 50;
+    std::mt19937 rng(7);
+    bool all_match = true;
+    benchmark::print_header("NMS, reference pairwise scan vs hailo_nms engine");
+    for (size_t count : {100, 1000, 10000, 20000})
+    {
+        for (bool cross_classes : {false, true})
+        {
+            const std::vector<HailoDetection> candidates = make_candidates(count, 80, rng);
+            const float iou_thr = 0.5f;
+            std::vector<HailoDetection> reference, engine;
+            // The reference is quadratic, fewer runs keep the largest cases short
+            size_t reference_iterations = count > 5000 ? 3 : iterations;
+            auto reference_times = benchmark::measure(reference_iterations, [&](size_t)
+                                                      { reference = candidates; reference_nms(reference, iou_thr, cross_classes); });
+            auto engine_times = benchmark::measure(iterations, [&](size_t)
+                                                   { engine = candidates; hailo_nms::nms(engine, hailo_nms::NmsConfig{iou_thr, cross_classes}); });
+            auto top_k_times = benchmark::measure(iterations, [&](size_t)
+                                                  { std::vector<HailoDetection> top = candidates; hailo_nms::nms(top, hailo_nms::NmsConfig{iou_thr, cross_classes, 100}); });
+            bool match = same_survivors(reference, engine);
+            all_match = all_match && match;
+            std::string name = std::to_string(count) + (cross_classes ? " cross-class" : " per-class");
+            benchmark::print_row(name + " reference", reference_times);
+            benchmark::print_row(name + " engine" + (match ? "" : " (MISMATCH)"), engine_times);
+            benchmark::print_row(name + " engine top-100", top_k_times);
+        }
+    }
+    return all_match ? 0 : 1;
+}
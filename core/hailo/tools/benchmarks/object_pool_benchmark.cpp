@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file object_pool_benchmark.cpp
+ * @authors Hailo
+ *
+ * Cost of building and releasing the metadata of a frame with std::make_shared against the pooled
+ * hailo_common helpers. Every frame gets 100 detections with one classification each, like a detection
+ * postprocess followed by a classifier, and is released either on the thread that built it or on another
+ * thread, the way a sink frees the frames a postprocess filled.
+ * Besides the time per frame, the minor page faults and the resident set growth of every case show how much
+ * memory each allocation strategy keeps touching.
+ **/
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hailo_common.hpp"
+#include "benchmark.hpp"
+
+static const size_t DETECTIONS_PER_FRAME = 100;
+
+static HailoROIPtr build_frame_std()
+{
+    HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f));
+    for (size_t i = 0; i < DETECTIONS_PER_FRAME; i++)
+    {
+        float offset = float(i) / DETECTIONS_PER_FRAME;
+        HailoDetectionPtr detection = std::make_shared<HailoDetection>(HailoBBox(offset * 0.9f, offset * 0.8f, 0.1f, 0.2f), 1, "person", 0.5f + offset / 2.0f);
+        detection->set_scaling_bbox(roi->get_bbox());
+        roi->add_object(detection);
+        detection->add_object(std::make_shared<HailoClassification>("color", 3, "red", offset));
+    }
+    return roi;
+}
+
+static HailoROIPtr build_frame_pooled()
+{
+    HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f));
+    for (size_t i = 0; i < DETECTIONS_PER_FRAME; i++)
+    {
+        float offset = float(i) / DETECTIONS_PER_FRAME;
+        HailoDetectionPtr detection = hailo_common::add_detection(roi, HailoBBox(offset * 0.9f, offset * 0.8f, 0.1f, 0.2f), "person", 0.5f + offset / 2.0f, 1);
+        hailo_common::add_classification(detection, "color", "red", offset, 3);
+    }
+    return roi;
+}
+
+static long resident_kb()
+{
+    long pages = 0, resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm == nullptr)
+        return 0;
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+        resident = 0;
+    fclose(statm);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static long minor_faults()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+}
+
+struct Churn
+{
+    long faults;
+    long resident_kb;
+};
+
+// Builds and releases frames on the calling thread
+template <typename Build>
+static std::vector<double> same_thread(size_t iterations, Build build, Churn &churn)
+{
+    long faults = minor_faults();
+    long resident = resident_kb();
+    auto times = benchmark::measure(iterations, [&](size_t)
+                                    { HailoROIPtr roi = build(); });
+    churn = {minor_faults() - faults, resident_kb() - resident};
+    return times;
+}
+
+// Builds a batch of frames on the calling thread and releases them on another one, times are per frame
+template <typename Build>
+static std::vector<double> cross_thread(size_t iterations, size_t batch_size, Build build, Churn &churn)
+{
+    long faults = minor_faults();
+    long resident = resident_kb();
+    auto times = benchmark::measure(iterations, [&](size_t)
+                                    {
+                                        std::vector<HailoROIPtr> frames;
+                                        frames.reserve(batch_size);
+                                        for (size_t i = 0; i < batch_size; i++)
+                                            frames.push_back(build());
+                                        std::thread sink([&frames]
+                                                         { frames.clear(); });
+                                        sink.join(); });
+    for (double &time : times)
+        time /= batch_size;
+    churn = {minor_faults() - faults, resident_kb() - resident};
+    return times;
+}
+
+static void print_case(const std::string &name, const std::vector<double> &times, const Churn &churn)
+{
+    benchmark::print_row(name, times);
+    double objects_per_second = (DETECTIONS_PER_FRAME * 2) / benchmark::percentile(times, 0.5) * 1e6;
+    printf("%-44s %12.2fM objects/s, %ld minor faults, %+ld kB resident\n", "", objects_per_second / 1e6, churn.faults, churn.resident_kb);
+}
+
+int main()
+{
+    const size_t iterations = 2000;
+    const size_t cross_thread_iterations = 100;
+    const size_t batch_size = 32;
+    Churn churn;
+
+    benchmark::print_header("Frame of 100 detections + 100 classifications, build and release");
+    auto std_times = same_thread(iterations, build_frame_std, churn);
+    print_case("make_shared, same thread", std_times, churn);
+    auto pooled_times = same_thread(iterations, build_frame_pooled, churn);
+    print_case("pooled, same thread", pooled_times, churn);
+    std_times = cross_thread(cross_thread_iterations, batch_size, build_frame_std, churn);
+    print_case("make_shared, released on another thread", std_times, churn);
+    pooled_times = cross_thread(cross_thread_iterations, batch_size, build_frame_pooled, churn);
+    print_case("pooled, released on another thread", pooled_times, churn);
+    return 0;
+}
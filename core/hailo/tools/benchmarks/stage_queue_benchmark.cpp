@@ -0,0 +1,184 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file stage_queue_benchmark.cpp
+ * @authors Hailo
+ *
+ * Hop latency and throughput of the queues between the stages of the hailo15 ai_example_app,
+ * against the mutex + condition variable queue they replaced (LockedQueue below).
+ * A source thread feeds a chain of synthetic stages, each one pops a buffer, spins for a given time to stand in for
+ * its work, stamps the buffer and pushes it to the next queue. Latency is measured with a paced source, so the
+ * stages sleep between frames as they do on a live camera, throughput with a source pushing as fast as it can.
+ * The fan-in case has two sources feeding the same stage, which is what makes the queue pick its MPMC ring.
+ **/
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "infra/queue.hpp"
+#include "benchmark.hpp"
+
+/**
+ * @brief The stage queue as it was before the lock-free rings, one mutex and one condition variable
+ *        shared by the producer and the consumer.
+ */
+class LockedQueue
+{
+private:
+    std::queue<BufferPtr> m_queue;
+    size_t m_max_buffers;
+    bool m_flushing = false;
+    std::condition_variable m_condvar;
+    std::mutex m_mutex;
+
+public:
+    LockedQueue(std::string, size_t max_buffers, bool = false, bool = false) : m_max_buffers(max_buffers) {}
+
+    void push(BufferPtr buffer)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condvar.wait(lock, [this]
+                       { return m_queue.size() < m_max_buffers; });
+        m_queue.push(buffer);
+        m_condvar.notify_one();
+    }
+
+    BufferPtr pop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condvar.wait(lock, [this]
+                       { return !m_queue.empty() || m_flushing; });
+        if (m_queue.empty())
+            return nullptr;
+        BufferPtr buffer = m_queue.front();
+        m_queue.pop();
+        m_condvar.notify_one();
+        return buffer;
+    }
+};
+
+struct PipelineCase
+{
+    const char *name;
+    size_t stages;
+    size_t sources;   // Sources pushing into the first queue, more than one makes it a fan-in
+    double work_us;   // Time every stage spends on a buffer
+    double period_us; // Time between two buffers of a source, 0 pushes as fast as possible
+};
+
+static void spin_for(double us)
+{
+    if (us <= 0.0)
+        return;
+    auto begin = benchmark::clock::now();
+    while (benchmark::elapsed_us(begin) < us)
+    {
+    }
+}
+
+/**
+ * @brief Runs frames_per_source buffers from every source through the chain of stages.
+ *
+ * @param hop_latencies  -  std::vector<double> &
+ *        Filled with the time between consecutive stamps of every buffer, sorted.
+ *
+ * @return double  -  Buffers per second through the whole chain.
+ */
+template <typename QueueType>
+static double run_pipeline(const PipelineCase &pipeline_case, size_t frames_per_source, size_t queue_size, std::vector<double> &hop_latencies)
+{
+    std::vector<std::shared_ptr<QueueType>> queues;
+    for (size_t i = 0; i <= pipeline_case.stages; i++)
+    {
+        bool single_producer = (i > 0 || pipeline_case.sources == 1);
+        queues.push_back(std::make_shared<QueueType>("queue_" + std::to_string(i), queue_size, false, single_producer));
+    }
+    const size_t total_frames = frames_per_source * pipeline_case.sources;
+
+    auto begin = benchmark::clock::now();
+    std::vector<std::thread> threads;
+    for (size_t source = 0; source < pipeline_case.sources; source++)
+    {
+        threads.emplace_back([&]
+                             {
+                                 auto next = benchmark::clock::now();
+                                 for (size_t i = 0; i < frames_per_source; i++)
+                                 {
+                                     if (pipeline_case.period_us > 0.0)
+                                     {
+                                         next += std::chrono::microseconds(long(pipeline_case.period_us));
+                                         std::this_thread::sleep_until(next);
+                                     }
+                                     queues[0]->push(std::make_shared<Buffer>(nullptr));
+                                 } });
+    }
+    for (size_t stage = 0; stage < pipeline_case.stages; stage++)
+    {
+        threads.emplace_back([&, stage]
+                             {
+                                 const std::string stage_name = "stage_" + std::to_string(stage);
+                                 for (size_t i = 0; i < total_frames; i++)
+                                 {
+                                     BufferPtr buffer = queues[stage]->pop();
+                                     spin_for(pipeline_case.work_us);
+                                     buffer->add_time_stamp(stage_name);
+                                     queues[stage + 1]->push(buffer);
+                                 } });
+    }
+
+    hop_latencies.clear();
+    for (size_t i = 0; i < total_frames; i++)
+    {
+        BufferPtr buffer = queues.back()->pop();
+        for (size_t hop = 1; hop < buffer->get_num_stages(); hop++)
+            hop_latencies.push_back(std::chrono::duration<double, std::micro>(buffer->get_time_stamp(hop) - buffer->get_time_stamp(hop - 1)).count());
+    }
+    double elapsed = benchmark::elapsed_us(begin);
+    for (auto &thread : threads)
+        thread.join();
+    std::sort(hop_latencies.begin(), hop_latencies.end());
+    return total_frames / elapsed * 1e6;
+}
+
+int main()
+{
+    const size_t queue_size = 5;
+    const size_t paced_frames = 2000;
+    const size_t saturated_frames = 100000;
+    const PipelineCase cases[] = {
+        {"1 stage, idle", 1, 1, 0.0, 0.0},
+        {"4 stages, idle", 4, 1, 0.0, 0.0},
+        {"4 stages, 20us of work", 4, 1, 20.0, 0.0},
+        {"2 sources fan-in, 2 stages, idle", 2, 2, 0.0, 0.0},
+    };
+
+    benchmark::print_header("Hop latency (source paced at 1 kHz per source), locked vs lock-free queue");
+    std::vector<double> latencies;
+    for (PipelineCase pipeline_case : cases)
+    {
+        pipeline_case.period_us = 1000.0;
+        std::string name = pipeline_case.name;
+        run_pipeline<LockedQueue>(pipeline_case, paced_frames, queue_size, latencies);
+        benchmark::print_row(name + " locked", latencies);
+        run_pipeline<Queue>(pipeline_case, paced_frames, queue_size, latencies);
+        benchmark::print_row(name + " lock-free", latencies);
+    }
+
+    printf("\nThroughput (unpaced source)\n%-44s %12s %12s %12s\n", "case", "locked [/s]", "lock-free [/s]", "speedup");
+    for (const PipelineCase &pipeline_case : cases)
+    {
+        double locked = run_pipeline<LockedQueue>(pipeline_case, saturated_frames, queue_size, latencies);
+        double lock_free = run_pipeline<Queue>(pipeline_case, saturated_frames, queue_size, latencies);
+        printf("%-44s %12.0f %12.0f %11.2fx\n", pipeline_case.name, locked, lock_free, lock_free / locked);
+    }
+    return 0;
+}
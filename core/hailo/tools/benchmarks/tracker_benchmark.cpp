@@ -0,0 +1,242 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file tracker_benchmark.cpp
+ * @authors Hailo
+ *
+ * Replays a detection sequence through HailoTracker::update with every assignment solver and reports the
+ * per-frame latency percentiles. The synthetic run then has 1 to 16 threads each update their own tracker of the
+ * registry, by handle, by name, and by name under one process wide mutex like the registry lock every update used to
+ * take, and reports the aggregate updates per second.
+ *   tracker_benchmark                        - synthetic sequences of 20, 100 and 300 moving objects
+ *   tracker_benchmark <det.txt> <width> <height>
+ *                                            - a recorded sequence in the MOTChallenge det.txt format
+ *                                              (frame,id,left,top,width,height,confidence,...) in pixels
+ **/
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hailo_tracker.hpp"
+#include "benchmark.hpp"
+
+struct RecordedDetection
+{
+    float xmin, ymin, width, height, confidence;
+};
+using Sequence = std::vector<std::vector<RecordedDetection>>;
+
+static Sequence load_mot_sequence(const std::string &path, float image_width, float image_height)
+{
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error("Detection file " + path + " can not be opened");
+    std::map<int, std::vector<RecordedDetection>> frames;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        for (char &c : line)
+            c = (c == ',') ? ' ' : c;
+        std::istringstream fields(line);
+        int frame, id;
+        RecordedDetection detection;
+        if (!(fields >> frame >> id >> detection.xmin >> detection.ymin >> detection.width >> detection.height >> detection.confidence))
+            continue;
+        detection.xmin /= image_width;
+        detection.ymin /= image_height;
+        detection.width /= image_width;
+        detection.height /= image_height;
+        frames[frame].push_back(detection);
+    }
+    if (frames.empty())
+        return {};
+    Sequence sequence(frames.rbegin()->first - frames.begin()->first + 1);
+    for (auto &frame : frames)
+        sequence[frame.first - frames.begin()->first] = std::move(frame.second);
+    return sequence;
+}
+
+// Objects bouncing around the frame, with detection noise and 5% missed detections
+static Sequence make_sequence(size_t num_objects, size_t num_frames, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    struct Object
+    {
+        float x, y, w, h, vx, vy;
+    };
+    std::vector<Object> objects(num_objects);
+    for (Object &object : objects)
+    {
+        object.w = 0.02f + 0.05f * unit(rng);
+        object.h = 0.04f + 0.08f * unit(rng);
+        object.x = unit(rng) * (1.0f - object.w);
+        object.y = unit(rng) * (1.0f - object.h);
+        object.vx = (unit(rng) - 0.5f) * 0.01f;
+        object.vy = (unit(rng) - 0.5f) * 0.01f;
+    }
+    Sequence sequence(num_frames);
+    for (auto &frame : sequence)
+    {
+        for (Object &object : objects)
+        {
+            object.x += object.vx;
+            object.y += object.vy;
+            if (object.x < 0.0f || object.x + object.w > 1.0f)
+                object.vx = -object.vx;
+            if (object.y < 0.0f || object.y + object.h > 1.0f)
+                object.vy = -object.vy;
+            if (unit(rng) < 0.05f)
+                continue;
+            frame.push_back({object.x + (unit(rng) - 0.5f) * 0.004f, object.y + (unit(rng) - 0.5f) * 0.004f, object.w, object.h, 0.9f});
+        }
+    }
+    return sequence;
+}
+
+static void replay(const std::string &name, const Sequence &sequence)
+{
+    const std::pair<assignment_solver_t, const char *> solvers[] = {
+        {ASSIGNMENT_SOLVER_LAPJV, "lapjv"},
+        {ASSIGNMENT_SOLVER_LAPJV_GATED, "lapjv-gated"},
+        {ASSIGNMENT_SOLVER_GREEDY, "greedy"},
+    };
+    for (const auto &solver : solvers)
+    {
+        std::string tracker_name = name + " " + solver.second;
+        HailoTracker::GetInstance().add_jde_tracker(tracker_name);
+        HailoTracker::GetInstance().set_assignment_solver(tracker_name, solver.first);
+        HailoTrackerHandle tracker = HailoTracker::GetInstance().get_jde_tracker(tracker_name);
+
+        std::vector<double> times;
+        times.reserve(sequence.size());
+        size_t tracks = 0;
+        for (const auto &frame : sequence)
+        {
+            std::vector<HailoDetectionPtr> detections;
+            detections.reserve(frame.size());
+            for (const RecordedDetection &detection : frame)
+                detections.push_back(std::make_shared<HailoDetection>(HailoBBox(detection.xmin, detection.ymin, detection.width, detection.height), "object", detection.confidence));
+            benchmark::clock::time_point begin = benchmark::clock::now();
+            tracks += HailoTracker::GetInstance().update(tracker, detections).size();
+            times.push_back(benchmark::elapsed_us(begin));
+        }
+        HailoTracker::GetInstance().remove_jde_tracker(tracker_name);
+        std::sort(times.begin(), times.end());
+        benchmark::print_row(tracker_name + ", " + std::to_string(sequence.empty() ? 0 : tracks / sequence.size()) + " tracks/frame", times);
+    }
+}
+
+enum class RegistryAccess
+{
+    GLOBAL_LOCK,
+    NAME,
+    HANDLE,
+};
+
+// Every thread replays the sequence through its own tracker, returns the updates per second of all threads together
+static double registry_throughput(size_t num_threads, RegistryAccess access, const Sequence &sequence)
+{
+    static std::mutex registry_lock;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        names.push_back("stream " + std::to_string(i));
+        HailoTracker::GetInstance().add_jde_tracker(names.back());
+    }
+
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> start{false};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        threads.emplace_back([&, i]
+                             {
+                                 const std::string &name = names[i];
+                                 HailoTrackerHandle tracker = HailoTracker::GetInstance().get_jde_tracker(name);
+                                 ready++;
+                                 while (!start.load())
+                                     std::this_thread::yield();
+                                 for (const auto &frame : sequence)
+                                 {
+                                     std::vector<HailoDetectionPtr> detections;
+                                     detections.reserve(frame.size());
+                                     for (const RecordedDetection &detection : frame)
+                                         detections.push_back(std::make_shared<HailoDetection>(HailoBBox(detection.xmin, detection.ymin, detection.width, detection.height), "object", detection.confidence));
+                                     if (access == RegistryAccess::HANDLE)
+                                     {
+                                         HailoTracker::GetInstance().update(tracker, detections);
+                                     }
+                                     else if (access == RegistryAccess::NAME)
+                                     {
+                                         HailoTracker::GetInstance().update(name, detections);
+                                     }
+                                     else
+                                     {
+                                         std::lock_guard<std::mutex> lock(registry_lock);
+                                         HailoTracker::GetInstance().update(name, detections);
+                                     }
+                                 } });
+    }
+    while (ready.load() < num_threads)
+        std::this_thread::yield();
+    benchmark::clock::time_point begin = benchmark::clock::now();
+    start = true;
+    for (auto &thread : threads)
+        thread.join();
+    double elapsed = benchmark::elapsed_us(begin);
+    for (const std::string &name : names)
+        HailoTracker::GetInstance().remove_jde_tracker(name);
+    return num_threads * sequence.size() / elapsed * 1e6;
+}
+
+static void registry_scaling(const Sequence &sequence)
+{
+    printf("\nHailoTracker registry, one tracker per thread\n%-10s %16s %16s %16s %10s\n", "threads", "global lock [/s]", "by name [/s]", "by handle [/s]", "speedup");
+    for (size_t num_threads : {1, 2, 4, 8, 16})
+    {
+        double global_lock = registry_throughput(num_threads, RegistryAccess::GLOBAL_LOCK, sequence);
+        double by_name = registry_throughput(num_threads, RegistryAccess::NAME, sequence);
+        double by_handle = registry_throughput(num_threads, RegistryAccess::HANDLE, sequence);
+        printf("%-10zu %16.0f %16.0f %16.0f %9.2fx\n", num_threads, global_lock, by_name, by_handle, by_handle / global_lock);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 1 && argc != 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " [<det.txt> <image width> <image height>]" << std::endl;
+        return 1;
+    }
+    benchmark::print_header("HailoTracker::update per frame, by assignment solver");
+    try
+    {
+        if (argc == 4)
+        {
+            replay(argv[1], load_mot_sequence(argv[1], std::stof(argv[2]), std::stof(argv[3])));
+            return 0;
+        }
+        std::mt19937 rng(7);
+        for (size_t num_objects : {20, 100, 300})
+            replay(std::to_string(num_objects) + " objects", make_sequence(num_objects, 300, rng));
+        registry_scaling(make_sequence(20, 300, rng));
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
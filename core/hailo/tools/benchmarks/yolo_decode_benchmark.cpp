@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * @file yolo_decode_benchmark.cpp
+ * @authors Hailo
+ *
+ * Decode time of the yolov5 postprocess on synthetic 640x640 outputs (80x80, 40x40 and 20x20 cells, 3 anchors,
+ * 80 classes), uint8 and uint16, against the generic decode that dequantizes the objectness of every cell and
+ * anchor before looking at its classes (reference_decode below, the loop YoloPost::extract_boxes falls back to).
+ * Scores are mostly low with a given fraction of hot values, which sets how many cells pass the threshold.
+ * Both paths end with the same NMS, and the run fails if their detections differ. The quantized path is timed
+ * through the yolov5 entry point, so it also pays for adding its detections to the ROI.
+ **/
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "detection/yolo_postprocess.hpp"
+#include "hailo_nms.hpp"
+#include "benchmark.hpp"
+
+struct OutputBuffer
+{
+    std::vector<uint8_t> data;
+    HailoTensorPtr tensor;
+};
+
+static OutputBuffer make_output(const std::string &name, uint size, bool is_uint16, double hot_fraction, std::mt19937 &rng)
+{
+    const uint features = YoloOutputLayer::NUM_ANCHORS * (YoloOutputLayer::CLASS_CHANNEL_OFFSET + 80);
+    const size_t count = size_t(size) * size * features;
+    const uint max_value = is_uint16 ? 65535 : 255;
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    OutputBuffer output;
+    output.data.resize(count * (is_uint16 ? sizeof(uint16_t) : sizeof(uint8_t)));
+    for (size_t i = 0; i < count; i++)
+    {
+        uint value = unit(rng) < hot_fraction ? uint(max_value * (0.5 + 0.5 * unit(rng))) : uint(max_value * 0.1 * unit(rng));
+        if (is_uint16)
+            reinterpret_cast<uint16_t *>(output.data.data())[i] = uint16_t(value);
+        else
+            output.data[i] = uint8_t(value);
+    }
+
+    hailo_vstream_info_t info{};
+    strncpy(info.name, name.c_str(), sizeof(info.name) - 1);
+    info.shape.width = size;
+    info.shape.height = size;
+    info.shape.features = features;
+    info.format.type = is_uint16 ? HAILO_FORMAT_TYPE_UINT16 : HAILO_FORMAT_TYPE_UINT8;
+    info.quant_info.qp_scale = 1.0f / max_value;
+    info.quant_info.qp_zp = 0.0f;
+    output.tensor = std::make_shared<HailoTensor>(output.data.data(), info);
+    return output;
+}
+
+// The decode YoloPost used for every layer before the quantized path, followed by the same NMS
+static std::vector<HailoDetection> reference_decode(HailoROIPtr roi, YoloParams &params)
+{
+    std::vector<HailoTensorPtr> tensors = roi->get_tensors();
+    std::sort(tensors.begin(), tensors.end(), [](const HailoTensorPtr &a, const HailoTensorPtr &b)
+              { return a->size() < b->size(); });
+    const uint image_width = tensors[0]->width() * 32;
+    const uint image_height = tensors[0]->height() * 32;
+    std::vector<HailoDetection> objects;
+    objects.reserve(params.max_boxes);
+    for (size_t i = 0; i < tensors.size(); i++)
+    {
+        bool is_uint16 = tensors[i]->vstream_info().format.type == HAILO_FORMAT_TYPE_UINT16;
+        Yolov5OL layer(tensors[i], params.anchors_vec[i], params.output_activation == "sigmoid", params.label_offset, is_uint16);
+        for (uint row = 0; row < layer._height; ++row)
+        {
+            for (uint col = 0; col < layer._width; ++col)
+            {
+                for (uint anchor = 0; anchor < layer.NUM_ANCHORS; ++anchor)
+                {
+                    float confidence = layer.get_confidence(row, col, anchor);
+                    if (confidence < params.detection_threshold)
+                        continue;
+                    uint class_id;
+                    float class_confidence;
+                    std::tie(class_id, class_confidence) = layer.get_class(row, col, anchor);
+                    confidence = confidence * class_confidence;
+                    if (confidence > params.detection_threshold)
+                    {
+                        float x, y, w, h;
+                        std::tie(x, y) = layer.get_center(row, col, anchor);
+                        std::tie(w, h) = layer.get_shape(row, col, anchor, image_width, image_height);
+                        objects.push_back(HailoDetection(HailoBBox(x - (w / 2.0f), y - (h / 2.0f), w, h), class_id, params.labels[class_id], confidence));
+                    }
+                }
+            }
+        }
+    }
+    hailo_nms::nms(objects, hailo_nms::NmsConfig{params.iou_threshold, false, params.max_boxes});
+    return objects;
+}
+
+static bool same_detections(std::vector<HailoDetection> &expected, std::vector<HailoDetectionPtr> &actual)
+{
+    if (expected.size() != actual.size())
+        return false;
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        HailoBBox a = expected[i].get_bbox();
+        HailoBBox b = actual[i]->get_bbox();
+        if (expected[i].get_class_id() != actual[i]->get_class_id() || expected[i].get_confidence() != actual[i]->get_confidence() ||
+            a.xmin() != b.xmin() || a.ymin() != b.ymin() || a.width() != b.width() || a.height() != b.height())
+            return false;
+    }
+    return true;
+}
+
+int main()
+{
+    const size_t iterations = 50;
+    std::mt19937 rng(7);
+    Yolov5Params params;
+    bool all_same = true;
+
+    benchmark::print_header("yolov5 640x640 decode + NMS per frame, generic vs quantized");
+    for (bool is_uint16 : {false, true})
+    {
+        for (double hot_fraction : {0.001, 0.02})
+        {
+            std::vector<OutputBuffer> outputs;
+            HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f));
+            for (uint size : {80u, 40u, 20u})
+            {
+                outputs.push_back(make_output("yolov5/conv" + std::to_string(size), size, is_uint16, hot_fraction, rng));
+                roi->add_tensor(outputs.back().tensor);
+            }
+
+            std::vector<HailoDetection> expected = reference_decode(roi, params);
+            yolov5(roi, &params);
+            std::vector<HailoDetectionPtr> actual = hailo_common::get_hailo_detections(roi);
+            bool same = same_detections(expected, actual);
+            all_same = all_same && same;
+
+            char name[64];
+            snprintf(name, sizeof(name), "%s, %.1f%% hot%s", is_uint16 ? "uint16" : "uint8", hot_fraction * 100, same ? "" : " MISMATCH");
+            auto generic = benchmark::measure(iterations, [&](size_t)
+                                              { reference_decode(roi, params); });
+            auto quantized = benchmark::measure(iterations, [&](size_t)
+                                                {
+                                                    roi->remove_objects_typed(HAILO_DETECTION);
+                                                    yolov5(roi, &params); });
+            benchmark::print_row(std::string(name) + " generic", generic);
+            benchmark::print_row(std::string(name) + " quantized", quantized);
+        }
+    }
+    return all_same ? 0 : 1;
+}
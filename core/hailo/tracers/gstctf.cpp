@@ -114,7 +114,7 @@ typedef guint32 ctf_header_timestamp;
   } G_STMT_END
 
 /* *INDENT-OFF* */
-#define CTF_EVENT_WRITE_HEADER(id,mem) \
+#define CTF_EVENT_WRITE_HEADER_AT(id,timestamp,mem) \
   G_STMT_START {                       \
     /* Write event ID */               \
     CTF_EVENT_WRITE_INT16(id,mem);     \
@@ -122,10 +122,13 @@ typedef guint32 ctf_header_timestamp;
     CTF_EVENT_WRITE_INT32(             \
       GST_CLOCK_DIFF (                 \
           ctf_descriptor->start_time,  \
-          gst_util_get_timestamp ()    \
+          timestamp                    \
       )/1000,                          \
     mem);                              \
   } G_STMT_END
+
+#define CTF_EVENT_WRITE_HEADER(id,mem) \
+  CTF_EVENT_WRITE_HEADER_AT(id,gst_util_get_timestamp (),mem)
 /* *INDENT-ON* */
 
 static void file_parser_handler (gchar * line);
@@ -1185,6 +1188,48 @@ do_print_ctf_init (event_id id)
   g_mutex_unlock (&ctf_descriptor->mutex);
 }
 
+/* Write an event whose payload was already serialized (see gsttracebuffer.cpp).
+ * It is stamped with the given gst_util_get_timestamp () time, when the event happened rather than when it is written. */
+void
+do_print_ctf_event (event_id id, GstClockTime timestamp, const guint8 * payload, gsize payload_size)
+{
+  GError *error;
+  guint8 *mem;
+  guint8 *event_mem;
+  gsize event_size;
+
+  event_size = payload_size + CTF_HEADER_SIZE;
+
+  if (event_exceeds_mem_size (event_size)) {
+    return;
+  }
+
+  mem = ctf_descriptor->mem;
+  event_mem = mem + TCP_HEADER_SIZE;
+
+  /* Lock mem and datastream and output_stream resources */
+  g_mutex_lock (&ctf_descriptor->mutex);
+  /* Add CTF header */
+  CTF_EVENT_WRITE_HEADER_AT (id, timestamp, event_mem);
+  /* Add event payload */
+  memcpy (event_mem, payload, payload_size);
+
+  if (FALSE == ctf_descriptor->file_output_disable) {
+    event_mem = mem + TCP_HEADER_SIZE;
+    fwrite (event_mem, sizeof (gchar), event_size, ctf_descriptor->datastream);
+  }
+
+  if (FALSE == ctf_descriptor->tcp_output_disable) {
+    /* Write the TCP header */
+    TCP_EVENT_HEADER_WRITE (TCP_DATASTREAM_ID, event_size, mem);
+
+    g_output_stream_write (ctf_descriptor->output_stream,
+        ctf_descriptor->mem, event_size + TCP_HEADER_SIZE, NULL, &error);
+  }
+
+  g_mutex_unlock (&ctf_descriptor->mutex);
+}
+
 void
 gst_ctf_close (void)
 {
@@ -53,4 +53,6 @@ void do_print_buffer_event (event_id id, const gchar * pad, GstClockTime pts,
     guint64 offset_end, guint64 size, GstBufferFlags flags,
     guint32 refcount);
 void do_print_ctf_init (event_id id);
+void do_print_ctf_event (event_id id, GstClockTime timestamp,
+    const guint8 * payload, gsize payload_size);
 G_END_DECLS
\ No newline at end of file
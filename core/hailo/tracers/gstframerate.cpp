@@ -29,6 +29,7 @@
 
 #include "gstframerate.hpp"
 #include "gstctf.hpp"
+#include "gsttracebuffer.hpp"
 
 GST_DEBUG_CATEGORY_STATIC (gst_framerate_debug);
 #define GST_CAT_DEFAULT gst_framerate_debug
@@ -72,6 +73,7 @@ typedef struct _GstFramerateHash GstFramerateHash;
 struct _GstFramerateHash
 {
   gchar *fullname;
+  guint32 name_id;
   guint counter;
 };
 
@@ -181,10 +183,17 @@ print_framerate (GstPeriodicTracer * tracer)
   while (g_hash_table_iter_next (&iter, &key, &value)) {
     pad_table = (GstFramerateHash *) value;
 
-    gst_tracer_record_log (tr_framerate, pad_table->fullname,
-        pad_table->counter);
-    do_print_framerate_event (FPS_EVENT_ID, pad_table->fullname,
-        pad_table->counter);
+    GstTraceRecord record = { };
+
+    if (gst_trace_buffer_log_enabled ())
+      gst_tracer_record_log (tr_framerate, pad_table->fullname,
+          pad_table->counter);
+
+    record.timestamp = gst_util_get_timestamp ();
+    record.event = FPS_EVENT_ID;
+    record.names[0] = pad_table->name_id;
+    record.values[0] = pad_table->counter;
+    gst_trace_buffer_write (&record);
     pad_table->counter = 0;
   }
 
@@ -232,6 +241,7 @@ consider_frames (GstFramerateTracer * self, GstPad * pad, guint amount)
 
     pad_frames = (GstFramerateHash*)g_malloc (sizeof (GstFramerateHash));
     pad_frames->fullname = fullname;
+    pad_frames->name_id = gst_trace_buffer_intern (fullname);
     pad_frames->counter = amount;
 
     GST_OBJECT_LOCK (self);
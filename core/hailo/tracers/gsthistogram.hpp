@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <gst/gst.h>
+
+// Buckets per power of 2 are 2^HISTOGRAM_SUB_BUCKET_BITS, a value is known within 1/HISTOGRAM_SUB_BUCKETS of itself
+#define HISTOGRAM_SUB_BUCKET_BITS (5)
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+/**
+ * @brief HDR style histogram of nanosecond values - log2 buckets, each split in HISTOGRAM_SUB_BUCKETS linear ones.
+ *        It covers the whole guint64 range with a fixed footprint (HISTOGRAM_BUCKETS counters)
+ *        and about 3% error on the quantiles. Not thread safe.
+ */
+class LatencyHistogram
+{
+private:
+    std::array<guint32, HISTOGRAM_BUCKETS> m_counts{};
+    guint64 m_count = 0;
+    guint64 m_sum = 0;
+    guint64 m_max = 0;
+
+    static guint bucket_of(guint64 value)
+    {
+        if (value < HISTOGRAM_SUB_BUCKETS)
+            return value;
+        guint exponent = g_bit_storage(value) - 1;
+        guint shift = exponent - HISTOGRAM_SUB_BUCKET_BITS;
+        return (shift + 1) * HISTOGRAM_SUB_BUCKETS + ((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+    }
+
+    // The highest value that falls in a bucket
+    static guint64 highest_value_of(guint bucket)
+    {
+        if (bucket < HISTOGRAM_SUB_BUCKETS)
+            return bucket;
+        guint shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+        guint64 lowest = guint64(HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) << shift;
+        return lowest + ((guint64(1) << shift) - 1);
+    }
+
+public:
+    void record(guint64 value)
+    {
+        m_counts[bucket_of(value)]++;
+        m_count++;
+        m_sum += value;
+        m_max = MAX(m_max, value);
+    }
+
+    /**
+     * @brief The value below which a fraction of the recorded values are.
+     *
+     * @param quantile  -  double
+     *        The fraction, 0.5 for the median.
+     *
+     * @return guint64
+     *         The highest value of the bucket holding the quantile, 0 when nothing was recorded.
+     */
+    guint64 value_at_quantile(double quantile) const
+    {
+        guint64 rank = MAX(guint64(1), guint64(std::ceil(quantile * m_count)));
+        guint64 seen = 0;
+        for (guint bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+        {
+            seen += m_counts[bucket];
+            if (seen >= rank)
+                return MIN(highest_value_of(bucket), m_max);
+        }
+        return m_max;
+    }
+
+    guint64 count() const { return m_count; }
+    guint64 sum() const { return m_sum; }
+    guint64 max() const { return m_max; }
+};
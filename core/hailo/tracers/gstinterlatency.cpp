@@ -40,6 +40,7 @@
 
 #include "gstinterlatency.hpp"
 #include "gstctf.hpp"
+#include "gsttracebuffer.hpp"
 
 GST_DEBUG_CATEGORY_STATIC (gst_interlatency_debug);
 #define GST_CAT_DEFAULT gst_interlatency_debug
@@ -111,31 +112,38 @@ static void
 log_latency (GstInterLatencyTracer * interlatency_tracer,
     const GstStructure * data, GstPad * sink_pad, guint64 sink_ts)
 {
-  GstPad *src_pad = NULL;
+  GstPad *src_pad;
   guint64 src_ts;
-  gchar *src = NULL, *sink = NULL;
   guint64 time;
-  GString *time_string = NULL;
+  GstTraceRecord record = { };
 
-  gst_structure_id_get (data,
-      latency_probe_pad, GST_TYPE_PAD, &src_pad,
-      latency_probe_ts, G_TYPE_UINT64, &src_ts, NULL);
-
-  src = g_strdup_printf ("%s_%s", GST_DEBUG_PAD_NAME (src_pad));
-  sink = g_strdup_printf ("%s_%s", GST_DEBUG_PAD_NAME (sink_pad));
+  /* Borrow the values, gst_structure_id_get would return a new pad reference per buffer */
+  src_pad = GST_PAD_CAST (g_value_get_object (gst_structure_id_get_value (data,
+              latency_probe_pad)));
+  src_ts = g_value_get_uint64 (gst_structure_id_get_value (data,
+          latency_probe_ts));
 
   time = GST_CLOCK_DIFF (src_ts, sink_ts);
 
-  time_string = g_string_new ("");
-  g_string_printf (time_string, "%" GST_TIME_FORMAT, GST_TIME_ARGS (time));
+  if (gst_trace_buffer_log_enabled ()) {
+    gchar *src = g_strdup_printf ("%s_%s", GST_DEBUG_PAD_NAME (src_pad));
+    gchar *sink = g_strdup_printf ("%s_%s", GST_DEBUG_PAD_NAME (sink_pad));
+    GString *time_string = g_string_new ("");
 
-  gst_tracer_record_log (tr_interlatency, src, sink, time_string->str);
+    g_string_printf (time_string, "%" GST_TIME_FORMAT, GST_TIME_ARGS (time));
+    gst_tracer_record_log (tr_interlatency, src, sink, time_string->str);
 
-  do_print_interlatency_event (INTERLATENCY_EVENT_ID, src, sink, time);
+    g_string_free (time_string, TRUE);
+    g_free (src);
+    g_free (sink);
+  }
 
-  g_string_free (time_string, TRUE);
-  g_free (src);
-  g_free (sink);
+  record.timestamp = gst_util_get_timestamp ();
+  record.event = INTERLATENCY_EVENT_ID;
+  record.names[0] = gst_trace_buffer_intern_pad (src_pad);
+  record.names[1] = gst_trace_buffer_intern_pad (sink_pad);
+  record.values[0] = time;
+  gst_trace_buffer_write (&record);
 }
 
 static void
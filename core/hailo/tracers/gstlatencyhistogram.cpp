@@ -0,0 +1,368 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * SECTION:gstlatencyhistogram
+ * @short_description: live latency percentiles of the proctime, interlatency and scheduletime tracers.
+ *
+ * A tracing module that aggregates the records of the proctime, interlatency and scheduletime tracers
+ * (which must be enabled too) into histograms per element, per source to pad path and per pad.
+ * Every period it exports their percentiles in OpenMetrics text format, to a file (replaced atomically)
+ * or to a unix socket (location=unix:<path>, one connection per snapshot), and starts new histograms.
+ * The histograms are filled by the trace buffer drainer, never by the streaming threads.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "gstlatencyhistogram.hpp"
+#include "gstctf.hpp"
+#include "gsttracebuffer.hpp"
+#include "gsthistogram.hpp"
+
+GST_DEBUG_CATEGORY_STATIC(gst_latency_histogram_debug);
+#define GST_CAT_DEFAULT gst_latency_histogram_debug
+
+#define LATENCY_HISTOGRAM_DEFAULT_FILE "latency_histograms.prom"
+#define LATENCY_HISTOGRAM_UNIX_PREFIX "unix:"
+#define LATENCY_HISTOGRAM_SEND_TIMEOUT_MS (200)
+// Series kept per metric in a period, the latencies of other series are not counted until the next period
+#define LATENCY_HISTOGRAM_MAX_SERIES (256)
+
+static const double latency_histogram_quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+typedef struct
+{
+    guint16 event;
+    const gchar *name;
+    const gchar *help;
+    const gchar *labels[2];
+} LatencyMetric;
+
+static const LatencyMetric latency_metrics[] = {
+    {PROCTIME_EVENT_ID, "hailo_proctime_seconds",
+     "Time an element takes to produce an output buffer from its input buffer", {"element", NULL}},
+    {INTERLATENCY_EVENT_ID, "hailo_interlatency_seconds",
+     "Time a buffer takes from a source pad to a pad downstream", {"from_pad", "to_pad"}},
+    {SCHED_TIME_EVENT_ID, "hailo_scheduletime_seconds",
+     "Time between two consecutive buffers of a pad", {"pad", NULL}},
+};
+#define LATENCY_METRICS G_N_ELEMENTS(latency_metrics)
+
+// Histograms of a metric, by the ids of their names (names[0] | names[1] << 32)
+typedef std::unordered_map<guint64, std::unique_ptr<LatencyHistogram>> HistogramSeries;
+
+struct LatencyHistograms
+{
+    std::mutex mutex;
+    HistogramSeries series[LATENCY_METRICS];
+    guint64 uncounted = 0;
+};
+
+struct _GstLatencyHistogramTracer
+{
+    GstPeriodicTracer parent;
+
+    LatencyHistograms *histograms;
+    gchar *location;
+};
+
+#define _do_init \
+    GST_DEBUG_CATEGORY_INIT(gst_latency_histogram_debug, "latencyhistogram", 0, "latencyhistogram tracer");
+
+G_DEFINE_TYPE_WITH_CODE(GstLatencyHistogramTracer, gst_latency_histogram_tracer,
+                        GST_TYPE_PERIODIC_TRACER, _do_init);
+
+static gint
+metric_of(guint16 event)
+{
+    for (guint metric = 0; metric < LATENCY_METRICS; metric++)
+    {
+        if (latency_metrics[metric].event == event)
+            return metric;
+    }
+    return -1;
+}
+
+/* Called by the trace buffer drainer */
+static void
+record_latencies(const GstTraceRecord *records, gsize count, gpointer user_data)
+{
+    LatencyHistograms *histograms = ((GstLatencyHistogramTracer *)user_data)->histograms;
+
+    std::lock_guard<std::mutex> lock(histograms->mutex);
+    for (gsize i = 0; i < count; i++)
+    {
+        const GstTraceRecord &record = records[i];
+        gint metric = metric_of(record.event);
+        if (metric < 0)
+            continue;
+
+        HistogramSeries &series = histograms->series[metric];
+        guint64 key = record.names[0] | ((guint64)record.names[1] << 32);
+        auto it = series.find(key);
+        if (it == series.end())
+        {
+            if (series.size() >= LATENCY_HISTOGRAM_MAX_SERIES)
+            {
+                histograms->uncounted++;
+                continue;
+            }
+            it = series.emplace(key, std::make_unique<LatencyHistogram>()).first;
+        }
+        it->second->record(record.values[0]);
+    }
+}
+
+static void
+append_seconds(GString *text, guint64 nanoseconds)
+{
+    gchar value[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_string_append_c(text, ' ');
+    g_string_append(text, g_ascii_formatd(value, sizeof(value), "%.9g", nanoseconds / 1e9));
+    g_string_append_c(text, '\n');
+}
+
+/* Label values escaped as OpenMetrics requires */
+static void
+append_label(GString *labels, const gchar *key, const gchar *value)
+{
+    if (labels->len > 0)
+        g_string_append_c(labels, ',');
+    g_string_append_printf(labels, "%s=\"", key);
+    for (const gchar *c = value; '\0' != *c; c++)
+    {
+        if ('\\' == *c || '"' == *c)
+            g_string_append_c(labels, '\\');
+        if ('\n' == *c)
+            g_string_append(labels, "\\n");
+        else
+            g_string_append_c(labels, *c);
+    }
+    g_string_append_c(labels, '"');
+}
+
+static void
+append_metric(GString *text, const LatencyMetric &metric, const HistogramSeries &series)
+{
+    std::vector<std::pair<std::string, const LatencyHistogram *>> sorted;
+
+    for (auto &entry : series)
+    {
+        GString *labels = g_string_new(NULL);
+        for (guint i = 0; i < G_N_ELEMENTS(metric.labels) && metric.labels[i]; i++)
+        {
+            gchar *name = gst_trace_buffer_lookup_name((guint32)(entry.first >> (32 * i)));
+            append_label(labels, metric.labels[i], name);
+            g_free(name);
+        }
+        sorted.emplace_back(labels->str, entry.second.get());
+        g_string_free(labels, TRUE);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<std::string, const LatencyHistogram *> &a, const std::pair<std::string, const LatencyHistogram *> &b)
+              { return a.first < b.first; });
+
+    g_string_append_printf(text, "# TYPE %s summary\n# UNIT %s seconds\n# HELP %s %s, over the last period.\n",
+                           metric.name, metric.name, metric.name, metric.help);
+    for (auto &entry : sorted)
+    {
+        const gchar *labels = entry.first.c_str();
+        const LatencyHistogram *histogram = entry.second;
+        for (double quantile : latency_histogram_quantiles)
+        {
+            gchar value[G_ASCII_DTOSTR_BUF_SIZE];
+            g_string_append_printf(text, "%s{%s,quantile=\"%s\"}", metric.name, labels,
+                                   g_ascii_formatd(value, sizeof(value), "%g", quantile));
+            append_seconds(text, histogram->value_at_quantile(quantile));
+        }
+        g_string_append_printf(text, "%s_sum{%s}", metric.name, labels);
+        append_seconds(text, histogram->sum());
+        g_string_append_printf(text, "%s_count{%s} %" G_GUINT64_FORMAT "\n", metric.name, labels, histogram->count());
+    }
+
+    // The maximum is its own family, a summary only has quantiles, a sum and a count
+    gchar *max_name = g_strdup_printf("%.*s_max_seconds", (gint)(strlen(metric.name) - strlen("_seconds")), metric.name);
+    g_string_append_printf(text, "# TYPE %s gauge\n# UNIT %s seconds\n# HELP %s Maximum of %s over the last period.\n",
+                           max_name, max_name, max_name, metric.name);
+    for (auto &entry : sorted)
+    {
+        g_string_append_printf(text, "%s{%s}", max_name, entry.first.c_str());
+        append_seconds(text, entry.second->max());
+    }
+    g_free(max_name);
+}
+
+static void
+send_to_socket(GstLatencyHistogramTracer *self, const gchar *path, const GString *text)
+{
+    struct sockaddr_un address;
+    struct timeval timeout = {0, LATENCY_HISTOGRAM_SEND_TIMEOUT_MS * 1000};
+    gsize sent = 0;
+    gint fd;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (g_strlcpy(address.sun_path, path, sizeof(address.sun_path)) >= sizeof(address.sun_path))
+    {
+        GST_ERROR_OBJECT(self, "Socket path %s is too long", path);
+        return;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        GST_WARNING_OBJECT(self, "Could not create a socket: %s", g_strerror(errno));
+        return;
+    }
+    // The main loop must not wait long for a stuck reader
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        GST_DEBUG_OBJECT(self, "Nothing listens on %s, snapshot dropped: %s", path, g_strerror(errno));
+        close(fd);
+        return;
+    }
+    while (sent < text->len)
+    {
+        ssize_t res = send(fd, text->str + sent, text->len - sent, MSG_NOSIGNAL);
+        if (res < 0 && EINTR == errno)
+            continue;
+        if (res < 0)
+        {
+            GST_WARNING_OBJECT(self, "Snapshot sent partially to %s: %s", path, g_strerror(errno));
+            break;
+        }
+        sent += res;
+    }
+    close(fd);
+}
+
+static void
+write_snapshot(GstLatencyHistogramTracer *self, const GString *text)
+{
+    GError *error = NULL;
+
+    if (g_str_has_prefix(self->location, LATENCY_HISTOGRAM_UNIX_PREFIX))
+    {
+        send_to_socket(self, self->location + strlen(LATENCY_HISTOGRAM_UNIX_PREFIX), text);
+        return;
+    }
+
+    // Written to a temporary file and renamed, a reader never sees a partial snapshot
+    if (!g_file_set_contents(self->location, text->str, text->len, &error))
+    {
+        GST_WARNING_OBJECT(self, "Could not write %s: %s", self->location, error->message);
+        g_error_free(error);
+    }
+}
+
+static gboolean
+export_histograms(GstPeriodicTracer *tracer)
+{
+    GstLatencyHistogramTracer *self = GST_LATENCY_HISTOGRAM_TRACER(tracer);
+    LatencyHistograms *histograms = self->histograms;
+    HistogramSeries series[LATENCY_METRICS];
+    guint64 uncounted;
+    GString *text;
+
+    // Take the histograms of the period, the drainer fills new ones meanwhile
+    {
+        std::lock_guard<std::mutex> lock(histograms->mutex);
+        for (guint metric = 0; metric < LATENCY_METRICS; metric++)
+            series[metric].swap(histograms->series[metric]);
+        uncounted = histograms->uncounted;
+        histograms->uncounted = 0;
+    }
+    if (uncounted > 0)
+    {
+        GST_WARNING_OBJECT(self, "%" G_GUINT64_FORMAT " latencies were not counted, a metric has more than %d series",
+                           uncounted, LATENCY_HISTOGRAM_MAX_SERIES);
+    }
+
+    text = g_string_new(NULL);
+    for (guint metric = 0; metric < LATENCY_METRICS; metric++)
+        append_metric(text, latency_metrics[metric], series[metric]);
+    g_string_append(text, "# EOF\n");
+    write_snapshot(self, text);
+    g_string_free(text, TRUE);
+
+    return TRUE;
+}
+
+static void
+reset_histograms(GstPeriodicTracer *tracer)
+{
+    LatencyHistograms *histograms = GST_LATENCY_HISTOGRAM_TRACER(tracer)->histograms;
+
+    std::lock_guard<std::mutex> lock(histograms->mutex);
+    for (guint metric = 0; metric < LATENCY_METRICS; metric++)
+        histograms->series[metric].clear();
+    histograms->uncounted = 0;
+}
+
+/* Called once, when the first pipeline starts playing */
+static void
+set_location(GstPeriodicTracer *tracer)
+{
+    GstLatencyHistogramTracer *self = GST_LATENCY_HISTOGRAM_TRACER(tracer);
+    GList *location = gst_shark_tracer_get_param(GST_SHARK_TRACER(self), "location");
+
+    if (NULL != location)
+        self->location = g_strdup((const gchar *)location->data);
+    else
+        self->location = g_build_filename(get_ctf_path_name(), LATENCY_HISTOGRAM_DEFAULT_FILE, NULL);
+    GST_INFO_OBJECT(self, "Exporting latency histograms to %s", self->location);
+}
+
+/* tracer class */
+
+static void
+gst_latency_histogram_tracer_finalize(GObject *obj)
+{
+    GstLatencyHistogramTracer *self = GST_LATENCY_HISTOGRAM_TRACER(obj);
+
+    gst_trace_buffer_remove_listener(record_latencies, self);
+    delete self->histograms;
+    self->histograms = NULL;
+    g_free(self->location);
+    self->location = NULL;
+
+    G_OBJECT_CLASS(gst_latency_histogram_tracer_parent_class)->finalize(obj);
+}
+
+static void
+gst_latency_histogram_tracer_class_init(GstLatencyHistogramTracerClass *klass)
+{
+    GstPeriodicTracerClass *ptracer_class = GST_PERIODIC_TRACER_CLASS(klass);
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    ptracer_class->reset = GST_DEBUG_FUNCPTR(reset_histograms);
+    ptracer_class->timer_callback = GST_DEBUG_FUNCPTR(export_histograms);
+    ptracer_class->write_header = GST_DEBUG_FUNCPTR(set_location);
+
+    gobject_class->finalize = gst_latency_histogram_tracer_finalize;
+}
+
+static void
+gst_latency_histogram_tracer_init(GstLatencyHistogramTracer *self)
+{
+    self->histograms = new LatencyHistograms();
+    self->location = NULL;
+
+    gst_trace_buffer_add_listener(record_latencies, self);
+}
@@ -0,0 +1,14 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+
+#include "gstperiodictracer.hpp"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_LATENCY_HISTOGRAM_TRACER (gst_latency_histogram_tracer_get_type ())
+G_DECLARE_FINAL_TYPE (GstLatencyHistogramTracer, gst_latency_histogram_tracer, GST, LATENCY_HISTOGRAM_TRACER, GstPeriodicTracer)
+
+G_END_DECLS
@@ -41,7 +41,9 @@
 #include "gstqueuelevel.hpp"
 #include "gstbitrate.hpp"
 #include "gstbuffer.hpp"
+#include "gstlatencyhistogram.hpp"
 #include "gstctf.hpp"
+#include "gsttracebuffer.hpp"
 
 static gboolean
 plugin_init(GstPlugin *plugin)
@@ -105,11 +107,20 @@ plugin_init(GstPlugin *plugin)
   {
     return FALSE;
   }
+  if (!gst_tracer_register(plugin, "latencyhistogram", gst_latency_histogram_tracer_get_type()))
+  {
+    return FALSE;
+  }
   if (!gst_ctf_init())
   {
     return FALSE;
   }
 
+  if (!gst_trace_buffer_init())
+  {
+    return FALSE;
+  }
+
   return TRUE;
 }
 
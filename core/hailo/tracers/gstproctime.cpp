@@ -27,6 +27,7 @@
 #include "gstproctimecompute.hpp"
 #include "gstproctime.hpp"
 #include "gstctf.hpp"
+#include "gsttracebuffer.hpp"
 
 GST_DEBUG_CATEGORY_STATIC (gst_proc_time_debug);
 #define GST_CAT_DEFAULT gst_proc_time_debug
@@ -92,13 +93,19 @@ do_push_buffer_pre (GstTracer * self, guint64 ts, GstPad * pad)
       should_calculate);
 
   if (should_log) {
-    time_string = g_strdup_printf ("%" GST_TIME_FORMAT, GST_TIME_ARGS (time));
-
-    gst_tracer_record_log (tr_proc_time, name, time_string);
-
-    do_print_proctime_event (PROCTIME_EVENT_ID, name, time);
-
-    g_free (time_string);
+    GstTraceRecord record = { };
+
+    if (gst_trace_buffer_log_enabled ()) {
+      time_string = g_strdup_printf ("%" GST_TIME_FORMAT, GST_TIME_ARGS (time));
+      gst_tracer_record_log (tr_proc_time, name, time_string);
+      g_free (time_string);
+    }
+
+    record.timestamp = gst_util_get_timestamp ();
+    record.event = PROCTIME_EVENT_ID;
+    record.names[0] = gst_trace_buffer_intern_object (GST_OBJECT_PARENT (pad));
+    record.values[0] = time;
+    gst_trace_buffer_write (&record);
   }
 
   gst_object_unref (pad_peer);
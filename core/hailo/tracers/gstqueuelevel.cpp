@@ -26,6 +26,7 @@
 
 #include "gstqueuelevel.hpp"
 #include "gstctf.hpp"
+#include "gsttracebuffer.hpp"
 
 GST_DEBUG_CATEGORY_STATIC (gst_queue_level_debug);
 #define GST_CAT_DEFAULT gst_queue_level_debug
@@ -99,6 +100,7 @@ do_queue_level (GstTracer * self, guint64 ts, GstPad * pad)
   gchar *size_time_string;
   gchar *max_size_time_string;
   const gchar *element_name;
+  GstTraceRecord record = { };
 
   element = get_parent_element (pad);
 
@@ -115,20 +117,28 @@ do_queue_level (GstTracer * self, guint64 ts, GstPad * pad)
       "max-size-buffers", &max_size_buffers,
       "max-size-time", &max_size_time, NULL);
 
-  size_time_string =
-      g_strdup_printf ("%" GST_TIME_FORMAT, GST_TIME_ARGS (size_time));
+  if (gst_trace_buffer_log_enabled ()) {
+    size_time_string =
+        g_strdup_printf ("%" GST_TIME_FORMAT, GST_TIME_ARGS (size_time));
 
-  max_size_time_string =
-      g_strdup_printf ("%" GST_TIME_FORMAT, GST_TIME_ARGS (max_size_time));
+    max_size_time_string =
+        g_strdup_printf ("%" GST_TIME_FORMAT, GST_TIME_ARGS (max_size_time));
 
-  gst_tracer_record_log (tr_qlevel, element_name, size_bytes, max_size_bytes,
-      size_buffers, max_size_buffers, size_time_string, max_size_time_string);
+    gst_tracer_record_log (tr_qlevel, element_name, size_bytes, max_size_bytes,
+        size_buffers, max_size_buffers, size_time_string, max_size_time_string);
 
-  g_free (size_time_string);
-  g_free (max_size_time_string);
+    g_free (size_time_string);
+    g_free (max_size_time_string);
+  }
 
-  do_print_queue_level_event (QUEUE_LEVEL_EVENT_ID, element_name, size_bytes,
-      max_size_bytes, size_buffers, max_size_buffers, size_time, max_size_time);
+  record.timestamp = gst_util_get_timestamp ();
+  record.event = QUEUE_LEVEL_EVENT_ID;
+  record.names[0] = gst_trace_buffer_intern_object (GST_OBJECT_CAST (element));
+  record.values[0] = size_bytes | ((guint64) max_size_bytes << 32);
+  record.values[1] = size_buffers | ((guint64) max_size_buffers << 32);
+  record.values[2] = size_time;
+  record.values[3] = max_size_time;
+  gst_trace_buffer_write (&record);
 
 out:
   {
@@ -26,6 +26,7 @@
 
 #include "gstscheduletime.hpp"
 #include "gstctf.hpp"
+#include "gsttracebuffer.hpp"
 
 GST_DEBUG_CATEGORY_STATIC (gst_scheduletime_debug);
 #define GST_CAT_DEFAULT gst_scheduletime_debug
@@ -99,7 +100,6 @@ sched_time_compute (GstTracer * tracer, guint64 ts, GstPad * pad)
   self = GST_SCHEDULETIME_TRACER (tracer);
   schedule_pads = self->schedule_pads;
 
-  g_snprintf (pad_name, PAD_NAME_SIZE, "%s_%s", GST_DEBUG_PAD_NAME (pad));
   schedule_pad = (GstSchedulePad *) g_hash_table_lookup (schedule_pads, pad);
 
   if (NULL == schedule_pad) {
@@ -115,15 +115,24 @@ sched_time_compute (GstTracer * tracer, guint64 ts, GstPad * pad)
   }
 
   if (schedule_pad->previous_time != 0) {
-    time_string = g_string_new ("");
+    GstTraceRecord record = { };
+
     time_diff = GST_CLOCK_DIFF (schedule_pad->previous_time, ts);
-    g_string_printf (time_string, "%" GST_TIME_FORMAT,
-        GST_TIME_ARGS (time_diff));
 
-    gst_tracer_record_log (tr_schedule, pad_name, time_string->str);
+    if (gst_trace_buffer_log_enabled ()) {
+      g_snprintf (pad_name, PAD_NAME_SIZE, "%s_%s", GST_DEBUG_PAD_NAME (pad));
+      time_string = g_string_new ("");
+      g_string_printf (time_string, "%" GST_TIME_FORMAT,
+          GST_TIME_ARGS (time_diff));
+      gst_tracer_record_log (tr_schedule, pad_name, time_string->str);
+      g_string_free (time_string, TRUE);
+    }
 
-    do_print_scheduling_event (SCHED_TIME_EVENT_ID, pad_name, time_diff);
-    g_string_free (time_string, TRUE);
+    record.timestamp = gst_util_get_timestamp ();
+    record.event = SCHED_TIME_EVENT_ID;
+    record.names[0] = gst_trace_buffer_intern_pad (pad);
+    record.values[0] = time_diff;
+    gst_trace_buffer_write (&record);
   }
   schedule_pad->previous_time = ts;
 }
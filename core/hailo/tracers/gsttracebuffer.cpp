@@ -0,0 +1,519 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * SECTION:gsttracebuffer
+ * @short_description: low overhead backend for the tracers
+ *
+ * Tracers write fixed size binary records (#GstTraceRecord) into a ring buffer of their
+ * streaming thread - no lock, no allocation and no string formatting per buffer.
+ * Pads and elements are interned once into numeric ids.
+ * A background drainer empties the rings every TRACE_BUFFER_DRAIN_INTERVAL_MS, and writes the
+ * records as CTF events (default, stamped with the time each record was written by its tracer)
+ * or into a compact binary file (HAILO_TRACE_FORMAT=binary) that keeps the time of every record,
+ * decoded by tools/trace_analyzer/decode_hailo_trace.py, or nowhere (HAILO_TRACE_FORMAT=none).
+ * Listeners (e.g. the latencyhistogram tracer) get every drained batch, whatever the format.
+ * When a ring is full the record is dropped and counted, a streaming thread never waits for the drainer.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "gsttracebuffer.hpp"
+
+GST_DEBUG_CATEGORY_STATIC (gst_trace_buffer_debug);
+#define GST_CAT_DEFAULT gst_trace_buffer_debug
+
+/* Records per thread, a power of 2 */
+#define TRACE_BUFFER_RING_SIZE (4096)
+#define TRACE_BUFFER_DRAIN_INTERVAL_MS (10)
+#define TRACE_BUFFER_MAX_NAME (255)
+#define TRACE_BUFFER_MAX_PAYLOAD (2 * (TRACE_BUFFER_MAX_NAME + 1) + 4 * sizeof (guint32) + 2 * sizeof (guint64))
+#define TRACE_BUFFER_UNKNOWN_NAME "unknown"
+
+G_STATIC_ASSERT (sizeof (GstTraceRecord) == 56);
+G_STATIC_ASSERT ((TRACE_BUFFER_RING_SIZE & (TRACE_BUFFER_RING_SIZE - 1)) == 0);
+
+typedef enum
+{
+  TRACE_FORMAT_CTF,
+  TRACE_FORMAT_BINARY,
+  TRACE_FORMAT_NONE,
+} trace_format;
+
+/* A ring written only by its thread and read only by the drainer */
+class TraceRing
+{
+public:
+  std::vector<GstTraceRecord> records;
+  guint16 index;
+  alignas (64) std::atomic<guint64> head{0};
+  alignas (64) std::atomic<guint64> tail{0};
+  std::atomic<guint64> dropped{0};
+  std::atomic<bool> orphaned{false};
+  /* Drops already reported, touched by the drainer only */
+  guint64 reported_dropped = 0;
+
+  explicit TraceRing (guint16 index) : records (TRACE_BUFFER_RING_SIZE), index (index) {}
+
+  void push (const GstTraceRecord & record)
+  {
+    guint64 position = head.load (std::memory_order_relaxed);
+    if (position - tail.load (std::memory_order_acquire) >= TRACE_BUFFER_RING_SIZE) {
+      dropped.fetch_add (1, std::memory_order_relaxed);
+      return;
+    }
+    records[position & (TRACE_BUFFER_RING_SIZE - 1)] = record;
+    head.store (position + 1, std::memory_order_release);
+  }
+};
+
+/* Orphans the ring of a thread when the thread exits, the drainer frees it once it is empty */
+struct TraceRingHolder
+{
+  std::shared_ptr<TraceRing> ring;
+
+  ~TraceRingHolder ()
+  {
+    if (ring)
+      ring->orphaned.store (true, std::memory_order_release);
+  }
+};
+
+struct GstTraceBuffer
+{
+  trace_format format = TRACE_FORMAT_CTF;
+  FILE *binary = NULL;
+  GQuark pad_quark = 0;
+  GQuark object_quark = 0;
+  GstDebugCategory *tracer_category = NULL;
+
+  /* Guards rings, names, name_ids, next_thread and stop */
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<std::shared_ptr<TraceRing>> rings;
+  std::vector<std::string> names;
+  std::unordered_map<std::string, guint32> name_ids;
+  guint16 next_thread = 0;
+  bool stop = false;
+  std::thread drainer;
+
+  /* Guards listeners, held while they are called so a removed listener is never called after */
+  std::mutex listeners_mutex;
+  std::vector<std::pair<GstTraceBufferListener, gpointer>> listeners;
+
+  /* Drainer state */
+  std::vector<std::string> drained_names;
+  std::vector<GstTraceRecord> batch;
+};
+
+static GstTraceBuffer *trace_buffer = NULL;
+static thread_local TraceRingHolder thread_ring;
+
+static guint8 *
+write_string (guint8 * mem, const std::string & str)
+{
+  memcpy (mem, str.c_str (), str.size () + 1);
+  return mem + str.size () + 1;
+}
+
+static guint8 *
+write_uint32 (guint8 * mem, guint32 value)
+{
+  GST_WRITE_UINT32_LE (mem, value);
+  return mem + sizeof (guint32);
+}
+
+static guint8 *
+write_uint64 (guint8 * mem, guint64 value)
+{
+  GST_WRITE_UINT64_LE (mem, value);
+  return mem + sizeof (guint64);
+}
+
+static const std::string &
+drained_name (guint32 id)
+{
+  static const std::string unknown = TRACE_BUFFER_UNKNOWN_NAME;
+  return id < trace_buffer->drained_names.size ()? trace_buffer->drained_names[id] : unknown;
+}
+
+/* Serialize a record as the payload of its CTF event, the layouts of the do_print_*_event functions */
+static gsize
+encode_ctf_payload (const GstTraceRecord & record, guint8 * payload)
+{
+  guint8 *mem = payload;
+
+  switch (record.event) {
+    case INTERLATENCY_EVENT_ID:
+      mem = write_string (mem, drained_name (record.names[0]));
+      mem = write_string (mem, drained_name (record.names[1]));
+      mem = write_uint64 (mem, record.values[0]);
+      break;
+    case PROCTIME_EVENT_ID:
+    case SCHED_TIME_EVENT_ID:
+    case FPS_EVENT_ID:
+      mem = write_string (mem, drained_name (record.names[0]));
+      mem = write_uint64 (mem, record.values[0]);
+      break;
+    case QUEUE_LEVEL_EVENT_ID:
+      mem = write_string (mem, drained_name (record.names[0]));
+      mem = write_uint32 (mem, (guint32) record.values[0]);
+      mem = write_uint32 (mem, (guint32) (record.values[0] >> 32));
+      mem = write_uint32 (mem, (guint32) record.values[1]);
+      mem = write_uint32 (mem, (guint32) (record.values[1] >> 32));
+      mem = write_uint64 (mem, record.values[2]);
+      mem = write_uint64 (mem, record.values[3]);
+      break;
+    default:
+      GST_WARNING ("Trace record of unknown event %u", record.event);
+      break;
+  }
+  return mem - payload;
+}
+
+static void
+write_binary_name (guint32 id, const std::string & name)
+{
+  GstTraceRecord record = { };
+
+  record.timestamp = gst_util_get_timestamp ();
+  record.event = TRACE_BUFFER_NAME_EVENT_ID;
+  record.names[0] = id;
+  record.values[0] = name.size ();
+  fwrite (&record, sizeof (record), 1, trace_buffer->binary);
+  fwrite (name.data (), 1, name.size (), trace_buffer->binary);
+}
+
+static void
+report_dropped (TraceRing & ring)
+{
+  guint64 dropped = ring.dropped.load (std::memory_order_relaxed);
+
+  if (dropped == ring.reported_dropped)
+    return;
+
+  if (trace_buffer->format == TRACE_FORMAT_BINARY) {
+    GstTraceRecord record = { };
+
+    record.timestamp = gst_util_get_timestamp ();
+    record.event = TRACE_BUFFER_DROPPED_EVENT_ID;
+    record.thread = ring.index;
+    record.values[0] = dropped - ring.reported_dropped;
+    fwrite (&record, sizeof (record), 1, trace_buffer->binary);
+  }
+  GST_WARNING ("%" G_GUINT64_FORMAT " trace records of thread %u were dropped, its ring is full",
+      dropped - ring.reported_dropped, ring.index);
+  ring.reported_dropped = dropped;
+}
+
+/* Move the records of all the rings to the output, called by the drainer only */
+static void
+trace_buffer_drain (void)
+{
+  std::vector<std::shared_ptr<TraceRing>> rings;
+  std::vector<guint64> heads;
+  size_t first_name;
+  guint8 payload[TRACE_BUFFER_MAX_PAYLOAD];
+
+  {
+    std::lock_guard<std::mutex> lock (trace_buffer->mutex);
+    rings = trace_buffer->rings;
+  }
+  heads.reserve (rings.size ());
+  for (auto & ring : rings)
+    heads.push_back (ring->head.load (std::memory_order_acquire));
+
+  /* A name is interned before the records referring to it are written,
+   * so reading the names after the heads gets every name the records need */
+  {
+    std::lock_guard<std::mutex> lock (trace_buffer->mutex);
+    first_name = trace_buffer->drained_names.size ();
+    trace_buffer->drained_names.insert (trace_buffer->drained_names.end (),
+        trace_buffer->names.begin () + first_name, trace_buffer->names.end ());
+  }
+  if (trace_buffer->format == TRACE_FORMAT_BINARY) {
+    for (size_t id = first_name; id < trace_buffer->drained_names.size (); id++)
+      write_binary_name (id, trace_buffer->drained_names[id]);
+  }
+
+  /* Rings are in order per thread only, sort the batch to write it in time order */
+  trace_buffer->batch.clear ();
+  for (size_t i = 0; i < rings.size (); i++) {
+    TraceRing & ring = *rings[i];
+    for (guint64 position = ring.tail.load (std::memory_order_relaxed); position < heads[i]; position++)
+      trace_buffer->batch.push_back (ring.records[position & (TRACE_BUFFER_RING_SIZE - 1)]);
+    ring.tail.store (heads[i], std::memory_order_release);
+    report_dropped (ring);
+  }
+  std::stable_sort (trace_buffer->batch.begin (), trace_buffer->batch.end (),
+      [](const GstTraceRecord & a, const GstTraceRecord & b)
+      { return a.timestamp < b.timestamp; });
+
+  if (!trace_buffer->batch.empty ()) {
+    std::lock_guard<std::mutex> lock (trace_buffer->listeners_mutex);
+    for (auto & listener : trace_buffer->listeners)
+      listener.first (trace_buffer->batch.data (), trace_buffer->batch.size (), listener.second);
+  }
+
+  if (trace_buffer->format == TRACE_FORMAT_BINARY) {
+    fwrite (trace_buffer->batch.data (), sizeof (GstTraceRecord),
+        trace_buffer->batch.size (), trace_buffer->binary);
+    fflush (trace_buffer->binary);
+  } else if (trace_buffer->format == TRACE_FORMAT_CTF) {
+    for (const GstTraceRecord & record : trace_buffer->batch) {
+      gsize payload_size = encode_ctf_payload (record, payload);
+      if (payload_size > 0)
+        do_print_ctf_event ((event_id) record.event, record.timestamp, payload, payload_size);
+    }
+  }
+
+  /* Free the rings of the threads that exited once they are empty */
+  {
+    std::lock_guard<std::mutex> lock (trace_buffer->mutex);
+    auto & all_rings = trace_buffer->rings;
+    all_rings.erase (std::remove_if (all_rings.begin (), all_rings.end (),
+            [](const std::shared_ptr<TraceRing> & ring)
+            {
+              return ring->orphaned.load (std::memory_order_acquire) &&
+                  ring->tail.load (std::memory_order_relaxed) == ring->head.load (std::memory_order_acquire);
+            }), all_rings.end ());
+  }
+}
+
+static void
+trace_buffer_drainer_loop (void)
+{
+  std::unique_lock<std::mutex> lock (trace_buffer->mutex);
+  while (!trace_buffer->stop) {
+    trace_buffer->cv.wait_for (lock, std::chrono::milliseconds (TRACE_BUFFER_DRAIN_INTERVAL_MS));
+    lock.unlock ();
+    trace_buffer_drain ();
+    lock.lock ();
+  }
+}
+
+static TraceRing *
+trace_buffer_add_ring (void)
+{
+  std::lock_guard<std::mutex> lock (trace_buffer->mutex);
+  thread_ring.ring = std::make_shared<TraceRing> (trace_buffer->next_thread++);
+  trace_buffer->rings.push_back (thread_ring.ring);
+  return thread_ring.ring.get ();
+}
+
+static void
+trace_buffer_open_binary (void)
+{
+  gchar *path;
+  guint8 header[16];
+
+  path = g_build_filename (get_ctf_path_name (), TRACE_BUFFER_BINARY_FILE, NULL);
+  trace_buffer->binary = g_fopen (path, "wb");
+  if (NULL == trace_buffer->binary) {
+    GST_ERROR ("Could not open binary trace file %s, using CTF", path);
+    g_free (path);
+    return;
+  }
+  g_free (path);
+
+  GST_WRITE_UINT32_LE (header, TRACE_BUFFER_BINARY_MAGIC);
+  GST_WRITE_UINT16_LE (header + 4, TRACE_BUFFER_BINARY_VERSION);
+  GST_WRITE_UINT16_LE (header + 6, sizeof (GstTraceRecord));
+  GST_WRITE_UINT64_LE (header + 8, gst_util_get_timestamp ());
+  fwrite (header, 1, sizeof (header), trace_buffer->binary);
+  trace_buffer->format = TRACE_FORMAT_BINARY;
+}
+
+gboolean
+gst_trace_buffer_init (void)
+{
+  const gchar *format;
+
+  if (trace_buffer) {
+    GST_ERROR ("Trace buffer already exists.");
+    return FALSE;
+  }
+
+  GST_DEBUG_CATEGORY_INIT (gst_trace_buffer_debug, "tracebuffer", 0, "tracers ring buffer backend");
+
+  trace_buffer = new GstTraceBuffer ();
+  trace_buffer->pad_quark = g_quark_from_static_string ("hailo-trace-buffer-pad-id");
+  trace_buffer->object_quark = g_quark_from_static_string ("hailo-trace-buffer-object-id");
+  trace_buffer->tracer_category = gst_debug_get_category ("GST_TRACER");
+
+  format = g_getenv (TRACE_BUFFER_FORMAT_ENV);
+  if (NULL != format && 0 == g_ascii_strcasecmp (format, "binary")) {
+    trace_buffer_open_binary ();
+  } else if (NULL != format && 0 == g_ascii_strcasecmp (format, "none")) {
+    trace_buffer->format = TRACE_FORMAT_NONE;
+  } else if (NULL != format && 0 != g_ascii_strcasecmp (format, "ctf")) {
+    GST_ERROR ("Invalid trace format \"%s\", using CTF", format);
+  }
+
+  trace_buffer->drainer = std::thread (trace_buffer_drainer_loop);
+  /* Drain what is left when the application exits */
+  atexit (gst_trace_buffer_close);
+
+  return TRUE;
+}
+
+void
+gst_trace_buffer_close (void)
+{
+  if (NULL == trace_buffer)
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock (trace_buffer->mutex);
+    if (trace_buffer->stop)
+      return;
+    trace_buffer->stop = true;
+  }
+  trace_buffer->cv.notify_all ();
+  if (trace_buffer->drainer.joinable ())
+    trace_buffer->drainer.join ();
+
+  trace_buffer_drain ();
+  if (NULL != trace_buffer->binary) {
+    fclose (trace_buffer->binary);
+    trace_buffer->binary = NULL;
+    /* Records written from now on are never drained, the rings drop them once full */
+    trace_buffer->format = TRACE_FORMAT_NONE;
+  }
+}
+
+guint32
+gst_trace_buffer_intern (const gchar * name)
+{
+  std::string key (name ? name : TRACE_BUFFER_UNKNOWN_NAME);
+
+  if (NULL == trace_buffer)
+    return 0;
+
+  if (key.size () > TRACE_BUFFER_MAX_NAME)
+    key.resize (TRACE_BUFFER_MAX_NAME);
+
+  std::lock_guard<std::mutex> lock (trace_buffer->mutex);
+  auto it = trace_buffer->name_ids.find (key);
+  if (it != trace_buffer->name_ids.end ())
+    return it->second;
+
+  guint32 id = trace_buffer->names.size ();
+  trace_buffer->names.push_back (key);
+  trace_buffer->name_ids.emplace (std::move (key), id);
+  return id;
+}
+
+/* The id is kept on the pad, so only the first record of a pad formats and looks up its name */
+guint32
+gst_trace_buffer_intern_pad (GstPad * pad)
+{
+  gpointer cached;
+  gchar *name;
+  guint32 id;
+
+  if (NULL == trace_buffer || NULL == pad)
+    return 0;
+
+  cached = g_object_get_qdata (G_OBJECT (pad), trace_buffer->pad_quark);
+  if (cached)
+    return GPOINTER_TO_UINT (cached) - 1;
+
+  name = g_strdup_printf ("%s_%s", GST_DEBUG_PAD_NAME (pad));
+  id = gst_trace_buffer_intern (name);
+  g_free (name);
+  g_object_set_qdata (G_OBJECT (pad), trace_buffer->pad_quark, GUINT_TO_POINTER (id + 1));
+  return id;
+}
+
+guint32
+gst_trace_buffer_intern_object (GstObject * object)
+{
+  gpointer cached;
+  guint32 id;
+
+  if (NULL == trace_buffer || NULL == object)
+    return 0;
+
+  cached = g_object_get_qdata (G_OBJECT (object), trace_buffer->object_quark);
+  if (cached)
+    return GPOINTER_TO_UINT (cached) - 1;
+
+  id = gst_trace_buffer_intern (GST_OBJECT_NAME (object));
+  g_object_set_qdata (G_OBJECT (object), trace_buffer->object_quark, GUINT_TO_POINTER (id + 1));
+  return id;
+}
+
+void
+gst_trace_buffer_write (GstTraceRecord * record)
+{
+  TraceRing *ring;
+
+  if (G_UNLIKELY (NULL == trace_buffer))
+    return;
+
+  ring = thread_ring.ring.get ();
+  if (G_UNLIKELY (NULL == ring))
+    ring = trace_buffer_add_ring ();
+
+  record->thread = ring->index;
+  ring->push (*record);
+}
+
+gchar *
+gst_trace_buffer_lookup_name (guint32 id)
+{
+  if (NULL == trace_buffer)
+    return g_strdup (TRACE_BUFFER_UNKNOWN_NAME);
+
+  std::lock_guard<std::mutex> lock (trace_buffer->mutex);
+  if (id >= trace_buffer->names.size ())
+    return g_strdup (TRACE_BUFFER_UNKNOWN_NAME);
+  return g_strdup (trace_buffer->names[id].c_str ());
+}
+
+void
+gst_trace_buffer_add_listener (GstTraceBufferListener listener, gpointer user_data)
+{
+  if (NULL == trace_buffer)
+    return;
+
+  std::lock_guard<std::mutex> lock (trace_buffer->listeners_mutex);
+  trace_buffer->listeners.emplace_back (listener, user_data);
+}
+
+void
+gst_trace_buffer_remove_listener (GstTraceBufferListener listener, gpointer user_data)
+{
+  if (NULL == trace_buffer)
+    return;
+
+  std::lock_guard<std::mutex> lock (trace_buffer->listeners_mutex);
+  auto & listeners = trace_buffer->listeners;
+  listeners.erase (std::remove (listeners.begin (), listeners.end (),
+          std::make_pair (listener, user_data)), listeners.end ());
+}
+
+/* Whether gst_tracer_record_log prints, so tracers only format their log strings when they are used */
+gboolean
+gst_trace_buffer_log_enabled (void)
+{
+  if (!gst_debug_is_active ())
+    return FALSE;
+  if (NULL == trace_buffer || NULL == trace_buffer->tracer_category)
+    return TRUE;
+  return gst_debug_category_get_threshold (trace_buffer->tracer_category) >= GST_LEVEL_TRACE;
+}
@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+
+#include <gst/gst.h>
+#include "gstctf.hpp"
+
+G_BEGIN_DECLS
+
+/* Output format of the trace buffer, selected with HAILO_TRACE_FORMAT=ctf|binary|none */
+#define TRACE_BUFFER_FORMAT_ENV "HAILO_TRACE_FORMAT"
+/* Name of the binary trace file, written in the CTF output folder */
+#define TRACE_BUFFER_BINARY_FILE "hailotrace.bin"
+#define TRACE_BUFFER_BINARY_MAGIC (0x43525448) /* "HTRC" */
+#define TRACE_BUFFER_BINARY_VERSION (1)
+
+/* Records of the binary file that are not tracer events */
+#define TRACE_BUFFER_NAME_EVENT_ID (0xFFFF)    /* names[0] is named by the values[0] bytes that follow the record */
+#define TRACE_BUFFER_DROPPED_EVENT_ID (0xFFFE) /* values[0] records of the thread were dropped, its ring was full */
+
+/**
+ * A fixed size trace event, as written by the tracers and as stored in the binary file.
+ * Pads and elements are referred to by the ids returned by gst_trace_buffer_intern*.
+ * The meaning of names and values depends on the event:
+ *   INTERLATENCY_EVENT_ID - names: from pad, to pad. values: time.
+ *   PROCTIME_EVENT_ID     - names: element. values: time.
+ *   SCHED_TIME_EVENT_ID   - names: pad. values: time.
+ *   FPS_EVENT_ID          - names: pad. values: fps.
+ *   QUEUE_LEVEL_EVENT_ID  - names: queue. values: bytes | max bytes << 32, buffers | max buffers << 32, time, max time.
+ */
+typedef struct
+{
+  guint64 timestamp; /* gst_util_get_timestamp () time of the event */
+  guint16 event;     /* event_id */
+  guint16 thread;    /* index of the writing thread, set by gst_trace_buffer_write */
+  guint32 names[2];
+  guint32 reserved;
+  guint64 values[4];
+} GstTraceRecord;
+
+/**
+ * Called by the drainer thread with every batch of records, in time order.
+ * It must be quick, the rings fill up while it runs.
+ */
+typedef void (*GstTraceBufferListener) (const GstTraceRecord * records, gsize count, gpointer user_data);
+
+gboolean gst_trace_buffer_init (void);
+void gst_trace_buffer_close (void);
+guint32 gst_trace_buffer_intern (const gchar * name);
+guint32 gst_trace_buffer_intern_pad (GstPad * pad);
+guint32 gst_trace_buffer_intern_object (GstObject * object);
+void gst_trace_buffer_write (GstTraceRecord * record);
+gboolean gst_trace_buffer_log_enabled (void);
+gchar *gst_trace_buffer_lookup_name (guint32 id);
+void gst_trace_buffer_add_listener (GstTraceBufferListener listener, gpointer user_data);
+void gst_trace_buffer_remove_listener (GstTraceBufferListener listener, gpointer user_data);
+
+G_END_DECLS
@@ -2,6 +2,9 @@
  * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
  * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
  **/
+#include <atomic>
+#include <functional>
+#include <shared_mutex>
 
 // Tracker Includes
 #include "jde_tracker/jde_tracker.hpp"
@@ -9,32 +12,152 @@
 #include "hailo_tracker.hpp"
 #include "hailo_common.hpp"
 
-std::mutex HailoTracker::mutex_;
+/**
+ * A tracker and its parameters.
+ * The tracker is only touched under its own mutex, so unrelated trackers are updated in parallel.
+ * Parameter changes are published as a new immutable snapshot (swapped atomically, without taking the mutex),
+ * and applied to the tracker by its next update.
+ */
+class HailoTrackerEntry
+{
+public:
+    std::mutex mutex;
+    JDETracker tracker;
+    std::shared_ptr<const HailoTrackerParams> params;
+    std::shared_ptr<const HailoTrackerParams> applied_params;
+    std::atomic<bool> removed{false};
+
+    explicit HailoTrackerEntry(const HailoTrackerParams &tracker_params)
+        : tracker(tracker_params.kalman_distance,
+                  tracker_params.iou_threshold,
+                  tracker_params.init_iou_threshold,
+                  tracker_params.keep_tracked_frames,
+                  tracker_params.keep_new_frames,
+                  tracker_params.keep_lost_frames,
+                  tracker_params.keep_past_metadata,
+                  tracker_params.std_weight_position,
+                  tracker_params.std_weight_position_box,
+                  tracker_params.std_weight_velocity,
+                  tracker_params.std_weight_velocity_box,
+                  tracker_params.debug,
+                  tracker_params.hailo_objects_blacklist,
+                  tracker_params.assignment_solver),
+          params(std::make_shared<const HailoTrackerParams>(tracker_params)),
+          applied_params(params)
+    {
+    }
+
+    HailoTrackerEntry() : HailoTrackerEntry(default_params()) {}
+
+    static HailoTrackerParams default_params()
+    {
+        JDETracker tracker;
+        return {tracker.get_kalman_distance(),
+                tracker.get_iou_threshold(),
+                tracker.get_init_iou_threshold(),
+                tracker.get_keep_tracked_frames(),
+                tracker.get_keep_new_frames(),
+                tracker.get_keep_lost_frames(),
+                tracker.get_keep_past_metadata(),
+                tracker.get_std_weight_position(),
+                tracker.get_std_weight_position_box(),
+                tracker.get_std_weight_velocity(),
+                tracker.get_std_weight_velocity_box(),
+                tracker.get_debug(),
+                tracker.get_hailo_objects_blacklist(),
+                tracker.get_assignment_solver()};
+    }
+
+    // Publish a copy of the latest snapshot with one change, retrying if another setter published first
+    void modify_params(const std::function<void(HailoTrackerParams &)> &modify)
+    {
+        std::shared_ptr<const HailoTrackerParams> current = std::atomic_load(&params);
+        std::shared_ptr<const HailoTrackerParams> next;
+        do
+        {
+            auto copy = std::make_shared<HailoTrackerParams>(*current);
+            modify(*copy);
+            next = std::move(copy);
+        } while (!std::atomic_compare_exchange_weak(&params, &current, next));
+    }
+
+    // Apply the latest snapshot to the tracker, called with the mutex held
+    void apply_params()
+    {
+        std::shared_ptr<const HailoTrackerParams> latest = std::atomic_load(&params);
+        if (latest == applied_params)
+            return;
+        tracker.set_kalman_distance(latest->kalman_distance);
+        tracker.set_iou_threshold(latest->iou_threshold);
+        tracker.set_init_iou_threshold(latest->init_iou_threshold);
+        tracker.set_keep_tracked_frames(latest->keep_tracked_frames);
+        tracker.set_keep_new_frames(latest->keep_new_frames);
+        tracker.set_keep_lost_frames(latest->keep_lost_frames);
+        tracker.set_keep_past_metadata(latest->keep_past_metadata);
+        tracker.set_std_weight_position(latest->std_weight_position);
+        tracker.set_std_weight_position_box(latest->std_weight_position_box);
+        tracker.set_std_weight_velocity(latest->std_weight_velocity);
+        tracker.set_std_weight_velocity_box(latest->std_weight_velocity_box);
+        tracker.set_debug(latest->debug);
+        tracker.set_hailo_objects_blacklist(latest->hailo_objects_blacklist);
+        tracker.set_assignment_solver(latest->assignment_solver);
+        applied_params = std::move(latest);
+    }
+};
 
 class HailoTracker::HailoTrackerPrivate
 {
 public:
-    std::map<std::string, JDETracker> trackers;
+    // Guards the registry only, trackers are locked separately
+    std::shared_mutex mutex;
+    std::map<std::string, HailoTrackerHandle> trackers;
+
+    // Find a tracker, nullptr if there is none by that name
+    HailoTrackerHandle get(const std::string &name)
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto tracker = trackers.find(name);
+        if (tracker == trackers.end())
+            return nullptr;
+        return tracker->second;
+    }
+
+    // Find a tracker, or create one with default parameters
+    HailoTrackerHandle get_or_add(const std::string &name)
+    {
+        HailoTrackerHandle tracker = get(name);
+        if (tracker)
+            return tracker;
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        auto &added = trackers[name];
+        if (!added)
+            added = std::make_shared<HailoTrackerEntry>();
+        return added;
+    }
 };
 
 HailoTracker::HailoTracker() : priv(std::make_unique<HailoTrackerPrivate>()){};
 HailoTracker::~HailoTracker(){};
 HailoTracker &HailoTracker::GetInstance()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
     static HailoTracker instance;
     return instance;
 }
 
 void HailoTracker::remove_jde_tracker(const std::string &name)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers.erase(name);
+    std::unique_lock<std::shared_mutex> lock(priv->mutex);
+    auto tracker = priv->trackers.find(name);
+    if (tracker == priv->trackers.end())
+        return;
+    // Handles resolved earlier must not keep updating a tracker that name based calls no longer reach
+    tracker->second->removed = true;
+    priv->trackers.erase(tracker);
 }
 
 std::vector<std::string> HailoTracker::get_trackers_list()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(priv->mutex);
     std::vector<std::string> trackers_list;
     for (auto &tracker : priv->trackers)
     {
@@ -45,42 +168,51 @@ std::vector<std::string> HailoTracker::get_trackers_list()
 
 void HailoTracker::add_jde_tracker(const std::string &name, HailoTrackerParams tracker_params)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    priv->trackers.emplace(std::piecewise_construct, std::forward_as_tuple(name),
-                           std::forward_as_tuple(tracker_params.kalman_distance,
-                                                 tracker_params.iou_threshold,
-                                                 tracker_params.init_iou_threshold,
-                                                 tracker_params.keep_tracked_frames,
-                                                 tracker_params.keep_new_frames,
-                                                 tracker_params.keep_lost_frames,
-                                                 tracker_params.keep_past_metadata,
-                                                 tracker_params.std_weight_position,
-                                                 tracker_params.std_weight_position_box,
-                                                 tracker_params.std_weight_velocity,
-                                                 tracker_params.std_weight_velocity_box,
-                                                 tracker_params.debug,
-                                                 tracker_params.hailo_objects_blacklist));
+    std::unique_lock<std::shared_mutex> lock(priv->mutex);
+    auto &tracker = priv->trackers[name];
+    if (!tracker)
+        tracker = std::make_shared<HailoTrackerEntry>(tracker_params);
 }
 
 void HailoTracker::add_jde_tracker(const std::string &name)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers.emplace(name, JDETracker());
+    std::unique_lock<std::shared_mutex> lock(priv->mutex);
+    auto &tracker = priv->trackers[name];
+    if (!tracker)
+        tracker = std::make_shared<HailoTrackerEntry>();
+}
+
+HailoTrackerHandle HailoTracker::get_jde_tracker(const std::string &name)
+{
+    return priv->get_or_add(name);
+}
+
+bool HailoTracker::is_removed(const HailoTrackerHandle &tracker)
+{
+    return tracker->removed;
 }
 
 std::vector<HailoDetectionPtr> HailoTracker::update(const std::string &name, std::vector<HailoDetectionPtr> &inputs)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto online_stracks = priv->trackers[name].update(inputs);
-    bool debug = priv->trackers[name].get_debug();
+    return update(priv->get_or_add(name), inputs);
+}
+
+std::vector<HailoDetectionPtr> HailoTracker::update(const HailoTrackerHandle &tracker, std::vector<HailoDetectionPtr> &inputs)
+{
+    std::lock_guard<std::mutex> lock(tracker->mutex);
+    tracker->apply_params();
+    auto online_stracks = tracker->tracker.update(inputs);
+    bool debug = tracker->tracker.get_debug();
     return JDETracker::stracks_to_hailo_detections(online_stracks, debug);
 }
 
 void HailoTracker::add_object_to_track(const std::string &name, int track_id, HailoObjectPtr obj)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    STrack *tracked_detection = priv->trackers[name].get_detection_with_id(track_id);
+    HailoTrackerHandle tracker = priv->get(name);
+    if (!tracker)
+        return;
+    std::lock_guard<std::mutex> lock(tracker->mutex);
+    STrack *tracked_detection = tracker->tracker.get_detection_with_id(track_id);
     if (nullptr != tracked_detection)
     {
         tracked_detection->add_object(obj);
@@ -89,8 +221,11 @@ void HailoTracker::add_object_to_track(const std::string &name, int track_id, Ha
 
 void HailoTracker::remove_matrices_from_track(const std::string &name, int track_id)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    STrack *tracked_detection = priv->trackers[name].get_detection_with_id(track_id);
+    HailoTrackerHandle tracker = priv->get(name);
+    if (!tracker)
+        return;
+    std::lock_guard<std::mutex> lock(tracker->mutex);
+    STrack *tracked_detection = tracker->tracker.get_detection_with_id(track_id);
     if (tracked_detection)
     {
         std::vector<HailoObjectPtr> matrices;
@@ -106,78 +241,99 @@ void HailoTracker::remove_matrices_from_track(const std::string &name, int track
 
 void HailoTracker::remove_classifications_from_track(const std::string &name, int track_id, std::string classifier_type)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    STrack *tracked_detection = priv->trackers[name].get_detection_with_id(track_id);
+    HailoTrackerHandle tracker = priv->get(name);
+    if (!tracker)
+        return;
+    std::lock_guard<std::mutex> lock(tracker->mutex);
+    STrack *tracked_detection = tracker->tracker.get_detection_with_id(track_id);
     if (tracked_detection)
     {
         hailo_common::remove_classifications(tracked_detection->get_hailo_detection(), classifier_type);
     }
 }
 
-// Setters for members accessible at element-property level
+// Setters for members accessible at element-property level, unknown trackers are ignored
+static void modify_params(const HailoTrackerHandle &tracker, const std::function<void(HailoTrackerParams &)> &modify)
+{
+    if (tracker)
+        tracker->modify_params(modify);
+}
+
+void HailoTracker::set_params(const std::string &name, HailoTrackerParams params)
+{
+    HailoTrackerHandle tracker = priv->get(name);
+    if (tracker)
+        std::atomic_store(&tracker->params, std::make_shared<const HailoTrackerParams>(std::move(params)));
+}
 void HailoTracker::set_kalman_distance(const std::string &name, float new_distance)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers[name].set_kalman_distance(new_distance);
+    modify_params(priv->get(name), [&](HailoTrackerParams &params)
+                  { params.kalman_distance = new_distance; });
 }
 void HailoTracker::set_iou_threshold(const std::string &name, float new_iou_thr)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers[name].set_iou_threshold(new_iou_thr);
+    modify_params(priv->get(name), [&](HailoTrackerParams &params)
+                  { params.iou_threshold = new_iou_thr; });
 }
 void HailoTracker::set_init_iou_threshold(const std::string &name, float new_init_iou_thr)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers[name].set_init_iou_threshold(new_init_iou_thr);
+    modify_params(priv->get(name), [&](HailoTrackerParams &params)
+                  { params.init_iou_threshold = new_init_iou_thr; });
 }
 void HailoTracker::set_keep_tracked_frames(const std::string &name, int new_keep_tracked)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers[name].set_keep_tracked_frames(new_keep_tracked);
+    modify_params(priv->get(name), [&](HailoTrackerParams &params)
+                  { params.keep_tracked_frames = new_keep_tracked; });
 }
 void HailoTracker::set_keep_new_frames(const std::string &name, int new_keep_new)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers[name].set_keep_new_frames(new_keep_new);
+    modify_params(priv->get(name), [&](HailoTrackerParams &params)
+                  { params.keep_new_frames = new_keep_new; });
 }
 void HailoTracker::set_keep_lost_frames(const std::string &name, int new_keep_lost)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers[name].set_keep_lost_frames(new_keep_lost);
+    modify_params(priv->get(name), [&](HailoTrackerParams &params)
+                  { params.keep_lost_frames = new_keep_lost; });
 }
 void HailoTracker::set_keep_past_metadata(const std::string &name, bool new_keep_past)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers[name].set_keep_past_metadata(new_keep_past);
+    modify_params(priv->get(name), [&](HailoTrackerParams &params)
+                  { params.keep_past_metadata = new_keep_past; });
 }
 void HailoTracker::set_std_weight_position(const std::string &name, float new_std_weight_pos)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers[name].set_std_weight_position(new_std_weight_pos);
+    modify_params(priv->get(name), [&](HailoTrackerParams &params)
+                  { params.std_weight_position = new_std_weight_pos; });
 }
 void HailoTracker::set_std_weight_position_box(const std::string &name, float new_std_weight_position_box)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers[name].set_std_weight_position_box(new_std_weight_position_box);
+    modify_params(priv->get(name), [&](HailoTrackerParams &params)
+                  { params.std_weight_position_box = new_std_weight_position_box; });
 }
 void HailoTracker::set_std_weight_velocity(const std::string &name, float new_std_weight_vel)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers[name].set_std_weight_velocity(new_std_weight_vel);
+    modify_params(priv->get(name), [&](HailoTrackerParams &params)
+                  { params.std_weight_velocity = new_std_weight_vel; });
 }
 void HailoTracker::set_std_weight_velocity_box(const std::string &name, float new_std_weight_velocity_box)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers[name].set_std_weight_velocity_box(new_std_weight_velocity_box);
+    modify_params(priv->get(name), [&](HailoTrackerParams &params)
+                  { params.std_weight_velocity_box = new_std_weight_velocity_box; });
 }
 void HailoTracker::set_debug(const std::string &name, bool new_debug)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers[name].set_debug(new_debug);
+    modify_params(priv->get(name), [&](HailoTrackerParams &params)
+                  { params.debug = new_debug; });
 }
 
 void HailoTracker::set_hailo_objects_blacklist(const std::string &name, std::vector<hailo_object_t> hailo_objects_blacklist_vec)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    priv->trackers[name].set_hailo_objects_blacklist(hailo_objects_blacklist_vec);
+    modify_params(priv->get(name), [&](HailoTrackerParams &params)
+                  { params.hailo_objects_blacklist = hailo_objects_blacklist_vec; });
+}
+
+void HailoTracker::set_assignment_solver(const std::string &name, assignment_solver_t assignment_solver)
+{
+    modify_params(priv->get(name), [&](HailoTrackerParams &params)
+                  { params.assignment_solver = assignment_solver; });
 }
@@ -10,8 +10,10 @@
 #include <mutex>
 #include <thread>
 #include <map>
+#include <memory>
 
 #include "hailo_objects.hpp"
+#include "jde_tracker/cost_matrix.hpp"
 
 #define DEFAULT_KALMAN_DISTANCE (0.7f)
 #define DEFAULT_IOU_THRESHOLD (0.8f)
@@ -23,6 +25,7 @@
 #define DEFAULT_STD_WEIGHT_VELOCITY (0.001)
 #define DEFAULT_STD_WEIGHT_VELOCITY_BOX (0.00000001)
 #define DEFAULT_DEBUG (false)
+#define DEFAULT_ASSIGNMENT_SOLVER (ASSIGNMENT_SOLVER_LAPJV)
 #define DEFAULT_HAILO_OBJECTS_BLACKLIST                     \
     {                                                       \
         HAILO_LANDMARKS, HAILO_DEPTH_MASK, HAILO_CLASS_MASK \
@@ -43,8 +46,14 @@ struct HailoTrackerParams
     float std_weight_velocity_box;
     bool debug;
     std::vector<hailo_object_t> hailo_objects_blacklist;
+    assignment_solver_t assignment_solver;
 };
 
+// A tracker of the registry, updated under its own lock. Safe to use after the tracker is removed from the registry,
+// but it then no longer receives name based calls, so holders check is_removed() and resolve the name again.
+class HailoTrackerEntry;
+using HailoTrackerHandle = std::shared_ptr<HailoTrackerEntry>;
+
 class HailoTracker
 {
 private:
@@ -54,7 +63,6 @@ private:
     HailoTracker &operator=(const HailoTracker &) = delete;
     ~HailoTracker();
     HailoTracker();
-    static std::mutex mutex_;
 
 public:
     static HailoTracker &GetInstance();
@@ -62,12 +70,19 @@ public:
     void add_jde_tracker(const std::string &name);
     void remove_jde_tracker(const std::string &name);
     std::vector<std::string> get_trackers_list();
+    // Resolve a tracker once (creating it if needed), to update it without looking it up by name
+    HailoTrackerHandle get_jde_tracker(const std::string &name);
+    // Whether the tracker was removed from the registry since it was resolved
+    bool is_removed(const HailoTrackerHandle &tracker);
+    // Creates the tracker with default parameters if it does not exist, other name based calls ignore unknown names
     std::vector<HailoDetectionPtr> update(const std::string &name, std::vector<HailoDetectionPtr> &inputs);
+    std::vector<HailoDetectionPtr> update(const HailoTrackerHandle &tracker, std::vector<HailoDetectionPtr> &inputs);
     void add_object_to_track(const std::string &name, int id, HailoObjectPtr obj);
     void remove_classifications_from_track(const std::string &name, int track_id, std::string classifier_type);
     void remove_matrices_from_track(const std::string &name, int track_id);
 
-    // Setters for members accessible at element-property level
+    // Setters for members accessible at element-property level, applied by the next update of the tracker
+    void set_params(const std::string &name, HailoTrackerParams params);
     void set_kalman_distance(const std::string &name, float new_distance);
     void set_iou_threshold(const std::string &name, float new_iou_thr);
     void set_init_iou_threshold(const std::string &name, float new_init_iou_thr);
@@ -81,4 +96,5 @@ public:
     void set_std_weight_velocity_box(const std::string &name, float new_std_weight_velocity_box);
     void set_debug(const std::string &name, bool new_debug);
     void set_hailo_objects_blacklist(const std::string &name, std::vector<hailo_object_t> hailo_objects_blacklist_vec);
+    void set_assignment_solver(const std::string &name, assignment_solver_t assignment_solver);
 };
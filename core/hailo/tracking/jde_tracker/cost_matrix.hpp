@@ -0,0 +1,213 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/*
+  Cost matrix of the JDE Tracker associations and the kernels that fill it.
+  The matrix is one contiguous row-major buffer that keeps its capacity from frame to frame,
+  iou and feature distances are computed with SSE2 / NEON kernels (scalar fallback elsewhere).
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "hailo_simd.hpp"
+
+/**
+ * @brief Solver used to match the rows and columns of a cost matrix.
+ *        LAPJV       - Jonker-Volgenant over the whole matrix, optimal.
+ *        LAPJV_GATED - Jonker-Volgenant over each group of rows/columns connected by
+ *                      a pair under the threshold, optimal and much cheaper on sparse scenes.
+ *        GREEDY      - Cheapest pairs first, approximate but fastest on crowded scenes.
+ */
+typedef enum
+{
+    ASSIGNMENT_SOLVER_LAPJV = 0,
+    ASSIGNMENT_SOLVER_LAPJV_GATED = 1,
+    ASSIGNMENT_SOLVER_GREEDY = 2,
+} assignment_solver_t;
+
+/**
+ * @brief Dense row-major cost matrix backed by one buffer.
+ *        Resizing never shrinks the buffer, so a matrix reused across frames
+ *        stops allocating once it has seen the largest scene.
+ *        The contents after a resize are unspecified, fill functions write every entry.
+ */
+class CostMatrix
+{
+private:
+    std::vector<float> m_data;
+    int m_rows = 0;
+    int m_cols = 0;
+
+public:
+    void resize(int rows, int cols)
+    {
+        m_rows = rows;
+        m_cols = cols;
+        m_data.resize((size_t)rows * cols);
+    }
+    int rows() const { return m_rows; }
+    int cols() const { return m_cols; }
+    bool empty() const { return m_data.empty(); }
+    float *data() { return m_data.data(); }
+    const float *data() const { return m_data.data(); }
+    float *row(int row) { return m_data.data() + (size_t)row * m_cols; }
+    const float *row(int row) const { return m_data.data() + (size_t)row * m_cols; }
+    float &operator()(int row, int col) { return m_data[(size_t)row * m_cols + col]; }
+    const float &operator()(int row, int col) const { return m_data[(size_t)row * m_cols + col]; }
+};
+
+/**
+ * @brief A set of boxes <xmin,ymin,xmax,ymax> stored as structure of arrays,
+ *        so the iou kernel can load 4 boxes per register.
+ */
+struct BoxSet
+{
+    std::vector<float> xmin;
+    std::vector<float> ymin;
+    std::vector<float> xmax;
+    std::vector<float> ymax;
+
+    void resize(size_t size)
+    {
+        xmin.resize(size);
+        ymin.resize(size);
+        xmax.resize(size);
+        ymax.resize(size);
+    }
+    size_t size() const { return xmin.size(); }
+};
+
+/**
+ * @brief Scratch buffers of the assignment solvers, kept by the tracker between frames.
+ */
+struct AssignmentWorkspace
+{
+    std::vector<double> extended;                             // lapjv square cost matrix
+    std::vector<int> x, y;                                    // lapjv row / column solutions
+    std::vector<int> rowsol, colsol;                          // solutions of the full matrix
+    std::vector<int> parent, start, order;                    // gated - connected components of the pairs
+    CostMatrix sub_cost;                                      // gated - cost matrix of one component
+    std::vector<int> sub_rows, sub_cols;                      // gated - indices of a component in the full matrix
+    std::vector<int> sub_rowsol, sub_colsol;                  // gated - solutions of one component
+    std::vector<std::pair<float, std::pair<int, int>>> pairs; // greedy - candidate pairs
+};
+
+namespace cost_kernels
+{
+    /**
+     * @brief Fill one row of an iou distance matrix: 1 - iou(a, b[j]) for every box of b.
+     *        Pairs that do not overlap get a distance of exactly 1.
+     *
+     * @param a  -  const float[4]
+     *        The row box <xmin,ymin,xmax,ymax>.
+     *
+     * @param b  -  const BoxSet &
+     *        The column boxes.
+     *
+     * @param out  -  float *
+     *        The row to fill, b.size() entries.
+     */
+    inline void iou_distance_row(const float a[4], const BoxSet &b, float *out)
+    {
+        const size_t count = b.size();
+        const float a_area = (a[2] - a[0]) * (a[3] - a[1]);
+        size_t j = 0;
+#if defined(HAILO_SIMD_SSE2)
+        const __m128 ax0 = _mm_set1_ps(a[0]), ay0 = _mm_set1_ps(a[1]), ax1 = _mm_set1_ps(a[2]), ay1 = _mm_set1_ps(a[3]);
+        const __m128 area = _mm_set1_ps(a_area), zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+        for (; j + 4 <= count; j += 4)
+        {
+            __m128 bx0 = _mm_loadu_ps(&b.xmin[j]), by0 = _mm_loadu_ps(&b.ymin[j]);
+            __m128 bx1 = _mm_loadu_ps(&b.xmax[j]), by1 = _mm_loadu_ps(&b.ymax[j]);
+            __m128 iw = _mm_sub_ps(_mm_min_ps(ax1, bx1), _mm_max_ps(ax0, bx0));
+            __m128 ih = _mm_sub_ps(_mm_min_ps(ay1, by1), _mm_max_ps(ay0, by0));
+            __m128 inter = _mm_mul_ps(iw, ih);
+            __m128 b_area = _mm_mul_ps(_mm_sub_ps(bx1, bx0), _mm_sub_ps(by1, by0));
+            __m128 iou = _mm_div_ps(inter, _mm_sub_ps(_mm_add_ps(area, b_area), inter));
+            __m128 overlap = _mm_and_ps(_mm_cmpgt_ps(iw, zero), _mm_cmpgt_ps(ih, zero));
+            _mm_storeu_ps(out + j, _mm_sub_ps(one, _mm_and_ps(overlap, iou)));
+        }
+#elif defined(HAILO_SIMD_NEON)
+        const float32x4_t ax0 = vdupq_n_f32(a[0]), ay0 = vdupq_n_f32(a[1]), ax1 = vdupq_n_f32(a[2]), ay1 = vdupq_n_f32(a[3]);
+        const float32x4_t area = vdupq_n_f32(a_area), zero = vdupq_n_f32(0.0f), one = vdupq_n_f32(1.0f);
+        for (; j + 4 <= count; j += 4)
+        {
+            float32x4_t bx0 = vld1q_f32(&b.xmin[j]), by0 = vld1q_f32(&b.ymin[j]);
+            float32x4_t bx1 = vld1q_f32(&b.xmax[j]), by1 = vld1q_f32(&b.ymax[j]);
+            float32x4_t iw = vsubq_f32(vminq_f32(ax1, bx1), vmaxq_f32(ax0, bx0));
+            float32x4_t ih = vsubq_f32(vminq_f32(ay1, by1), vmaxq_f32(ay0, by0));
+            float32x4_t inter = vmulq_f32(iw, ih);
+            float32x4_t b_area = vmulq_f32(vsubq_f32(bx1, bx0), vsubq_f32(by1, by0));
+            float32x4_t iou = vdivq_f32(inter, vsubq_f32(vaddq_f32(area, b_area), inter));
+            uint32x4_t overlap = vandq_u32(vcgtq_f32(iw, zero), vcgtq_f32(ih, zero));
+            float32x4_t masked = vreinterpretq_f32_u32(vandq_u32(overlap, vreinterpretq_u32_f32(iou)));
+            vst1q_f32(out + j, vsubq_f32(one, masked));
+        }
+#endif
+        for (; j < count; j++)
+        {
+            float iw = std::min(a[2], b.xmax[j]) - std::max(a[0], b.xmin[j]);
+            float ih = std::min(a[3], b.ymax[j]) - std::max(a[1], b.ymin[j]);
+            float iou = 0.0f;
+            if (iw > 0.0f && ih > 0.0f)
+            {
+                float b_area = (b.xmax[j] - b.xmin[j]) * (b.ymax[j] - b.ymin[j]);
+                iou = iw * ih / (a_area + b_area - iw * ih);
+            }
+            out[j] = 1.0f - iou;
+        }
+    }
+
+    /**
+     * @brief Squared euclidean distance between two feature vectors.
+     *
+     * @param a  -  const float *
+     *        First feature vector.
+     *
+     * @param b  -  const float *
+     *        Second feature vector.
+     *
+     * @param size  -  size_t
+     *        Length of the vectors.
+     *
+     * @return float
+     *         sum((a - b)^2)
+     */
+    inline float squared_distance(const float *a, const float *b, size_t size)
+    {
+        size_t k = 0;
+        float sum = 0.0f;
+#if defined(HAILO_SIMD_SSE2)
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        for (; k + 8 <= size; k += 8)
+        {
+            __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k));
+            __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + k + 4), _mm_loadu_ps(b + k + 4));
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+        }
+        float sums[4];
+        _mm_storeu_ps(sums, _mm_add_ps(acc0, acc1));
+        sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#elif defined(HAILO_SIMD_NEON)
+        float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+        for (; k + 8 <= size; k += 8)
+        {
+            float32x4_t d0 = vsubq_f32(vld1q_f32(a + k), vld1q_f32(b + k));
+            float32x4_t d1 = vsubq_f32(vld1q_f32(a + k + 4), vld1q_f32(b + k + 4));
+            acc0 = vfmaq_f32(acc0, d0, d0);
+            acc1 = vfmaq_f32(acc1, d1, d1);
+        }
+        sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+        for (; k < size; k++)
+            sum += (a[k] - b[k]) * (a[k] - b[k]);
+        return sum;
+    }
+}
@@ -17,6 +17,7 @@
 #include <vector>
 
 // Tappas includes
+#include "cost_matrix.hpp"
 #include "hailo_objects.hpp"
 #include "kalman_filter.hpp"
 #include "lapjv.hpp"
@@ -33,6 +34,7 @@
 #define DEFAULT_STD_WEIGHT_VELOCITY (0.001)
 #define DEFAULT_STD_WEIGHT_VELOCITY_BOX (0.00000001)
 #define DEFAULT_DEBUG (false)
+#define DEFAULT_ASSIGNMENT_SOLVER (ASSIGNMENT_SOLVER_LAPJV)
 
 __BEGIN_DECLS
 class JDETracker
@@ -41,15 +43,16 @@ class JDETracker
     // CLASS MEMBERS
     //******************************************************************
 private:
-    float m_kalman_dist_thr;   // threshold used for kalman tracker, bigger is looser
-    float m_iou_thr;           // threshold used for iou tracker, bigger is looser
-    float m_init_iou_thr;      // threshold used for iou tracker for new detections, bigger is looser
-    int m_keep_tracked_frames; // number of frames to keep tracking w/o detection
-    int m_keep_new_frames;     // number of frames to keep new detections w/o detection
-    int m_keep_lost_frames;    // number of frames to keep lost detections w/o detection
-    bool m_keep_past_metadata; // keep past metadata for new detections
-    int m_frame_id{0};         // the current frame id
-    bool m_debug;              // debug flag to ebable output new and lost tracks
+    float m_kalman_dist_thr;                 // threshold used for kalman tracker, bigger is looser
+    float m_iou_thr;                         // threshold used for iou tracker, bigger is looser
+    float m_init_iou_thr;                    // threshold used for iou tracker for new detections, bigger is looser
+    int m_keep_tracked_frames;               // number of frames to keep tracking w/o detection
+    int m_keep_new_frames;                   // number of frames to keep new detections w/o detection
+    int m_keep_lost_frames;                  // number of frames to keep lost detections w/o detection
+    bool m_keep_past_metadata;               // keep past metadata for new detections
+    int m_frame_id{0};                       // the current frame id
+    bool m_debug;                            // debug flag to ebable output new and lost tracks
+    assignment_solver_t m_assignment_solver; // solver used to match stracks between sets
 
     std::vector<STrack> m_tracked_stracks;                 // Currently tracked STracks
     std::vector<STrack> m_lost_stracks;                    // Currently lost STracks
@@ -57,6 +60,14 @@ private:
     KalmanFilter m_kalman_filter;                          // Kalman Filter
     std::vector<hailo_object_t> m_hailo_objects_blacklist; // Objects that will never be kept track of
 
+    // Buffers reused across frames, so a steady scene does not allocate in the association steps
+    CostMatrix m_cost_matrix;                            // Cost matrix of the current association
+    BoxSet m_atlbrs;                                     // Boxes of the cost matrix rows
+    BoxSet m_btlbrs;                                     // Boxes of the cost matrix columns
+    std::vector<TrackerTypes::DETECTBOX> m_measurements; // Detections in measurement space, for gating
+    std::vector<float> m_gating_distance;                // Gating distances of one track to all detections
+    AssignmentWorkspace m_assignment_workspace;          // Scratch buffers of the assignment solvers
+
     //******************************************************************
     // CLASS RESOURCE MANAGEMENT
     //******************************************************************
@@ -68,9 +79,11 @@ public:
                bool keep_past_metadata = DEFAULT_KEEP_PAST_METADATA, float std_weight_position = DEFAULT_STD_WEIGHT_POSITION,
                float std_weight_position_box = DEFAULT_STD_WEIGHT_POSITION_BOX, float std_weight_velocity = DEFAULT_STD_WEIGHT_VELOCITY,
                float std_weight_velocity_box = DEFAULT_STD_WEIGHT_VELOCITY_BOX, bool debug = DEFAULT_DEBUG,
-               std::vector<hailo_object_t> hailo_objects_blacklist_vec = {HAILO_LANDMARKS, HAILO_DEPTH_MASK, HAILO_CLASS_MASK}) : m_kalman_dist_thr(kalman_dist), m_iou_thr(iou_thr), m_init_iou_thr(init_iou_thr),
-                                                                                                                                  m_keep_tracked_frames(keep_tracked), m_keep_new_frames(keep_new), m_keep_lost_frames(keep_lost),
-                                                                                                                                  m_keep_past_metadata(keep_past_metadata), m_debug(debug), m_hailo_objects_blacklist(hailo_objects_blacklist_vec)
+               std::vector<hailo_object_t> hailo_objects_blacklist_vec = {HAILO_LANDMARKS, HAILO_DEPTH_MASK, HAILO_CLASS_MASK},
+               assignment_solver_t assignment_solver = DEFAULT_ASSIGNMENT_SOLVER) : m_kalman_dist_thr(kalman_dist), m_iou_thr(iou_thr), m_init_iou_thr(init_iou_thr),
+                                                                                    m_keep_tracked_frames(keep_tracked), m_keep_new_frames(keep_new), m_keep_lost_frames(keep_lost),
+                                                                                    m_keep_past_metadata(keep_past_metadata), m_debug(debug), m_assignment_solver(assignment_solver),
+                                                                                    m_hailo_objects_blacklist(hailo_objects_blacklist_vec)
     {
         m_kalman_filter = KalmanFilter(std_weight_position, std_weight_position_box, std_weight_velocity, std_weight_velocity_box);
     }
@@ -97,6 +110,7 @@ public:
     void set_std_weight_velocity_box(float std_weight_velocity_box) { m_kalman_filter.set_std_weight_velocity_box(std_weight_velocity_box); }
     void set_debug(bool debug) { m_debug = debug; }
     void set_hailo_objects_blacklist(std::vector<hailo_object_t> hailo_objects_blacklist) { m_hailo_objects_blacklist = hailo_objects_blacklist; }
+    void set_assignment_solver(assignment_solver_t assignment_solver) { m_assignment_solver = assignment_solver; }
 
     // Getters for members accessible at element-property level
     float get_kalman_distance() { return m_kalman_dist_thr; }
@@ -112,6 +126,7 @@ public:
     float get_std_weight_velocity_box() { return m_kalman_filter.get_std_weight_velocity_box(); }
     bool get_debug() { return m_debug; }
     std::vector<hailo_object_t> get_hailo_objects_blacklist() { return m_hailo_objects_blacklist; }
+    assignment_solver_t get_assignment_solver() { return m_assignment_solver; }
 
     //******************************************************************
     // TRACKING FUNCTIONS
@@ -128,10 +143,11 @@ public:
 private:
     void update_unmatches(std::vector<STrack *> strack_pool, std::vector<STrack> &tracked_stracks, std::vector<STrack> &lost_stracks, std::vector<STrack> &new_stracks);
     void update_matches(std::vector<std::pair<int, int>> matches, std::vector<STrack *> tracked_stracks, std::vector<STrack> &detections, std::vector<STrack> &activated_stracks);
-    void linear_assignment(std::vector<std::vector<float>> &cost_matrix, int cost_matrix_rows, int cost_matrix_cols, float thresh, std::vector<std::pair<int, int>> &matches, std::vector<int> &unmatched_a, std::vector<int> &unmatched_b);
+    void linear_assignment(CostMatrix &cost_matrix, int cost_matrix_rows, int cost_matrix_cols, float thresh, std::vector<std::pair<int, int>> &matches, std::vector<int> &unmatched_a, std::vector<int> &unmatched_b);
 
-    std::vector<std::vector<float>> iou_distance(std::vector<STrack *> &atracks, std::vector<STrack> &btracks);
-    std::vector<std::vector<float>> iou_distance(std::vector<STrack> &atracks, std::vector<STrack> &btracks);
+    void iou_distance(std::vector<STrack *> &atracks, std::vector<STrack> &btracks, CostMatrix &cost_matrix);
+    void iou_distance(std::vector<STrack> &atracks, std::vector<STrack> &btracks, CostMatrix &cost_matrix);
+    void iou_distance(BoxSet &atlbrs, BoxSet &btlbrs, CostMatrix &cost_matrix);
 
     std::vector<STrack *> joint_strack_pointers(std::vector<STrack *> &tlista, std::vector<STrack *> &tlistb);
     std::vector<STrack *> joint_strack_pointers(std::vector<STrack> &tlista, std::vector<STrack> &tlistb);
@@ -139,8 +155,8 @@ private:
     std::vector<STrack> sub_stracks(std::vector<STrack> &tlista, std::vector<STrack> &tlistb);
     void remove_duplicate_stracks(std::vector<STrack> &stracksa, std::vector<STrack> &stracksb);
 
-    void embedding_distance(std::vector<STrack *> &tracks, std::vector<STrack> &detections, std::vector<std::vector<float>> &cost_matrix);
-    void fuse_motion(std::vector<std::vector<float>> &cost_matrix, std::vector<STrack *> &tracks, std::vector<STrack> &detections, float lambda_);
+    void embedding_distance(std::vector<STrack *> &tracks, std::vector<STrack> &detections, CostMatrix &cost_matrix);
+    void fuse_motion(CostMatrix &cost_matrix, std::vector<STrack *> &tracks, std::vector<STrack> &detections, float lambda_);
 };
 __END_DECLS
 
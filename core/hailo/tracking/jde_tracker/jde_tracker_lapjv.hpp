@@ -6,6 +6,7 @@
 
 // General cpp includes
 #include <algorithm>
+#include <climits>
 #include <cmath>
 #include <iostream>
 #include <stdexcept>
@@ -13,6 +14,7 @@
 #include <vector>
 
 // Tappas includes
+#include "cost_matrix.hpp"
 #include "lapjv.hpp"
 #include "strack.hpp"
 #include "tracker_macros.hpp"
@@ -22,8 +24,11 @@
  * @brief Performs linear assignment on a given cost matrix.
  *        No return is made, instead vectors are filled with
  *        matching indices for row and column items.
+ *        The matrix is padded to a square (rows + cols) matrix where leaving
+ *        an item unmatched costs cost_limit / 2, so no pair costing more than
+ *        cost_limit is matched.
  * 
- * @param cost  -  std::vector<std::vector<float>>
+ * @param cost  -  const CostMatrix &
  *        A 2D cost matrix of distances between 2 sets of objects
  *
  * @param rowsol  -  std::vector<int>
@@ -34,133 +39,279 @@
  *        A vector to fill with matching indices of items in the rows
  *        ex: colsol[0] = 2 means item 0 in the cols matches item 2 in the rows
  *
+ * @param workspace  -  AssignmentWorkspace &
+ *        Scratch buffers, reused between calls.
+ *
  * @param cost_limit  -  float
  *        The cost limit for lapjv
  *
  * @param return_cost  -  bool
  *        If true, then return the total cost, default true.
  */
-inline double lapjv_external(const std::vector<std::vector<float>> &cost,
+inline double lapjv_external(const CostMatrix &cost,
                              std::vector<int> &rowsol,
                              std::vector<int> &colsol,
+                             AssignmentWorkspace &workspace,
                              float cost_limit = LONG_MAX, bool return_cost = true)
 {
-    std::vector<std::vector<float>> cost_c;
-    cost_c.assign(cost.begin(), cost.end());
-
-    std::vector<std::vector<float>> cost_c_extended;
-
-    int n_rows = cost.size();
-    int n_cols = cost[0].size();
+    int n_rows = cost.rows();
+    int n_cols = cost.cols();
     rowsol.resize(n_rows);
     colsol.resize(n_cols);
 
-    int n = 0;
-    if (n_rows == n_cols)
+    // Square matrix: [cost, limit/2; limit/2, 0]
+    int n = n_rows + n_cols;
+    const double half_limit = (float)(cost_limit / 2.0);
+    std::vector<double> &extended = workspace.extended;
+    extended.resize((size_t)n * n);
+    for (int i = 0; i < n_rows; i++)
     {
-        n = n_rows;
+        const float *cost_row = cost.row(i);
+        double *extended_row = &extended[(size_t)i * n];
+        for (int j = 0; j < n_cols; j++)
+            extended_row[j] = cost_row[j];
+        std::fill(extended_row + n_cols, extended_row + n, half_limit);
     }
-
-    n = n_rows + n_cols;
-    cost_c_extended.resize(n);
-    for (uint i = 0; i < cost_c_extended.size(); i++) {
-        cost_c_extended[i].resize(n);
+    for (int i = n_rows; i < n; i++)
+    {
+        double *extended_row = &extended[(size_t)i * n];
+        std::fill(extended_row, extended_row + n_cols, half_limit);
+        std::fill(extended_row + n_cols, extended_row + n, 0.0);
     }
 
-    for (uint i = 0; i < cost_c_extended.size(); i++)
+    workspace.x.resize(n);
+    workspace.y.resize(n);
+    int *x_c = workspace.x.data();
+    int *y_c = workspace.y.data();
+
+    int ret = lapjv_internal(n, extended.data(), x_c, y_c);
+    if (ret != 0)
     {
-        for (uint j = 0; j < cost_c_extended[i].size(); j++)
-        {
-            cost_c_extended[i][j] = cost_limit / 2.0;
-        }
+        throw std::runtime_error("JDETracker error: incorrect lapjv calculation!");
     }
 
-    for (uint i = n_rows; i < cost_c_extended.size(); i++)
+    double opt = 0.0;
+    for (int i = 0; i < n; i++)
     {
-        for (uint j = n_cols; j < cost_c_extended[i].size(); j++)
-        {
-            cost_c_extended[i][j] = 0;
-        }
+        if (x_c[i] >= n_cols)
+            x_c[i] = -1;
+        if (y_c[i] >= n_rows)
+            y_c[i] = -1;
     }
     for (int i = 0; i < n_rows; i++)
     {
-        for (int j = 0; j < n_cols; j++)
+        rowsol[i] = x_c[i];
+    }
+    for (int i = 0; i < n_cols; i++)
+    {
+        colsol[i] = y_c[i];
+    }
+
+    if (return_cost)
+    {
+        for (uint i = 0; i < rowsol.size(); i++)
         {
-            cost_c_extended[i][j] = cost_c[i][j];
+            if (rowsol[i] != -1)
+            {
+                opt += extended[(size_t)i * n + rowsol[i]];
+            }
         }
     }
 
-    cost_c.clear();
-    cost_c.assign(cost_c_extended.begin(), cost_c_extended.end());
+    return opt;
+}
 
-    double **cost_ptr;
-    cost_ptr = new double *[sizeof(double *) * n];
-    for (int i = 0; i < n; i++)
-        cost_ptr[i] = new double[sizeof(double) * n];
+/**
+ * @brief Finds the root of a node in a union-find forest, compressing the path on the way.
+ */
+inline int assignment_find_root(std::vector<int> &parent, int node)
+{
+    while (parent[node] != node)
+    {
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+    return node;
+}
+
+/**
+ * @brief Performs linear assignment only between items that can be matched.
+ *        Rows and columns are nodes of a graph with an edge for every pair
+ *        cheaper than the threshold (the pairs lapjv_external could ever match).
+ *        Each connected component is solved on its own: single pairs directly,
+ *        larger components with lapjv on their small sub matrix. Items without
+ *        any edge stay unmatched. The optimum is the same as the dense solve,
+ *        while the cost drops from (rows + cols)^3 to the size of the components.
+ *
+ * @param cost  -  const CostMatrix &
+ *        A 2D cost matrix of distances between 2 sets of objects
+ *
+ * @param thresh  -  float
+ *        The cost limit, pairs at or above it are never matched.
+ *
+ * @param rowsol  -  std::vector<int>
+ *        Filled with the matching column of each row, or -1.
+ *
+ * @param colsol  -  std::vector<int>
+ *        Filled with the matching row of each column, or -1.
+ *
+ * @param workspace  -  AssignmentWorkspace &
+ *        Scratch buffers, reused between calls.
+ */
+inline void gated_assignment(const CostMatrix &cost,
+                             float thresh,
+                             std::vector<int> &rowsol,
+                             std::vector<int> &colsol,
+                             AssignmentWorkspace &workspace)
+{
+    int n_rows = cost.rows();
+    int n_cols = cost.cols();
+    int n = n_rows + n_cols;
+    rowsol.assign(n_rows, -1);
+    colsol.assign(n_cols, -1);
 
+    // Union every row with the columns it can be matched to
+    std::vector<int> &parent = workspace.parent;
+    parent.resize(n);
     for (int i = 0; i < n; i++)
+        parent[i] = i;
+    for (int i = 0; i < n_rows; i++)
     {
-        for (int j = 0; j < n; j++)
+        const float *cost_row = cost.row(i);
+        for (int j = 0; j < n_cols; j++)
         {
-            cost_ptr[i][j] = cost_c[i][j];
+            if (cost_row[j] < thresh)
+            {
+                int root_a = assignment_find_root(parent, i);
+                int root_b = assignment_find_root(parent, n_rows + j);
+                if (root_a != root_b)
+                    parent[root_b] = root_a;
+            }
         }
     }
 
-    int x_c[n];
-    int y_c[n];
-
-    int ret = lapjv_internal(n, cost_ptr, x_c, y_c);
-    if (ret != 0)
+    // Bucket the nodes by component (counting sort on the root), rows before columns inside each bucket
+    std::vector<int> &start = workspace.start;
+    std::vector<int> &order = workspace.order;
+    start.assign(n + 1, 0);
+    order.resize(n);
+    for (int i = 0; i < n; i++)
     {
-        throw std::runtime_error("JDETracker error: incorrect lapjv calculation!");
+        parent[i] = assignment_find_root(parent, i);
+        start[parent[i] + 1]++;
     }
+    for (int i = 0; i < n; i++)
+        start[i + 1] += start[i];
+    for (int i = 0; i < n; i++)
+        order[start[parent[i]]++] = i;
+    // start[r] now holds the end of bucket r, the bucket begins at the end of bucket r - 1
 
-    double opt = 0.0;
-
-    if (n != n_rows)
+    int begin = 0;
+    for (int root = 0; root < n; root++)
     {
-        for (int i = 0; i < n; i++)
+        int end = start[root];
+        if (end - begin > 1)
         {
-            if (x_c[i] >= n_cols)
-                x_c[i] = -1;
-            if (y_c[i] >= n_rows)
-                y_c[i] = -1;
-        }
-        for (int i = 0; i < n_rows; i++)
-        {
-            rowsol[i] = x_c[i];
-        }
-        for (int i = 0; i < n_cols; i++)
-        {
-            colsol[i] = y_c[i];
-        }
+            workspace.sub_rows.clear();
+            workspace.sub_cols.clear();
+            for (int k = begin; k < end; k++)
+            {
+                if (order[k] < n_rows)
+                    workspace.sub_rows.push_back(order[k]);
+                else
+                    workspace.sub_cols.push_back(order[k] - n_rows);
+            }
 
-        if (return_cost)
-        {
-            for (uint i = 0; i < rowsol.size(); i++)
+            if (workspace.sub_rows.size() == 1 && workspace.sub_cols.size() == 1)
+            {
+                // A single pair under the threshold is always matched
+                rowsol[workspace.sub_rows[0]] = workspace.sub_cols[0];
+                colsol[workspace.sub_cols[0]] = workspace.sub_rows[0];
+            }
+            else
             {
-                if (rowsol[i] != -1)
+                CostMatrix &sub_cost = workspace.sub_cost;
+                sub_cost.resize(workspace.sub_rows.size(), workspace.sub_cols.size());
+                for (int i = 0; i < sub_cost.rows(); i++)
                 {
-                    opt += cost_ptr[i][rowsol[i]];
+                    const float *cost_row = cost.row(workspace.sub_rows[i]);
+                    float *sub_row = sub_cost.row(i);
+                    for (int j = 0; j < sub_cost.cols(); j++)
+                        sub_row[j] = cost_row[workspace.sub_cols[j]];
+                }
+                lapjv_external(sub_cost, workspace.sub_rowsol, workspace.sub_colsol, workspace, thresh, false);
+                for (int i = 0; i < sub_cost.rows(); i++)
+                {
+                    if (workspace.sub_rowsol[i] >= 0)
+                    {
+                        int row = workspace.sub_rows[i];
+                        int col = workspace.sub_cols[workspace.sub_rowsol[i]];
+                        rowsol[row] = col;
+                        colsol[col] = row;
+                    }
                 }
             }
         }
+        begin = end;
     }
-    else if (return_cost)
+}
+
+/**
+ * @brief Performs a greedy assignment: the pairs cheaper than the threshold
+ *        are matched cheapest first, skipping rows and columns already taken.
+ *        Not optimal, but O(P log P) in the number of candidate pairs, which
+ *        keeps crowded scenes cheap.
+ *
+ * @param cost  -  const CostMatrix &
+ *        A 2D cost matrix of distances between 2 sets of objects
+ *
+ * @param thresh  -  float
+ *        The cost limit, pairs at or above it are never matched.
+ *
+ * @param rowsol  -  std::vector<int>
+ *        Filled with the matching column of each row, or -1.
+ *
+ * @param colsol  -  std::vector<int>
+ *        Filled with the matching row of each column, or -1.
+ *
+ * @param workspace  -  AssignmentWorkspace &
+ *        Scratch buffers, reused between calls.
+ */
+inline void greedy_assignment(const CostMatrix &cost,
+                              float thresh,
+                              std::vector<int> &rowsol,
+                              std::vector<int> &colsol,
+                              AssignmentWorkspace &workspace)
+{
+    int n_rows = cost.rows();
+    int n_cols = cost.cols();
+    rowsol.assign(n_rows, -1);
+    colsol.assign(n_cols, -1);
+
+    auto &pairs = workspace.pairs;
+    pairs.clear();
+    for (int i = 0; i < n_rows; i++)
     {
-        for (uint i = 0; i < rowsol.size(); i++)
+        const float *cost_row = cost.row(i);
+        for (int j = 0; j < n_cols; j++)
         {
-            opt += cost_ptr[i][rowsol[i]];
+            if (cost_row[j] < thresh)
+                pairs.emplace_back(cost_row[j], std::make_pair(i, j));
         }
     }
+    // Ties are broken by row then column, so the result does not depend on the sort implementation
+    std::sort(pairs.begin(), pairs.end());
 
-    for (int i = 0; i < n; i++)
+    for (auto &pair : pairs)
     {
-        delete[] cost_ptr[i];
+        int row = pair.second.first;
+        int col = pair.second.second;
+        if (rowsol[row] < 0 && colsol[col] < 0)
+        {
+            rowsol[row] = col;
+            colsol[col] = row;
+        }
     }
-    delete[] cost_ptr;
-
-    return opt;
 }
 
 
@@ -168,8 +319,9 @@ inline double lapjv_external(const std::vector<std::vector<float>> &cost,
  * @brief Performs linear assignment on a given cost matrix.
  *        No return is made, instead a given matrix of matches is filled,
  *        and vectors are filled for unmatched members of each list.
+ *        The solver is chosen by the assignment-solver member (see assignment_solver_t).
  * 
- * @param cost_matrix  -  std::vector<std::vector<float>>
+ * @param cost_matrix  -  CostMatrix
  *        A 2D cost matrix of distances between 2 sets of objects
  *
  * @param thresh  -  float
@@ -184,7 +336,7 @@ inline double lapjv_external(const std::vector<std::vector<float>> &cost,
  * @param unmatched_b  - std::vector<int>
  *        Indices of unmatched objects from the column items
  */
-inline void JDETracker::linear_assignment(std::vector<std::vector<float>> &cost_matrix,
+inline void JDETracker::linear_assignment(CostMatrix &cost_matrix,
                                           int cost_matrix_rows,
                                           int cost_matrix_cols,
                                           float thresh,
@@ -197,7 +349,7 @@ inline void JDETracker::linear_assignment(std::vector<std::vector<float>> &cost_
     unmatched_a.clear();
     unmatched_b.clear();
 
-	if (cost_matrix.size() == 0)
+	if (cost_matrix.empty())
 	{
 		for (int i = 0; i < cost_matrix_rows; i++)
 		{
@@ -210,9 +362,21 @@ inline void JDETracker::linear_assignment(std::vector<std::vector<float>> &cost_
 		return;
 	}
 
-    std::vector<int> rowsol;
-    std::vector<int> colsol;
-    lapjv_external(cost_matrix, rowsol, colsol, thresh);
+    std::vector<int> &rowsol = m_assignment_workspace.rowsol;
+    std::vector<int> &colsol = m_assignment_workspace.colsol;
+    switch (m_assignment_solver)
+    {
+    case ASSIGNMENT_SOLVER_LAPJV_GATED:
+        gated_assignment(cost_matrix, thresh, rowsol, colsol, m_assignment_workspace);
+        break;
+    case ASSIGNMENT_SOLVER_GREEDY:
+        greedy_assignment(cost_matrix, thresh, rowsol, colsol, m_assignment_workspace);
+        break;
+    case ASSIGNMENT_SOLVER_LAPJV:
+    default:
+        lapjv_external(cost_matrix, rowsol, colsol, m_assignment_workspace, thresh);
+        break;
+    }
 
     for (uint i = 0; i < rowsol.size(); i++)
     {
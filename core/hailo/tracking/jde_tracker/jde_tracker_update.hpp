@@ -211,10 +211,10 @@ inline std::vector<STrack> JDETracker::update(std::vector<HailoDetectionPtr> &in
 
     std::vector<STrack *> strack_pool; // A pool of tracked/lost stracks to find matches for
 
-    std::vector<std::vector<float>> distances; // A distance cost matrix for linear assignment
-    std::vector<std::pair<int, int>> matches;  // Pairs of matches between sets of stracks
-    std::vector<int> unmatched_tracked;        // Unmatched tracked stracks
-    std::vector<int> unmatched_detections;     // Unmatched new detections
+    CostMatrix &distances = this->m_cost_matrix; // A distance cost matrix for linear assignment
+    std::vector<std::pair<int, int>> matches;    // Pairs of matches between sets of stracks
+    std::vector<int> unmatched_tracked;          // Unmatched tracked stracks
+    std::vector<int> unmatched_detections;       // Unmatched new detections
 
     //******************************************************************
     // Step 1: Prepare tracks for new detections
@@ -248,7 +248,7 @@ inline std::vector<STrack> JDETracker::update(std::vector<HailoDetectionPtr> &in
 
     // Instead of embedding distance, this time we will associate based on iou,
     // so calculate the iou distance of what's left
-    distances = iou_distance(strack_pool, detections);
+    iou_distance(strack_pool, detections, distances);
 
     // Recalculate the linear assignment, this time use the iou threshold
     linear_assignment(distances, strack_pool.size(), detections.size(), this->m_iou_thr, matches, unmatched_tracked, unmatched_detections);
@@ -272,7 +272,7 @@ inline std::vector<STrack> JDETracker::update(std::vector<HailoDetectionPtr> &in
     std::vector<STrack *> unconfirmed_pool = joint_strack_pointers(this->m_new_stracks, blank); // Prepare a pool of unconfirmed stracks
 
     // Recalculate the iou distance, this time between unconfirmed stracks and the remaining detections
-    distances = iou_distance(unconfirmed_pool, detections);
+    iou_distance(unconfirmed_pool, detections, distances);
 
     // Recalculate the linear assignment, this time with the lower m_init_iou_thr threshold
     linear_assignment(distances, unconfirmed_pool.size(), detections.size(), this->m_init_iou_thr, matches, unmatched_tracked, unmatched_detections);
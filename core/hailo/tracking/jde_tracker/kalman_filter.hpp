@@ -23,6 +23,7 @@
 // General cpp includes
 #include <algorithm>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -63,14 +64,21 @@ class KalmanFilter
         16.919};
 
     private:
-    // Identity matrices by which to multiply later means and covariances, initialized in the constructor and unchanged later
-    xt::xtensor_fixed<float, xt::xshape<8, 8>, xt::layout_type::row_major> m_motion_matrix;
-    xt::xtensor_fixed<float, xt::xshape<4, 8>, xt::layout_type::row_major> m_update_matrix;
+    // The motion model is constant velocity with a time step of 1 frame (x += vx, y += vy, ...),
+    // and the observation model takes the first 4 state entries (x, y, a, h) as is.
+    // Both are applied in closed form by the kernels below instead of multiplying by their matrices.
+    static constexpr int STATE_DIM = 8;
+    static constexpr int MEASUREMENT_DIM = 4;
     float m_std_weight_position;  // weight of standard deviation for x and y
     float m_std_weight_position_box;  // weight of standard deviation for a and h
     float m_std_weight_velocity;  // weight of standard deviation for vx and vy
     float m_std_weight_velocity_box;  // weight of standard deviation for va and vh
 
+    // Structure-of-arrays scratch buffers of multi_predict, element e of track t is at [e * count + t].
+    // They keep their capacity between frames, so predicting does not allocate once they reached the number of tracks.
+    std::vector<float> m_batch_mean;
+    std::vector<float> m_batch_covariance;
+
     //******************************************************************
     // CLASS RESOURCE MANAGEMENT
     //******************************************************************
@@ -80,15 +88,6 @@ class KalmanFilter
     m_std_weight_position(std_weight_position), m_std_weight_position_box(std_weight_position_box),
     m_std_weight_velocity(std_weight_velocity), m_std_weight_velocity_box(std_weight_velocity_box)
     {
-        int ndim = 4;
-        float dt = 1.;
-
-        m_motion_matrix = xt::eye<float>({8, 8}, 0); // Identity matrix of shape 8 x 8
-        for (int i = 0; i < ndim; i++)
-        {
-            m_motion_matrix(i, ndim + i) = dt;
-        }
-        m_update_matrix = xt::eye<float>({4, 8}, 0); // Identity matrix of shape 4 x 8
     }
 
     // Params setters
@@ -106,242 +105,90 @@ class KalmanFilter
     //******************************************************************
     // LINEAR ALGEBRA HELPER FUNCTIONS
     //******************************************************************
+    // Fixed size kernels working on plain row-major float arrays, fully unrolled by the compiler.
+    // Every sum is accumulated in the same order as the general matrix products they replace,
+    // and the products by the 0/1 entries of the motion and update matrices are exact,
+    // so the results are bit-identical to the matrix formulation.
     private:
     /**
      * @brief Performs a LL^T Cholesky decomposition of a symmetric, positive definite 
      *        matrix A such that A = LLT, where L is a lower triangular matrix and LT it's transpose.
+     *        NOTE: the partial sums are accumulated in an int, as the filter always did.
+     *              The covariances of normalized boxes are far below 1, so the sums are 0 in practice.
      * 
-     * @param matrix  -  TrackerTypes::KAL_HCOVA : <4x4>
-     *        The matrix to decompose, expected to be 4x4, and positive definite
+     * @param matrix  -  const float[4][4]
+     *        The matrix to decompose, positive definite
      *
-     * @return TrackerTypes::KAL_HCOVA  : <4x4>
-     *         The lower triamgular matrix of the cholesky decomposition.
+     * @param lower_matrix  -  float[4][4]
+     *         Output, the lower triamgular matrix of the cholesky decomposition.
      */
-    TrackerTypes::KAL_HCOVA cholesky_decomposition(TrackerTypes::KAL_HCOVA &matrix)
+    static inline void cholesky_decomposition(const float (&matrix)[MEASUREMENT_DIM][MEASUREMENT_DIM],
+                                              float (&lower_matrix)[MEASUREMENT_DIM][MEASUREMENT_DIM])
     {
-        TrackerTypes::KAL_HCOVA lower_matrix = xt::zeros<float>({(int)matrix.shape(0), (int)matrix.shape(0)});
+        for (int i = 0; i < MEASUREMENT_DIM; i++)
+            for (int j = 0; j < MEASUREMENT_DIM; j++)
+                lower_matrix[i][j] = 0.0f;
 
         int sum = 0;
         // Decomposing a matrix into Lower Triangular
-        for (uint i = 0; i < matrix.shape(0); i++) {
-            for (uint j = 0; j <= i; j++) {
+        for (int i = 0; i < MEASUREMENT_DIM; i++) {
+            for (int j = 0; j <= i; j++) {
                 sum = 0;
                 if (j == i) // summation for diagonals
                 {
-                    for (uint k = 0; k < j; k++)
-                        sum += std::pow(lower_matrix(j, k), 2);
-                    lower_matrix(j,j) = std::sqrt(matrix(j,j) - sum);
+                    for (int k = 0; k < j; k++)
+                        sum += std::pow(lower_matrix[j][k], 2);
+                    lower_matrix[j][j] = std::sqrt(matrix[j][j] - sum);
                 } else {
                     // Evaluating L(i, j) using L(j, j)
-                    for (uint k = 0; k < j; k++)
-                        sum += lower_matrix(i, k) * lower_matrix(j, k);
-                    lower_matrix(i, j) = (matrix(i, j) - sum) / lower_matrix(j, j);
+                    for (int k = 0; k < j; k++)
+                        sum += lower_matrix[i][k] * lower_matrix[j][k];
+                    lower_matrix[i][j] = (matrix[i][j] - sum) / lower_matrix[j][j];
                 }
             }
         }
-        return lower_matrix;
     }
 
     /**
-     * @brief Solves the system of linear equations Ax=B
-     *        where A is a lower triangular matrix L.
-     *        In short, performs forward-substitution.
-     * 
-     * @param L  -  xt::xarray<float>
-     *        A lower trangular matrix.
-     *
-     * @param B  -  xt::xarray<float>
-     *        The right-hand-side of the system Ax=B, the number of rows
-     *        must match the rows of L.
-     *
-     * @return xt::xarray<float> 
-     *         The solution x to the system Ax=B.
+     * @brief Standard deviations of the position (x, y, a, h) noise for a given box height.
      */
-    xt::xarray<float> forward_substitution(xt::xarray<float> L, xt::xarray<float> B)
+    inline void position_noise(float height, float *variance) const
     {
-        // Check dimensionality
-        if (L.dimension() != 2 || B.dimension() != 2)
-            throw std::invalid_argument("forward_substitution broadcast error: only 2D matrices supported!");
-
-        // Get the rows and cols
-        int L_rows = L.shape(0);
-        int L_cols = L.shape(1);
-        int B_rows = B.shape(0);
-        int B_cols = B.shape(1);
-
-        // Check broadcasting rules
-        if (L_rows != B_rows)
-            throw std::invalid_argument("forward_substitution broadcast error: rows don't match!");
-
-        // Prepare x matrix
-        float partial_sum = 0.0;
-        xt::xarray<float>::shape_type shape = {(long unsigned int)L_cols, (long unsigned int)B_cols};
-        xt::xarray<float, xt::layout_type::row_major> x = xt::zeros<float>(shape);
-
-        // For each column of x (=B_cols)
-        for (int i = 0; i < B_cols; ++i)
-        {
-            // For each row of x (and row of L, since symmetric)
-            for (int j = 0; j < L_rows; ++j)
-            {
-                partial_sum = 0;  // Reset the partial sum
-                // For each column of L up to the current diagonal (the j current row in L)
-                // This process is forward substitution
-                for (int k = 0; k < j; ++k)
-                {
-                    // Sum the dot product of the L_row*x_col up to the missing diagonal 
-                    partial_sum += L(j, k) * x(k, i);
-                }
-                // x at the missing diagonal is (B - the known sum)/the known L
-                x(j, i) = (B(j, i) - partial_sum) / L(j, j);
-            }
-        }
-        return x;
-    }
-
-    /**
-     * @brief Solves the system of linear equations Ax=B
-     *        where A is an upper triangular matrix U.
-     *        In short, performs back-substitution.
-     * 
-     * @param U  -  xt::xarray<float>
-     *        An upper trangular matrix.
-     *
-     * @param B  -  xt::xarray<float>
-     *        The right-hand-side of the system Ax=B, the number of rows
-     *        must match the rows of U.
-     *
-     * @return xt::xarray<float> 
-     *         The solution x to the system Ax=B.
-     */
-    xt::xarray<float> back_substitution(xt::xarray<float> U, xt::xarray<float> B)
-    {
-        // Check dimensionality
-        if (U.dimension() != 2 || B.dimension() != 2)
-            throw std::invalid_argument("forward_substitution broadcast error: only 2D matrices supported!");
-
-        // Get the rows and cols
-        int U_rows = U.shape(0);
-        int U_cols = U.shape(1);
-        int B_rows = B.shape(0);
-        int B_cols = B.shape(1);
-
-        // Check broadcasting rules
-        if (U_rows != B_rows)
-            throw std::invalid_argument("forward_substitution broadcast error: rows don't match!");
-
-        // Prepare x matrix
-        float partial_sum = 0.0;
-        xt::xarray<float>::shape_type shape = {(long unsigned int)U_cols, (long unsigned int)B_cols};
-        xt::xarray<float, xt::layout_type::row_major> x = xt::zeros<float>(shape);
-
-        // For each column of x (=y_cols=B_cols)
-        for (int i = 0; i < B_cols; ++i)
-        {
-            // For each row of U
-            // Since U is an upper matrix, we have to iterate in ascending order (starting from the bottom rows)
-            for (int j = U_rows - 1; j >= 0; j--)
-            {
-                partial_sum = 0;  // Reset the partial sum
-                // For each column of U up to the current diagonal
-                // Since U is an upper matrix, we have to iterate backwards
-                // This process is back substitution
-                for (int k = U_rows - 1; k > j; k--)
-                {
-                    // Sum the dot product of the U_row*x_col up to the missing diagonal 
-                    partial_sum += U(j, k) * x(k, i);
-                }
-                // x at the missing diagonal is (B - the known sum)/the known U
-                x(j, i) = (B(j, i) - partial_sum) / U(j, j);
-            }
-        }
-        return x;
+        float standard_deviation[MEASUREMENT_DIM] = {m_std_weight_position * height, m_std_weight_position * height,
+                                                     m_std_weight_position_box * height, m_std_weight_position_box * height};
+        for (int i = 0; i < MEASUREMENT_DIM; i++)
+            variance[i] = standard_deviation[i] * standard_deviation[i];
     }
 
     /**
-     * @brief Solves the system of linear equations Ax=B
-     *        using the cholesky decomposition of A.
-     *        Parameters are auto and then adapted to 
-     *        support all types of xcontainers.
-     *
-     *        Given the cholesky A=LLT (where LT = L transposed),
-     *        we can turn Ax=B into LLTx=B, and split this into
-     *        the equations Ly=B, LTx=y. We first solve for y in 
-     *        Ly=B using forward-substitution, then solve for x in
-     *        LTx=y using back-substitution.
-     * 
-     * @param L_  -  any xcontainer
-     *        The cholesky decomposition of A, where A=LLT
-     *
-     * @param B_  -  any xcontainer
-     *        The right-hand-side of the system Ax=B, the number of rows
-     *        must match the sides of L_
-     *
-     * @return xt::xarray<float>
-     *         The solution x to the system Ax=B.
+     * @brief Variances of the motion noise (x, y, a, h, vx, vy, va, vh) for a given box height.
      */
-    xt::xarray<float> solve_linear_eq_with_cholesky(auto L_, auto B_)
+    inline void motion_noise(float height, float *variance) const
     {
-        // Adapt the auto inputs to ensure xarrays
-        xt::xarray<float> L = L_;
-        xt::xarray<float> LT = xt::transpose(L);
-        xt::xarray<float> B = B_;
-
-        // Check dimensionality
-        if (L.dimension() != 2 || B.dimension() != 2)
-            throw std::invalid_argument("solve_cholesky broadcast error: only 2D matrices supported!");
-
-        // Check broadcasting rules: the rows of L and B should match
-        if (L.shape(0) != B.shape(0))
-            throw std::invalid_argument("solve_cholesky broadcast error: rows don't match!");
-
-        // First solve Ly=B with forward-substitution
-        xt::xarray<float, xt::layout_type::row_major> y = forward_substitution(L, B);
-
-        // Then solve LTx=y with back-substitution
-        xt::xarray<float, xt::layout_type::row_major> x = back_substitution(LT, y);
-
-        return x;
+        float standard_deviation[STATE_DIM] = {m_std_weight_position * height, m_std_weight_position * height,
+                                               m_std_weight_position_box * height, m_std_weight_position_box * height,
+                                               m_std_weight_velocity * height, m_std_weight_velocity * height,
+                                               m_std_weight_velocity_box * height, m_std_weight_velocity_box * height};
+        for (int i = 0; i < STATE_DIM; i++)
+            variance[i] = standard_deviation[i] * standard_deviation[i];
     }
 
     /**
-     * @brief Compute matrix multiplication between two 2 dimensional matrices .
-     * 
-     * @param matrix_1  -  xt::xarray<float, xt::layout_type::row_major>
-     *        The LHS matrix, columns must match rows in RHS matrix.
-     * 
-     * @param matrix_2  -  xt::xarray<float, xt::layout_type::row_major>
-     *        The RHS matrix, rows must match columns in LHS matrix.
-     * 
-     * @return xt::xarray<float, xt::layout_type::row_major>
-     *         The matrix multiplication of the two matrices.
-     *         Normal matrix broadcasting rules apply.
+     * @brief Projects a state to measurement space: the projected mean is the first 4 entries of the mean,
+     *        and the projected covariance is the top left 4x4 block of the covariance plus the position noise.
      */
-    xt::xarray<float, xt::layout_type::row_major> mat_mul_2D(xt::xarray<float, xt::layout_type::row_major> matrix_1,
-                                                             xt::xarray<float, xt::layout_type::row_major> matrix_2)
+    inline void project(const float *mean, const float *covariance,
+                        float (&projected_mean)[MEASUREMENT_DIM], float (&projected_covariance)[MEASUREMENT_DIM][MEASUREMENT_DIM]) const
     {
-        uint axis_length = matrix_1.shape(1);
-        if (axis_length != matrix_2.shape(0))
+        float variance[MEASUREMENT_DIM];
+        position_noise(mean[3], variance);
+        for (int i = 0; i < MEASUREMENT_DIM; i++)
         {
-            throw std::invalid_argument("mat_mul_2D broadcast error: axis don't match!");
+            projected_mean[i] = mean[i];
+            for (int j = 0; j < MEASUREMENT_DIM; j++)
+                projected_covariance[i][j] = covariance[i * STATE_DIM + j];
+            projected_covariance[i][i] += variance[i];
         }
-
-        float row_sum;
-        xt::xarray<float>::shape_type shape = {matrix_1.shape(0), matrix_2.shape(1)};
-        xt::xarray<float, xt::layout_type::row_major> product_matrix(shape);
-        for (uint i = 0; i < matrix_1.shape(0); ++i)
-        {
-            for (uint j = 0; j < matrix_2.shape(1); ++j)
-            {
-                row_sum = 0.0;
-                for (uint k = 0; k < matrix_1.shape(1); ++k)
-                {
-                    row_sum += matrix_1(i, k) * matrix_2(k, j);
-                }
-                product_matrix(i, j) = row_sum;
-            }
-        }
-        return product_matrix;
     }
 
     //******************************************************************
@@ -363,24 +210,31 @@ class KalmanFilter
     TrackerTypes::KAL_DATA initiate(const TrackerTypes::DETECTBOX &measurement)
     {
         TrackerTypes::KAL_MEAN mean;
-        xt::view(mean, xt::all(), xt::range(_, 4)) = xt::squeeze(measurement);
-        xt::view(mean, xt::all(), xt::range(4, _)) = xt::zeros<float>({4});
+        TrackerTypes::KAL_COVA var;
+        float *mean_data = mean.data();
+        float *var_data = var.data();
 
         float measured_height = measurement(3);
-        TrackerTypes::KAL_MEAN standard_deviation;
+        float standard_deviation[STATE_DIM];
         // Build standard deviation to the position (x, y, a, h)
-        standard_deviation(0) = 2 * m_std_weight_position * measured_height;
-        standard_deviation(1) = 2 * m_std_weight_position * measured_height;
-        standard_deviation(2) = 2 * m_std_weight_position_box * measured_height;
-        standard_deviation(3) = 2 * m_std_weight_position_box * measured_height;
+        standard_deviation[0] = 2 * m_std_weight_position * measured_height;
+        standard_deviation[1] = 2 * m_std_weight_position * measured_height;
+        standard_deviation[2] = 2 * m_std_weight_position_box * measured_height;
+        standard_deviation[3] = 2 * m_std_weight_position_box * measured_height;
         // Build standard deviation to the velocities (vx, vy, va, vh)
-        standard_deviation(4) = 10 * m_std_weight_velocity * measured_height;
-        standard_deviation(5) = 10 * m_std_weight_velocity * measured_height;
-        standard_deviation(6) = 5 * m_std_weight_velocity_box * measured_height;
-        standard_deviation(7) = 5 * m_std_weight_velocity_box * measured_height;
+        standard_deviation[4] = 10 * m_std_weight_velocity * measured_height;
+        standard_deviation[5] = 10 * m_std_weight_velocity * measured_height;
+        standard_deviation[6] = 5 * m_std_weight_velocity_box * measured_height;
+        standard_deviation[7] = 5 * m_std_weight_velocity_box * measured_height;
 
-        // The standard deviations form the diagonal of the new covariance
-        TrackerTypes::KAL_COVA var = xt::diag(xt::squeeze(xt::square(standard_deviation)));
+        for (int i = 0; i < STATE_DIM; i++)
+        {
+            // Unobserved velocities are initialized to 0
+            mean_data[i] = (i < MEASUREMENT_DIM) ? measurement(i) : 0.0f;
+            // The standard deviations form the diagonal of the new covariance
+            for (int j = 0; j < STATE_DIM; j++)
+                var_data[i * STATE_DIM + j] = (i == j) ? standard_deviation[i] * standard_deviation[i] : 0.0f;
+        }
         return std::make_pair(mean, var);
     }
 
@@ -398,28 +252,118 @@ class KalmanFilter
      */
     void predict(TrackerTypes::KAL_MEAN &mean, TrackerTypes::KAL_COVA &covariance)
     {
-        float mean_height = mean(3);
-        TrackerTypes::KAL_MEAN standard_deviation;
-        // Build standard deviation for the position (x, y, a, h)
-        standard_deviation(0) = m_std_weight_position * mean_height;
-        standard_deviation(1) = m_std_weight_position * mean_height;
-        standard_deviation(2) = m_std_weight_position_box * mean_height;
-        standard_deviation(3) = m_std_weight_position_box * mean_height;
-        // Build standard deviation for the velocities (vx, vy, va, vh)
-        standard_deviation(4) = m_std_weight_velocity * mean_height;
-        standard_deviation(5) = m_std_weight_velocity * mean_height;
-        standard_deviation(6) = m_std_weight_velocity_box * mean_height;
-        standard_deviation(7) = m_std_weight_velocity_box * mean_height;
-        // Square and reshape the deviations to match the covariance space
-        TrackerTypes::KAL_COVA motion_covariance = xt::diag(xt::squeeze(xt::square(standard_deviation)));
-
-        TrackerTypes::KAL_MEAN predicted_mean = mat_mul_2D(this->m_motion_matrix, xt::transpose(mean));
-        TrackerTypes::KAL_COVA predicted_covariance = mat_mul_2D(this->m_motion_matrix, mat_mul_2D(covariance, xt::transpose(m_motion_matrix)));
-        predicted_covariance += motion_covariance;  // Apply the standard deviation of motion to the covariance
-
-        // Update the input mean / covariance 
-        mean = predicted_mean;
-        covariance = predicted_covariance;
+        float *m = mean.data();
+        float *P = covariance.data();
+        float variance[STATE_DIM];
+        motion_noise(m[3], variance);
+
+        // mean = F * mean: the positions move by their velocities
+        for (int i = 0; i < MEASUREMENT_DIM; i++)
+            m[i] = m[i] + m[i + MEASUREMENT_DIM];
+
+        // covariance = F * covariance * F^T + Q, first the columns (covariance * F^T), then the rows (F * ...)
+        for (int i = 0; i < STATE_DIM; i++)
+            for (int j = 0; j < MEASUREMENT_DIM; j++)
+                P[i * STATE_DIM + j] = P[i * STATE_DIM + j] + P[i * STATE_DIM + j + MEASUREMENT_DIM];
+        for (int i = 0; i < MEASUREMENT_DIM; i++)
+            for (int j = 0; j < STATE_DIM; j++)
+                P[i * STATE_DIM + j] = P[i * STATE_DIM + j] + P[(i + MEASUREMENT_DIM) * STATE_DIM + j];
+        for (int i = 0; i < STATE_DIM; i++)
+            P[i * STATE_DIM + i] += variance[i];
+    }
+
+    /**
+     * @brief Run Kalman filter prediction step on a batch of states.
+     *        The states are gathered into a structure-of-arrays layout, so each step of the
+     *        prediction runs as one vectorizable loop across all the states, then scattered back.
+     *        Gives the same results as calling predict on each state.
+     * 
+     * @param count  -  size_t
+     *        The number of states.
+     * 
+     * @param mean_at  -  std::function<TrackerTypes::KAL_MEAN &(size_t)>
+     *        Returns the mean of the i-th state.
+     * 
+     * @param covariance_at  -  std::function<TrackerTypes::KAL_COVA &(size_t)>
+     *        Returns the covariance of the i-th state.
+     */
+    void multi_predict(size_t count,
+                       const std::function<TrackerTypes::KAL_MEAN &(size_t)> &mean_at,
+                       const std::function<TrackerTypes::KAL_COVA &(size_t)> &covariance_at)
+    {
+        if (count == 0)
+            return;
+        m_batch_mean.resize(STATE_DIM * count);
+        m_batch_covariance.resize(STATE_DIM * STATE_DIM * count);
+        float *m = m_batch_mean.data();
+        float *P = m_batch_covariance.data();
+
+        // Gather
+        for (size_t t = 0; t < count; t++)
+        {
+            const float *mean = mean_at(t).data();
+            const float *covariance = covariance_at(t).data();
+            for (int e = 0; e < STATE_DIM; e++)
+                m[e * count + t] = mean[e];
+            for (int e = 0; e < STATE_DIM * STATE_DIM; e++)
+                P[e * count + t] = covariance[e];
+        }
+
+        // covariance = F * covariance * F^T + Q, the noise depends on the height before the prediction
+        for (int i = 0; i < STATE_DIM; i++)
+        {
+            for (int j = 0; j < MEASUREMENT_DIM; j++)
+            {
+                float *dst = P + (i * STATE_DIM + j) * count;
+                const float *src = P + (i * STATE_DIM + j + MEASUREMENT_DIM) * count;
+                for (size_t t = 0; t < count; t++)
+                    dst[t] = dst[t] + src[t];
+            }
+        }
+        for (int i = 0; i < MEASUREMENT_DIM; i++)
+        {
+            for (int j = 0; j < STATE_DIM; j++)
+            {
+                float *dst = P + (i * STATE_DIM + j) * count;
+                const float *src = P + ((i + MEASUREMENT_DIM) * STATE_DIM + j) * count;
+                for (size_t t = 0; t < count; t++)
+                    dst[t] = dst[t] + src[t];
+            }
+        }
+        const float weights[STATE_DIM] = {m_std_weight_position, m_std_weight_position,
+                                          m_std_weight_position_box, m_std_weight_position_box,
+                                          m_std_weight_velocity, m_std_weight_velocity,
+                                          m_std_weight_velocity_box, m_std_weight_velocity_box};
+        const float *height = m + 3 * count;
+        for (int i = 0; i < STATE_DIM; i++)
+        {
+            float *dst = P + (i * STATE_DIM + i) * count;
+            for (size_t t = 0; t < count; t++)
+            {
+                float standard_deviation = weights[i] * height[t];
+                dst[t] += standard_deviation * standard_deviation;
+            }
+        }
+
+        // mean = F * mean
+        for (int i = 0; i < MEASUREMENT_DIM; i++)
+        {
+            float *dst = m + i * count;
+            const float *src = m + (i + MEASUREMENT_DIM) * count;
+            for (size_t t = 0; t < count; t++)
+                dst[t] = dst[t] + src[t];
+        }
+
+        // Scatter
+        for (size_t t = 0; t < count; t++)
+        {
+            float *mean = mean_at(t).data();
+            float *covariance = covariance_at(t).data();
+            for (int e = 0; e < STATE_DIM; e++)
+                mean[e] = m[e * count + t];
+            for (int e = 0; e < STATE_DIM * STATE_DIM; e++)
+                covariance[e] = P[e * count + t];
+        }
     }
 
     /**
@@ -437,19 +381,14 @@ class KalmanFilter
      */
     TrackerTypes::KAL_HDATA project(const TrackerTypes::KAL_MEAN &mean, const TrackerTypes::KAL_COVA &covariance)
     {
-        float mean_height = mean(3);
-        TrackerTypes::DETECTBOX standard_deviation;
-        // Build standard deviation for the position (x, y, a, h)
-        standard_deviation(0) = m_std_weight_position * mean_height;
-        standard_deviation(1) = m_std_weight_position * mean_height;
-        standard_deviation(2) = m_std_weight_position_box * mean_height;
-        standard_deviation(3) = m_std_weight_position_box * mean_height;
-        // Square and reshape the deviations to match the covariance space
-        TrackerTypes::KAL_HCOVA innovation_covariance = xt::diag(xt::square(xt::squeeze(standard_deviation)));
-
-        TrackerTypes::KAL_HMEAN mean1 = mat_mul_2D(this->m_update_matrix, xt::transpose(mean));
-        TrackerTypes::KAL_HCOVA covariance1 = mat_mul_2D(this->m_update_matrix, mat_mul_2D(covariance, xt::transpose(this->m_update_matrix)));
-        covariance1 += innovation_covariance;
+        float projected_mean[MEASUREMENT_DIM];
+        float projected_covariance[MEASUREMENT_DIM][MEASUREMENT_DIM];
+        project(mean.data(), covariance.data(), projected_mean, projected_covariance);
+
+        TrackerTypes::KAL_HMEAN mean1;
+        TrackerTypes::KAL_HCOVA covariance1;
+        std::copy(projected_mean, projected_mean + MEASUREMENT_DIM, mean1.data());
+        std::copy(&projected_covariance[0][0], &projected_covariance[0][0] + MEASUREMENT_DIM * MEASUREMENT_DIM, covariance1.data());
         return std::make_pair(mean1, covariance1);
     }
 
@@ -477,19 +416,79 @@ class KalmanFilter
                                   const TrackerTypes::KAL_COVA &covariance,
                                   const TrackerTypes::DETECTBOX &measurement)
     {
-        TrackerTypes::KAL_HDATA projection_results = project(mean, covariance);
-        TrackerTypes::KAL_HMEAN projected_mean = projection_results.first;
-        TrackerTypes::KAL_HCOVA projected_covariance = projection_results.second;
-
-        // Solve Ax=B using cholesky decomposition
-        xt::xtensor_fixed<float, xt::xshape<4, 8>> B = xt::transpose(mat_mul_2D(covariance, xt::transpose(this->m_update_matrix)));
-        auto cholesky_factor = cholesky_decomposition(projected_covariance);
-        xt::xtensor_fixed<float, xt::xshape<8, 4>> kalman_gain = xt::transpose(solve_linear_eq_with_cholesky(cholesky_factor, B));
-        xt::xtensor_fixed<float, xt::xshape<1, 4>> innovation = measurement - projected_mean;
-        auto tmp = mat_mul_2D(innovation, xt::transpose(kalman_gain));
-
-        TrackerTypes::KAL_MEAN new_mean = mean + tmp;
-        TrackerTypes::KAL_COVA new_covariance = covariance - mat_mul_2D(kalman_gain, mat_mul_2D(projected_covariance, xt::transpose(kalman_gain)));
+        const float *m = mean.data();
+        const float *P = covariance.data();
+        float projected_mean[MEASUREMENT_DIM];
+        float projected_covariance[MEASUREMENT_DIM][MEASUREMENT_DIM];
+        project(m, P, projected_mean, projected_covariance);
+
+        // Solve S * K^T = (P * H^T)^T for the kalman gain K using the cholesky decomposition S = LL^T:
+        // first Ly = B with forward-substitution, then L^Tx = y with back-substitution, K = x^T.
+        float cholesky_factor[MEASUREMENT_DIM][MEASUREMENT_DIM];
+        cholesky_decomposition(projected_covariance, cholesky_factor);
+        float y[MEASUREMENT_DIM][STATE_DIM];
+        float x[MEASUREMENT_DIM][STATE_DIM];
+        for (int i = 0; i < STATE_DIM; i++)
+        {
+            for (int j = 0; j < MEASUREMENT_DIM; j++)
+            {
+                float partial_sum = 0.0f;
+                for (int k = 0; k < j; k++)
+                    partial_sum += cholesky_factor[j][k] * y[k][i];
+                y[j][i] = (P[i * STATE_DIM + j] - partial_sum) / cholesky_factor[j][j];
+            }
+            for (int j = MEASUREMENT_DIM - 1; j >= 0; j--)
+            {
+                float partial_sum = 0.0f;
+                for (int k = MEASUREMENT_DIM - 1; k > j; k--)
+                    partial_sum += cholesky_factor[k][j] * x[k][i];
+                x[j][i] = (y[j][i] - partial_sum) / cholesky_factor[j][j];
+            }
+        }
+        float kalman_gain[STATE_DIM][MEASUREMENT_DIM];
+        for (int i = 0; i < STATE_DIM; i++)
+            for (int j = 0; j < MEASUREMENT_DIM; j++)
+                kalman_gain[i][j] = x[j][i];
+
+        float innovation[MEASUREMENT_DIM];
+        for (int k = 0; k < MEASUREMENT_DIM; k++)
+            innovation[k] = measurement(k) - projected_mean[k];
+
+        // new_mean = mean + innovation * K^T
+        TrackerTypes::KAL_MEAN new_mean;
+        float *new_m = new_mean.data();
+        for (int i = 0; i < STATE_DIM; i++)
+        {
+            float row_sum = 0.0f;
+            for (int k = 0; k < MEASUREMENT_DIM; k++)
+                row_sum += innovation[k] * kalman_gain[i][k];
+            new_m[i] = m[i] + row_sum;
+        }
+
+        // new_covariance = covariance - K * (S * K^T)
+        float gain_covariance[MEASUREMENT_DIM][STATE_DIM];
+        for (int i = 0; i < MEASUREMENT_DIM; i++)
+        {
+            for (int j = 0; j < STATE_DIM; j++)
+            {
+                float row_sum = 0.0f;
+                for (int k = 0; k < MEASUREMENT_DIM; k++)
+                    row_sum += projected_covariance[i][k] * kalman_gain[j][k];
+                gain_covariance[i][j] = row_sum;
+            }
+        }
+        TrackerTypes::KAL_COVA new_covariance;
+        float *new_P = new_covariance.data();
+        for (int i = 0; i < STATE_DIM; i++)
+        {
+            for (int j = 0; j < STATE_DIM; j++)
+            {
+                float row_sum = 0.0f;
+                for (int k = 0; k < MEASUREMENT_DIM; k++)
+                    row_sum += kalman_gain[i][k] * gain_covariance[k][j];
+                new_P[i * STATE_DIM + j] = P[i * STATE_DIM + j] - row_sum;
+            }
+        }
         return std::make_pair(new_mean, new_covariance);
     }
 
@@ -517,22 +516,46 @@ class KalmanFilter
                                       const TrackerTypes::KAL_COVA &covariance,
                                       const std::vector<TrackerTypes::DETECTBOX> &measurements)
     {
-        TrackerTypes::KAL_HDATA projection_results = project(mean, covariance);
-        TrackerTypes::KAL_HMEAN mean1 = projection_results.first;
-        TrackerTypes::KAL_HCOVA covariance1 = projection_results.second;
-        
-        // DETECTBOXSS differs from DETECTBOX in that DETECTBOXSS is Nx4 instead of 1x4
-        TrackerTypes::DETECTBOXSS d = xt::zeros<float>({(int)measurements.size(), 4});
-        for (uint i = 0; i < measurements.size(); ++i)
+        xt::xarray<float>::shape_type shape = {measurements.size()};
+        xt::xarray<float> square_mahalanobis(shape);
+        gating_distance(mean, covariance, measurements, square_mahalanobis.data());
+        return square_mahalanobis;
+    }
+
+    /**
+     * @brief Compute gating distance between state distribution and measurements
+     *        into a caller provided buffer (see the overload above).
+     * 
+     * @param square_mahalanobis  -  float *
+     *        Output, an array of length N to fill with the squared Mahalanobis distances.
+     */
+    void gating_distance(const TrackerTypes::KAL_MEAN &mean,
+                         const TrackerTypes::KAL_COVA &covariance,
+                         const std::vector<TrackerTypes::DETECTBOX> &measurements,
+                         float *square_mahalanobis)
+    {
+        float mean1[MEASUREMENT_DIM];
+        float covariance1[MEASUREMENT_DIM][MEASUREMENT_DIM];
+        project(mean.data(), covariance.data(), mean1, covariance1);
+
+        // Extract lower triangular matrix from cholesky decomposition
+        float cholesky_factor[MEASUREMENT_DIM][MEASUREMENT_DIM];
+        cholesky_decomposition(covariance1, cholesky_factor);
+        for (size_t n = 0; n < measurements.size(); n++)
         {
-            xt::row(d, i) = xt::squeeze(measurements[i] - mean1);
+            // Solve Lz = d with forward-substitution, the distance is the squared norm of z
+            float z[MEASUREMENT_DIM];
+            float distance = 0.0f;
+            for (int j = 0; j < MEASUREMENT_DIM; j++)
+            {
+                float partial_sum = 0.0f;
+                for (int k = 0; k < j; k++)
+                    partial_sum += cholesky_factor[j][k] * z[k];
+                z[j] = ((measurements[n](j) - mean1[j]) - partial_sum) / cholesky_factor[j][j];
+                distance += z[j] * z[j];
+            }
+            square_mahalanobis[n] = distance;
         }
-        // Extract lower triangular matrix from cholesky decomposition
-        xt::xarray<float, xt::layout_type::row_major> cholesky_factor = cholesky_decomposition(covariance1);
-        xt::xarray<float, xt::layout_type::row_major> z = xt::transpose(forward_substitution(cholesky_factor, xt::transpose(d)));
-        auto zz = z * z;  // Element-wise multiplication
-        xt::xarray<float> square_mahalanobis = xt::sum(zz, {1});
-        return square_mahalanobis;
     }
 };
 __END_DECLS
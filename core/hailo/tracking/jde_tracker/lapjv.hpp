@@ -6,6 +6,7 @@
     Linear Assignment Problem solver using Jonker-Volgenant algorithm.
     The linear assignment problem is the bijection between two sets with equal cardinality 
     which optimizes the sum of the individual mapping costs taken from the fixed cost matrix.
+    The n x n cost matrix is given as one contiguous row-major buffer: cost[i * n + j].
     For more information on lapjv, see https://github.com/samylee/Towards-Realtime-MOT-Cpp
 */
 
@@ -35,13 +36,13 @@ typedef double cost_t;
 typedef char boolean;
 typedef enum fp_t { FP_1 = 1, FP_2 = 2, FP_DYNAMIC = 3 } fp_t;
 
-extern int_t lapjv_internal(const uint_t n, cost_t *cost[], int_t *x, int_t *y);
+extern int_t lapjv_internal(const uint_t n, const cost_t *cost, int_t *x, int_t *y);
 
 
 /*
     Column-reduction and reduction transfer for a dense cost matrix.
 */
-inline int_t _ccrrt_dense(const uint_t n, cost_t *cost[],
+inline int_t _ccrrt_dense(const uint_t n, const cost_t *cost,
 	int_t *free_rows, int_t *x, int_t *y, cost_t *v)
 {
 	int_t n_free_rows;
@@ -54,7 +55,7 @@ inline int_t _ccrrt_dense(const uint_t n, cost_t *cost[],
 	}
 	for (uint_t i = 0; i < n; i++) {
 		for (uint_t j = 0; j < n; j++) {
-			const cost_t c = cost[i][j];
+			const cost_t c = cost[i * n + j];
 			if (c < v[j]) {
 				v[j] = c;
 				y[j] = i;
@@ -89,7 +90,7 @@ inline int_t _ccrrt_dense(const uint_t n, cost_t *cost[],
 				if (j2 == (uint_t)j) {
 					continue;
 				}
-				const cost_t c = cost[i][j2] - v[j2];
+				const cost_t c = cost[i * n + j2] - v[j2];
 				if (c < min) {
 					min = c;
 				}
@@ -104,7 +105,7 @@ inline int_t _ccrrt_dense(const uint_t n, cost_t *cost[],
 /*
     Augmenting row reduction for a dense cost matrix.
 */
-inline int_t _carr_dense(const uint_t n, cost_t *cost[],
+inline int_t _carr_dense(const uint_t n, const cost_t *cost,
 	                     const uint_t n_free_rows,
 	                     int_t *free_rows, int_t *x, int_t *y, cost_t *v)
 {
@@ -120,11 +121,11 @@ inline int_t _carr_dense(const uint_t n, cost_t *cost[],
 		rr_cnt++;
 		const int_t free_i = free_rows[current++];
 		j1 = 0;
-		v1 = cost[free_i][0] - v[0];
+		v1 = cost[free_i * n] - v[0];
 		j2 = -1;
 		v2 = LARGE;
 		for (uint_t j = 1; j < n; j++) {
-			const cost_t c = cost[free_i][j] - v[j];
+			const cost_t c = cost[free_i * n + j] - v[j];
 			if (c < v2) {
 				if (c >= v1) {
 					v2 = c;
@@ -194,7 +195,7 @@ inline uint_t _find_dense(const uint_t n, uint_t lo, cost_t *d, int_t *cols, int
     Scan all columns starting from arbitrary column in SCAN
     and try to decrease d of the columns using the SCAN column.
 */
-inline int_t _scan_dense(const uint_t n, cost_t *cost[],
+inline int_t _scan_dense(const uint_t n, const cost_t *cost,
                          uint_t *plo, uint_t*phi,
                          cost_t *d, int_t *cols, int_t *pred,
                          int_t *y, cost_t *v)
@@ -207,10 +208,10 @@ inline int_t _scan_dense(const uint_t n, cost_t *cost[],
 		int_t j = cols[lo++];
 		const int_t i = y[j];
 		const cost_t mind = d[j];
-		h = cost[i][j] - v[j] - mind;
+		h = cost[i * n + j] - v[j] - mind;
 		for (uint_t k = hi; k < n; k++) {
 			j = cols[k];
-			cred_ij = cost[i][j] - v[j] - h;
+			cred_ij = cost[i * n + j] - v[j] - h;
 			if (cred_ij < d[j]) {
 				d[j] = cred_ij;
 				pred[j] = i;
@@ -234,7 +235,7 @@ inline int_t _scan_dense(const uint_t n, cost_t *cost[],
     This is a dense matrix version.
     return The closest free column index.
 */
-inline int_t find_path_dense(const uint_t n, cost_t *cost[],
+inline int_t find_path_dense(const uint_t n, const cost_t *cost,
                              const int_t start_i,
                              int_t *y, cost_t *v,
                              int_t *pred)
@@ -251,7 +252,7 @@ inline int_t find_path_dense(const uint_t n, cost_t *cost[],
 	for (uint_t i = 0; i < n; i++) {
 		cols[i] = i;
 		pred[i] = start_i;
-		d[i] = cost[start_i][i] - v[i];
+		d[i] = cost[start_i * n + i] - v[i];
 	}
 	while (final_j == -1) {
 		// No columns left on the SCAN list.
@@ -288,7 +289,7 @@ inline int_t find_path_dense(const uint_t n, cost_t *cost[],
 /*
     Augment for a dense cost matrix.
 */
-inline int_t _ca_dense(const uint_t n, cost_t *cost[],
+inline int_t _ca_dense(const uint_t n, const cost_t *cost,
                        const uint_t n_free_rows,
                        int_t *free_rows, int_t *x, int_t *y, cost_t *v)
 {
@@ -320,7 +321,7 @@ inline int_t _ca_dense(const uint_t n, cost_t *cost[],
 /*
     Solve dense sparse LAP.
 */
-inline int lapjv_internal(const uint_t n, cost_t *cost[],
+inline int lapjv_internal(const uint_t n, const cost_t *cost,
 	                      int_t *x, int_t *y)
 {
 	int ret;
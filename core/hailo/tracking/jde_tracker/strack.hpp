@@ -12,6 +12,7 @@
 
 // General cpp includes
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <iostream>
 #include <string>
@@ -277,10 +278,15 @@ public:
      */
     int next_id()
     {
-        static int _count = 0;
-        _count++;
-        _count = _count % 100000; // Cycle ids after 100000
-        return _count;
+        // Shared by all the trackers, which may be updated from several threads at once
+        static std::atomic<int> _count{0};
+        int count = _count.load(std::memory_order_relaxed);
+        int next;
+        do
+        {
+            next = (count + 1) % 100000; // Cycle ids after 100000
+        } while (!_count.compare_exchange_weak(count, next, std::memory_order_relaxed));
+        return next;
     }
 
     /**
@@ -311,8 +317,10 @@ public:
             {
                 stracks[i]->m_mean(7) = 0;
             }
-            kalman_filter.predict(stracks[i]->m_mean, stracks[i]->m_covariance);
         }
+        kalman_filter.multi_predict(stracks.size(),
+                                    [&stracks](size_t i) -> TrackerTypes::KAL_MEAN & { return stracks[i]->m_mean; },
+                                    [&stracks](size_t i) -> TrackerTypes::KAL_COVA & { return stracks[i]->m_covariance; });
     }
 
     /**
@@ -0,0 +1,120 @@
+import argparse
+import csv
+import struct
+import sys
+
+# Must match core/hailo/tracers/gsttracebuffer.hpp
+MAGIC = 0x43525448
+VERSION = 1
+HEADER = struct.Struct('<IHHQ')
+RECORD = struct.Struct('<QHHIIIQQQQ')
+NAME_EVENT_ID = 0xFFFF
+DROPPED_EVENT_ID = 0xFFFE
+
+# The event_id enum of core/hailo/tracers/gstctf.hpp
+PROCTIME_EVENT_ID = 2
+INTERLATENCY_EVENT_ID = 3
+FPS_EVENT_ID = 4
+SCHED_TIME_EVENT_ID = 5
+QUEUE_LEVEL_EVENT_ID = 6
+
+CSV_COLUMNS = ['time', 'thread', 'event', 'name', 'to', 'value',
+               'max_bytes', 'buffers', 'max_buffers', 'queue_time', 'max_time']
+
+
+def read_records(path):
+    """Yield (timestamp relative to the start of the trace, thread, event, names, values), resolving the names."""
+    names = {}
+    with open(path, 'rb') as trace:
+        magic, version, record_size, start_time = HEADER.unpack(trace.read(HEADER.size))
+        if magic != MAGIC:
+            raise ValueError(f'{path} is not a binary hailo trace')
+        if version != VERSION or record_size != RECORD.size:
+            raise ValueError(f'{path} has version {version} and records of {record_size} bytes, '
+                             f'expected version {VERSION} and {RECORD.size} bytes')
+
+        while True:
+            data = trace.read(RECORD.size)
+            if len(data) < RECORD.size:
+                break
+            timestamp, event, thread, name0, name1, _, *values = RECORD.unpack(data)
+            if event == NAME_EVENT_ID:
+                names[name0] = trace.read(values[0]).decode('utf-8', errors='replace')
+                continue
+            yield (timestamp - start_time, thread, event,
+                   (names.get(name0, 'unknown'), names.get(name1, 'unknown')), values)
+
+
+def decode(timestamp, thread, event, names, values):
+    """Return the fields of a record as a CSV_COLUMNS dict, None for an unknown event."""
+    row = {'time': timestamp, 'thread': thread}
+    if event == INTERLATENCY_EVENT_ID:
+        row.update(event='interlatency', name=names[0], to=names[1], value=values[0])
+    elif event == PROCTIME_EVENT_ID:
+        row.update(event='proctime', name=names[0], value=values[0])
+    elif event == SCHED_TIME_EVENT_ID:
+        row.update(event='scheduletime', name=names[0], value=values[0])
+    elif event == FPS_EVENT_ID:
+        row.update(event='framerate', name=names[0], value=values[0])
+    elif event == QUEUE_LEVEL_EVENT_ID:
+        row.update(event='queuelevel', name=names[0], value=values[0] & 0xFFFFFFFF, max_bytes=values[0] >> 32,
+                   buffers=values[1] & 0xFFFFFFFF, max_buffers=values[1] >> 32,
+                   queue_time=values[2], max_time=values[3])
+    elif event == DROPPED_EVENT_ID:
+        row.update(event='dropped', value=values[0])
+    else:
+        return None
+    return row
+
+
+def format_text(row):
+    line = f"{row['time'] / 1e9:.9f} thread {row['thread']} {row['event']}"
+    event = row['event']
+    if event == 'interlatency':
+        return f"{line} from_pad={row['name']} to_pad={row['to']} time={row['value']}"
+    if event == 'framerate':
+        return f"{line} pad={row['name']} fps={row['value']}"
+    if event == 'queuelevel':
+        return (f"{line} queue={row['name']} size_bytes={row['value']} max_size_bytes={row['max_bytes']} "
+                f"size_buffers={row['buffers']} max_size_buffers={row['max_buffers']} "
+                f"size_time={row['queue_time']} max_size_time={row['max_time']}")
+    if event == 'dropped':
+        return f"{line} records={row['value']}"
+    key = 'element' if event == 'proctime' else 'pad'
+    return f"{line} {key}={row['name']} time={row['value']}"
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode the binary trace written by the hailo tracers '
+                                     'with HAILO_TRACE_FORMAT=binary (hailotrace.bin). Times are in nanoseconds.')
+    parser.add_argument('trace', help='Path of hailotrace.bin')
+    parser.add_argument('--csv', action='store_true', help='Write CSV instead of text')
+    parser.add_argument('-o', '--output', help='Output file, stdout by default')
+    args = parser.parse_args()
+
+    output = open(args.output, 'w', newline='') if args.output else sys.stdout
+    writer = None
+    if args.csv:
+        writer = csv.DictWriter(output, fieldnames=CSV_COLUMNS)
+        writer.writeheader()
+
+    dropped = 0
+    for record in read_records(args.trace):
+        row = decode(*record)
+        if row is None:
+            continue
+        if row['event'] == 'dropped':
+            dropped += row['value']
+        if writer:
+            writer.writerow(row)
+        else:
+            output.write(format_text(row) + '\n')
+
+    if dropped:
+        print(f'Warning: {dropped} records were dropped while tracing, the trace is incomplete', file=sys.stderr)
+    if args.output:
+        output.close()
+
+
+if __name__ == '__main__':
+    main()